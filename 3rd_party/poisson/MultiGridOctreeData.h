@@ -891,16 +891,6 @@ public:
 	template< class Data >
 	int init( OrientedPointStream< Real >& pointStream , LocalDepth maxDepth , bool useConfidence , std::vector< PointSample >& samples , std::vector< ProjectiveData< Data , Real > >* sampleData );
 
-	template< class Data >
-	int init(
-		std::size_t num,
-		const float* pts,
-		const float* nms,
-		const float* cls,
-		const XForm4x4< Real >& xForm,
-		LocalDepth maxDepth, bool useConfidence, std::vector< PointSample >& samples, std::vector< ProjectiveData< Data, Real > >* sampleData
-	);
-
 	template< int DensityDegree >
 	typename Octree::template DensityEstimator< DensityDegree >* setDensityEstimator( const std::vector< PointSample >& samples , LocalDepth splatDepth , Real samplesPerNode );
 	template< int NormalDegree , int DensityDegree >
@@ -998,5 +988,4 @@ template< class Real > void Reset( void ){ Octree< Real >::ResetNodeCount(); }
 #include "MultiGridOctreeData.System.inl"
 #include "MultiGridOctreeData.IsoSurface.inl"
 #include "MultiGridOctreeData.Evaluation.inl"
-#include "MyTreeInit.inl"
 #endif // MULTI_GRID_OCTREE_DATA_INCLUDED
@@ -31,6 +31,42 @@ namespace MiscLib
 	{
 		return (float)rn_rand() / MiscLib_RN_RAND_MOD;
 	}
+
+	/*
+	 * Counter based random stream (SplitMix64). A stream is completely
+	 * determined by its seed and key and does not share any state, so
+	 * streams can be used concurrently and reproduce the same numbers
+	 * regardless of the thread they run on.
+	 */
+	class RandomStream
+	{
+	public:
+		RandomStream(unsigned long long seed, unsigned long long key)
+		: m_state(Mix(seed + 0x9E3779B97F4A7C15ULL) ^ Mix(key))
+		{}
+		size_t operator()()
+		{
+			return (size_t)(Mix(m_state += 0x9E3779B97F4A7C15ULL) >> 1);
+		}
+		size_t urand(size_t m)
+		{
+			return (*this)() % m;
+		}
+		double drand()
+		{
+			return (double)(Mix(m_state += 0x9E3779B97F4A7C15ULL) >> 11)
+				* (1.0 / 9007199254740992.0);
+		}
+	private:
+		static unsigned long long Mix(unsigned long long z)
+		{
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		}
+	private:
+		unsigned long long m_state;
+	};
 };
 
 #endif
@@ -13,9 +13,6 @@
 #include "Octree.h"
 #include "ScorePrimitiveShapeVisitor.h"
 #include "FlatNormalThreshPointCompatibilityFunc.h"
-#ifdef DOPARALLEL
-#include <omp.h>
-#endif
 #undef max
 #undef min
 
@@ -93,25 +90,32 @@ void RansacShapeDetector::GenerateCandidates(
 	const PointCloud &pc, ScoreVisitorT &scoreVisitor,
 	size_t currentSize, size_t numInvalid,
 	const MiscLib::Vector< double > &sampleLevelProbSum,
+	size_t round,
 	size_t *drawnCandidates,
 	MiscLib::Vector< std::pair< float, size_t > > *sampleLevelScores,
 	float *bestExpectedValue,
 	CandidatesType *candidates) const
 {
-	size_t genCands = 0;
-
-#ifdef DOPARALLEL
+	// Every draw uses its own random stream and the candidates are merged in
+	// the order of the draws afterwards, so the result does not depend on the
+	// number of threads nor on their scheduling.
+	const int numDraws = 200;
+	MiscLib::Vector< MiscLib::Vector< Candidate > > drawn(numDraws);
+	MiscLib::Vector< char > sampled(numDraws, 0);
+
+#ifdef _OPENMP
 	#pragma omp parallel
 #endif
 	{
 	ScoreVisitorT scoreVisitorCopy(scoreVisitor);
-#ifdef DOPARALLEL
-	#pragma omp for schedule(dynamic, 10) reduction(+:genCands)
+#ifdef _OPENMP
+	#pragma omp for schedule(dynamic, 4)
 #endif
-	for(int candIter = 0; candIter < 200; ++candIter)
+	for(int candIter = 0; candIter < numDraws; ++candIter)
 	{
+		MiscLib::RandomStream rng(m_options.m_seed, round * numDraws + candIter);
 		// pick a sample level
-		double s = ((double)rand()) / (double)RAND_MAX;
+		double s = rng.drand();
 		size_t sampleLevel = 0;
 		for(; sampleLevel < sampleLevelProbSum.size() - 1; ++sampleLevel)
 			if(sampleLevelProbSum[sampleLevel] >= s)
@@ -120,9 +124,9 @@ void RansacShapeDetector::GenerateCandidates(
 		MiscLib::Vector< size_t > samples;
 		const IndexedOctreeType::CellType *node;
 		if(!DrawSamplesStratified(globalOctree, m_reqSamples, sampleLevel,
-			scoreVisitorCopy.GetShapeIndex(), &samples, &node))
+			scoreVisitorCopy.GetShapeIndex(), rng, &samples, &node))
 			continue;
-		++genCands;
+		sampled[candIter] = 1;
 		// construct the candidates
 		size_t c = samples.size();
 		MiscLib::Vector< Vec3f > samplePoints(samples.size() << 1);
@@ -162,31 +166,27 @@ void RansacShapeDetector::GenerateCandidates(
 			shape->Release();
 			cand.ImproveBounds(octrees, pc, scoreVisitorCopy,
 				currentSize, m_options.m_bitmapEpsilon, 1);
+			drawn[candIter].push_back(cand);
+		}
+	}
+	}
+
+	size_t genCands = 0;
+	for(int candIter = 0; candIter < numDraws; ++candIter)
+	{
+		genCands += sampled[candIter];
+		for(size_t i = 0; i < drawn[candIter].size(); ++i)
+		{
+			const Candidate &cand = drawn[candIter][i];
+			(*sampleLevelScores)[cand.Level()].first += cand.ExpectedValue();
+			++(*sampleLevelScores)[cand.Level()].second;
 			if(cand.UpperBound() < m_options.m_minSupport)
-			{
-#ifdef DOPARALLEL
-				#pragma omp critical
-#endif
-				{
-				(*sampleLevelScores)[node->Level()].first += cand.ExpectedValue();
-				++(*sampleLevelScores)[node->Level()].second;
-				}
 				continue;
-			}
-
-#ifdef DOPARALLEL
-			#pragma omp critical
-#endif
-			{
-				(*sampleLevelScores)[node->Level()].first += cand.ExpectedValue();
-				++(*sampleLevelScores)[node->Level()].second;
-				candidates->push_back(cand);
-				if(cand.ExpectedValue() > *bestExpectedValue)
-					*bestExpectedValue = cand.ExpectedValue();
-			}
+			candidates->push_back(cand);
+			if(cand.ExpectedValue() > *bestExpectedValue)
+				*bestExpectedValue = cand.ExpectedValue();
 		}
 	}
-	}
 	*drawnCandidates += genCands;
 }
 
@@ -460,8 +460,10 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 	/*
 	 * Initialization part
 	 */
-	srand((unsigned int)time(NULL));
-	rn_setseed((size_t)time(NULL));
+	// all random decisions derive from the seed, so repeated detections
+	// with the same options give identical results
+	rn_setseed(m_options.m_seed);
+	MiscLib::RandomStream subsetRng(m_options.m_seed, (unsigned long long)-1);
 
 	CandidatesType candidates;
 
@@ -479,6 +481,7 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 
 	// construct stratified subsets
 	MiscLib::Vector< ImmediateOctreeType * > octrees(subsets);
+	MiscLib::Vector< std::pair< size_t, size_t > > subsetRanges(subsets);
 	for(size_t i = octrees.size(); i;)
 	{
 		--i;
@@ -490,7 +493,7 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 			size_t bucketSize = pcSize / subsetSize;
 			for(size_t j = 0; j < subsetSize; ++j)
 			{
-				size_t index = rn_rand() % bucketSize;
+				size_t index = subsetRng.urand(bucketSize);
 				index += j * bucketSize;
 				if(index >= pcSize)
 					index = pcSize - 1;
@@ -502,14 +505,23 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 			for(size_t j = pcSize - 1, i = 0; i < subsetIndices.size(); --j, ++i)
 				std::swap(pc[j + beginIdx], pc[subsetIndices[i]]);
 		}
+		subsetRanges[i] = std::make_pair(pcSize - subsetSize + beginIdx,
+			pcSize + beginIdx);
+		pcSize -= subsetSize;
+	}
+	// the subsets occupy disjoint ranges of the point cloud, so their octrees
+	// can be built concurrently
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for(int i = 0; i < static_cast<int>(octrees.size()); ++i)
+	{
 		octrees[i] = new ImmediateOctreeType;
 		octrees[i]->ContainedData(&pc);
-		octrees[i]->DataRange(pcSize - subsetSize + beginIdx,
-			pcSize + beginIdx);
+		octrees[i]->DataRange(subsetRanges[i].first, subsetRanges[i].second);
 		octrees[i]->MaxBucketSize() = 20;
 		octrees[i]->MaxSubdivisionLevel() = 10;
 		octrees[i]->Build(bcube);
-		pcSize -= subsetSize;
 	}
 
 	pcSize = endIdx - beginIdx;
@@ -545,6 +557,25 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 	subsetScoreVisitor.SetShapeIndex(shapeIndex);
 	globalScoreVisitor.SetShapeIndex(shapeIndex);
 	size_t currentSize = pcSize;
+	size_t round = 0; // number of candidate generation rounds (keys the random streams)
+	bool canceled = false;
+	float progress = 0;
+	// reports the progress and returns false if the detection should be canceled
+	auto reportProgress = [&]() -> bool
+	{
+		if(!m_progressCallback)
+			return true;
+		// the detection stops when either all points have been assigned or no
+		// more shapes of the minimal size are likely to be found
+		float remaining = float(currentSize - numInvalid);
+		float assigned = 1.f - remaining / pcSize;
+		float failProb = CandidateFailureProbability(m_options.m_minSupport,
+			remaining, drawnCandidates, globalOctTreeMaxNodeDepth);
+		float converged = std::log(std::max(failProb, 1e-30f))
+			/ std::log(m_options.m_probability);
+		progress = std::max(progress, std::min(1.f, std::max(assigned, converged)));
+		return m_progressCallback(progress);
+	};
 	do
 	{
 		MiscLib::Vector< std::pair< float, size_t > > sampleLevelScores(
@@ -568,10 +599,16 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 				octrees, pc, subsetScoreVisitor,
 				currentSize, numInvalid,
 				sampleLevelProbSum,
+				round++,
 				&drawnCandidates,
 				&sampleLevelScores,
 				&bestExpectedValue,
 				&candidates);
+			if(!reportProgress())
+			{
+				canceled = true;
+				break;
+			}
 		}
 		while(CandidateFailureProbability(bestExpectedValue,
 				currentSize - numInvalid, drawnCandidates,
@@ -579,6 +616,8 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 			&& CandidateFailureProbability(m_options.m_minSupport,
 				currentSize - numInvalid, drawnCandidates,
 				globalOctTreeMaxNodeDepth) > m_options.m_probability);
+		if(canceled)
+			break;
 		// find the best candidate:
 		float bestCandidateFailureProbability;
 		float failureProbability = std::numeric_limits< float >::infinity();
@@ -718,18 +757,16 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 
 				// reindex global octree
 				size_t minInvalidIndex = currentSize - numInvalid + beginIdx;
+				// a sequential compaction (each write depends on all previous reads)
 				int j = 0;
-#ifdef DOPARALLEL
-				#pragma omp parallel for schedule(static)
-#endif
 				for(int i = 0; i < static_cast<int>(globalOctreeIndices.size()); ++i)
 					if(shapeIndex[globalOctreeIndices[i]] < minInvalidIndex)
 						globalOctreeIndices[j++] = shapeIndex[globalOctreeIndices[i]];
 				globalOctreeIndices.resize(currentSize - numInvalid);
 
 				// reindex candidates (this also recomputes the bounds)
-#ifdef DOPARALLEL
-				#pragma omp parallel for schedule(static)
+#ifdef _OPENMP
+				#pragma omp parallel for schedule(dynamic, 16)
 #endif
 				for(int i = 0; i < static_cast<int>(candidates.size()); ++i)
 					candidates[i].Reindex(shapeIndex, minInvalidIndex, mergedSubsets,
@@ -766,34 +803,35 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 					for(size_t i = 0; i < shuffleIndices.size(); ++i)
 						reindex[shuffleIndices[i]] = i;
 					// reindex global octree
-#ifdef DOPARALLEL
+#ifdef _OPENMP
 					#pragma omp parallel for schedule(static)
 #endif
 					for(int i = 0; i < static_cast<int>(globalOctreeIndices.size()); ++i)
 						if(globalOctreeIndices[i] < reindex.size())
 							globalOctreeIndices[i] = reindex[globalOctreeIndices[i]];
 					// reindex candidates
-#ifdef DOPARALLEL
+#ifdef _OPENMP
 					#pragma omp parallel for schedule(static, 100)
 #endif
 					for(int i = 0; i < static_cast<int>(candidates.size()); ++i)
 						candidates[i].Reindex(reindex);
-					for(size_t i = 1, begin = subsetSizes[0] + beginIdx;
-						i < octrees.size(); begin += subsetSizes[i], ++i)
-					{
-						octrees[i]->DataRange(begin, begin + subsetSizes[i]);
-						octrees[i]->Rebuild();
-						if(octrees[i]->Root()->Size() != subsetSizes[i])
-							std::cout << "ERROR IN REBUILD!!!!" << std::endl;
-					}
 				}
-				else
-					for(size_t i = 0, begin = beginIdx; i < octrees.size();
-						begin += subsetSizes[i], ++i)
-					{
-						octrees[i]->DataRange(begin, begin + subsetSizes[i]);
-						octrees[i]->Rebuild();
-					}
+				// the subsets occupy disjoint ranges, so their octrees can be
+				// rebuilt concurrently
+				MiscLib::Vector< size_t > subsetBegins(octrees.size());
+				for(size_t i = 0, begin = beginIdx; i < octrees.size();
+					begin += subsetSizes[i], ++i)
+					subsetBegins[i] = begin;
+#ifdef _OPENMP
+				#pragma omp parallel for schedule(dynamic, 1)
+#endif
+				for(int i = mergedSubsets? 1 : 0; i < static_cast<int>(octrees.size()); ++i)
+				{
+					octrees[i]->DataRange(subsetBegins[i], subsetBegins[i] + subsetSizes[i]);
+					octrees[i]->Rebuild();
+					if(mergedSubsets && octrees[i]->Root()->Size() != subsetSizes[i])
+						std::cout << "ERROR IN REBUILD!!!!" << std::endl;
+				}
 
 				//so everything is in its correct place, but we need to update the global octree ranges
 				currentSize = globalOctreeIndices.size();
@@ -814,8 +852,8 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 			{
 				// the bounds of the candidates have become invalid and have to be
 				// recomputed
-#ifdef DOPARALLEL
-				#pragma omp parallel for schedule(static, 100)
+#ifdef _OPENMP
+				#pragma omp parallel for schedule(dynamic, 16)
 #endif
 				for(int i = 0; i < static_cast<int>(candidates.size()); ++i)
 					candidates[i].RecomputeBounds(octrees, pc, subsetScoreVisitor,
@@ -830,6 +868,11 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 					&& candidates[i].Size() > 0)
 					candidates[remainingCandidates++] = candidates[i];
 			candidates.resize(remainingCandidates);
+			if(!reportProgress())
+			{
+				canceled = true;
+				break;
+			}
 		} // Ende abgrasen
 		if(foundCandidate)
 		{
@@ -855,7 +898,8 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 	}
 	while(CandidateFailureProbability(m_options.m_minSupport, currentSize - numInvalid,
 		drawnCandidates, globalOctTreeMaxNodeDepth) > m_options.m_probability
-		&& (currentSize - numInvalid) >= m_options.m_minSupport);
+		&& (currentSize - numInvalid) >= m_options.m_minSupport
+		&& !canceled);
 
 	if(numInvalid)
 	{
@@ -909,6 +953,7 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 bool RansacShapeDetector::DrawSamplesStratified(const IndexedOctreeType &oct,
 	size_t numSamples, size_t depth,
 	const MiscLib::Vector< int > &shapeIndex,
+	MiscLib::RandomStream &rng,
 	MiscLib::Vector< size_t > *samples,
 	const IndexedOctreeType::CellType **node) const
 {
@@ -919,7 +964,7 @@ bool RansacShapeDetector::DrawSamplesStratified(const IndexedOctreeType &oct,
 		size_t first;
 		do
 		{
-			first = oct.Dereference(rn_rand() % oct.size());
+			first = oct.Dereference(rng.urand(oct.size()));
 		}
 		while(shapeIndex[first] != -1);
 		samples->push_back(first);
@@ -936,7 +981,7 @@ bool RansacShapeDetector::DrawSamplesStratified(const IndexedOctreeType &oct,
 			size_t i, iter = 0;
 			do
 			{
-				i = oct.Dereference(rn_rand() % (*node)->Size()
+				i = oct.Dereference(rng.urand((*node)->Size())
 					+ nodeRange.first);
 			}
 			while( ( shapeIndex[i] != -1
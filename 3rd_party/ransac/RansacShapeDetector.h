@@ -4,7 +4,9 @@
 #include "PrimitiveShapeConstructor.h"
 #include <MiscLib/Vector.h>
 #include <MiscLib/NoShrinkVector.h>
+#include <MiscLib/Random.h>
 #include <utility>
+#include <functional>
 #include "Candidate.h"
 #include <MiscLib/RefCountPtr.h>
 #include "Octree.h"
@@ -27,6 +29,7 @@ class DLL_LINKAGE RansacShapeDetector
 			, m_bitmapEpsilon(0.01f)
 			, m_fitting(LS_FITTING)
 			, m_probability(0.001f)
+			, m_seed(0)
 			{}
 			float m_epsilon;
 			float m_normalThresh;
@@ -34,7 +37,11 @@ class DLL_LINKAGE RansacShapeDetector
 			float m_bitmapEpsilon;
 			enum { NO_FITTING, LS_FITTING } m_fitting;
 			float m_probability;
+			unsigned int m_seed; // detections with the same seed are identical
 		};
+		// Receives the progress in [0, 1]. Returning false cancels the
+		// detection; the shapes found so far are still returned.
+		typedef std::function< bool (float) > ProgressCallback;
 		RansacShapeDetector();
 		RansacShapeDetector(const Options &options);
 		virtual ~RansacShapeDetector();
@@ -44,6 +51,7 @@ class DLL_LINKAGE RansacShapeDetector
 		void AutoAcceptSize(size_t s) { m_autoAcceptSize = s; }
 		size_t AutoAcceptSize() const { return m_autoAcceptSize; }
 		const Options &GetOptions() const { return m_options; }
+		void SetProgressCallback(const ProgressCallback &callback) { m_progressCallback = callback; }
 
 	private:
 		typedef MiscLib::Vector< PrimitiveShapeConstructor * > ConstructorsType;
@@ -51,6 +59,7 @@ class DLL_LINKAGE RansacShapeDetector
 		bool DrawSamplesStratified(const IndexedOctreeType &oct,
 			size_t numSamples, size_t depth,
 			const MiscLib::Vector< int > &shapeIndex,
+			MiscLib::RandomStream &rng,
 			MiscLib::Vector< size_t > *samples,
 			const IndexedOctreeType::CellType **node) const;
 		PrimitiveShape *Fit(bool allowDifferentShapes,
@@ -80,6 +89,7 @@ class DLL_LINKAGE RansacShapeDetector
 			const PointCloud &pc, ScoreVisitorT &scoreVisitor,
 			size_t currentSize, size_t numInvalid,
 			const MiscLib::Vector< double > &sampleLevelProbSum,
+			size_t round,
 			size_t *drawnCandidates,
 			MiscLib::Vector< std::pair< float, size_t > > *sampleLevelScores,
 			float *bestExpectedValue,
@@ -101,6 +111,7 @@ class DLL_LINKAGE RansacShapeDetector
 		size_t m_maxCandTries;
 		size_t m_reqSamples;
 		size_t m_autoAcceptSize;
+		ProgressCallback m_progressCallback;
 };
 
 #endif
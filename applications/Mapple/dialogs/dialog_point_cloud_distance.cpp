@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dialogs/dialog_point_cloud_distance.h"
+
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/core/surface_mesh.h>
+#include <easy3d/algo/point_cloud_distance.h>
+#include <easy3d/renderer/renderer.h>
+#include <easy3d/renderer/drawable_points.h>
+#include <easy3d/util/file_system.h>
+#include <easy3d/util/logging.h>
+
+#include "paint_canvas.h"
+#include "main_window.h"
+
+
+using namespace easy3d;
+
+
+DialogPointCloudDistance::DialogPointCloudDistance(MainWindow *window)
+        : Dialog(window) {
+    setupUi(this);
+    layout()->setSizeConstraint(QLayout::SetFixedSize);
+
+    connect(comboBoxReference, SIGNAL(currentIndexChanged(int)), this, SLOT(referenceChanged(int)));
+    connect(computeButton, SIGNAL(clicked()), this, SLOT(compute()));
+}
+
+
+DialogPointCloudDistance::~DialogPointCloudDistance() {
+}
+
+
+void DialogPointCloudDistance::showEvent(QShowEvent *e) {
+    comboBoxReference->clear();
+    references_.clear();
+    for (auto m : viewer_->models()) {
+        if (m == viewer_->currentModel())
+            continue;
+        if (dynamic_cast<PointCloud *>(m) || dynamic_cast<SurfaceMesh *>(m)) {
+            references_.push_back(m);
+            comboBoxReference->addItem(QString::fromStdString(file_system::simple_name(m->name())));
+        }
+    }
+    referenceChanged(comboBoxReference->currentIndex());
+    QDialog::showEvent(e);
+}
+
+
+void DialogPointCloudDistance::referenceChanged(int idx) {
+    // signed distances are defined only w.r.t. a surface
+    const bool is_mesh = idx >= 0 && idx < static_cast<int>(references_.size()) &&
+                         dynamic_cast<SurfaceMesh *>(references_[idx]);
+    checkBoxSigned->setEnabled(is_mesh);
+}
+
+
+void DialogPointCloudDistance::compute() {
+    PointCloud *cloud = dynamic_cast<PointCloud *>(viewer_->currentModel());
+    if (!cloud)
+        return;
+
+    const int idx = comboBoxReference->currentIndex();
+    if (idx < 0 || idx >= static_cast<int>(references_.size()) || references_[idx] == cloud) {
+        LOG(WARNING) << "please choose a reference model (other than the current model)";
+        return;
+    }
+
+    PointCloudDistance::Statistics stats;
+    if (dynamic_cast<SurfaceMesh *>(references_[idx]))
+        stats = PointCloudDistance::cloud_to_mesh(cloud, dynamic_cast<SurfaceMesh *>(references_[idx]), nullptr,
+                                                  checkBoxSigned->isChecked());
+    else
+        stats = PointCloudDistance::cloud_to_cloud(cloud, dynamic_cast<PointCloud *>(references_[idx]));
+    if (stats.num_points == 0)
+        return;
+
+    auto drawable = cloud->renderer()->get_points_drawable("vertices");
+    drawable->set_coloring(State::SCALAR_FIELD, State::VERTEX, "v:distance");
+    cloud->renderer()->update();
+    viewer_->update();
+    window_->updateRenderingPanel();
+}
@@ -0,0 +1,146 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "dialogs/dialog_point_cloud_outlier_removal.h"
+
+#include <easy3d/algo/point_cloud_outlier_removal.h>
+#include <easy3d/renderer/drawable_points.h>
+#include <easy3d/renderer/renderer.h>
+#include <easy3d/renderer/buffers.h>
+#include <easy3d/renderer/manipulator.h>
+#include <easy3d/util/logging.h>
+#include <QButtonGroup>
+#include <QIntValidator>
+
+#include "paint_canvas.h"
+#include "main_window.h"
+
+
+using namespace easy3d;
+
+
+DialogPointCloudOutlierRemoval::DialogPointCloudOutlierRemoval(MainWindow *window)
+        : Dialog(window) {
+    setupUi(this);
+    layout()->setSizeConstraint(QLayout::SetFixedSize);
+
+    // default value
+    lineEditNeighborSize->setText("16");
+    lineEditNeighborSize->setValidator(new QIntValidator(1, 1000, this));
+    lineEditStdRatio->setText("1.0");
+    lineEditStdRatio->setValidator(new QDoubleValidator(0.0, 100.0, 5, this));
+    lineEditRadius->setText("0.01");
+    lineEditMinNeighbors->setText("2");
+    lineEditMinNeighbors->setValidator(new QIntValidator(0, 1000, this));
+
+    QButtonGroup *buttonGroup = new QButtonGroup(this);
+    buttonGroup->addButton(radioButtonStatistical, 0);
+    buttonGroup->addButton(radioButtonRadius, 1);
+    connect(buttonGroup, SIGNAL(buttonClicked(int)), this, SLOT(methodChanged(int)));
+    methodChanged(0);
+
+    connect(queryButton, SIGNAL(clicked()), this, SLOT(query()));
+    connect(applyButton, SIGNAL(clicked()), this, SLOT(apply()));
+}
+
+
+DialogPointCloudOutlierRemoval::~DialogPointCloudOutlierRemoval() {
+}
+
+
+void DialogPointCloudOutlierRemoval::closeEvent(QCloseEvent *e) {
+    outliers_.clear();
+    QDialog::closeEvent(e);
+}
+
+
+void DialogPointCloudOutlierRemoval::methodChanged(int id) {
+    lineEditNeighborSize->setDisabled(id != 0);
+    lineEditStdRatio->setDisabled(id != 0);
+    lineEditRadius->setDisabled(id != 1);
+    lineEditMinNeighbors->setDisabled(id != 1);
+}
+
+
+void DialogPointCloudOutlierRemoval::query() {
+    PointCloud *cloud = dynamic_cast<PointCloud *>(viewer_->currentModel());
+    if (!cloud)
+        return;
+
+    if (radioButtonStatistical->isChecked()) {
+        unsigned int k = lineEditNeighborSize->text().toUInt();
+        float ratio = lineEditStdRatio->text().toFloat();
+        outliers_ = PointCloudOutlierRemoval::statistical_outliers(cloud, k, ratio);
+    } else {
+        float radius = lineEditRadius->text().toFloat();
+        unsigned int min_neighbors = lineEditMinNeighbors->text().toUInt();
+        outliers_ = PointCloudOutlierRemoval::radius_outliers(cloud, radius, min_neighbors);
+    }
+
+    // select the outliers, so they can be visualized (and deleted using the selection tools)
+    PointCloudOutlierRemoval::mark(cloud, outliers_, "v:select");
+    auto d = cloud->renderer()->get_points_drawable("vertices");
+    if (d) {
+        d->set_coloring(State::SCALAR_FIELD, State::VERTEX, "v:select");
+        viewer_->makeCurrent();
+        buffers::update(cloud, d);
+        viewer_->doneCurrent();
+    }
+    viewer_->update();
+    window_->updateUi();
+}
+
+
+void DialogPointCloudOutlierRemoval::apply() {
+    PointCloud *cloud = dynamic_cast<PointCloud *>(viewer_->currentModel());
+    if (!cloud)
+        return;
+
+    if (outliers_.empty()) {
+        LOG(INFO) << "please query the outliers first";
+        return;
+    }
+
+    const int old_num = cloud->n_vertices();
+    for (auto v : outliers_)
+        cloud->delete_vertex(v);
+    cloud->collect_garbage();
+    outliers_.clear();
+
+    auto select = cloud->get_vertex_property<bool>("v:select");
+    if (select)
+        cloud->remove_vertex_property(select);
+    auto d = cloud->renderer()->get_points_drawable("vertices");
+    if (d && d->property_name() == "v:select")
+        d->set_uniform_coloring(d->color());
+
+    const int new_num = cloud->n_vertices();
+    LOG(INFO) << old_num - new_num << " points removed. " << new_num << " points remain";
+
+    cloud->manipulator()->reset();
+    cloud->renderer()->update();
+    viewer_->update();
+    window_->updateUi();
+}
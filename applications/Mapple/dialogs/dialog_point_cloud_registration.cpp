@@ -0,0 +1,128 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "dialogs/dialog_point_cloud_registration.h"
+
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/algo/point_cloud_registration.h>
+#include <easy3d/renderer/renderer.h>
+#include <easy3d/renderer/manipulator.h>
+#include <easy3d/renderer/manipulated_frame.h>
+#include <easy3d/util/file_system.h>
+#include <easy3d/util/logging.h>
+#include <QIntValidator>
+
+#include "paint_canvas.h"
+#include "main_window.h"
+
+
+using namespace easy3d;
+
+
+DialogPointCloudRegistration::DialogPointCloudRegistration(MainWindow *window)
+        : Dialog(window), source_(nullptr), transformation_(mat4::identity()) {
+    setupUi(this);
+    layout()->setSizeConstraint(QLayout::SetFixedSize);
+
+    // default value
+    comboBoxMethod->setCurrentIndex(1);
+    lineEditMaxIterations->setText("50");
+    lineEditMaxIterations->setValidator(new QIntValidator(1, 10000, this));
+    lineEditMaxDistance->setText("0");
+    lineEditMaxDistance->setValidator(new QDoubleValidator(0.0, 1e10, 6, this));
+    lineEditTrimRatio->setText("1.0");
+    lineEditTrimRatio->setValidator(new QDoubleValidator(0.01, 1.0, 3, this));
+    lineEditNumLevels->setText("1");
+    lineEditNumLevels->setValidator(new QIntValidator(1, 10, this));
+
+    connect(registerButton, SIGNAL(clicked()), this, SLOT(registration()));
+    connect(applyButton, SIGNAL(clicked()), this, SLOT(apply()));
+}
+
+
+DialogPointCloudRegistration::~DialogPointCloudRegistration() {
+}
+
+
+void DialogPointCloudRegistration::showEvent(QShowEvent *e) {
+    comboBoxTarget->clear();
+    targets_.clear();
+    for (auto m : viewer_->models()) {
+        PointCloud *cloud = dynamic_cast<PointCloud *>(m);
+        if (cloud && m != viewer_->currentModel()) {
+            targets_.push_back(cloud);
+            comboBoxTarget->addItem(QString::fromStdString(file_system::simple_name(cloud->name())));
+        }
+    }
+    QDialog::showEvent(e);
+}
+
+
+void DialogPointCloudRegistration::registration() {
+    PointCloud *cloud = dynamic_cast<PointCloud *>(viewer_->currentModel());
+    if (!cloud)
+        return;
+
+    const int idx = comboBoxTarget->currentIndex();
+    if (idx < 0 || idx >= static_cast<int>(targets_.size()) || targets_[idx] == cloud) {
+        LOG(WARNING) << "please choose a target point cloud (other than the current model)";
+        return;
+    }
+
+    PointCloudRegistration icp;
+    icp.set_method(comboBoxMethod->currentIndex() == 0 ? PointCloudRegistration::POINT_TO_POINT
+                                                        : PointCloudRegistration::POINT_TO_PLANE);
+    icp.set_max_iterations(lineEditMaxIterations->text().toInt());
+    icp.set_max_distance(lineEditMaxDistance->text().toFloat());
+    icp.set_trim_ratio(lineEditTrimRatio->text().toFloat());
+    icp.set_robust(checkBoxRobust->isChecked());
+    icp.set_num_levels(lineEditNumLevels->text().toInt());
+
+    // starts from the current manipulated transformation (if any)
+    transformation_ = icp.apply(cloud, targets_[idx], cloud->manipulator()->matrix());
+    source_ = cloud;
+
+    // shows the result as the manipulated transformation, i.e., Manipulator::matrix() == transformation_
+    const vec3 &center = cloud->bounding_box().center();
+    cloud->manipulator()->frame()->setFromMatrix(transformation_ * mat4::translation(center));
+    viewer_->update();
+}
+
+
+void DialogPointCloudRegistration::apply() {
+    PointCloud *cloud = dynamic_cast<PointCloud *>(viewer_->currentModel());
+    if (!cloud || cloud != source_) {
+        LOG(WARNING) << "please register the current model first";
+        return;
+    }
+
+    PointCloudRegistration::transform(cloud, transformation_);
+    source_ = nullptr;
+
+    cloud->manipulator()->reset();
+    cloud->renderer()->update();
+    viewer_->update();
+    window_->updateUi();
+}
@@ -0,0 +1,61 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DIALOG_POINT_CLOUD_REGISTRATION_H
+#define DIALOG_POINT_CLOUD_REGISTRATION_H
+
+#include <easy3d/core/types.h>
+
+#include "dialog.h"
+#include "ui_dialog_point_cloud_registration.h"
+
+
+namespace easy3d {
+    class PointCloud;
+}
+
+class DialogPointCloudRegistration : public Dialog, public Ui::DialogPointCloudRegistration {
+Q_OBJECT
+
+public:
+    DialogPointCloudRegistration(MainWindow *window);
+    ~DialogPointCloudRegistration();
+
+private Q_SLOTS:
+    void registration();
+    void apply();
+
+protected:
+    virtual void showEvent(QShowEvent *e);
+
+private:
+    // the point clouds (except the current one) that can be the target
+    std::vector<easy3d::PointCloud *> targets_;
+
+    easy3d::PointCloud *source_;    // the source of the last registration
+    easy3d::mat4 transformation_;
+};
+
+#endif // DIALOG_POINT_CLOUD_REGISTRATION_H
@@ -137,11 +137,9 @@ void DialogPointCloudSimplification::query() {
             points_to_remove_ = PointCloudSimplification::uniform_simplification(cloud, expected_number);
         } else {
             float threshold = lineEditDistanceThreshold->text().toFloat();
-            if (checkBoxUniform->isChecked()) {
-                if (!kdtree_)
-                    constructKdTree();
-                points_to_remove_ = PointCloudSimplification::uniform_simplification(cloud, threshold, kdtree_);
-            } else
+            if (checkBoxUniform->isChecked())
+                points_to_remove_ = PointCloudSimplification::uniform_simplification(cloud, threshold);
+            else
                 points_to_remove_ = PointCloudSimplification::grid_simplification(cloud, threshold);
         }
         LOG(INFO) << cloud->n_vertices() - points_to_remove_.size() << " points will remain";
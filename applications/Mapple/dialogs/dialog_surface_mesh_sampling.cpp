@@ -54,12 +54,14 @@ void DialogSurfaceMeshSampling::apply() {
         return;
 
     int num = spinBoxPointNumber->value();
-    if (num < mesh->n_vertices()) {
+    const bool blue_noise = checkBoxBlueNoise->isChecked();
+    if (!blue_noise && num < mesh->n_vertices()) {
         LOG(WARNING) << "point num must >= the num of vertices of the input mesh";
         return;
     }
 
     SurfaceMeshSampler sampler;
+    sampler.set_blue_noise(blue_noise);
     PointCloud *cloud = sampler.apply(mesh, num);
     if (cloud) {
         viewer_->addModel(cloud);
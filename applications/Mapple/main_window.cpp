@@ -89,6 +89,9 @@
 #include "dialogs/dialog_surface_mesh_curvature.h"
 #include "dialogs/dialog_surface_mesh_sampling.h"
 #include "dialogs/dialog_point_cloud_normal_estimation.h"
+#include "dialogs/dialog_point_cloud_outlier_removal.h"
+#include "dialogs/dialog_point_cloud_registration.h"
+#include "dialogs/dialog_point_cloud_distance.h"
 #include "dialogs/dialog_point_cloud_ransac_primitive_extraction.h"
 #include "dialogs/dialog_point_cloud_simplification.h"
 #include "dialogs/dialog_gaussian_noise.h"
@@ -946,6 +949,9 @@ void MainWindow::createActionsForSelectMenu() {
 
 void MainWindow::createActionsForPointCloudMenu() {
     connect(ui->actionDownSampling, SIGNAL(triggered()), this, SLOT(pointCloudDownsampling()));
+    connect(ui->actionOutlierRemoval, SIGNAL(triggered()), this, SLOT(pointCloudOutlierRemoval()));
+    connect(ui->actionPointCloudRegistration, SIGNAL(triggered()), this, SLOT(pointCloudRegistration()));
+    connect(ui->actionPointCloudDistance, SIGNAL(triggered()), this, SLOT(pointCloudDistance()));
 
     connect(ui->actionEstimatePointCloudNormals, SIGNAL(triggered()), this, SLOT(pointCloudEstimateNormals()));
     connect(ui->actionReorientPointCloudNormals, SIGNAL(triggered()), this, SLOT(pointCloudReorientNormals()));
@@ -1910,6 +1916,30 @@ void MainWindow::pointCloudDownsampling() {
 }
 
 
+void MainWindow::pointCloudOutlierRemoval() {
+    static DialogPointCloudOutlierRemoval* dialog = nullptr;
+    if (!dialog)
+        dialog = new DialogPointCloudOutlierRemoval(this);
+    dialog->show();
+}
+
+
+void MainWindow::pointCloudRegistration() {
+    static DialogPointCloudRegistration* dialog = nullptr;
+    if (!dialog)
+        dialog = new DialogPointCloudRegistration(this);
+    dialog->show();
+}
+
+
+void MainWindow::pointCloudDistance() {
+    static DialogPointCloudDistance* dialog = nullptr;
+    if (!dialog)
+        dialog = new DialogPointCloudDistance(this);
+    dialog->show();
+}
+
+
 void MainWindow::addGaussianNoise() {
     static DialogGaussianNoise* dialog = nullptr;
     if (!dialog)
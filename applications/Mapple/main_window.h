@@ -120,6 +120,9 @@ public slots:
 
     // point cloud
     void pointCloudDownsampling();
+    void pointCloudOutlierRemoval();
+    void pointCloudRegistration();
+    void pointCloudDistance();
     void pointCloudEstimateNormals();
     void pointCloudReorientNormals();
     void pointCloudNormalizeNormals();
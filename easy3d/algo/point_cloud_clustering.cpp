@@ -0,0 +1,358 @@
+#include <iostream>
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <easy3d/algo/point_cloud_clustering.h>
+
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+
+#include <easy3d/util/logging.h>
+#include <easy3d/util/stop_watch.h>
+
+
+namespace easy3d {
+
+    //  \cond
+    namespace details {
+
+        // A concurrent union-find (i.e., disjoint sets). A root is always linked to a root with a smaller index, so
+        // the representative of a set is its smallest element, no matter in which order the unions are performed.
+        class ConcurrentUnionFind {
+        public:
+            explicit ConcurrentUnionFind(int n) : parent_(n) {
+                for (int i = 0; i < n; ++i)
+                    parent_[i].store(i);
+            }
+
+            int find(int x) {
+                while (true) {
+                    int p = parent_[x].load();
+                    if (p == x)
+                        return x;
+                    const int gp = parent_[p].load();
+                    if (p != gp) // path halving
+                        parent_[x].compare_exchange_weak(p, gp);
+                    x = gp;
+                }
+            }
+
+            void unite(int a, int b) {
+                while (true) {
+                    a = find(a);
+                    b = find(b);
+                    if (a == b)
+                        return;
+                    if (a < b)
+                        std::swap(a, b);
+                    // a is linked to b only if it is still a root. Otherwise, retry.
+                    int expected = a;
+                    if (parent_[a].compare_exchange_strong(expected, b))
+                        return;
+                }
+            }
+
+        private:
+            std::vector<std::atomic<int> > parent_;
+        };
+
+
+        // Returns the number of bits needed to represent x.
+        int num_bits(uint64_t x) {
+            int bits = 0;
+            while (x) {
+                ++bits;
+                x >>= 1;
+            }
+            return bits;
+        }
+    }
+    //  \endcond
+
+
+    int PointCloudClustering::euclidean(PointCloud *cloud, float radius, unsigned int min_points,
+                                        const std::string &name) {
+        if (!cloud || cloud->n_vertices() == 0 || radius <= 0) {
+            LOG(ERROR) << "empty point cloud or invalid radius: " << radius;
+            return 0;
+        }
+
+        StopWatch w;
+        const std::vector<vec3> &points = cloud->points();
+        const int num = static_cast<int>(points.size());
+
+        // The grid. The diagonal of a cell equals the radius, so all points in the same cell are connected.
+        Box3 box;
+        for (const auto &p : points)
+            box.add_point(p);
+        const double cell_size = radius / std::sqrt(3.0);
+        uint64_t dims[3];
+        double num_cells = 1.0;
+        for (unsigned int d = 0; d < 3; ++d) {
+            dims[d] = static_cast<uint64_t>((box.max_coord(d) - box.min_coord(d)) / cell_size) + 1;
+            num_cells *= static_cast<double>(dims[d]);
+        }
+        if (num_cells > static_cast<double>(uint64_t(1) << 62)) {
+            LOG(ERROR) << "radius (" << radius << ") is too small w.r.t. the extent of the point cloud";
+            return 0;
+        }
+
+        // The cell of each point, indexed such that the cells are ordered by z, y, and then x.
+        const vec3 &origin = box.min_point();
+        std::vector<uint64_t> keys(num);
+#pragma omp parallel for
+        for (int i = 0; i < num; ++i) {
+            uint64_t c[3];
+            for (unsigned int d = 0; d < 3; ++d)
+                c[d] = std::min(dims[d] - 1, static_cast<uint64_t>((points[i][d] - origin[d]) / cell_size));
+            keys[i] = c[0] + dims[0] * (c[1] + dims[1] * c[2]);
+        }
+
+        std::cerr << "T " << w.elapsed_seconds(3) << std::endl;
+        // Sorts the points by their cells: a counting sort on the leading bits of the keys distributes the points
+        // into (at most 2^16) buckets, which are then sorted in parallel.
+        const uint64_t max_key = dims[0] * dims[1] * dims[2] - 1;
+        const int shift = std::max(0, details::num_bits(max_key) - 16);
+        const int num_buckets = static_cast<int>(max_key >> shift) + 1;
+        std::vector<int> bucket_start(num_buckets + 1, 0);
+        for (int i = 0; i < num; ++i)
+            ++bucket_start[(keys[i] >> shift) + 1];
+        for (int b = 0; b < num_buckets; ++b)
+            bucket_start[b + 1] += bucket_start[b];
+        std::vector<int> order(num);
+        {
+            std::vector<int> next(bucket_start.begin(), bucket_start.end() - 1);
+            for (int i = 0; i < num; ++i)
+                order[next[keys[i] >> shift]++] = i;
+        }
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int b = 0; b < num_buckets; ++b) {
+            std::sort(order.begin() + bucket_start[b], order.begin() + bucket_start[b + 1], [&](int i, int j) {
+                return keys[i] < keys[j] || (keys[i] == keys[j] && i < j);
+            });
+        }
+
+        std::cerr << "T " << w.elapsed_seconds(3) << std::endl;
+        // The non-empty cells. The points of cell c are order[cell_start[c]], ..., order[cell_start[c + 1] - 1].
+        std::vector<uint64_t> cell_keys;
+        std::vector<int> cell_start;
+        for (int j = 0; j < num; ++j) {
+            if (j == 0 || keys[order[j]] != keys[order[j - 1]]) {
+                cell_keys.push_back(keys[order[j]]);
+                cell_start.push_back(j);
+            }
+        }
+        cell_start.push_back(num);
+        std::vector<uint64_t>().swap(keys);
+        const int num_nonempty_cells = static_cast<int>(cell_keys.size());
+
+        std::cerr << "T " << w.elapsed_seconds(3) << std::endl;
+        // A copy of the points in the sorted order, for coherent memory access when testing pairs of cells.
+        std::vector<vec3> sorted_points(num);
+#pragma omp parallel for
+        for (int j = 0; j < num; ++j)
+            sorted_points[j] = points[order[j]];
+
+        // The neighboring cells that may contain points within the radius are at most two cells away. Only the
+        // neighbors with larger keys are visited, such that each pair of cells is tested once. These are the cells in
+        // the same row (i.e., same y and z) on the right, and the cells in the 22 rows (dy, dz) above.
+        std::vector<int> rows;  // (dy, dz) stored consecutively
+        for (int dz = 0; dz <= 2; ++dz) {
+            for (int dy = -2; dy <= 2; ++dy) {
+                if (dz > 0 || dy > 0) {
+                    rows.push_back(dy);
+                    rows.push_back(dz);
+                }
+            }
+        }
+        const int num_rows = static_cast<int>(rows.size() / 2);
+        const float squared_radius = radius * radius;
+
+        // decodes the coordinates of a cell from its key
+        auto cell_coordinates = [&](uint64_t key, int64_t coord[3]) {
+            coord[0] = static_cast<int64_t>(key % dims[0]);
+            coord[1] = static_cast<int64_t>((key / dims[0]) % dims[1]);
+            coord[2] = static_cast<int64_t>(key / (dims[0] * dims[1]));
+        };
+
+        std::cerr << "T " << w.elapsed_seconds(3) << std::endl;
+        // Merges the neighboring cells that have at least one pair of points within the radius.
+        details::ConcurrentUnionFind sets(num_nonempty_cells);
+        auto merge = [&](int c, int n) {
+            if (sets.find(c) == sets.find(n))
+                return;
+            for (int i = cell_start[c]; i < cell_start[c + 1]; ++i) {
+                for (int j = cell_start[n]; j < cell_start[n + 1]; ++j) {
+                    if (distance2(sorted_points[i], sorted_points[j]) <= squared_radius) {
+                        sets.unite(c, n);
+                        return;
+                    }
+                }
+            }
+        };
+
+        // The cells are processed in blocks. Within a block, the first candidate neighbor in each row is tracked by a
+        // cursor that only moves forward (because the keys of the neighbors increase with the key of the cell), so
+        // finding the neighbors doesn't require a search for each cell.
+        const int block_size = 4096;
+        const int num_blocks = (num_nonempty_cells + block_size - 1) / block_size;
+        const int64_t row_length = static_cast<int64_t>(dims[0]);
+        const int64_t slice_size = static_cast<int64_t>(dims[0] * dims[1]);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int b = 0; b < num_blocks; ++b) {
+            const int begin = b * block_size;
+            const int end = std::min(num_nonempty_cells, begin + block_size);
+            std::vector<int> cursors(num_rows);
+            for (int r = 0; r < num_rows; ++r) {
+                const int64_t first = static_cast<int64_t>(cell_keys[begin]) - 2 + rows[r * 2] * row_length +
+                                      rows[r * 2 + 1] * slice_size;
+                cursors[r] = static_cast<int>(std::lower_bound(cell_keys.begin(), cell_keys.end(),
+                                                               static_cast<uint64_t>(std::max<int64_t>(0, first))) -
+                                              cell_keys.begin());
+            }
+
+            for (int c = begin; c < end; ++c) {
+                int64_t coord[3];
+                cell_coordinates(cell_keys[c], coord);
+
+                // the same row
+                for (int n = c + 1; n < num_nonempty_cells && cell_keys[n] <= cell_keys[c] + 2; ++n) {
+                    int64_t neighbor[3];
+                    cell_coordinates(cell_keys[n], neighbor);
+                    if (neighbor[1] == coord[1] && neighbor[2] == coord[2])
+                        merge(c, n);
+                }
+
+                // the rows above
+                for (int r = 0; r < num_rows; ++r) {
+                    const int64_t first = static_cast<int64_t>(cell_keys[c]) - 2 + rows[r * 2] * row_length +
+                                          rows[r * 2 + 1] * slice_size;
+                    int &n = cursors[r];
+                    while (n < num_nonempty_cells && static_cast<int64_t>(cell_keys[n]) < first)
+                        ++n;
+                    for (int m = n; m < num_nonempty_cells && static_cast<int64_t>(cell_keys[m]) <= first + 4; ++m) {
+                        int64_t neighbor[3];
+                        cell_coordinates(cell_keys[m], neighbor);
+                        if (std::abs(neighbor[0] - coord[0]) <= 2 && neighbor[1] == coord[1] + rows[r * 2] &&
+                            neighbor[2] == coord[2] + rows[r * 2 + 1])
+                            merge(c, m);
+                    }
+                }
+            }
+        }
+
+        std::cerr << "T " << w.elapsed_seconds(3) << std::endl;
+        // The clusters are labeled in descending order of their sizes (and ascending order of their representative
+        // cells for the same size), which is independent of the number of threads.
+        std::vector<int> roots(num_nonempty_cells);
+        std::vector<int> sizes(num_nonempty_cells, 0);
+        for (int c = 0; c < num_nonempty_cells; ++c) {
+            roots[c] = sets.find(c);
+            sizes[roots[c]] += cell_start[c + 1] - cell_start[c];
+        }
+        std::vector<int> clusters;
+        for (int c = 0; c < num_nonempty_cells; ++c) {
+            if (roots[c] == c && sizes[c] >= static_cast<int>(min_points))
+                clusters.push_back(c);
+        }
+        std::stable_sort(clusters.begin(), clusters.end(), [&](int a, int b) { return sizes[a] > sizes[b]; });
+        std::vector<int> cluster_label(num_nonempty_cells, -1);
+        for (std::size_t i = 0; i < clusters.size(); ++i)
+            cluster_label[clusters[i]] = static_cast<int>(i);
+
+        auto labels = cloud->vertex_property<int>(name, -1);
+        std::vector<int> &label_vector = labels.vector();
+#pragma omp parallel for
+        for (int c = 0; c < num_nonempty_cells; ++c) {
+            const int label = cluster_label[roots[c]];
+            for (int j = cell_start[c]; j < cell_start[c + 1]; ++j)
+                label_vector[order[j]] = label;
+        }
+
+        std::cerr << "T " << w.elapsed_seconds(3) << std::endl;
+        const int num_clusters = static_cast<int>(clusters.size());
+        LOG(INFO) << num_clusters << " clusters found (" << num_nonempty_cells << " non-empty cells). "
+                  << w.time_string();
+        return num_clusters;
+    }
+
+
+    std::vector<PointCloud *> PointCloudClustering::extract(const PointCloud *cloud, const std::string &name) {
+        std::vector<PointCloud *> clusters;
+        if (!cloud)
+            return clusters;
+
+        auto labels = cloud->get_vertex_property<int>(name);
+        if (!labels) {
+            LOG(ERROR) << "point cloud doesn't have the vertex property '" << name << "'";
+            return clusters;
+        }
+
+        // the index of each point in its cluster
+        const std::vector<int> &label_vector = labels.vector();
+        const int num = static_cast<int>(label_vector.size());
+        std::vector<int> index(num, -1);
+        std::vector<unsigned int> sizes;
+        for (int i = 0; i < num; ++i) {
+            const int label = label_vector[i];
+            if (label < 0)
+                continue;
+            if (label >= static_cast<int>(sizes.size()))
+                sizes.resize(label + 1, 0);
+            index[i] = static_cast<int>(sizes[label]++);
+        }
+
+        auto normals = cloud->get_vertex_property<vec3>("v:normal");
+        auto colors = cloud->get_vertex_property<vec3>("v:color");
+        std::vector<std::vector<vec3> *> cluster_points, cluster_normals, cluster_colors;
+        for (auto size : sizes) {
+            PointCloud *cluster = new PointCloud;
+            cluster->resize(size);
+            cluster_points.push_back(&cluster->points());
+            if (normals)
+                cluster_normals.push_back(&cluster->add_vertex_property<vec3>("v:normal").vector());
+            if (colors)
+                cluster_colors.push_back(&cluster->add_vertex_property<vec3>("v:color").vector());
+            clusters.push_back(cluster);
+        }
+
+        const std::vector<vec3> &points = cloud->points();
+#pragma omp parallel for
+        for (int i = 0; i < num; ++i) {
+            const int label = label_vector[i];
+            if (label < 0)
+                continue;
+            (*cluster_points[label])[index[i]] = points[i];
+            if (normals)
+                (*cluster_normals[label])[index[i]] = normals.vector()[i];
+            if (colors)
+                (*cluster_colors[label])[index[i]] = colors.vector()[i];
+        }
+
+        return clusters;
+    }
+
+} // namespace easy3d
@@ -0,0 +1,74 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EASY3D_ALGO_POINT_CLOUD_CLUSTERING_H
+#define EASY3D_ALGO_POINT_CLOUD_CLUSTERING_H
+
+
+#include <vector>
+#include <string>
+
+#include <easy3d/core/point_cloud.h>
+
+
+namespace easy3d {
+
+    /// \brief Segments point clouds into spatially connected clusters.
+    /// \class PointCloudClustering easy3d/algo/point_cloud_clustering.h
+    /// \details This is the point cloud counterpart of SurfaceMeshComponent. Two points are connected if their distance
+    ///     is not larger than a given radius, and a cluster is a connected component of the resulting graph (i.e.,
+    ///     Euclidean clustering). Instead of querying the neighbors of each point, the points are sorted into a
+    ///     uniform grid whose cells have a diagonal equal to the radius, such that all points in a cell are connected.
+    ///     The cells are then merged by a concurrent union-find, in parallel. This keeps the memory and time linear in
+    ///     the number of points, and thus scales to large point clouds (e.g., 100M+ points).
+    class PointCloudClustering {
+    public:
+        /**
+         * \brief Euclidean clustering of a point cloud.
+         * @param cloud The point cloud.
+         * @param radius Two points are in the same cluster if they are connected by a chain of points, in which the
+         *      distance between consecutive points is not larger than \p radius.
+         * @param min_points The minimum number of points of a cluster. The points of smaller clusters are labeled -1.
+         * @param name The name of the integer vertex property storing the labels. It is created if it doesn't exist.
+         * @return The number of clusters. The clusters are labeled 0, 1, 2, ... in descending order of their sizes.
+         */
+        static int euclidean(PointCloud *cloud, float radius, unsigned int min_points = 1,
+                             const std::string &name = "v:cluster");
+
+        /**
+         * \brief Extracts the clusters of a point cloud as separate point clouds.
+         * \details The points, and their normals and colors (i.e., "v:normal" and "v:color") if exist, are copied.
+         * @param cloud The point cloud.
+         * @param name The name of the integer vertex property storing the labels, e.g., as computed by euclidean().
+         *      Points with negative labels are ignored.
+         * @return The clusters, indexed by their labels. The caller takes the ownership of the point clouds.
+         */
+        static std::vector<PointCloud *> extract(const PointCloud *cloud, const std::string &name = "v:cluster");
+    };
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_ALGO_POINT_CLOUD_CLUSTERING_H
@@ -0,0 +1,223 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <easy3d/algo/point_cloud_distance.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <easy3d/core/surface_mesh.h>
+#include <easy3d/algo/triangle_mesh_bvh.h>
+#include <easy3d/kdtree/kdtree_search_flann.h>
+#include <easy3d/kdtree/kdtree_search_nanoflann.h>
+#include <easy3d/util/logging.h>
+#include <easy3d/util/progress.h>
+#include <easy3d/util/stop_watch.h>
+
+
+namespace easy3d {
+
+    //  \cond
+    namespace details {
+
+        // The number of points in a block. The points of a block are processed in parallel, and the progress is
+        // reported (and cancellation is checked) after each block.
+        const int distance_block_size = 1 << 16;
+
+        // Computes distances[i] = query(i) for all the points. Returns false if the computation was canceled.
+        template<typename Query>
+        bool compute_distances(const Query &query, bool parallel, std::vector<float> &distances) {
+            const int num = static_cast<int>(distances.size());
+            const int num_blocks = (num + distance_block_size - 1) / distance_block_size;
+            ProgressLogger progress(num_blocks, false, false);
+            for (int b = 0; b < num_blocks; ++b) {
+                if (progress.is_canceled())
+                    return false;
+                const int begin = b * distance_block_size;
+                const int end = std::min(num, begin + distance_block_size);
+#pragma omp parallel for if(parallel) schedule(dynamic, 1024)
+                for (int i = begin; i < end; ++i)
+                    distances[i] = query(i);
+                progress.notify(b + 1);
+            }
+            return true;
+        }
+
+
+        PointCloudDistance::Statistics statistics(const std::vector<float> &distances, double seconds) {
+            PointCloudDistance::Statistics stats;
+            if (distances.empty())
+                return stats;
+
+            double sum = 0.0, sum_squares = 0.0;
+            float min_value = distances[0], max_value = distances[0];
+            for (auto d : distances) {
+                sum += d;
+                sum_squares += static_cast<double>(d) * d;
+                min_value = std::min(min_value, d);
+                max_value = std::max(max_value, d);
+            }
+
+            const double num = static_cast<double>(distances.size());
+            const double mean = sum / num;
+            stats.num_points = distances.size();
+            stats.min = min_value;
+            stats.max = max_value;
+            stats.mean = static_cast<float>(mean);
+            stats.rms = static_cast<float>(std::sqrt(sum_squares / num));
+            stats.stddev = static_cast<float>(std::sqrt(std::max(0.0, sum_squares / num - mean * mean)));
+            stats.seconds = seconds;
+            return stats;
+        }
+
+
+        void report(const PointCloudDistance::Statistics &stats) {
+            LOG(INFO) << "distances of " << stats.num_points << " points computed (min: " << stats.min
+                      << ", max: " << stats.max << ", mean: " << stats.mean << ", RMS: " << stats.rms
+                      << ", standard deviation: " << stats.stddev << "). " << stats.seconds << " seconds ("
+                      << static_cast<std::size_t>(stats.throughput()) << " points/s)";
+        }
+
+
+        bool thread_safe(const KdTreeSearch *tree) {
+            return dynamic_cast<const KdTreeSearch_NanoFLANN *>(tree) ||
+                   dynamic_cast<const KdTreeSearch_FLANN *>(tree);
+        }
+
+
+        // Computes the distances from the points to the reference point cloud. Returns false if canceled.
+        bool cloud_to_cloud(const std::vector<vec3> &points, PointCloud *reference, KdTreeSearch *kdtree,
+                            std::vector<float> &distances, double &seconds) {
+            KdTreeSearch *tree = kdtree;
+            if (!tree) {
+                tree = new KdTreeSearch_NanoFLANN;
+                tree->begin();
+                tree->add_point_cloud(reference);
+                tree->end();
+            }
+
+            StopWatch w;
+            distances.resize(points.size());
+            const bool done = compute_distances([&](int i) -> float {
+                float squared_distance = 0.0f;
+                tree->find_closest_point(points[i], squared_distance);
+                return std::sqrt(squared_distance);
+            }, thread_safe(tree), distances);
+            seconds = w.elapsed_seconds(6);
+
+            if (!kdtree)
+                delete tree;
+            return done;
+        }
+    }
+    //  \endcond
+
+
+    PointCloudDistance::Statistics
+    PointCloudDistance::cloud_to_cloud(PointCloud *cloud, PointCloud *reference, KdTreeSearch *kdtree,
+                                       const std::string &name) {
+        if (!cloud || cloud->n_vertices() == 0 || !reference || reference->n_vertices() == 0) {
+            LOG(ERROR) << "empty point cloud or reference point cloud";
+            return Statistics();
+        }
+
+        std::vector<float> distances;
+        double seconds = 0.0;
+        if (!details::cloud_to_cloud(cloud->points(), reference, kdtree, distances, seconds)) {
+            LOG(WARNING) << "distance computation canceled";
+            return Statistics();
+        }
+
+        auto prop = cloud->vertex_property<float>(name);
+        prop.vector().swap(distances);
+
+        const Statistics stats = details::statistics(prop.vector(), seconds);
+        details::report(stats);
+        return stats;
+    }
+
+
+    PointCloudDistance::Statistics
+    PointCloudDistance::cloud_to_mesh(PointCloud *cloud, const SurfaceMesh *reference, const TriangleMeshBVH *bvh,
+                                      bool signed_distance, const std::string &name) {
+        if (!cloud || cloud->n_vertices() == 0 || !reference || reference->n_faces() == 0) {
+            LOG(ERROR) << "empty point cloud or reference mesh";
+            return Statistics();
+        }
+
+        const TriangleMeshBVH *tree = bvh ? bvh : new TriangleMeshBVH(reference);
+
+        const std::vector<vec3> &points = cloud->points();
+        std::vector<float> distances(points.size());
+
+        StopWatch w;
+        const bool done = details::compute_distances([&](int i) -> float {
+            const vec3 &p = points[i];
+            const TriangleMeshBVH::NearestNeighbor nn = tree->nearest(p);
+            if (signed_distance && dot(p - nn.nearest, reference->compute_face_normal(nn.face)) < 0)
+                return -nn.dist;
+            return nn.dist;
+        }, true, distances);
+        const double seconds = w.elapsed_seconds(6);
+
+        if (!bvh)
+            delete tree;
+
+        if (!done) {
+            LOG(WARNING) << "distance computation canceled";
+            return Statistics();
+        }
+
+        auto prop = cloud->vertex_property<float>(name);
+        prop.vector().swap(distances);
+
+        const Statistics stats = details::statistics(prop.vector(), seconds);
+        details::report(stats);
+        return stats;
+    }
+
+
+    float PointCloudDistance::hausdorff_distance(PointCloud *cloud_a, PointCloud *cloud_b) {
+        if (!cloud_a || cloud_a->n_vertices() == 0 || !cloud_b || cloud_b->n_vertices() == 0) {
+            LOG(ERROR) << "empty point cloud(s)";
+            return 0.0f;
+        }
+
+        std::vector<float> distances_ab, distances_ba;
+        double seconds_ab = 0.0, seconds_ba = 0.0;
+        if (!details::cloud_to_cloud(cloud_a->points(), cloud_b, nullptr, distances_ab, seconds_ab) ||
+            !details::cloud_to_cloud(cloud_b->points(), cloud_a, nullptr, distances_ba, seconds_ba)) {
+            LOG(WARNING) << "distance computation canceled";
+            return 0.0f;
+        }
+
+        const float ab = *std::max_element(distances_ab.begin(), distances_ab.end());
+        const float ba = *std::max_element(distances_ba.begin(), distances_ba.end());
+        LOG(INFO) << "Hausdorff distance: " << std::max(ab, ba) << " (directed: " << ab << " and " << ba << "). "
+                  << seconds_ab + seconds_ba << " seconds";
+        return std::max(ab, ba);
+    }
+
+} // namespace easy3d
@@ -0,0 +1,103 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EASY3D_ALGO_POINT_CLOUD_DISTANCE_H
+#define EASY3D_ALGO_POINT_CLOUD_DISTANCE_H
+
+
+#include <string>
+
+#include <easy3d/core/point_cloud.h>
+
+
+namespace easy3d {
+
+    class SurfaceMesh;
+    class KdTreeSearch;
+    class TriangleMeshBVH;
+
+    /// \brief Computes the distances from the points of a point cloud to a reference point cloud or surface mesh.
+    /// \class PointCloudDistance easy3d/algo/point_cloud_distance.h
+    /// \details The distance of each point is stored in a vertex property (by default "v:distance"), which can be
+    ///     visualized as a scalar field. The queries run in parallel, in blocks of points, which allows to report the
+    ///     progress and to cancel the computation. A KdTreeSearch_NanoFLANN (for a reference point cloud) or a
+    ///     TriangleMeshBVH (for a reference mesh) is built if not given. A given KdTree is queried in parallel only if
+    ///     it is thread-safe (i.e., KdTreeSearch_NanoFLANN or KdTreeSearch_FLANN).
+    class PointCloudDistance {
+    public:
+        /// \brief A summary of the computed distances.
+        struct Statistics {
+            Statistics() : num_points(0), min(0), max(0), mean(0), rms(0), stddev(0), seconds(0) {}
+
+            std::size_t num_points; ///< the number of points (0 if the computation failed or was canceled)
+            float min;              ///< the minimum distance
+            /// the maximum distance. For unsigned distances, this is the (directed) Hausdorff distance from the point
+            /// cloud to the reference.
+            float max;
+            float mean;             ///< the mean distance
+            float rms;              ///< the root mean square of the distances
+            float stddev;           ///< the standard deviation of the distances
+            double seconds;         ///< the time spent on the queries (excluding building the KdTree/BVH)
+
+            /// \brief The number of queries per second.
+            double throughput() const { return seconds > 0 ? num_points / seconds : 0.0; }
+        };
+
+        /**
+         * \brief Computes the distance from each point of \p cloud to its closest point in \p reference.
+         * @param cloud The point cloud whose distances are computed.
+         * @param reference The reference point cloud.
+         * @param kdtree A kdtree defined on the reference point cloud. If null, a new kdtree will be built and used.
+         * @param name The name of the vertex property storing the distances. It is created if it doesn't exist.
+         * @return The statistics of the distances.
+         */
+        static Statistics cloud_to_cloud(PointCloud *cloud, PointCloud *reference, KdTreeSearch *kdtree = nullptr,
+                                         const std::string &name = "v:distance");
+
+        /**
+         * \brief Computes the distance from each point of \p cloud to the surface of \p reference.
+         * @param cloud The point cloud whose distances are computed.
+         * @param reference The reference surface mesh.
+         * @param bvh A BVH built for the reference mesh. If null, a new BVH will be built and used.
+         * @param signed_distance If true, the distances of the points on the back side of the surface are negative.
+         *      The side is determined by the normal of the face containing the closest point.
+         * @param name The name of the vertex property storing the distances. It is created if it doesn't exist.
+         * @return The statistics of the distances.
+         */
+        static Statistics cloud_to_mesh(PointCloud *cloud, const SurfaceMesh *reference,
+                                        const TriangleMeshBVH *bvh = nullptr, bool signed_distance = false,
+                                        const std::string &name = "v:distance");
+
+        /**
+         * \brief Computes the (symmetric) Hausdorff distance between two point clouds, i.e., the maximum of the
+         *        directed Hausdorff distances in both directions. No property is added to the point clouds.
+         */
+        static float hausdorff_distance(PointCloud *cloud_a, PointCloud *cloud_b);
+    };
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_ALGO_POINT_CLOUD_DISTANCE_H
@@ -23,30 +23,143 @@
  */
 
 #include <easy3d/algo/point_cloud_normals.h>
+
+#include <cmath>
+#include <cfloat>
+#include <limits>
+#include <algorithm>
+
 #include <easy3d/core/point_cloud.h>
-#include <easy3d/core/principal_axes.h>
+#include <easy3d/core/constant.h>
 #include <easy3d/kdtree/kdtree_search_nanoflann.h>
 
 #include <easy3d/util/stop_watch.h>
 
 
-#ifdef HAS_BOOST
-
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/connected_components.hpp>
-#include <boost/graph/prim_minimum_spanning_tree.hpp>
-
 #ifdef VISUALIZATION_FOR_DEBUGGING
-#include <easy3d/core/constant.h>
 #include <easy3d/core/random.h>
 #include <easy3d/renderer/drawable_lines.h>
 #endif
 
-#endif
-
 
 namespace easy3d {
 
+    namespace details {
+
+        // The covariance matrix of the first n neighbors of a point, returned as its upper triangle (xx, xy, xz, yy,
+        // yz, zz). The coordinates are taken relative to the query point to avoid the loss of precision.
+        inline void covariance(const std::vector<vec3> &points, const std::vector<int> &neighbors, std::size_t n,
+                               const vec3 &origin, double cov[6]) {
+            double sx = 0, sy = 0, sz = 0, sxx = 0, sxy = 0, sxz = 0, syy = 0, syz = 0, szz = 0;
+            for (std::size_t j = 0; j < n; ++j) {
+                const vec3 &q = points[neighbors[j]];
+                const double x = q.x - origin.x, y = q.y - origin.y, z = q.z - origin.z;
+                sx += x;
+                sy += y;
+                sz += z;
+                sxx += x * x;
+                sxy += x * y;
+                sxz += x * z;
+                syy += y * y;
+                syz += y * z;
+                szz += z * z;
+            }
+            const double inv = 1.0 / n;
+            const double mx = sx * inv, my = sy * inv, mz = sz * inv;
+            cov[0] = sxx * inv - mx * mx;
+            cov[1] = sxy * inv - mx * my;
+            cov[2] = sxz * inv - mx * mz;
+            cov[3] = syy * inv - my * my;
+            cov[4] = syz * inv - my * mz;
+            cov[5] = szz * inv - mz * mz;
+        }
+
+
+        // The eigenvalues (in descending order) of a symmetric 3x3 matrix given by its upper triangle, computed in
+        // closed form. See: Oliver K. Smith. Eigenvalues of a symmetric 3x3 matrix. Communications of the ACM, 1961.
+        inline void eigen_values(const double a[6], double eval[3]) {
+            const double q = (a[0] + a[3] + a[5]) / 3.0;
+            const double p1 = a[1] * a[1] + a[2] * a[2] + a[4] * a[4];
+            const double d0 = a[0] - q, d1 = a[3] - q, d2 = a[5] - q;
+            const double p2 = d0 * d0 + d1 * d1 + d2 * d2 + 2.0 * p1;
+            const double p = std::sqrt(p2 / 6.0);
+            if (p <= 1e-30 * std::max(1.0, std::fabs(q))) {   // a multiple of the identity
+                eval[0] = eval[1] = eval[2] = q;
+                return;
+            }
+
+            // B = (A - qI) / p, and r = det(B) / 2
+            const double b00 = d0 / p, b11 = d1 / p, b22 = d2 / p;
+            const double b01 = a[1] / p, b02 = a[2] / p, b12 = a[4] / p;
+            double r = 0.5 * (b00 * (b11 * b22 - b12 * b12) - b01 * (b01 * b22 - b12 * b02) +
+                              b02 * (b01 * b12 - b11 * b02));
+            r = std::min(1.0, std::max(-1.0, r));
+
+            const double phi = std::acos(r) / 3.0;
+            eval[0] = q + 2.0 * p * std::cos(phi);
+            eval[2] = q + 2.0 * p * std::cos(phi + 2.0 * M_PI / 3.0);
+            eval[1] = 3.0 * q - eval[0] - eval[2];
+        }
+
+
+        // The unit eigenvector of a symmetric 3x3 matrix (given by its upper triangle) for the eigenvalue lambda, i.e.,
+        // the most stable cross product of two rows of (A - lambda I). Returns false if lambda is not simple.
+        inline bool eigen_vector(const double a[6], double lambda, dvec3 &v) {
+            const dvec3 r0(a[0] - lambda, a[1], a[2]);
+            const dvec3 r1(a[1], a[3] - lambda, a[4]);
+            const dvec3 r2(a[2], a[4], a[5] - lambda);
+            const dvec3 c01 = cross(r0, r1), c02 = cross(r0, r2), c12 = cross(r1, r2);
+            const double l01 = length2(c01), l02 = length2(c02), l12 = length2(c12);
+            double lmax = l01;
+            v = c01;
+            if (l02 > lmax) {
+                lmax = l02;
+                v = c02;
+            }
+            if (l12 > lmax) {
+                lmax = l12;
+                v = c12;
+            }
+            if (lmax <= 0.0 || !std::isfinite(lmax))
+                return false;
+            v /= std::sqrt(lmax);
+            return true;
+        }
+
+
+        // The normal (the eigenvector of the smallest eigenvalue) of a covariance matrix with eigenvalues eval.
+        inline vec3 normal(const double cov[6], const double eval[3]) {
+            dvec3 n;
+            if (eigen_vector(cov, eval[2], n))
+                return vec3(n.x, n.y, n.z);
+            // the two smallest eigenvalues are equal (e.g., points on a line): any direction orthogonal to the
+            // principal axis
+            if (eigen_vector(cov, eval[0], n)) {
+                n = normalize(orthogonal(n));
+                return vec3(n.x, n.y, n.z);
+            }
+            return vec3(0, 0, 1);
+        }
+
+
+        // the normal and the curvature (surface variation) of point i from its first n neighbors
+        inline void estimate(const std::vector<vec3> &points, const std::vector<int> &neighbors, std::size_t n,
+                             int i, vec3 &normal, float *curvature) {
+            double cov[6], eval[3];
+            covariance(points, neighbors, n, points[i], cov);
+            eigen_values(cov, eval);
+            normal = details::normal(cov, eval);
+            if (normal.z < 0) // almost have positive Z
+                normal = -normal;
+
+            if (curvature) {
+                const double sum = eval[0] + eval[1] + eval[2];
+                *curvature = sum > 0.0 ? static_cast<float>(std::max(0.0, eval[2]) / sum) : 0.0f;
+            }
+        }
+    }
+
+
     bool PointCloudNormals::estimate(PointCloud *cloud, unsigned int k /* = 16 */,
                                      bool compute_curvature /* = false */) const {
         if (!cloud) {
@@ -75,296 +188,404 @@ namespace easy3d {
         w.restart();
         LOG(INFO) << "estimating normals...";
 
-#pragma omp parallel for
-        for (int i = 0; i < num; ++i) {
-            const vec3 &p = points[i];
+#pragma omp parallel
+        {
+            // the neighbor buffers are reused for all points handled by a thread
             std::vector<int> neighbors;
-            kdtree.find_closest_k_points(p, k, neighbors);
-
-            PrincipalAxes<3, float> pca;
-            pca.begin();
-            for (unsigned int j = 0; j < neighbors.size(); ++j) {
-                int idx = neighbors[j];
-                pca.add_point(points[idx]);
+            std::vector<float> squared_distances;
+            neighbors.reserve(k);
+            squared_distances.reserve(k);
+
+#pragma omp for
+            for (int i = 0; i < num; ++i) {
+                kdtree.find_closest_k_points(points[i], k, neighbors, squared_distances);
+                details::estimate(points, neighbors, neighbors.size(), i, normals[i],
+                                  compute_curvature ? &(*curvatures)[i] : nullptr);
             }
-            pca.end();
-
-            // the eigen vector corresponding to the smallest eigen value
-            normals[i] = pca.axis(2);
-            if (normals[i].z < 0) // almost have positive Z
-                normals[i] = -normals[i];
-
-            if (compute_curvature)
-                (*curvatures)[i] = float(
-                        pca.eigen_value(2) / (pca.eigen_value(0) + pca.eigen_value(1) + pca.eigen_value(2)));
         }
 
         LOG(INFO) << "done. " << w.time_string();
         return true;
     }
 
-#ifdef HAS_BOOST
 
-    namespace details {
+    bool PointCloudNormals::estimate_adaptive(PointCloud *cloud, unsigned int k_min /* = 8 */,
+                                              unsigned int k_max /* = 48 */,
+                                              bool compute_curvature /* = false */) const {
+        if (!cloud) {
+            LOG(ERROR) << "empty input point cloud";
+            return false;
+        }
+        if (k_min < 3 || k_min > k_max) {
+            LOG(ERROR) << "invalid neighborhood sizes: k_min = " << k_min << ", k_max = " << k_max;
+            return false;
+        }
 
-        struct VertexProperty {
-            VertexProperty(easy3d::PointCloud::Vertex v = easy3d::PointCloud::Vertex(-1)) : vertex(v) {}
+        StopWatch w;
+        w.start();
 
-            easy3d::PointCloud::Vertex vertex;
-        };
+        LOG(INFO) << "building kd_tree...";
+        KdTreeSearch_NanoFLANN kdtree;
+        kdtree.begin();
+        kdtree.add_point_cloud(cloud);
+        kdtree.end();
+        LOG(INFO) << "done. " << w.time_string();
 
-        struct EdgeProperty {
-            EdgeProperty(float w = -std::numeric_limits<float>::max()) : weight(w) {}
+        int num = cloud->n_vertices();
+        const std::vector<vec3> &points = cloud->points();
+        std::vector<vec3> &normals = cloud->vertex_property<vec3>("v:normal").vector();
+        std::vector<int> &sizes = cloud->vertex_property<int>("v:neighborhood_size").vector();
 
-            float weight;
-        };
+        std::vector<float> *curvatures = nullptr;
+        if (compute_curvature)
+            curvatures = &(cloud->vertex_property<float>("v:curvature").vector());
 
-        /// RiemannianGraph encodes:
-        /// - the adjacency relations of vertices in a K neighbors.
-        /// - vertices contain the corresponding input point cloud vertex
-        /// - the edge weight = edge weight = 1 - | normal1 * normal2 |
-        class RiemannianGraph
-                : public boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS, VertexProperty, EdgeProperty> {
-        public:
-            typedef RiemannianGraph::vertex_descriptor Vertex;
-            typedef RiemannianGraph::edge_descriptor Edge;
+        // the candidate neighborhood sizes
+        std::vector<unsigned int> candidates;
+        const unsigned int step = std::max(1u, (k_max - k_min) / 8);
+        for (unsigned int size = k_min; size < k_max; size += step)
+            candidates.push_back(size);
+        candidates.push_back(k_max);
 
-        public:
-            Vertex top;
-        };
+        w.restart();
+        LOG(INFO) << "estimating normals (adaptive neighborhood size)...";
 
-        // builds the graph
-        void build_graph(easy3d::PointCloud *cloud, const KdTreeSearch *tree, unsigned int k, RiemannianGraph &graph) {
-            // Step 1: create the vertices of the graph
-
-            // we need to remember the vertex descriptor of each point.
-            // This is needed in a later stage to add edges.
-            auto vertex_descriptors = cloud->vertex_property<RiemannianGraph::Vertex>("v:descriptors");
-
-            for (auto v : cloud->vertices())
-                vertex_descriptors[v] = boost::add_vertex(VertexProperty(v), graph);
-
-            // Step 2: create the edges connecting neighboring points.
-
-            auto points = cloud->get_vertex_property<easy3d::vec3>("v:point");
-            auto normals = cloud->get_vertex_property<easy3d::vec3>("v:normal");
-            for (auto v : cloud->vertices()) {
-                const easy3d::vec3 &p = points[v];
-
-                // The indices of the neighbors of v (NOTE: the result include v itself).
-                std::vector<int> neighbor_indices;
-                tree->find_closest_k_points(p, k, neighbor_indices);
-                if (neighbor_indices.size() < k)
-                    continue; // in extreme cases, a point cloud can have less than K points
-
-                // now let's create the edges
-                for (std::size_t i = 0; i < neighbor_indices.size(); ++i) {
-                    int index = neighbor_indices[i];
-                    if (index == v.idx())
-                        continue; // this is actually the current vertex
-
-                    easy3d::PointCloud::Vertex v2(index);
-                    RiemannianGraph::Vertex vd1 = vertex_descriptors[v];
-                    RiemannianGraph::Vertex vd2 = vertex_descriptors[v2];
-                    std::pair<RiemannianGraph::Edge, bool> ed = boost::edge(vd1, vd2, graph);
-                    if (ed.second)
-                        continue; // the edge already exists.
-
-                    const easy3d::vec3 &n1 = normals[v];
-                    const easy3d::vec3 &n2 = normals[v2];
-                    float weight = 1.0f - std::abs(dot(n1, n2));
-                    if (weight < 0)
-                        weight = 0; // safety check
-
-                    // add an edge to the graph: add_edge()
-                    boost::add_edge(vd1, vd2, EdgeProperty(weight), graph);
+#pragma omp parallel
+        {
+            std::vector<int> neighbors;
+            std::vector<float> squared_distances;
+            neighbors.reserve(k_max);
+            squared_distances.reserve(k_max);
+
+#pragma omp for
+            for (int i = 0; i < num; ++i) {
+                const vec3 &p = points[i];
+                kdtree.find_closest_k_points(p, k_max, neighbors, squared_distances);
+                const std::size_t found = neighbors.size();
+
+                // The neighbors are sorted by their distances, so the covariance matrices of all candidate sizes are
+                // obtained from the running sums. The size with the minimum eigenentropy (i.e., the most structured
+                // neighborhood) is chosen, see: Weinmann et al. Semantic point cloud interpretation based on optimal
+                // neighborhoods, relevant features and efficient classifiers. ISPRS Journal, 2015.
+                double s[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+                std::size_t best = std::min<std::size_t>(k_min, found);
+                double best_entropy = DBL_MAX;
+                std::size_t j = 0;
+                for (auto size : candidates) {
+                    if (size > found)
+                        break;
+                    for (; j < size; ++j) {
+                        const vec3 &q = points[neighbors[j]];
+                        const double x = q.x - p.x, y = q.y - p.y, z = q.z - p.z;
+                        s[0] += x;
+                        s[1] += y;
+                        s[2] += z;
+                        s[3] += x * x;
+                        s[4] += x * y;
+                        s[5] += x * z;
+                        s[6] += y * y;
+                        s[7] += y * z;
+                        s[8] += z * z;
+                    }
+                    const double inv = 1.0 / size;
+                    const double mx = s[0] * inv, my = s[1] * inv, mz = s[2] * inv;
+                    const double cov[6] = {s[3] * inv - mx * mx, s[4] * inv - mx * my, s[5] * inv - mx * mz,
+                                           s[6] * inv - my * my, s[7] * inv - my * mz, s[8] * inv - mz * mz};
+                    double eval[3];
+                    details::eigen_values(cov, eval);
+                    const double sum = eval[0] + eval[1] + eval[2];
+                    if (sum <= 0.0)
+                        continue;
+                    double entropy = 0.0;
+                    for (double e : eval) {
+                        e = std::max(e / sum, 1e-12);
+                        entropy -= e * std::log(e);
+                    }
+                    if (entropy < best_entropy) {
+                        best_entropy = entropy;
+                        best = size;
+                    }
                 }
-            }
 
-            cloud->remove_vertex_property(vertex_descriptors);
+                sizes[i] = static_cast<int>(best);
+                details::estimate(points, neighbors, best, i, normals[i],
+                                  compute_curvature ? &(*curvatures)[i] : nullptr);
+            }
         }
 
+        LOG(INFO) << "done. " << w.time_string();
+        return true;
+    }
 
-        /// MST_Graph encodes:
-        /// - the adjacency relations of vertices in a Minimum Spanning Tree.
-        /// - vertices contain the corresponding input point cloud vertex
-        /// - a boolean indicating if the normal is oriented.
-        struct MST_VertexProperty : public VertexProperty {
-            MST_VertexProperty(easy3d::PointCloud::Vertex v = easy3d::PointCloud::Vertex(-1), bool oriented = false)
-                    : VertexProperty(v), is_oriented(oriented) {}
-
-            bool is_oriented;
-        };
-
-        class MST_Graph : public boost::adjacency_list<boost::vecS, boost::vecS, boost::directedS, MST_VertexProperty> {
-        public:
-            typedef typename MST_Graph::vertex_descriptor Vertex;
-            typedef typename MST_Graph::edge_descriptor Edge;
-
-        public:
-            MST_Graph(PointCloud::VertexProperty<vec3> nmap) : normal_map(nmap) {}
-
-            PointCloud::VertexProperty<vec3> normal_map;
+    namespace details {
 
-            Vertex root;
+        /// The k-nearest-neighbor graph of a point cloud in the compressed sparse row (CSR) format. It is undirected:
+        /// an edge appears in the adjacency lists of both its end vertices. The weight of an edge (i, j) is
+        /// 1 - |n_i * n_j|, which is computed on the fly from the normals.
+        struct RiemannianGraph {
+            std::vector<std::size_t> offsets;   // the adjacency of vertex i is [offsets[i], offsets[i + 1])
+            std::vector<int> adjacency;
         };
 
-
-        void extract_minimum_spanning_tree(const RiemannianGraph &graph, MST_Graph &mst) {
-            RiemannianGraph::Vertex top = graph.top;
-
-            std::vector<details::RiemannianGraph::Vertex> predecessor(boost::num_vertices(graph));
-            boost::prim_minimum_spanning_tree(
-                    graph,
-                    &predecessor[0],
-                    boost::weight_map(boost::get(&details::EdgeProperty::weight, graph)).root_vertex(top)
-            );
-
-            // we create a directed graph (i.e., MST_Graph) to represent the MST.
-            // add vertices
-            for (std::size_t i = 0; i < predecessor.size(); ++i) {
-                // the current vertex: graph[i].vertex
-                PointCloud::Vertex v = graph[i].vertex;
-
-                if (predecessor[i] == i) { // is either the root or unreachable
-                    // the root or unreachable vertices are marked "oriented".
-                    auto vt = boost::add_vertex(MST_VertexProperty(v, true), mst);
-                    if (i == top)
-                        mst.root = vt;
-                } else {
-                    // other vertices are marked "oriented".
-                    boost::add_vertex(MST_VertexProperty(v, false), mst);
+        // builds the graph
+        void build_graph(const std::vector<vec3> &points, const KdTreeSearch *tree, unsigned int k,
+                         RiemannianGraph &graph) {
+            const int num = static_cast<int>(points.size());
+
+            // the neighbors of each point (excluding the point itself), -1 for unused entries
+            const std::size_t stride = k > 0 ? k - 1 : 0;
+            std::vector<int> knn(num * stride, -1);
+            std::vector<int> degree(num, 0);
+
+#pragma omp parallel
+            {
+                std::vector<int> neighbors;
+                std::vector<float> squared_distances;
+#pragma omp for
+                for (int i = 0; i < num; ++i) {
+                    // The indices of the neighbors of v (NOTE: the result include v itself).
+                    tree->find_closest_k_points(points[i], k, neighbors, squared_distances);
+                    if (neighbors.size() < k)
+                        continue; // in extreme cases, a point cloud can have less than K points
+
+                    std::size_t count = 0;
+                    for (auto j : neighbors) {
+                        if (j == i || count == stride)
+                            continue; // this is actually the current vertex
+                        knn[i * stride + count++] = j;
+#pragma omp atomic
+                        ++degree[j];
+                    }
+#pragma omp atomic
+                    degree[i] += static_cast<int>(count);
                 }
             }
 
-            // add edges
-            for (std::size_t i = 0; i < predecessor.size(); ++i) {
-                if (predecessor[i] == i)  // is either the root or not reachable
-                    continue;
-                else {
-                    // the parent: predecessor[i]
-                    // current vertex: i
-                    boost::add_edge(predecessor[i], i, mst);
+            graph.offsets.resize(num + 1);
+            graph.offsets[0] = 0;
+            for (int i = 0; i < num; ++i)
+                graph.offsets[i + 1] = graph.offsets[i] + degree[i];
+            graph.adjacency.resize(graph.offsets[num]);
+
+            // the first entries of each adjacency list are the neighbors, followed by the reverse neighbors. An edge
+            // found from both ends appears twice, which doesn't affect the spanning tree.
+            std::vector<std::size_t> cursor(graph.offsets.begin(), graph.offsets.end() - 1);
+#pragma omp parallel for
+            for (int i = 0; i < num; ++i) {
+                for (std::size_t c = 0; c < stride; ++c) {
+                    const int j = knn[i * stride + c];
+                    if (j < 0)
+                        break;
+                    std::size_t pos;
+#pragma omp atomic capture
+                    pos = cursor[i]++;
+                    graph.adjacency[pos] = j;
+#pragma omp atomic capture
+                    pos = cursor[j]++;
+                    graph.adjacency[pos] = i;
                 }
             }
         }
 
-        template<class Graph>
-        class BfsVisitor : public boost::default_bfs_visitor {
+
+        /// A union-find structure (with union by size and path halving).
+        class DisjointSets {
         public:
-            typedef typename Graph::vertex_descriptor VertexDescriptor;
-            typedef typename Graph::edge_descriptor EdgeDescriptor;
+            explicit DisjointSets(int n) : parent_(n), size_(n, 1) {
+                for (int i = 0; i < n; ++i)
+                    parent_[i] = i;
+            }
 
-            BfsVisitor(std::function<void(EdgeDescriptor e, Graph &g)> fun)
-                    : func_(fun) {}
+            int find(int i) {
+                while (parent_[i] != i) {
+                    parent_[i] = parent_[parent_[i]];
+                    i = parent_[i];
+                }
+                return i;
+            }
 
-            // Note: boost requires const graph
-            void examine_edge(EdgeDescriptor edge, const Graph &graph) const {
-                func_(edge, const_cast<Graph &>(graph));
+            // the representative of i without modifying the structure (safe for concurrent queries)
+            int root(int i) const {
+                while (parent_[i] != i)
+                    i = parent_[i];
+                return i;
+            }
+
+            bool unite(int a, int b) {
+                a = find(a);
+                b = find(b);
+                if (a == b)
+                    return false;
+                if (size_[a] < size_[b])
+                    std::swap(a, b);
+                parent_[b] = a;
+                size_[a] += size_[b];
+                return true;
             }
 
         private:
-            std::function<void(EdgeDescriptor edge, Graph &graph)> func_;
+            std::vector<int> parent_;
+            std::vector<int> size_;
         };
 
 
-        /// find the top vertex (the one with the largest Z value) in the graph.
-        /// orient the normal of the point with maximum Z towards +Z axis.
-        void find_top_vertex(PointCloud *cloud, RiemannianGraph &graph) {
-            float top_z = -std::numeric_limits<float>::max();
-            auto points = cloud->get_vertex_property<vec3>("v:point");
+        /// The edges are totally ordered by (weight, smaller index, larger index) so that the minimum spanning forest
+        /// is unique and Boruvka's algorithm never creates a cycle.
+        struct EdgeKey {
+            float weight;
+            int a, b;
+
+            EdgeKey() : weight(std::numeric_limits<float>::max()), a(-1), b(-1) {}
+            EdgeKey(float w, int i, int j) : weight(w), a(std::min(i, j)), b(std::max(i, j)) {}
+
+            bool valid() const { return a >= 0; }
+            bool operator<(const EdgeKey &other) const {
+                if (weight != other.weight)
+                    return weight < other.weight;
+                if (a != other.a)
+                    return a < other.a;
+                return b < other.b;
+            }
+        };
+
 
-            auto vi = boost::vertices(graph);
-            for (auto vit = vi.first; vit != vi.second; ++vit) {
-                RiemannianGraph::Vertex vd = *vit;
-                PointCloud::Vertex v = graph[vd].vertex;
-                if (points[v].z > top_z) {
-                    graph.top = vd;
-                    top_z = points[v].z;
+        /// Extracts the minimum spanning forest of the graph using Boruvka's algorithm. In each round, every vertex
+        /// finds (in parallel) its cheapest edge leading to another component, the cheapest of them is selected for
+        /// each component, and the components are merged. The number of components at least halves every round.
+        /// \return The edges of the spanning forest. On return, component[i] is the component label of vertex i.
+        /// \note The edges inside a component are no longer needed and they are removed from the graph on the fly.
+        std::vector<std::pair<int, int> > minimum_spanning_forest(RiemannianGraph &graph,
+                                                                  const std::vector<vec3> &normals,
+                                                                  std::vector<int> &component) {
+            const int num = static_cast<int>(normals.size());
+            DisjointSets sets(num);
+            component.resize(num);
+            for (int i = 0; i < num; ++i)
+                component[i] = i;
+
+            // the end of the remaining adjacency of each vertex
+            std::vector<std::size_t> ends(graph.offsets.begin() + 1, graph.offsets.end());
+
+            std::vector<std::pair<int, int> > forest;
+            std::vector<EdgeKey> vertex_best(num), component_best(num);
+            while (true) {
+#pragma omp parallel for
+                for (int i = 0; i < num; ++i) {
+                    EdgeKey best;
+                    const int ci = component[i];
+                    std::size_t end = graph.offsets[i];
+                    for (std::size_t e = graph.offsets[i]; e < ends[i]; ++e) {
+                        const int j = graph.adjacency[e];
+                        if (component[j] == ci)
+                            continue;
+                        graph.adjacency[end++] = j;
+                        float weight = 1.0f - std::abs(dot(normals[i], normals[j]));
+                        if (weight < 0)
+                            weight = 0; // safety check
+                        const EdgeKey key(weight, i, j);
+                        if (key < best)
+                            best = key;
+                    }
+                    ends[i] = end;
+                    vertex_best[i] = best;
                 }
-            }
 
-            PointCloud::Vertex top = graph[graph.top].vertex;
-            if (top.idx() != -1) {
-                auto normals = cloud->get_vertex_property<vec3>("v:normal");
-                if (normals[top].z < 0)
-                    normals[top] = -normals[top];
+                // the cheapest outgoing edge of each component
+                for (int i = 0; i < num; ++i) {
+                    const EdgeKey &key = vertex_best[i];
+                    if (key.valid() && key < component_best[component[i]])
+                        component_best[component[i]] = key;
+                }
+
+                std::size_t num_merged = 0;
+                for (int i = 0; i < num; ++i) {
+                    EdgeKey &key = component_best[i];
+                    if (!key.valid())
+                        continue;
+                    if (sets.unite(key.a, key.b)) {  // two components may select the same edge
+                        forest.emplace_back(key.a, key.b);
+                        ++num_merged;
+                    }
+                    key = EdgeKey();
+                }
+                if (num_merged == 0)
+                    break;
+
+#pragma omp parallel for
+                for (int i = 0; i < num; ++i)
+                    component[i] = sets.root(i);
             }
-        }
 
+            return forest;
+        }
 
-        // extract the connected components of a graph. The results are stored in a set of graphs
-        std::vector<RiemannianGraph> connected_components(PointCloud *cloud, const RiemannianGraph &riemannian_graph) {
-            std::vector<std::size_t> labels(boost::num_vertices(riemannian_graph));
-            std::size_t num = boost::connected_components(riemannian_graph, &labels[0]);
 
-            std::vector<RiemannianGraph> components(num);
+        /// Propagates the normal orientation along the spanning forest, starting from the top vertex (the one with
+        /// the largest Z value) of each component, whose normal is oriented towards the +Z axis. All trees are
+        /// traversed simultaneously, level by level. Each vertex has a unique parent in its tree, so the vertices of a
+        /// level can be processed in parallel.
+        void propagate_orientation(const std::vector<vec3> &points, const std::vector<int> &component,
+                                   const std::vector<std::pair<int, int> > &forest, std::vector<vec3> &normals) {
+            const int num = static_cast<int>(points.size());
 
-            // we need to remember the vertex descriptor of each point.
-            // This is needed in a later stage to add edges.
-            auto vertex_descriptors = cloud->vertex_property<RiemannianGraph::Vertex>("v:descriptors");
+            // the adjacency of the forest (in CSR format)
+            std::vector<std::size_t> offsets(num + 1, 0);
+            for (const auto &e : forest) {
+                ++offsets[e.first + 1];
+                ++offsets[e.second + 1];
+            }
+            for (int i = 0; i < num; ++i)
+                offsets[i + 1] += offsets[i];
+            std::vector<int> adjacency(offsets[num]);
+            std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+            for (const auto &e : forest) {
+                adjacency[cursor[e.first]++] = e.second;
+                adjacency[cursor[e.second]++] = e.first;
+            }
 
-            for (std::size_t i = 0; i < boost::num_vertices(riemannian_graph); ++i) {
-                std::size_t idx = labels[i];
-                RiemannianGraph &graph = components[idx];
-                PointCloud::Vertex v = riemannian_graph[i].vertex;
-                vertex_descriptors[v] = boost::add_vertex(VertexProperty(v), graph);
+            // the top vertex of each component
+            std::vector<int> top(num, -1);
+            for (int i = 0; i < num; ++i) {
+                int &t = top[component[i]];
+                if (t == -1 || points[i].z > points[t].z)
+                    t = i;
             }
 
-            // add the edges for each graph
-            auto ei = boost::edges(riemannian_graph);
-            for (auto eit = ei.first; eit != ei.second; ++eit) {
-                auto vd1 = boost::source(*eit, riemannian_graph);
-                auto vd2 = boost::target(*eit, riemannian_graph);
-                if (labels[vd1] == labels[vd2]) { // they belong to the same component
-                    std::size_t idx = labels[vd1];
-                    RiemannianGraph &graph = components[idx];
-                    auto p1 = riemannian_graph[vd1].vertex;
-                    auto p2 = riemannian_graph[vd2].vertex;
-                    auto s = vertex_descriptors[p1];
-                    auto t = vertex_descriptors[p2];
-                    boost::add_edge(s, t, EdgeProperty(riemannian_graph[*eit].weight), graph);
+            std::vector<int> parent(num, -1);
+            std::vector<int> frontier;
+            for (int i = 0; i < num; ++i) {
+                if (top[i] != -1) {
+                    const int t = top[i];
+                    if (normals[t].z < 0)
+                        normals[t] = -normals[t];
+                    parent[t] = t;
+                    frontier.push_back(t);
                 }
             }
 
-            cloud->remove_vertex_property(vertex_descriptors);
-
-            for (auto &graph : components)
-                find_top_vertex(cloud, graph);
-
-            return components;
-        }
-
-        /// propage the normal orientation from the source vertex to the target vertex
-        /// It does not orient normals that are already oriented.
-        /// It does not propagate the orientation if the angle between 2 normals > angle_max.
-        /// \pre Normals must be unit vectors
-        /// \pre `0 < angle_max <= PI/2`
-        void propagate_normal(MST_Graph::Edge edge, MST_Graph &graph) {
-            const static double angle_max = M_PI * 0.5;
-
-            // Gets source
-            MST_Graph::Vertex source_vertex = boost::source(edge, graph);
-            const bool source_normal_is_oriented = graph[source_vertex].is_oriented;
-            PointCloud::Vertex v_source = graph[source_vertex].vertex;
-            const vec3 &source_normal = graph.normal_map[v_source];
-
-            // Gets target
-            MST_Graph::Vertex target_vertex = boost::target(edge, graph);
-            bool &target_normal_is_oriented = graph[target_vertex].is_oriented;
-            PointCloud::Vertex v_target = graph[target_vertex].vertex;
-            vec3 &target_normal = graph.normal_map[v_target];
-
-            if (!target_normal_is_oriented) {
-                float normals_dot = dot(source_normal, target_normal);
-                if (normals_dot < 0) {
-                    target_normal = -target_normal;
+            std::vector<int> next;
+            while (!frontier.empty()) {
+                next.clear();
+#pragma omp parallel
+                {
+                    std::vector<int> local;
+#pragma omp for nowait
+                    for (int f = 0; f < static_cast<int>(frontier.size()); ++f) {
+                        const int v = frontier[f];
+                        for (std::size_t e = offsets[v]; e < offsets[v + 1]; ++e) {
+                            const int w = adjacency[e];
+                            if (w == parent[v])
+                                continue;
+                            parent[w] = v;
+                            if (dot(normals[v], normals[w]) < 0)
+                                normals[w] = -normals[w];
+                            local.push_back(w);
+                        }
+                    }
+#pragma omp critical
+                    next.insert(next.end(), local.begin(), local.end());
                 }
-
-                // Is orientation robust?
-                target_normal_is_oriented = source_normal_is_oriented &&
-                                            (std::abs(normals_dot) >=
-                                             std::cos(angle_max)); // oriented iff angle <= m_angle_max
+                frontier.swap(next);
             }
         }
     }
@@ -392,62 +613,49 @@ namespace easy3d {
         kdtree.end();
         LOG(INFO) << "done. " << w.time_string();
 
+        const std::vector<vec3> &points = cloud->points();
+
         w.restart();
         LOG(INFO) << "constructing graph...";
-        details::RiemannianGraph riemannian_graph;
-        details::build_graph(cloud, &kdtree, k, riemannian_graph);
-
-        // a point clouds might be in multiple clusters, so we have to extract the connected components
-        // first. After that, we can reorient all the components one by one.
-        std::vector<details::RiemannianGraph> components
-                = details::connected_components(cloud, riemannian_graph);
-        LOG(INFO) << "done. #vertices: " << boost::num_vertices(riemannian_graph)
-                  << ", #edges: " << boost::num_edges(riemannian_graph)
-                  << ", #components: " << components.size()
+        details::RiemannianGraph graph;
+        details::build_graph(points, &kdtree, k, graph);
+        LOG(INFO) << "done. #vertices: " << points.size()
+                  << ", #edges: " << graph.adjacency.size() / 2
                   << ". " << w.time_string();
 
+        // a point clouds might be in multiple clusters, so the result is a minimum spanning forest and each of its
+        // trees (i.e., connected components) is reoriented independently.
         w.restart();
         LOG(INFO) << "extract minimum spanning tree...";
-        std::vector<details::MST_Graph> ms_trees;
-        for (const auto &graph : components) {
-            ms_trees.emplace_back(cloud->get_vertex_property<vec3>("v:normal"));
-            details::MST_Graph &mst = ms_trees.back();
-            details::extract_minimum_spanning_tree(graph, mst);
-        }
-        LOG(INFO) << "done. " << w.time_string();
+        std::vector<int> component;
+        const auto forest = details::minimum_spanning_forest(graph, normals.vector(), component);
+        LOG(INFO) << "done. #components: " << points.size() - forest.size() << ". " << w.time_string();
 
         w.restart();
         LOG(INFO) << "propagate...";
-        for (const auto &mst : ms_trees) {
-            // Traverse the point set along the MST to propagate source_point's orientation
-            details::BfsVisitor<details::MST_Graph> bfsVisitor(details::propagate_normal);
-            boost::breadth_first_search(mst, mst.root, boost::visitor(bfsVisitor));
-        }
+        details::propagate_orientation(points, component, forest, normals.vector());
         LOG(INFO) << "done. " << w.time_string();
 
 #ifdef VISUALIZATION_FOR_DEBUGGING
-        // for debugging: create a drawable to visualize the MST_Graph
+        // for debugging: create a drawable to visualize the minimum spanning forest
         LinesDrawable* mst_graph = cloud->drawable("mst_graph");
         if (!mst_graph)
             mst_graph = cloud->add_drawable("mst_graph");
 
-        auto point_prop = cloud->get_vertex_property<vec3>("v:point");
-        std::vector<vec3> points, colors;
-        for (const auto& mst : ms_trees) {
-            const vec3& c = random_color(); // give each mst a unique color
-            auto ei = boost::edges(mst);
-            for (auto eit = ei.first; eit != ei.second; ++eit) {
-               auto sd = boost::source(*eit, mst);
-               auto td = boost::target(*eit, mst);
-               PointCloud::Vertex sv = mst[sd].vertex;
-               PointCloud::Vertex tv = mst[td].vertex;
-               points.push_back(point_prop[sv]);    colors.push_back(c);
-               points.push_back(point_prop[tv]);    colors.push_back(c);
-            }
+        std::vector<vec3> colors(points.size());
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            if (component[i] == static_cast<int>(i))
+                colors[i] = random_color(); // give each tree a unique color
+        }
+        std::vector<vec3> vertices, vertex_colors;
+        for (const auto& e : forest) {
+            const vec3& c = colors[component[e.first]];
+            vertices.push_back(points[e.first]);     vertex_colors.push_back(c);
+            vertices.push_back(points[e.second]);    vertex_colors.push_back(c);
         }
 
-        mst_graph->update_vertex_buffer(points);
-        mst_graph->update_color_buffer(colors);
+        mst_graph->update_vertex_buffer(vertices);
+        mst_graph->update_color_buffer(vertex_colors);
         mst_graph->set_per_vertex_color(true);
         mst_graph->set_visible(true);
 #endif
@@ -455,14 +663,4 @@ namespace easy3d {
         return true;
     }
 
-#else
-
-    bool PointCloudNormals::reorient(PointCloud *cloud, unsigned int k) const
-    {
-        LOG(ERROR) << "reorient point cloud normals requires boost";
-        return false;
-    }
-
-#endif
-
 }
@@ -38,14 +38,28 @@ namespace easy3d {
     class PointCloudNormals {
     public:
         /// \brief Estimates the point cloud normals using PCA.
+        /// \details The eigen-decomposition of the 3x3 covariance matrices is computed in closed form.
         /// \param cloud The input point cloud.
         /// @param k: the number of neighboring points to construct the covariance matrix.
         /// @param compute_curvature: also computes the curvature?
         bool estimate(PointCloud *cloud, unsigned int k = 16, bool compute_curvature = false) const;
 
+        /// \brief Estimates the point cloud normals using PCA with an adaptive neighborhood size.
+        /// \details For each point, the neighborhood size is chosen from [k_min, k_max] to minimize the eigenentropy
+        ///     of the covariance matrix, which adapts to varying sampling density and noise. The chosen sizes are
+        ///     stored in the vertex property "v:neighborhood_size".
+        /// \param cloud The input point cloud.
+        /// @param k_min: the minimum number of neighboring points (at least 3).
+        /// @param k_max: the maximum number of neighboring points.
+        /// @param compute_curvature: also computes the curvature?
+        bool estimate_adaptive(PointCloud *cloud, unsigned int k_min = 8, unsigned int k_max = 48,
+                               bool compute_curvature = false) const;
+
         /// \brief Reorients the point cloud normals.
         /// This method implements the normal reorientation method described in
         /// Hoppe et al. Surface reconstruction from unorganized points. SIGGRAPH 1992.
+        /// The orientation is propagated along the minimum spanning forest of the k-nearest-neighbor graph (computed
+        /// using Boruvka's algorithm), starting from the highest point of each connected component.
         /// \param cloud The input point cloud.
         /// @param k: the number of neighboring points to construct the graph.
         bool reorient(PointCloud *cloud, unsigned int k = 16) const;
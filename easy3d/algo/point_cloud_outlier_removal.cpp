@@ -0,0 +1,191 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <easy3d/algo/point_cloud_outlier_removal.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <easy3d/kdtree/kdtree_search_flann.h>
+#include <easy3d/kdtree/kdtree_search_nanoflann.h>
+#include <easy3d/util/logging.h>
+#include <easy3d/util/stop_watch.h>
+
+
+namespace easy3d {
+
+    //  \cond
+    namespace details {
+
+        /// Provides a KdTree for the point cloud, building one if not given. It also tells if the queries can be
+        /// issued in parallel.
+        class KdTreeHolder {
+        public:
+            KdTreeHolder(PointCloud *cloud, KdTreeSearch *tree) : tree_(tree), owned_(false) {
+                if (!tree_) {
+                    tree_ = new KdTreeSearch_NanoFLANN;
+                    tree_->begin();
+                    tree_->add_point_cloud(cloud);
+                    tree_->end();
+                    owned_ = true;
+                }
+            }
+
+            ~KdTreeHolder() {
+                if (owned_)
+                    delete tree_;
+            }
+
+            const KdTreeSearch *tree() const { return tree_; }
+
+            bool thread_safe() const {
+                return dynamic_cast<const KdTreeSearch_NanoFLANN *>(tree_) ||
+                       dynamic_cast<const KdTreeSearch_FLANN *>(tree_);
+            }
+
+        private:
+            KdTreeSearch *tree_;
+            bool owned_;
+        };
+
+
+        // collects the flagged points
+        std::vector<PointCloud::Vertex> flagged_points(const std::vector<unsigned char> &flags) {
+            std::vector<PointCloud::Vertex> points;
+            for (std::size_t i = 0; i < flags.size(); ++i) {
+                if (flags[i])
+                    points.push_back(PointCloud::Vertex(static_cast<int>(i)));
+            }
+            return points;
+        }
+    }
+    //  \endcond
+
+
+    std::vector<PointCloud::Vertex>
+    PointCloudOutlierRemoval::statistical_outliers(PointCloud *cloud, unsigned int k, float std_ratio,
+                                                   KdTreeSearch *kdtree) {
+        if (!cloud || cloud->n_vertices() < 2 || k == 0) {
+            LOG(ERROR) << "empty point cloud or invalid number of neighbors: " << k;
+            return std::vector<PointCloud::Vertex>();
+        }
+
+        StopWatch w;
+        const details::KdTreeHolder holder(cloud, kdtree);
+        const KdTreeSearch *tree = holder.tree();
+
+        const std::vector<vec3> &points = cloud->points();
+        const int num = static_cast<int>(points.size());
+
+        // the mean distance of each point to its k nearest neighbors
+        std::vector<double> mean_distances(num, 0.0);
+        double sum = 0.0, sum_squares = 0.0;
+#pragma omp parallel if(holder.thread_safe())
+        {
+            // the neighbor buffers are reused for all points handled by a thread
+            std::vector<int> neighbors;
+            std::vector<float> squared_distances;
+#pragma omp for reduction(+:sum, sum_squares)
+            for (int i = 0; i < num; ++i) {
+                tree->find_closest_k_points(points[i], k + 1, neighbors, squared_distances); // k+1 to exclude itself
+                double total = 0.0;
+                for (std::size_t j = 1; j < squared_distances.size(); ++j) // starts from 1 to exclude itself
+                    total += std::sqrt(squared_distances[j]);
+                const double mean = squared_distances.size() > 1 ? total / (squared_distances.size() - 1) : 0.0;
+                mean_distances[i] = mean;
+                sum += mean;
+                sum_squares += mean * mean;
+            }
+        }
+
+        const double mu = sum / num;
+        const double sigma = std::sqrt(std::max(0.0, sum_squares / num - mu * mu));
+        const double threshold = mu + std_ratio * sigma;
+
+        std::vector<unsigned char> outlier(num, 0);
+#pragma omp parallel for
+        for (int i = 0; i < num; ++i)
+            outlier[i] = mean_distances[i] > threshold;
+
+        const auto &outliers = details::flagged_points(outlier);
+        LOG(INFO) << outliers.size() << " outliers found (mean distance: " << mu << ", standard deviation: " << sigma
+                  << "). " << w.time_string();
+        return outliers;
+    }
+
+
+    std::vector<PointCloud::Vertex>
+    PointCloudOutlierRemoval::radius_outliers(PointCloud *cloud, float radius, unsigned int min_neighbors,
+                                              KdTreeSearch *kdtree) {
+        if (!cloud || radius <= 0) {
+            LOG(ERROR) << "empty point cloud or invalid radius: " << radius;
+            return std::vector<PointCloud::Vertex>();
+        }
+
+        StopWatch w;
+        const details::KdTreeHolder holder(cloud, kdtree);
+        const KdTreeSearch *tree = holder.tree();
+
+        const std::vector<vec3> &points = cloud->points();
+        const int num = static_cast<int>(points.size());
+        const float squared_radius = radius * radius;
+
+        // A kNN query with k = min_neighbors + 1 (to exclude the point itself) is enough: the point has enough
+        // neighbors iff all of them are within the radius. This avoids collecting all the points in the range,
+        // which can be many in dense regions.
+        std::vector<unsigned char> outlier(num, 0);
+#pragma omp parallel if(holder.thread_safe())
+        {
+            std::vector<int> neighbors;
+            std::vector<float> squared_distances;
+#pragma omp for
+            for (int i = 0; i < num; ++i) {
+                tree->find_closest_k_points(points[i], static_cast<int>(min_neighbors) + 1, neighbors,
+                                            squared_distances);
+                bool enough = squared_distances.size() > min_neighbors;
+                for (std::size_t j = 0; j < squared_distances.size() && enough; ++j)
+                    enough = squared_distances[j] <= squared_radius;
+                outlier[i] = !enough;
+            }
+        }
+
+        const auto &outliers = details::flagged_points(outlier);
+        LOG(INFO) << outliers.size() << " outliers found. " << w.time_string();
+        return outliers;
+    }
+
+
+    PointCloud::VertexProperty<bool>
+    PointCloudOutlierRemoval::mark(PointCloud *cloud, const std::vector<PointCloud::Vertex> &outliers,
+                                   const std::string &name) {
+        auto prop = cloud->vertex_property<bool>(name, false);
+        auto &flags = prop.vector();
+        std::fill(flags.begin(), flags.end(), false);
+        for (auto v : outliers)
+            prop[v] = true;
+        return prop;
+    }
+
+}
@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EASY3D_ALGO_POINT_CLOUD_OUTLIER_REMOVAL_H
+#define EASY3D_ALGO_POINT_CLOUD_OUTLIER_REMOVAL_H
+
+
+#include <vector>
+#include <string>
+
+#include <easy3d/core/point_cloud.h>
+
+
+namespace easy3d {
+
+    class KdTreeSearch;
+
+    /// \brief Removes outliers (e.g., isolated points and sparse noise) from point clouds.
+    /// \class PointCloudOutlierRemoval easy3d/algo/point_cloud_outlier_removal.h
+    /// \details The neighbor queries run in parallel if the KdTree is thread-safe (i.e., KdTreeSearch_NanoFLANN or
+    ///     KdTreeSearch_FLANN). If no KdTree is given, a KdTreeSearch_NanoFLANN will be built and used.
+    /// The returned outliers can be deleted from the point cloud, or marked using mark().
+    class PointCloudOutlierRemoval {
+    public:
+        /**
+         * \brief Statistical outlier removal. For each point, the mean distance to its k nearest neighbors is
+         *        computed. Points whose mean distance is larger than (mu + std_ratio * sigma) are outliers, where mu
+         *        and sigma are the mean and the standard deviation of the mean distances of all points.
+         * @param cloud The point cloud.
+         * @param k The number of nearest neighbors.
+         * @param std_ratio The multiplier of the standard deviation. A smaller value removes more points.
+         * @param kdtree A kdtree defined on this point cloud. If null, a new kdtree will be built and used.
+         * @return The outliers (i.e., the points to be deleted).
+         */
+        static std::vector<PointCloud::Vertex>
+        statistical_outliers(PointCloud *cloud, unsigned int k = 16, float std_ratio = 1.0f,
+                             KdTreeSearch *kdtree = nullptr);
+
+        /**
+         * \brief Radius outlier removal. Points that have less than \p min_neighbors neighbors (excluding themselves)
+         *        within the distance \p radius are outliers.
+         * @param cloud The point cloud.
+         * @param radius The radius of the neighborhood.
+         * @param min_neighbors The minimum number of neighbors a point must have to be kept.
+         * @param kdtree A kdtree defined on this point cloud. If null, a new kdtree will be built and used.
+         * @return The outliers (i.e., the points to be deleted).
+         */
+        static std::vector<PointCloud::Vertex>
+        radius_outliers(PointCloud *cloud, float radius, unsigned int min_neighbors = 2,
+                        KdTreeSearch *kdtree = nullptr);
+
+        /**
+         * \brief Marks the outliers using a boolean vertex property, e.g., for visualization or selection.
+         * @param cloud The point cloud.
+         * @param outliers The outliers returned by statistical_outliers() or radius_outliers().
+         * @param name The name of the vertex property. It is created if it doesn't exist.
+         * @return The vertex property, which is true for the outliers and false for the other points.
+         */
+        static PointCloud::VertexProperty<bool>
+        mark(PointCloud *cloud, const std::vector<PointCloud::Vertex> &outliers,
+             const std::string &name = "v:outlier");
+    };
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_ALGO_POINT_CLOUD_OUTLIER_REMOVAL_H
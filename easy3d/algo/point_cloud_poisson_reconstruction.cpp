@@ -25,6 +25,7 @@
 #include <easy3d/algo/point_cloud_poisson_reconstruction.h>
 
 #include <algorithm>
+#include <memory>
 
 #include <easy3d/core/surface_mesh.h>
 #include <easy3d/core/point_cloud.h>
@@ -42,15 +43,6 @@
 namespace easy3d {
 
 
-#if defined( _WIN32 ) || defined( _WIN64 )
-    double PeakMemoryUsageMB(void)
-    {
-        HANDLE h = GetCurrentProcess();
-        PROCESS_MEMORY_COUNTERS pmc;
-        return GetProcessMemoryInfo(h, &pmc, sizeof(pmc)) ? ((double)pmc.PeakWorkingSetSize) / (1 << 20) : 0;
-    }
-#endif // _WIN32 || _WIN64
-
 #define REAL    float
 
 #define DEGREE           2
@@ -61,32 +53,12 @@ namespace easy3d {
 #define BType  BOUNDARY_NEUMANN
 
 
-    template<class Real>
-    struct OctreeProfiler {
-        Octree<Real> &tree;
-        double t;
-
-        OctreeProfiler(Octree<Real> &t) : tree(t) { ; }
-
-        void start(void) { t = Time(), tree.resetLocalMemoryUsage(); }
-
-        void print(const char *header) const {
-            tree.memoryUsage();
-#if defined( _WIN32 ) || defined( _WIN64 )
-            if (header)
-                printf("%s %9.1f (s), %9.1f (MB) / %9.1f (MB) / %9.1f (MB)\n", header, Time() - t, tree.localMemoryUsage(), tree.maxMemoryUsage(), PeakMemoryUsageMB());
-            else
-                printf("%9.1f (s), %9.1f (MB) / %9.1f (MB) / %9.1f (MB)\n", Time() - t, tree.localMemoryUsage(), tree.maxMemoryUsage(), PeakMemoryUsageMB());
-#else // !_WIN32 && !_WIN64
-            if (header)
-                printf("%s %9.1f (s), %9.1f (MB) / %9.1f (MB)\n", header, Time() - t, tree.localMemoryUsage(),
-                       tree.maxMemoryUsage());
-            else
-                printf("%9.1f (s), %9.1f (MB) / %9.1f (MB)\n", Time() - t, tree.localMemoryUsage(),
-                       tree.maxMemoryUsage());
-#endif // _WIN32 || _WIN64
-        }
-    };
+    PoissonReconstruction::Statistics::Statistics()
+            : depth(0), num_points(0), num_samples(0), num_nodes(0), num_vertices(0), num_faces(0),
+              estimated_memory(0), peak_memory(0),
+              time_load(0), time_density(0), time_normal_field(0), time_finalize(0), time_constraints(0),
+              time_solve(0), time_iso_value(0), time_extraction(0), time_total(0) {
+    }
 
 
     PoissonReconstruction::PoissonReconstruction(void)
@@ -98,12 +70,13 @@ namespace easy3d {
         scale_ = 1.1f;
         pointWeight_ = 4.0f;
         gsIter_ = 8;
-        threads_ = omp_get_num_procs();
-        LOG(INFO) << "number of threads: " << threads_;
+        threads_ = 0;   // all available processors
 
         confidence_ = false;
         normalWeight_ = false;
         verbose_ = false;
+
+        memory_budget_ = 0;
     }
 
     PoissonReconstruction::~PoissonReconstruction(void) {
@@ -113,6 +86,62 @@ namespace easy3d {
     // \cond
     namespace details {
 
+        /**
+         * Feeds the points (and normals, colors) of a point cloud to the octree directly from the property arrays,
+         * transformed on the fly into the unit cube of the octree. No intermediate copy of the data is made.
+         */
+        template<class Real>
+        class PointCloudStream : public OrientedPointStreamWithData<Real, Point3D<Real> > {
+        public:
+            PointCloudStream(const vec3 *points, const vec3 *normals, const vec3 *colors, std::size_t num,
+                             const XForm4x4<Real> &xForm)
+                    : points_(points), normals_(normals), colors_(colors), num_(num), current_(0), xForm_(xForm) {
+                for (int i = 0; i < 3; i++)
+                    for (int j = 0; j < 3; j++)
+                        normalXForm_(i, j) = xForm(i, j);
+                normalXForm_ = normalXForm_.transpose().inverse();
+            }
+
+            using OrientedPointStreamWithData<Real, Point3D<Real> >::nextPoint;
+
+            void reset(void) override { current_ = 0; }
+
+            bool nextPoint(OrientedPoint3D<Real> &p, Point3D<Real> &d) override {
+                if (current_ >= num_)
+                    return false;
+                const vec3 &v = points_[current_];
+                const vec3 &n = normals_[current_];
+                p.p = xForm_ * Point3D<Real>(v.x, v.y, v.z);
+                p.n = normalXForm_ * Point3D<Real>(n.x, n.y, n.z);
+                if (colors_) {
+                    const vec3 &c = colors_[current_];
+                    d = Point3D<Real>(c.r * 255, c.g * 255, c.b * 255); // the color range in Misha's code is [0, 255]
+                }
+                ++current_;
+                return true;
+            }
+
+        private:
+            const vec3 *points_;
+            const vec3 *normals_;
+            const vec3 *colors_;
+            std::size_t num_;
+            std::size_t current_;
+            XForm4x4<Real> xForm_;
+            XForm3x3<Real> normalXForm_;
+        };
+
+
+        // Estimates the memory (in MB) required by the octree and the linear system from the number of leaf nodes
+        // containing samples. The active nodes after finalizing the tree are roughly proportional to the occupied
+        // leaves, and the peak is reached when solving the system. The constants are (conservatively) measured from
+        // the peak resident memory at depths 6 to 9, which is 1.4 ~ 2.3 KB per occupied leaf.
+        inline double estimated_memory_usage(std::size_t num_samples, bool has_colors) {
+            const double bytes_per_sample = has_colors ? 2100.0 : 2000.0;
+            return num_samples * bytes_per_sample / (1 << 20);
+        }
+
+
         template<class Vertex>
         SurfaceMesh *
         convert_to_mesh(CoredFileMeshData<Vertex> &mesh, const XForm4x4<REAL> &iXForm,
@@ -133,6 +162,8 @@ namespace easy3d {
                 color = result->add_vertex_property<vec3>("v:color");
 
             std::vector<SurfaceMesh::Vertex> all_vertices;
+            all_vertices.reserve(num_ic_pts + num_ooc_pts);
+            result->reserve(num_ic_pts + num_ooc_pts, num_ic_pts + num_ooc_pts + num_face, num_face);
 
             REAL min_density = FLT_MAX;
             REAL max_density = -FLT_MAX;
@@ -194,6 +225,8 @@ namespace easy3d {
     // \endcond
 
     SurfaceMesh *PoissonReconstruction::apply(const PointCloud *cloud, const std::string &density_attr_name) {
+        stats_ = Statistics();
+
         if (!cloud) {
             LOG(ERROR) << "nullptr point cloud";
             return nullptr;
@@ -204,57 +237,48 @@ namespace easy3d {
             LOG(ERROR) << "normal information not exist for Poisson surface reconstruction method";
             return nullptr;
         }
+        PointCloud::VertexProperty<vec3> colors = cloud->get_vertex_property<vec3>("v:color");
 
         typedef typename Octree<REAL>::template DensityEstimator<WEIGHT_DEGREE> DensityEstimator;
         typedef typename Octree<REAL>::template InterpolationInfo<false> InterpolationInfo;
 
         REAL isoValue = 0;
 
-        //if (OctNode< TreeNodeData >::NodeAllocator.blockSize != MEMORY_ALLOCATOR_BLOCK_SIZE)
-        OctNode<TreeNodeData>::SetAllocator(MEMORY_ALLOCATOR_BLOCK_SIZE);
-
-        Reset<REAL>();
-        Octree<REAL> tree;
-        OctreeProfiler<REAL> profiler(tree);
-        tree.threads = threads_;
-
-        int maxSolveDepth = depth_;
-        int kernelDepth = depth_ - 2;
-        if (kernelDepth > depth_) {
-            LOG(ERROR) << "kernelDepth (" << kernelDepth << ") cannot be greater than tree depth (" << depth_ << ")";
-            kernelDepth = depth_;
-        }
+        const int threads = threads_ > 0 ? threads_ : omp_get_num_procs();
 
         //////////////////////////////////////////////////////////////////////////
 
         LOG(INFO) << "Screened Poisson Reconstruction (V9.0.1)";
+        if (verbose_)
+            LOG(INFO) << "number of threads: " << threads;
         StopWatch t, w;
 
+        // records the time and the memory usage of a stage
+        auto stage_done = [&](Octree<REAL> &tree, double &time, const char *name) -> void {
+            time = t.elapsed_seconds(6);
+            tree.memoryUsage();
+            if (verbose_)
+                LOG(INFO) << " - " << name << ": " << t.time_string() << ", " << tree.localMemoryUsage() << " MB";
+        };
+
         //////////////////////////////////////////////////////////////////////////
 
-        int pointCount;
+        int pointCount = 0;
+        int maxSolveDepth = depth_;
 
         REAL pointWeightSum;
         std::vector<typename Octree<REAL>::PointSample> *samples = new std::vector<typename Octree<REAL>::PointSample>();
         std::vector<ProjectiveData<Point3D<REAL>, REAL> > *sampleData = nullptr;
+        if (colors)
+            sampleData = new std::vector<ProjectiveData<Point3D<REAL>, REAL> >();
         DensityEstimator *density = nullptr;
         SparseNodeData<Point3D<REAL>, NORMAL_DEGREE> *normalInfo = nullptr;
         REAL targetValue = (REAL) 0.5;
         XForm4x4<REAL> xForm, iXForm;
+        std::unique_ptr<Octree<REAL> > octree;
 
         { // Load the samples (and color data)
             LOG(INFO) << "loading data into tree... ";
-            t.restart();
-            profiler.start();
-            const float *pts = cloud->points()[0];
-            const float *nms = normals.vector()[0];
-            const float *cls = 0;
-            PointCloud::VertexProperty<vec3> colors = cloud->get_vertex_property<vec3>("v:color");
-            if (colors) {
-                cls = colors.vector()[0];
-                sampleData = new std::vector<ProjectiveData<Point3D<REAL>, REAL> >();
-            }
-
             xForm = XForm4x4<REAL>::Identity();
             {
                 const Box3 &box = cloud->bounding_box();
@@ -271,22 +295,59 @@ namespace easy3d {
                     sXForm(i, i) = (REAL) (1. / scale), tXForm(3, i) = -center[i];
                 xForm = (sXForm * tXForm) * xForm;
             }
-
-            pointCount = tree.init<Point3D<REAL> >(cloud->n_vertices(), pts, nms, cls, xForm, maxSolveDepth, false,
-                                                   *samples, sampleData);
             iXForm = xForm.inverse();
 
-#pragma omp parallel for num_threads(threads_)
+            details::PointCloudStream<REAL> stream(cloud->points().data(), normals.vector().data(),
+                                                   colors ? colors.vector().data() : nullptr, cloud->n_vertices(),
+                                                   xForm);
+            while (true) {
+                t.restart();
+                octree.reset();
+                // this also releases the nodes of a previous (over budget) attempt
+                OctNode<TreeNodeData>::SetAllocator(MEMORY_ALLOCATOR_BLOCK_SIZE);
+                Reset<REAL>();
+                octree.reset(new Octree<REAL>);
+                octree->threads = threads;
+                octree->resetLocalMemoryUsage();
+
+                samples->clear();
+                if (sampleData)
+                    sampleData->clear();
+                pointCount = octree->template init<Point3D<REAL> >(stream, maxSolveDepth, false, *samples, sampleData);
+                stats_.estimated_memory = details::estimated_memory_usage(samples->size(), sampleData != nullptr);
+
+                if (memory_budget_ == 0 || stats_.estimated_memory <= memory_budget_ || maxSolveDepth <= full_depth_)
+                    break;
+                LOG(WARNING) << "estimated memory at depth " << maxSolveDepth << " (" << stats_.estimated_memory
+                             << " MB) exceeds the budget (" << memory_budget_ << " MB). Retrying with depth "
+                             << maxSolveDepth - 1;
+                --maxSolveDepth;
+            }
+            if (memory_budget_ > 0 && stats_.estimated_memory > memory_budget_)
+                LOG(WARNING) << "estimated memory (" << stats_.estimated_memory << " MB) exceeds the budget ("
+                             << memory_budget_ << " MB) even at the full depth " << maxSolveDepth;
+
+#pragma omp parallel for num_threads(threads)
             for (int i = 0; i < (int) samples->size(); i++)
                 (*samples)[i].sample.data.n *= (REAL) -1;
 
-            if (verbose_)
-                profiler.print(" - Load input into tree: ");
+            stage_done(*octree, stats_.time_load, "Load input into tree");
 
             LOG(INFO) << "input points/samples: " << pointCount << "/" << samples->size() <<
                       ". memory usage: " << float(MemoryInfo::Usage()) / (1 << 20) << " MB. " << t.time_string();
         }
 
+        Octree<REAL> &tree = *octree;
+        stats_.depth = maxSolveDepth;
+        stats_.num_points = pointCount;
+        stats_.num_samples = samples->size();
+
+        int kernelDepth = maxSolveDepth - 2;
+        if (kernelDepth > maxSolveDepth) {
+            LOG(ERROR) << "kernelDepth (" << kernelDepth << ") cannot be greater than tree depth (" << maxSolveDepth << ")";
+            kernelDepth = maxSolveDepth;
+        }
+
         //////////////////////////////////////////////////////////////////////////
 
         DenseNodeData<REAL, DEGREE> solution;
@@ -300,21 +361,19 @@ namespace easy3d {
             // Get the kernel density estimator [If discarding, compute anew. Otherwise, compute once.]
             {
                 t.restart();
-                profiler.start();
+                tree.resetLocalMemoryUsage();
                 density = tree.setDensityEstimator<WEIGHT_DEGREE>(*samples, kernelDepth, samples_per_node_);
-                if (verbose_)
-                    profiler.print(" - Got kernel density:   ");
+                stage_done(tree, stats_.time_density, "Got kernel density");
             }
 
             // Transform the Hermite samples into a vector field [If discarding, compute anew. Otherwise, compute once.]
             {
                 LOG(INFO) << "setting normal field... ";
                 t.restart();
-                profiler.start();
+                tree.resetLocalMemoryUsage();
                 normalInfo = new SparseNodeData<Point3D<REAL>, NORMAL_DEGREE>();
                 *normalInfo = tree.setNormalField<NORMAL_DEGREE>(*samples, *density, pointWeightSum, true);
-                if (verbose_)
-                    profiler.print(" - Got normal field:     ");
+                stage_done(tree, stats_.time_normal_field, "Got normal field");
 
                 LOG(INFO) << "memory usage: " << float(MemoryInfo::Usage()) / (1 << 20) << " MB. "
                           << t.time_string();
@@ -325,7 +384,7 @@ namespace easy3d {
                 LOG(INFO) << "trimming tree and preparing for multi-grid... ";
 
                 t.restart();
-                profiler.start();
+                tree.resetLocalMemoryUsage();
                 std::vector<int> indexMap;
 
                 constexpr int MAX_DEGREE = NORMAL_DEGREE > DEGREE ? NORMAL_DEGREE : DEGREE;
@@ -337,8 +396,7 @@ namespace easy3d {
                     normalInfo->remapIndices(indexMap);
                 if (density)
                     density->remapIndices(indexMap);
-                if (verbose_)
-                    profiler.print(" - Finalized tree:       ");
+                stage_done(tree, stats_.time_finalize, "Finalized tree");
 
                 LOG(INFO) << "memory usage: " << float(MemoryInfo::Usage()) / (1 << 20) << " MB. "
                           << t.time_string();
@@ -347,31 +405,27 @@ namespace easy3d {
             // Add the FEM constraints
             {
                 t.restart();
-                profiler.start();
+                tree.resetLocalMemoryUsage();
                 constraints = tree.initDenseNodeData<DEGREE>();
                 tree.addFEMConstraints<DEGREE, BType, NORMAL_DEGREE, BType>(
                         FEMVFConstraintFunctor<NORMAL_DEGREE, BType, DEGREE, BType>(1., 0.), *normalInfo, constraints,
                         solveDepth);
-                if (verbose_)
-                    profiler.print(" - Set FEM constraints:  ");
-            }
 
-            // Free up the normal info [If we don't need it for subsequent iterations.]
-            delete normalInfo;
-            normalInfo = nullptr;
+                // Free up the normal info [If we don't need it for subsequent iterations.]
+                delete normalInfo;
+                normalInfo = nullptr;
 
-            // Add the interpolation constraints
-            if (pointWeight_ > 0) {
-                t.restart();
-                profiler.start();
-                int AdaptiveExponent = 1;
-                iInfo = new InterpolationInfo(tree, *samples, targetValue, AdaptiveExponent,
-                                              (REAL) pointWeight_ * pointWeightSum, (REAL) 0);
-                tree.addInterpolationConstraints<DEGREE, BType>(*iInfo, constraints, solveDepth);
-                if (verbose_)
-                    profiler.print(" - Set point constraints:");
+                // Add the interpolation constraints
+                if (pointWeight_ > 0) {
+                    int AdaptiveExponent = 1;
+                    iInfo = new InterpolationInfo(tree, *samples, targetValue, AdaptiveExponent,
+                                                  (REAL) pointWeight_ * pointWeightSum, (REAL) 0);
+                    tree.addInterpolationConstraints<DEGREE, BType>(*iInfo, constraints, solveDepth);
+                }
+                stage_done(tree, stats_.time_constraints, "Set FEM and point constraints");
             }
 
+            stats_.num_nodes = tree.nodes();
             if (verbose_) {
                 LOG(INFO) << " - Leaf Nodes / Active Nodes / Ghost Nodes: " << (int) tree.leaves() << " / "
                           << (int) tree.nodes() << " / " << (int) tree.ghostNodes();
@@ -382,7 +436,7 @@ namespace easy3d {
                 LOG(INFO) << "solving the linear system... ";
 
                 t.restart();
-                profiler.start();
+                tree.resetLocalMemoryUsage();
                 typename Octree<REAL>::SolverInfo solverInfo;
 
                 bool showResidual = false;
@@ -392,8 +446,7 @@ namespace easy3d {
                         1., 1.);
                 solution = tree.solveSystem<DEGREE, BType>(FEMSystemFunctor<DEGREE, BType>(0, 1., 0), iInfo,
                                                            constraints, solveDepth, solverInfo);
-                if (verbose_)
-                    profiler.print(" - Linear system solved: ");
+                stage_done(tree, stats_.time_solve, "Linear system solved");
                 if (iInfo)
                     delete iInfo, iInfo = nullptr;
 
@@ -407,10 +460,10 @@ namespace easy3d {
         CoredFileMeshData<PlyColorAndValueVertex<REAL> > mesh;
         {
             t.restart();
-            profiler.start();
+            tree.resetLocalMemoryUsage();
             double valueSum = 0, weightSum = 0;
-            typename Octree<REAL>::template MultiThreadedEvaluator<DEGREE, BType> evaluator(&tree, solution, threads_);
-#pragma omp parallel for num_threads(threads_) reduction( + : valueSum, weightSum )
+            typename Octree<REAL>::template MultiThreadedEvaluator<DEGREE, BType> evaluator(&tree, solution, threads);
+#pragma omp parallel for num_threads(threads) reduction( + : valueSum, weightSum )
             for (int j = 0; j < samples->size(); j++) {
                 ProjectiveData<OrientedPoint3D<REAL>, REAL> &sample = (*samples)[j].sample;
                 REAL w = sample.weight;
@@ -420,20 +473,18 @@ namespace easy3d {
             }
             isoValue = (REAL) (valueSum / weightSum);
 
-            PointCloud::VertexProperty<vec3> colors = cloud->get_vertex_property<vec3>("v:color");
             if (!colors && samples)
                 delete samples, samples = nullptr;
-            if (verbose_) {
-                profiler.print(" - Got average:          ");
+            stage_done(tree, stats_.time_iso_value, "Got average");
+            if (verbose_)
                 LOG(INFO) << " - Iso-Value: " << isoValue;
-            }
         }
 
         {
             LOG(INFO) << "extracting mesh... ";
 
             t.restart();
-            profiler.start();
+            tree.resetLocalMemoryUsage();
             SparseNodeData<ProjectiveData<Point3D<REAL>, REAL>, DATA_DEGREE> *colorData = nullptr;
             if (sampleData) {
                 float colorValue = 16.0f;
@@ -454,14 +505,11 @@ namespace easy3d {
                                                                             mesh, nonLinearFit, addBarycenter,
                                                                             !triangulate_mesh_);
 
-            if (verbose_) {
-                LOG(INFO) << " - Vertices / Polygons: " << mesh.outOfCorePointCount() + mesh.inCorePoints.size()
-                          << " / " << mesh.polygonCount();
-                if (!triangulate_mesh_)
-                    profiler.print(" - Got polygons:         ");
-                else
-                    profiler.print(" - Got triangles:        ");
-            }
+            stats_.num_vertices = mesh.outOfCorePointCount() + mesh.inCorePoints.size();
+            stats_.num_faces = mesh.polygonCount();
+            if (verbose_)
+                LOG(INFO) << " - Vertices / Polygons: " << stats_.num_vertices << " / " << stats_.num_faces;
+            stage_done(tree, stats_.time_extraction, triangulate_mesh_ ? "Got triangles" : "Got polygons");
 
             if (colorData) {
                 delete colorData;
@@ -478,11 +526,14 @@ namespace easy3d {
 
             LOG(INFO) << "memory usage: " << float(MemoryInfo::Usage()) / (1 << 20) << " MB. " << t.time_string();
         }
+        stats_.peak_memory = tree.maxMemoryUsage();
 
         //////////////////////////////////////////////////////////////////////////
 
-        PointCloud::VertexProperty<vec3> colors = cloud->get_vertex_property<vec3>("v:color");
         SurfaceMesh *result = details::convert_to_mesh(mesh, iXForm, density_attr_name, colors);
+        stats_.time_total = w.elapsed_seconds(6);
+        if (!result)
+            return nullptr;
         const std::string &file_name = file_system::name_less_extension(cloud->name()) + "_Poisson.ply";
         result->set_name(file_name);
         LOG(INFO) << "total reconstruction time: " << w.time_string();
@@ -27,6 +27,7 @@
 
 
 #include <string>
+#include <cstddef>
 
 
 namespace easy3d {
@@ -59,6 +60,49 @@ namespace easy3d {
          */
         void set_sampers_per_node(float s) { samples_per_node_ = s; }
 
+        /**
+         * \brief Set the number of threads used by the reconstruction.
+         * A value <= 0 (the default) uses all available processors.
+         */
+        void set_threads(int n) { threads_ = n; }
+
+        /**
+         * \brief Set an upper bound of the memory (in MB) the octree and the linear system may use.
+         * The memory requirement is estimated right after the samples are loaded into the octree. If it exceeds the
+         * budget, the reconstruction depth is reduced (but not below the full depth) until it fits. A value of 0 (the
+         * default) means no limit. The extracted mesh is always streamed to temporary files and thus not counted.
+         */
+        void set_memory_budget(std::size_t mb) { memory_budget_ = mb; }
+
+        /// \brief Timing and memory statistics of a reconstruction.
+        struct Statistics {
+            Statistics();
+
+            int depth;                  ///< the reconstruction depth actually used (may be lowered by the budget)
+            std::size_t num_points;     ///< the number of input points loaded into the octree
+            std::size_t num_samples;    ///< the number of leaf nodes containing samples
+            std::size_t num_nodes;      ///< the number of active octree nodes of the linear system
+            std::size_t num_vertices;   ///< the number of vertices of the reconstructed mesh
+            std::size_t num_faces;      ///< the number of faces of the reconstructed mesh
+
+            double estimated_memory;    ///< the estimated memory (in MB) of the octree and the linear system
+            double peak_memory;         ///< the peak memory usage (in MB) of the process during the reconstruction
+
+            // the time (in seconds) spent on each stage
+            double time_load;           ///< loading the samples into the octree
+            double time_density;        ///< estimating the kernel density
+            double time_normal_field;   ///< setting the normal field
+            double time_finalize;       ///< finalizing the octree for multi-grid
+            double time_constraints;    ///< adding the FEM and the interpolation constraints
+            double time_solve;          ///< solving the linear system
+            double time_iso_value;      ///< computing the iso-value
+            double time_extraction;     ///< extracting the iso-surface
+            double time_total;          ///< the whole reconstruction (including the conversion to SurfaceMesh)
+        };
+
+        /// \brief Returns the statistics of the last call to apply().
+        const Statistics &statistics() const { return stats_; }
+
         /// \brief reconstruction
         SurfaceMesh *apply(const PointCloud *cloud, const std::string &density_attr_name = "v:density");
 
@@ -129,6 +173,9 @@ namespace easy3d {
         bool confidence_;
         bool normalWeight_;
         bool verbose_;
+
+        std::size_t memory_budget_; // in MB, 0 means no limit
+        Statistics stats_;
     };
 
 } // namespace easy3d
@@ -28,6 +28,8 @@
 #include <list>
 
 #include <easy3d/core/point_cloud.h>
+#include <easy3d/util/progress.h>
+#include <easy3d/util/stop_watch.h>
 
 #include <3rd_party/ransac/RansacShapeDetector.h>
 #include <3rd_party/ransac/PlanePrimitiveShapeConstructor.h>
@@ -58,7 +60,8 @@ namespace easy3d {
                 float dist_thresh,
                 float bitmap_reso,
                 float normal_thresh,
-                float overlook_prob
+                float overlook_prob,
+                unsigned int seed
         ) {
             const Box3 &box = cloud->bounding_box();
             pc.setBBox(
@@ -71,6 +74,7 @@ namespace easy3d {
             //////////////////////////////////////////////////////////////////////////
 
             LOG(INFO) << "detecting primitives...";
+            StopWatch w;
 
             RansacShapeDetector::Options ransacOptions;
             ransacOptions.m_minSupport = min_support;
@@ -78,6 +82,7 @@ namespace easy3d {
             ransacOptions.m_bitmapEpsilon = bitmap_reso * pc.getScale();
             ransacOptions.m_normalThresh = normal_thresh;
             ransacOptions.m_probability = overlook_prob;
+            ransacOptions.m_seed = seed;
 
             RansacShapeDetector detector(ransacOptions); // the detector object
 
@@ -113,7 +118,14 @@ namespace easy3d {
             // i.e. into the range [ pc.size() - shapes[0].second, pc.size() )
             // the points of shape i are found in the range
             // [ pc.size() - \sum_{j=0..i} shapes[j].second, pc.size() - \sum_{j=0..i-1} shapes[j].second )
+            ProgressLogger progress(100, false, false);
+            detector.SetProgressCallback([&progress](float p) -> bool {
+                progress.notify(static_cast<std::size_t>(p * 100));
+                return !progress.is_canceled();
+            });
             std::size_t remaining = detector.Detect(pc, 0, pc.size(), &shapes); // run detection
+            if (progress.is_canceled())
+                LOG(WARNING) << "primitive detection cancelled. Primitives detected so far are kept";
 
             PointCloud_Ransac::reverse_iterator start = pc.rbegin();
             MiscLib::Vector<std::pair<MiscLib::RefCountPtr<PrimitiveShape>, std::size_t> >::const_iterator shape_itr = shapes.begin();
@@ -217,7 +229,7 @@ namespace easy3d {
                 ++index;
             }
 
-            LOG(INFO) << index << " primitives extracted. " << remaining << " points remained";
+            LOG(INFO) << index << " primitives extracted. " << remaining << " points remained. " << w.time_string();
             return index;
         }
     }
@@ -274,7 +286,7 @@ namespace easy3d {
             pc[i].index = i;
         }
 
-        return details::do_detect(cloud, pc, types_, min_support, dist_thresh, bitmap_reso, normal_thresh, overlook_prob);
+        return details::do_detect(cloud, pc, types_, min_support, dist_thresh, bitmap_reso, normal_thresh, overlook_prob, seed_);
     }
 
 
@@ -325,7 +337,7 @@ namespace easy3d {
             pc[index].index = idx;
         }
 
-        return details::do_detect(cloud, pc, types_, min_support, dist_thresh, bitmap_reso, normal_thresh, overlook_prob);
+        return details::do_detect(cloud, pc, types_, min_support, dist_thresh, bitmap_reso, normal_thresh, overlook_prob, seed_);
     }
 
 }
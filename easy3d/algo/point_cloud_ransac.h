@@ -42,6 +42,8 @@ namespace easy3d {
     ///     ransac.add_primitive_type(PrimitivesRansac::PLANE);
     ///     int num = ransac.detect(cloud);
     ///     \endcode
+    /// Candidates are generated and scored in parallel (if OpenMP is available). The detection reports its
+    /// progress through ProgressLogger and can be canceled, in which case the primitives found so far are kept.
 
     class PrimitivesRansac {
     public:
@@ -55,9 +57,17 @@ namespace easy3d {
         };
 
     public:
+        PrimitivesRansac() : seed_(0) {}
+
         /// \brief Setup the primitive types to be extracted. This is done by adding the interested primitive type one by one.
         void add_primitive_type(PrimType t);
 
+        /// \brief Sets the seed of the random number generator (default: 0). Running the detection on the same data
+        ///        with the same parameters and seed gives identical primitives, regardless of the number of threads.
+        void set_random_seed(unsigned int seed) { seed_ = seed; }
+        /// \brief Returns the seed of the random number generator.
+        unsigned int random_seed() const { return seed_; }
+
         /// \brief Extract primitives from the entire point cloud. \par
         /// Returns the number of extracted primitives.
         /// The extracted primitives are stored as properties:
@@ -91,6 +101,7 @@ namespace easy3d {
 
     private:
         std::set<PrimType> types_;
+        unsigned int seed_;
     };
 
 }
@@ -0,0 +1,388 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <easy3d/algo/point_cloud_registration.h>
+
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/algo/point_cloud_simplification.h>
+#include <easy3d/kdtree/kdtree_search_nanoflann.h>
+#include <easy3d/util/logging.h>
+#include <easy3d/util/stop_watch.h>
+
+#include <Eigen/Dense>
+
+
+namespace easy3d {
+
+    //  \cond
+    namespace details {
+
+        // The normal equations are accumulated in blocks of consecutive points and the blocks are summed in order,
+        // so the result doesn't depend on the number of threads.
+        const int kBlockSize = 4096;
+
+        // The sums of the weighted correspondences (p, q) with the normal n of q. The coordinates are relative to a
+        // fixed center to avoid cancellation.
+        struct Accumulator {
+            Accumulator() { std::fill(data, data + kSize, 0.0); }
+
+            // point-to-point: weight, sum of squared distances, weighted sums of p and q, and of p * q^T
+            double &w() { return data[0]; }
+            double &sqr_error() { return data[1]; }
+            double *p() { return data + 2; }
+            double *q() { return data + 5; }
+            double *pq() { return data + 8; }     // 3 x 3, row major
+            // point-to-plane: the normal equations A x = b (A is 6 x 6, row major)
+            double *A() { return data + 17; }
+            double *b() { return data + 53; }
+
+            void add(const Accumulator &other) {
+                for (int i = 0; i < kSize; ++i)
+                    data[i] += other.data[i];
+            }
+
+            static const int kSize = 59;
+            double data[kSize];
+        };
+
+
+        // one level of the registration: the source points and the target point cloud (with its kd-tree)
+        struct Level {
+            std::vector<vec3> source;
+            PointCloud *target;
+            std::unique_ptr<PointCloud> simplified_target;    // owned if the target is simplified
+            std::unique_ptr<KdTreeSearch_NanoFLANN> tree;
+        };
+
+
+        // the points kept by the grid simplification with the given cell size
+        std::vector<int> simplify(PointCloud *cloud, float cell_size) {
+            const auto removed = PointCloudSimplification::grid_simplification(cloud, cell_size);
+            std::vector<unsigned char> keep(cloud->vertices_size(), 1);
+            for (auto v : removed)
+                keep[v.idx()] = 0;
+            std::vector<int> kept;
+            for (auto v : cloud->vertices()) {
+                if (keep[v.idx()])
+                    kept.push_back(v.idx());
+            }
+            return kept;
+        }
+
+
+        Eigen::Matrix4d to_eigen(const mat4 &m) {
+            Eigen::Matrix4d result;
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j)
+                    result(i, j) = m(i, j);
+            }
+            return result;
+        }
+
+
+        mat4 to_mat4(const Eigen::Matrix4d &m) {
+            mat4 result;
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j)
+                    result(i, j) = static_cast<float>(m(i, j));
+            }
+            return result;
+        }
+
+    }
+    //  \endcond
+
+
+    PointCloudRegistration::PointCloudRegistration()
+            : method_(POINT_TO_POINT), max_iterations_(50), max_distance_(0.0f), trim_ratio_(1.0f), robust_(false),
+              num_levels_(1), convergence_threshold_(1e-6f), rms_error_(0.0f), inlier_ratio_(0.0f),
+              num_iterations_(0) {
+    }
+
+
+    mat4 PointCloudRegistration::apply(PointCloud *source, PointCloud *target, const mat4 &init) {
+        rms_error_ = 0.0f;
+        inlier_ratio_ = 0.0f;
+        num_iterations_ = 0;
+
+        if (!source || !target || source->n_vertices() < 3 || target->n_vertices() < 3) {
+            LOG(ERROR) << "registration requires two point clouds (each having at least 3 points)";
+            return mat4::identity();
+        }
+        if (source->has_garbage() || target->has_garbage()) {
+            LOG(ERROR) << "the point clouds have deleted points (call collect_garbage() first)";
+            return mat4::identity();
+        }
+
+        Method method = method_;
+        auto target_normals = target->get_vertex_property<vec3>("v:normal");
+        if (method == POINT_TO_PLANE && !target_normals) {
+            LOG(WARNING) << "point-to-plane registration requires normals of the target point cloud. "
+                            "Point-to-point is used instead";
+            method = POINT_TO_POINT;
+        }
+
+        StopWatch w;
+        const Box3 &box = target->bounding_box();
+        const double diagonal = box.diagonal();
+        const Eigen::Vector3d center(box.center().x, box.center().y, box.center().z);
+        const double max_sqr_dist = max_distance_ > 0.0f ? double(max_distance_) * max_distance_ : -1.0;
+
+        // the resolutions, from the coarsest to the finest (i.e., the input point clouds)
+        const int num_levels = std::max(1, num_levels_);
+        std::vector<details::Level> levels(num_levels);
+        for (int l = 0; l < num_levels; ++l) {
+            details::Level &level = levels[l];
+            if (l == num_levels - 1) {
+                level.source = source->points();
+                level.target = target;
+            } else {
+                const float cell_size = static_cast<float>(0.005 * diagonal * std::pow(2.0, num_levels - 2 - l));
+                for (auto idx : details::simplify(source, cell_size))
+                    level.source.push_back(source->points()[idx]);
+
+                level.simplified_target.reset(new PointCloud);
+                PointCloud *cloud = level.simplified_target.get();
+                PointCloud::VertexProperty<vec3> normals;
+                if (target_normals)
+                    normals = cloud->add_vertex_property<vec3>("v:normal");
+                for (auto idx : details::simplify(target, cell_size)) {
+                    auto v = cloud->add_vertex(target->points()[idx]);
+                    if (target_normals)
+                        normals[v] = target_normals.vector()[idx];
+                }
+                level.target = cloud;
+            }
+            level.tree.reset(new KdTreeSearch_NanoFLANN);
+            level.tree->begin();
+            level.tree->add_point_cloud(level.target);
+            level.tree->end();
+        }
+
+        Eigen::Matrix4d T = details::to_eigen(init);
+        for (int l = 0; l < num_levels; ++l) {
+            const details::Level &level = levels[l];
+            const std::vector<vec3> &points = level.source;
+            const std::vector<vec3> &target_points = level.target->points();
+            const vec3 *normals = nullptr;
+            if (method == POINT_TO_PLANE)
+                normals = level.target->get_vertex_property<vec3>("v:normal").vector().data();
+            const KdTreeSearch *tree = level.tree.get();
+
+            const int num = static_cast<int>(points.size());
+            const int num_blocks = (num + details::kBlockSize - 1) / details::kBlockSize;
+            std::vector<vec3> transformed(num);
+            std::vector<int> matches(num);
+            std::vector<float> sqr_dists(num);
+            std::vector<details::Accumulator> blocks(num_blocks);
+
+            int iter = 0;
+            for (; iter < max_iterations_; ++iter) {
+                // correspondences
+                const mat4 M = details::to_mat4(T);
+#pragma omp parallel for schedule(static)
+                for (int i = 0; i < num; ++i) {
+                    transformed[i] = M * points[i];
+                    matches[i] = tree->find_closest_point(transformed[i], sqr_dists[i]);
+                    if (max_sqr_dist >= 0.0 && sqr_dists[i] > max_sqr_dist)
+                        matches[i] = -1;
+                }
+
+                // trimming: only the closest correspondences are used
+                double sqr_dist_threshold = max_sqr_dist;
+                std::vector<float> dists;
+                dists.reserve(num);
+                for (int i = 0; i < num; ++i) {
+                    if (matches[i] >= 0)
+                        dists.push_back(sqr_dists[i]);
+                }
+                if (trim_ratio_ < 1.0f && !dists.empty()) {
+                    const std::size_t k = std::min(dists.size() - 1, static_cast<std::size_t>(
+                            std::ceil(trim_ratio_ * dists.size())) - 1);
+                    std::nth_element(dists.begin(), dists.begin() + k, dists.end());
+                    sqr_dist_threshold = dists[k];
+                    dists.resize(k + 1);
+                }
+
+                // robust weights: Huber kernel with the scale estimated from the median residual
+                double huber = -1.0;
+                if (robust_ && !dists.empty()) {
+                    const std::size_t m = dists.size() / 2;
+                    std::nth_element(dists.begin(), dists.begin() + m, dists.end());
+                    const double sigma = 1.4826 * std::sqrt(dists[m]);
+                    if (sigma > 0.0)
+                        huber = 1.345 * sigma;
+                }
+
+                // the normal equations
+#pragma omp parallel for schedule(static)
+                for (int b = 0; b < num_blocks; ++b) {
+                    details::Accumulator acc;
+                    const int end = std::min(num, (b + 1) * details::kBlockSize);
+                    for (int i = b * details::kBlockSize; i < end; ++i) {
+                        const int j = matches[i];
+                        if (j < 0 || (sqr_dist_threshold >= 0.0 && sqr_dists[i] > sqr_dist_threshold))
+                            continue;
+                        const Eigen::Vector3d p = Eigen::Vector3d(transformed[i].x, transformed[i].y, transformed[i].z) - center;
+                        const vec3 &t = target_points[j];
+                        const Eigen::Vector3d q = Eigen::Vector3d(t.x, t.y, t.z) - center;
+
+                        double weight = 1.0;
+                        if (huber > 0.0) {
+                            const double r = std::sqrt(double(sqr_dists[i]));
+                            if (r > huber)
+                                weight = huber / r;
+                        }
+                        acc.w() += weight;
+                        acc.sqr_error() += sqr_dists[i];
+
+                        if (method == POINT_TO_POINT) {
+                            for (int r = 0; r < 3; ++r) {
+                                acc.p()[r] += weight * p[r];
+                                acc.q()[r] += weight * q[r];
+                                for (int c = 0; c < 3; ++c)
+                                    acc.pq()[r * 3 + c] += weight * p[r] * q[c];
+                            }
+                        } else {
+                            const vec3 &nt = normals[j];
+                            const Eigen::Vector3d n(nt.x, nt.y, nt.z);
+                            Eigen::Matrix<double, 6, 1> J;
+                            J << p.cross(n), n;
+                            const double residual = (p - q).dot(n);
+                            for (int r = 0; r < 6; ++r) {
+                                acc.b()[r] += weight * J[r] * residual;
+                                for (int c = 0; c < 6; ++c)
+                                    acc.A()[r * 6 + c] += weight * J[r] * J[c];
+                            }
+                        }
+                    }
+                    blocks[b] = acc;
+                }
+                details::Accumulator sum;
+                int num_used = 0;
+                for (int b = 0; b < num_blocks; ++b)
+                    sum.add(blocks[b]);
+                for (int i = 0; i < num; ++i) {
+                    if (matches[i] >= 0 && (sqr_dist_threshold < 0.0 || sqr_dists[i] <= sqr_dist_threshold))
+                        ++num_used;
+                }
+                rms_error_ = num_used > 0 ? static_cast<float>(std::sqrt(sum.sqr_error() / num_used)) : 0.0f;
+                inlier_ratio_ = num > 0 ? static_cast<float>(num_used) / num : 0.0f;
+
+                const int min_required = (method == POINT_TO_POINT ? 3 : 6);
+                if (num_used < min_required || sum.w() <= 0.0) {
+                    LOG(WARNING) << "too few correspondences (" << num_used << ") for registration";
+                    break;
+                }
+
+                // the incremental transformation (in coordinates relative to the center)
+                Eigen::Matrix3d R;
+                Eigen::Vector3d t;
+                if (method == POINT_TO_POINT) {
+                    const Eigen::Vector3d mp = Eigen::Map<Eigen::Vector3d>(sum.p()) / sum.w();
+                    const Eigen::Vector3d mq = Eigen::Map<Eigen::Vector3d>(sum.q()) / sum.w();
+                    const Eigen::Matrix3d H = Eigen::Map<Eigen::Matrix<double, 3, 3, Eigen::RowMajor> >(sum.pq()) -
+                                              sum.w() * mp * mq.transpose();
+                    Eigen::JacobiSVD<Eigen::Matrix3d> svd(H, Eigen::ComputeFullU | Eigen::ComputeFullV);
+                    Eigen::Matrix3d D = Eigen::Matrix3d::Identity();
+                    if ((svd.matrixV() * svd.matrixU().transpose()).determinant() < 0)
+                        D(2, 2) = -1.0;    // avoid reflections
+                    R = svd.matrixV() * D * svd.matrixU().transpose();
+                    t = mq - R * mp;
+                } else {
+                    const Eigen::Matrix<double, 6, 6> A = Eigen::Map<Eigen::Matrix<double, 6, 6, Eigen::RowMajor> >(sum.A());
+                    const Eigen::Matrix<double, 6, 1> b = Eigen::Map<Eigen::Matrix<double, 6, 1> >(sum.b());
+                    const Eigen::Matrix<double, 6, 1> x = A.ldlt().solve(-b);
+                    const Eigen::Vector3d omega = x.head<3>();
+                    const double angle = omega.norm();
+                    R = angle > 0.0 ? Eigen::AngleAxisd(angle, omega / angle).toRotationMatrix() : Eigen::Matrix3d::Identity();
+                    t = x.tail<3>();
+                }
+
+                if (!R.allFinite() || !t.allFinite()) {
+                    LOG(WARNING) << "registration failed (degenerate configuration)";
+                    break;
+                }
+
+                // x' = R (x - c) + t + c
+                Eigen::Matrix4d delta = Eigen::Matrix4d::Identity();
+                delta.block<3, 3>(0, 0) = R;
+                delta.block<3, 1>(0, 3) = t + center - R * center;
+                T = delta * T;
+
+                const double rotation = std::acos(std::min(1.0, std::max(-1.0, (R.trace() - 1.0) * 0.5)));
+                const double translation = diagonal > 0.0 ? t.norm() / diagonal : t.norm();
+                if (rotation < convergence_threshold_ && translation < convergence_threshold_) {
+                    ++iter;
+                    break;
+                }
+            }
+            num_iterations_ += iter;
+
+            LOG(INFO) << "level " << l + 1 << "/" << num_levels << " (" << num << "/" << target_points.size()
+                      << " points): " << iter << " iterations, RMS error " << rms_error_ << ", inlier ratio "
+                      << inlier_ratio_;
+        }
+
+        LOG(INFO) << "registration done. " << w.time_string();
+        return details::to_mat4(T);
+    }
+
+
+    void PointCloudRegistration::transform(PointCloud *cloud, const mat4 &T) {
+        if (!cloud)
+            return;
+
+        auto &points = cloud->points();
+        const int num = static_cast<int>(points.size());
+#pragma omp parallel for
+        for (int i = 0; i < num; ++i)
+            points[i] = T * points[i];
+
+        // the transformation is rigid, so the normals are transformed by its rotation part
+        auto normals = cloud->get_vertex_property<vec3>("v:normal");
+        if (normals) {
+            const mat3 N(T);
+            auto &data = normals.vector();
+#pragma omp parallel for
+            for (int i = 0; i < num; ++i)
+                data[i] = N * data[i];
+        }
+
+        auto trans = cloud->get_model_property<mat4>("transformation");
+        if (trans)
+            trans[0] = T * trans[0];
+        else
+            cloud->add_model_property<mat4>("transformation", T);
+
+        cloud->invalidate_bounding_box();
+    }
+
+}
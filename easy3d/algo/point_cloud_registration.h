@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EASY3D_ALGO_POINT_CLOUD_REGISTRATION_H
+#define EASY3D_ALGO_POINT_CLOUD_REGISTRATION_H
+
+
+#include <easy3d/core/types.h>
+
+
+namespace easy3d {
+
+    class PointCloud;
+
+    /// \brief Rigid registration of two overlapping point clouds using the Iterative Closest Point (ICP) algorithm.
+    /// \class PointCloudRegistration easy3d/algo/point_cloud_registration.h
+    /// \details In each iteration, the closest point of each source point is found in parallel using a
+    ///     KdTreeSearch_NanoFLANN of the target point cloud. The correspondences can be rejected by a distance
+    ///     threshold, trimmed (i.e., only the closest ones are used), and down-weighted by a robust (Huber) kernel.
+    ///     The incremental transformation minimizes either the point-to-point or the point-to-plane distances. In
+    ///     the coarse-to-fine mode, the point clouds are first registered at coarser resolutions obtained by
+    ///     PointCloudSimplification::grid_simplification().
+    ///     Example:
+    ///     \code
+    ///         PointCloudRegistration icp;
+    ///         icp.set_method(PointCloudRegistration::POINT_TO_PLANE);
+    ///         const mat4 T = icp.apply(source, target);
+    ///         PointCloudRegistration::transform(source, T);
+    ///     \endcode
+    class PointCloudRegistration {
+    public:
+        /// \brief The error metric minimized in each iteration.
+        enum Method {
+            POINT_TO_POINT, ///< the distances between the corresponding points
+            POINT_TO_PLANE  ///< the distances from the source points to the tangent planes of the target points
+        };
+
+    public:
+        PointCloudRegistration();
+
+        /// \brief Sets the error metric (default POINT_TO_POINT). POINT_TO_PLANE requires the normals of the
+        ///     target point cloud (i.e., the "v:normal" property). It usually converges in much fewer iterations.
+        void set_method(Method m) { method_ = m; }
+        Method method() const { return method_; }
+
+        /// \brief Sets the maximum number of iterations at each resolution (default 50).
+        void set_max_iterations(int n) { max_iterations_ = n; }
+        int max_iterations() const { return max_iterations_; }
+
+        /// \brief Sets the maximum distance between corresponding points. Correspondences farther away are
+        ///     rejected. A value <= 0 (default) means no limit.
+        void set_max_distance(float d) { max_distance_ = d; }
+        float max_distance() const { return max_distance_; }
+
+        /// \brief Sets the fraction of the correspondences used in each iteration, in (0, 1]. Only the closest
+        ///     ones are used, which handles partial overlap. The default value 1 uses all of them.
+        void set_trim_ratio(float r) { trim_ratio_ = r; }
+        float trim_ratio() const { return trim_ratio_; }
+
+        /// \brief Down-weights the correspondences with large residuals using Huber weights (default false). The
+        ///     scale of the residuals is estimated from their median in each iteration.
+        void set_robust(bool b) { robust_ = b; }
+        bool robust() const { return robust_; }
+
+        /// \brief Sets the number of resolutions (default 1, i.e., no coarse levels). With n > 1 levels, the
+        ///     point clouds are first registered at n - 1 coarser resolutions, where the cell sizes of the grid
+        ///     simplification are 0.5%, 1%, 2%, ... of the diagonal length of the target point cloud.
+        void set_num_levels(int n) { num_levels_ = n; }
+        int num_levels() const { return num_levels_; }
+
+        /// \brief Sets the convergence threshold (default 1e-6). The iterations at a resolution stop when the
+        ///     incremental rotation (in radians) and translation (relative to the diagonal length of the target
+        ///     point cloud) are both smaller than this threshold.
+        void set_convergence_threshold(float t) { convergence_threshold_ = t; }
+        float convergence_threshold() const { return convergence_threshold_; }
+
+        /**
+         * \brief Registers the source point cloud to the target point cloud. None of them is modified.
+         * \param source The point cloud to be aligned.
+         * \param target The reference point cloud.
+         * \param init The initial transformation of the source point cloud.
+         * \return The transformation that aligns the source point cloud to the target point cloud (including the
+         *      initial transformation). The identity matrix is returned if the registration failed.
+         */
+        mat4 apply(PointCloud *source, PointCloud *target, const mat4 &init = mat4::identity());
+
+        /// \brief The root mean square distance of the (used) correspondences in the last iteration.
+        float rms_error() const { return rms_error_; }
+        /// \brief The fraction of the source points having a (used) correspondence in the last iteration.
+        float inlier_ratio() const { return inlier_ratio_; }
+        /// \brief The total number of iterations (over all resolutions) of the last registration.
+        int num_iterations() const { return num_iterations_; }
+
+        /**
+         * \brief Transforms a point cloud (i.e., its points and normals) by a rigid transformation. The
+         *      transformation is also recorded in the model property "transformation" (composed with the
+         *      existing one, if any).
+         */
+        static void transform(PointCloud *cloud, const mat4 &T);
+
+    private:
+        Method method_;
+        int max_iterations_;
+        float max_distance_;
+        float trim_ratio_;
+        bool robust_;
+        int num_levels_;
+        float convergence_threshold_;
+
+        float rms_error_;
+        float inlier_ratio_;
+        int num_iterations_;
+    };
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_ALGO_POINT_CLOUD_REGISTRATION_H
@@ -24,8 +24,10 @@
 
 #include <easy3d/algo/point_cloud_simplification.h>
 
-#include <set>
-#include <cassert>
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <algorithm>
 
 #include <easy3d/core/point_cloud.h>
 #include <easy3d/util/logging.h>
@@ -82,266 +84,497 @@ namespace easy3d {
     //  \cond
     namespace details {
 
-        /// Utility class for grid simplification of point set.
-        /// LessEpsilonPoints defines a 3D points order: two points are equal
-        /// iff they belong to the same cell of a grid of cell size = epsilon.
-        template<class Point>
-        class LessEpsilonPoints {
+        /// A hash grid of a point cloud (cells of size cell_size). It is built in O(n) and in parallel: the points are
+        /// distributed to partitions by the hash values of their cells, and each partition owns a separate slice of an
+        /// open-addressing hash table. The points of each cell are stored contiguously in increasing index order.
+        class HashGrid {
         public:
-            LessEpsilonPoints(float epsilon) : m_epsilon(epsilon) {
-                assert(epsilon > 0);
+            HashGrid(const std::vector<vec3> &points, float cell_size) : points_(points), cell_size_(cell_size) {
+                build();
             }
 
-            // Round points to multiples of m_epsilon, then compare.
-            bool operator()(const Point &a, const Point &b) const {
-                const vec3 *a_n = (a.pos);
-                const vec3 *b_n = (b.pos);
-
-                vec3 rounded_a(round_epsilon(a_n->x, m_epsilon), round_epsilon(a_n->y, m_epsilon),
-                               round_epsilon(a_n->z, m_epsilon));
-                vec3 rounded_b(round_epsilon(b_n->x, m_epsilon), round_epsilon(b_n->y, m_epsilon),
-                               round_epsilon(b_n->z, m_epsilon));
-
-                //return (rounded_a < rounded_b);
-                if (rounded_a.x < rounded_b.x)
-                    return true;
-                else if (rounded_a.x == rounded_b.x) {
-                    if (rounded_a.y < rounded_b.y)
-                        return true;
-                    else if (rounded_a.y == rounded_b.y) {
-                        if (rounded_a.z < rounded_b.z)
-                            return true;
-                    }
-                }
+            /// the grid is too fine to be represented (i.e., the number of cells overflows)
+            bool valid() const { return valid_; }
+
+            std::size_t num_cells() const { return cell_keys_.size(); }
 
-                return false;
+            /// the points of a cell are cell_points()[cell_start(c), cell_start(c + 1))
+            std::size_t cell_start(std::size_t c) const { return cell_start_[c]; }
+            const std::vector<int> &cell_points() const { return cell_points_; }
+
+            /// the integer coordinates of a cell
+            void cell_coordinates(std::size_t c, int64_t &x, int64_t &y, int64_t &z) const {
+                const uint64_t key = cell_keys_[c];
+                x = static_cast<int64_t>(key % dims_[0]);
+                y = static_cast<int64_t>((key / dims_[0]) % dims_[1]);
+                z = static_cast<int64_t>(key / dims_[0] / dims_[1]);
             }
 
-        private:
-            // Round number to multiples of epsilon
-            static inline float round_epsilon(float value, float epsilon) {
-                return std::floor(value / epsilon) * epsilon;
+            /// the cell with the given integer coordinates, or -1 if it has no points
+            int64_t find(int64_t x, int64_t y, int64_t z) const {
+                if (x < 0 || y < 0 || z < 0 || x >= static_cast<int64_t>(dims_[0]) ||
+                    y >= static_cast<int64_t>(dims_[1]) || z >= static_cast<int64_t>(dims_[2]))
+                    return -1;
+                const uint64_t key = static_cast<uint64_t>(x) + dims_[0] * (static_cast<uint64_t>(y) + dims_[1] *
+                                                                            static_cast<uint64_t>(z));
+                const uint64_t h = hash(key);
+                const std::size_t part = h >> (64 - kPartitionBits);
+                const std::size_t offset = slice_offset_[part];
+                const std::size_t mask = slice_offset_[part + 1] - offset - 1;
+                for (std::size_t slot = h & mask;; slot = (slot + 1) & mask) {
+                    const int64_t c = table_[offset + slot];
+                    if (c < 0)
+                        return -1;
+                    if (cell_keys_[c] == key)
+                        return c;
+                }
             }
 
         private:
-            float m_epsilon;
-        };
-    }
-    //  \endcond
-
-
-    std::vector<PointCloud::Vertex> PointCloudSimplification::grid_simplification(PointCloud *cloud, float epsilon) {
-        assert(epsilon > 0);
-
-        struct Point {
-            const vec3 *pos;
-            PointCloud::Vertex vertex;
-        };
+            static const int kPartitionBits = 8;
 
-        // Merges points which belong to the same cell of a grid of cell size = epsilon.
-        // points_to_keep will contain 1 point per cell; the others will be in points_to_remove.
-        std::set<Point, details::LessEpsilonPoints<Point> > points_to_keep(epsilon);
-        std::vector<PointCloud::Vertex> points_to_remove;
+            // the finalizer of splitmix64
+            static uint64_t hash(uint64_t x) {
+                x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+                x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+                return x ^ (x >> 31);
+            }
 
-        const auto &points = cloud->points();
-        for (auto v : cloud->vertices()) {
-            Point p;
-            p.pos = &(points[v.idx()]);
-            p.vertex = v;
-            const auto &result = points_to_keep.insert(p);
-            if (!result.second) // if not inserted
-                points_to_remove.push_back(v);
-        }
+            void build() {
+                const int num = static_cast<int>(points_.size());
+                valid_ = true;
+                if (num == 0) {
+                    slice_offset_.assign((1 << kPartitionBits) + 1, 0);
+                    cell_start_.assign(1, 0);
+                    return;
+                }
 
-        return points_to_remove;
-    }
+                // the cells are aligned with the origin, i.e., a point p is in cell floor(p / cell_size)
+                min_cell_[0] = min_cell_[1] = min_cell_[2] = DBL_MAX;
+                double max_cell[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+                for (const auto &p : points_) {
+                    for (int d = 0; d < 3; ++d) {
+                        const double c = std::floor(p[d] / cell_size_);
+                        min_cell_[d] = std::min(min_cell_[d], c);
+                        max_cell[d] = std::max(max_cell[d], c);
+                    }
+                }
+                double total = 1.0;
+                for (int d = 0; d < 3; ++d) {
+                    dims_[d] = static_cast<uint64_t>(max_cell[d] - min_cell_[d]) + 1;
+                    total *= static_cast<double>(dims_[d]);
+                }
+                if (total > 9.0e18) {
+                    valid_ = false;
+                    return;
+                }
 
+                // the key of the cell containing each point
+                std::vector<uint64_t> keys(num);
+#pragma omp parallel for
+                for (int i = 0; i < num; ++i) {
+                    const vec3 &p = points_[i];
+                    const uint64_t x = static_cast<uint64_t>(std::floor(p.x / cell_size_) - min_cell_[0]);
+                    const uint64_t y = static_cast<uint64_t>(std::floor(p.y / cell_size_) - min_cell_[1]);
+                    const uint64_t z = static_cast<uint64_t>(std::floor(p.z / cell_size_) - min_cell_[2]);
+                    keys[i] = x + dims_[0] * (y + dims_[1] * z);
+                }
 
-    std::vector<PointCloud::Vertex>
-    PointCloudSimplification::uniform_simplification(PointCloud *cloud, float epsilon, KdTreeSearch *tree) {
-        KdTreeSearch *kdtree = tree;
-        bool need_delete(false);
-        if (!kdtree) {
-            kdtree = new KdTreeSearch_ETH;
-            kdtree->begin();
-            kdtree->add_point_cloud(cloud);
-            kdtree->end();
-            need_delete = true;
-        }
+                // distribute the points to the partitions (a stable counting sort)
+                const std::size_t num_partitions = std::size_t(1) << kPartitionBits;
+                std::vector<std::size_t> part_start(num_partitions + 1, 0);
+                std::vector<uint8_t> part(num);
+                for (int i = 0; i < num; ++i) {
+                    part[i] = static_cast<uint8_t>(hash(keys[i]) >> (64 - kPartitionBits));
+                    ++part_start[part[i] + 1];
+                }
+                for (std::size_t k = 0; k < num_partitions; ++k)
+                    part_start[k + 1] += part_start[k];
+                std::vector<int> sorted(num);
+                {
+                    std::vector<std::size_t> cursor(part_start.begin(), part_start.end() - 1);
+                    for (int i = 0; i < num; ++i)
+                        sorted[cursor[part[i]]++] = i;
+                }
 
-        std::vector<bool> keep(cloud->n_vertices(), true);
-        const std::vector<vec3> &points = cloud->points();
+                // each partition owns a slice of the hash table with at least twice as many slots as its points
+                slice_offset_.resize(num_partitions + 1);
+                slice_offset_[0] = 0;
+                for (std::size_t k = 0; k < num_partitions; ++k) {
+                    std::size_t size = 1;
+                    while (size < 2 * (part_start[k + 1] - part_start[k]))
+                        size <<= 1;
+                    slice_offset_[k + 1] = slice_offset_[k] + size;
+                }
+                table_.assign(slice_offset_[num_partitions], -1);
+
+                // phase 1: insert the cells of each partition, with their local indices and sizes
+                std::vector<int> point_cell(num);                    // the local cell index of each point
+                std::vector<std::vector<uint64_t> > part_keys(num_partitions);
+                std::vector<std::vector<int> > part_sizes(num_partitions);
+#pragma omp parallel for schedule(dynamic)
+                for (int k = 0; k < static_cast<int>(num_partitions); ++k) {
+                    const std::size_t offset = slice_offset_[k];
+                    const std::size_t mask = slice_offset_[k + 1] - offset - 1;
+                    auto &local_keys = part_keys[k];
+                    auto &local_sizes = part_sizes[k];
+                    for (std::size_t j = part_start[k]; j < part_start[k + 1]; ++j) {
+                        const int i = sorted[j];
+                        const uint64_t key = keys[i];
+                        std::size_t slot = hash(key) & mask;
+                        while (true) {
+                            int64_t &c = table_[offset + slot];
+                            if (c < 0) {
+                                c = static_cast<int64_t>(local_keys.size());
+                                local_keys.push_back(key);
+                                local_sizes.push_back(0);
+                            }
+                            if (local_keys[c] == key) {
+                                ++local_sizes[c];
+                                point_cell[i] = static_cast<int>(c);
+                                break;
+                            }
+                            slot = (slot + 1) & mask;
+                        }
+                    }
+                }
 
-        double sqr_dist = epsilon * epsilon;
-        for (std::size_t i = 0; i < points.size(); ++i) {
-            if (keep[i]) {
-                const vec3 &p = points[i];
-                std::vector<int> neighbors;
-                kdtree->find_points_in_range(p, sqr_dist, neighbors);
-                if (neighbors.size() > 1) {
-                    for (std::size_t j = 1; j < neighbors.size(); ++j) {
-                        int idx = neighbors[j];
-                        keep[idx] = 0;
+                // phase 2: the global cell indices and the points of each cell
+                std::vector<std::size_t> first_cell(num_partitions + 1, 0);
+                for (std::size_t k = 0; k < num_partitions; ++k)
+                    first_cell[k + 1] = first_cell[k] + part_keys[k].size();
+                const std::size_t num_cells = first_cell[num_partitions];
+                cell_keys_.resize(num_cells);
+                cell_start_.resize(num_cells + 1);
+                cell_points_.resize(num);
+                cell_start_[num_cells] = num;
+#pragma omp parallel for schedule(dynamic)
+                for (int k = 0; k < static_cast<int>(num_partitions); ++k) {
+                    const std::size_t base = first_cell[k];
+                    for (std::size_t s = slice_offset_[k]; s < slice_offset_[k + 1]; ++s) {
+                        if (table_[s] >= 0)
+                            table_[s] += static_cast<int64_t>(base);
+                    }
+                    std::size_t start = part_start[k];
+                    for (std::size_t c = 0; c < part_keys[k].size(); ++c) {
+                        cell_keys_[base + c] = part_keys[k][c];
+                        cell_start_[base + c] = start;
+                        start += part_sizes[k][c];
+                    }
+                    std::vector<std::size_t> cursor(cell_start_.begin() + base,
+                                                    cell_start_.begin() + base + part_keys[k].size());
+                    for (std::size_t j = part_start[k]; j < part_start[k + 1]; ++j) {
+                        const int i = sorted[j];
+                        cell_points_[cursor[point_cell[i]]++] = i;
                     }
                 }
             }
-        }
 
-        std::vector<PointCloud::Vertex> points_to_remove;
-        for (std::size_t i = 0; i < keep.size(); ++i) {
-            if (!keep[i])
-                points_to_remove.push_back(PointCloud::Vertex(i));
-        }
+        private:
+            const std::vector<vec3> &points_;
+            float cell_size_;
+            bool valid_;
 
-        if (need_delete)
-            delete kdtree;
+            double min_cell_[3];                // the minimum cell coordinates
+            uint64_t dims_[3];                  // the number of cells in each dimension
 
-        return points_to_remove;
-    }
+            std::vector<std::size_t> slice_offset_;
+            std::vector<int64_t> table_;        // the hash table (cell indices, -1 for empty slots)
+
+            std::vector<uint64_t> cell_keys_;
+            std::vector<std::size_t> cell_start_;
+            std::vector<int> cell_points_;
+        };
 
 
-    //----- uniform simplification (specifying expected point number) ---------------------------------
+        // collects the points that are not kept
+        std::vector<PointCloud::Vertex> points_to_remove(const std::vector<unsigned char> &keep) {
+            std::vector<PointCloud::Vertex> points;
+            for (std::size_t i = 0; i < keep.size(); ++i) {
+                if (!keep[i])
+                    points.push_back(PointCloud::Vertex(static_cast<int>(i)));
+            }
+            return points;
+        }
 
 
-    //  \cond
-    namespace details {
+        /// Poisson-disk like sampling: a point is kept only if no point has been kept within the distance epsilon.
+        /// The grid cells (of size epsilon) are processed in 27 phases according to their coordinates modulo 3. The
+        /// cells of the same phase are at least two cells apart, so they can be processed in parallel and the result
+        /// doesn't depend on the number of threads. Within a cell, the points are visited in increasing index order.
+        /// \return The number of kept points, or -1 if epsilon is too small for the grid.
+        int poisson_disk_sampling(const std::vector<vec3> &points, float epsilon, std::vector<unsigned char> &keep) {
+            keep.assign(points.size(), 0);
+            const HashGrid grid(points, epsilon);
+            if (!grid.valid())
+                return -1;
+
+            const auto &cell_points = grid.cell_points();
+            std::vector<std::vector<int> > phases(27);
+            for (std::size_t c = 0; c < grid.num_cells(); ++c) {
+                int64_t x, y, z;
+                grid.cell_coordinates(c, x, y, z);
+                phases[(x % 3) + 3 * (y % 3) + 9 * (z % 3)].push_back(static_cast<int>(c));
+            }
+
+            std::vector<int> kept(points.size());
+            std::vector<int> num_kept_in_cell(grid.num_cells(), 0);
+
+            const float sqr_epsilon = epsilon * epsilon;
+            int num_kept = 0;
+            for (const auto &cells : phases) {
+#pragma omp parallel for schedule(dynamic, 64) reduction(+:num_kept)
+                for (int k = 0; k < static_cast<int>(cells.size()); ++k) {
+                    const int c = cells[k];
+                    int64_t x, y, z;
+                    grid.cell_coordinates(c, x, y, z);
+
+                    // the neighboring cells (including the cell itself)
+                    int64_t neighbors[27];
+                    int num_neighbors = 0;
+                    for (int64_t dz = -1; dz <= 1; ++dz) {
+                        for (int64_t dy = -1; dy <= 1; ++dy) {
+                            for (int64_t dx = -1; dx <= 1; ++dx) {
+                                const int64_t n = grid.find(x + dx, y + dy, z + dz);
+                                if (n >= 0)
+                                    neighbors[num_neighbors++] = n;
+                            }
+                        }
+                    }
 
-        struct PointPair {
-            PointPair(unsigned int idx_a, unsigned int idx_b, float dist) : distance(dist) {
-                if (idx_a < idx_b) {
-                    index_a = idx_a;
-                    index_b = idx_b;
-                } else {
-                    index_a = idx_b;
-                    index_b = idx_a;
+                    // the kept points of a cell are stored in the cell's range of 'kept'
+                    const std::size_t start = grid.cell_start(c);
+                    for (std::size_t j = start; j < grid.cell_start(c + 1); ++j) {
+                        const int i = cell_points[j];
+                        const vec3 &p = points[i];
+                        bool conflict = false;
+                        for (int m = 0; m < num_neighbors && !conflict; ++m) {
+                            const std::size_t n = neighbors[m];
+                            const std::size_t begin = grid.cell_start(n), end = begin + num_kept_in_cell[n];
+                            for (std::size_t l = begin; l < end; ++l) {
+                                if (distance2(p, points[kept[l]]) < sqr_epsilon) {
+                                    conflict = true;
+                                    break;
+                                }
+                            }
+                        }
+                        if (!conflict) {
+                            kept[start + num_kept_in_cell[c]++] = i;
+                            keep[i] = 1;
+                            ++num_kept;
+                        }
+                    }
                 }
             }
+            return num_kept;
+        }
+    }
+    //  \endcond
 
-            unsigned int index_a;
-            unsigned int index_b;
-            float distance;
-        };
 
-        class LessDistPointPair {
-        public:
-            LessDistPointPair() {}
+    std::vector<PointCloud::Vertex>
+    PointCloudSimplification::grid_simplification(PointCloud *cloud, float cell_size, Representative representative) {
+        if (!cloud || cell_size <= 0) {
+            LOG(ERROR) << "empty point cloud or invalid cell size: " << cell_size;
+            return std::vector<PointCloud::Vertex>();
+        }
 
-            bool operator()(const PointPair &pair_a, const PointPair &pair_b) const {
-                return pair_a.distance < pair_b.distance;
-            }
-        };
+        const auto &points = cloud->points();
+        const details::HashGrid grid(points, cell_size);
+        if (!grid.valid()) {
+            LOG(WARNING) << "cell size too small (" << cell_size << "). No point will be removed";
+            return std::vector<PointCloud::Vertex>();
+        }
 
-        // Only one pass. After execution, some points are deleted, but the number of remaining points may 
-        // still be greater than the expected number. 
-        // NOTE: the returned indices are w.r.t. the new point cloud (a subset of the original point cloud). 
-        static std::vector<int> uniform_simplification(PointCloud *cloud, unsigned int expected_num) {
-            const std::vector<vec3> &points = cloud->points();
-            unsigned int num = cloud->n_vertices();
-
-            std::vector<int> points_to_delete;
-            if (expected_num >= num)
-                return points_to_delete;    // expected num is greater than / equal to given number.
-
-            KdTreeSearch_ETH kdtree;
-            kdtree.begin();
-            kdtree.add_point_cloud(cloud);
-            kdtree.end();
-
-            // the average squared distance to its nearest neighbor; smaller value means highter density
-            std::vector<float> sqr_distance(cloud->n_vertices());
-            std::set<details::PointPair, details::LessDistPointPair> point_pairs;
-            for (unsigned int i = 0; i < num; ++i) {
-                const vec3 &p = points[i];
-                std::vector<int> neighbors;
-                std::vector<float> sqr_dists;
-                kdtree.find_closest_k_points(p, 2, neighbors, sqr_dists); // the first one is itself
-                if (neighbors.size() == 2) {
-                    sqr_distance[i] = sqr_dists[1];
-
-                    // now we get a pair of points
-                    details::PointPair pair(i, neighbors[1], sqr_dists[1]);
-                    point_pairs.insert(pair);
-                } else {
-                    // ignore, no point will not be deleted
+        // keeps a representative point for each cell of the grid
+        std::vector<unsigned char> keep(points.size(), 0);
+        const auto &cell_points = grid.cell_points();
+        const int num_cells = static_cast<int>(grid.num_cells());
+#pragma omp parallel for
+        for (int c = 0; c < num_cells; ++c) {
+            const std::size_t start = grid.cell_start(c), end = grid.cell_start(c + 1);
+            int chosen = cell_points[start];
+            switch (representative) {
+                case FIRST:
+                    break;
+                case CENTROID_NEAREST: {
+                    dvec3 center(0, 0, 0);
+                    for (std::size_t j = start; j < end; ++j) {
+                        const vec3 &p = points[cell_points[j]];
+                        center += dvec3(p.x, p.y, p.z);
+                    }
+                    center /= static_cast<double>(end - start);
+                    double min_dist = DBL_MAX;
+                    for (std::size_t j = start; j < end; ++j) {
+                        const vec3 &p = points[cell_points[j]];
+                        const double dist = distance2(dvec3(p.x, p.y, p.z), center);
+                        if (dist < min_dist) {
+                            min_dist = dist;
+                            chosen = cell_points[j];
+                        }
+                    }
+                    break;
                 }
-            }
-
-            // Now the elements in point_pairs are sorted in an increasing order, so we can delete points now.
-            unsigned int remaining_num = num;
-            std::set<details::PointPair, details::LessDistPointPair>::iterator pos = point_pairs.begin();
-            std::set<details::PointPair, details::LessDistPointPair>::iterator end = point_pairs.end();
-            for (; pos != end; ++pos) {
-                if (remaining_num == expected_num)
+                case RANDOM: {
+                    // the point with the smallest hash value of its index, which is reproducible
+                    uint64_t min_hash = UINT64_MAX;
+                    for (std::size_t j = start; j < end; ++j) {
+                        uint64_t h = static_cast<uint64_t>(cell_points[j]) + 0x9e3779b97f4a7c15ull;
+                        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+                        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+                        h ^= (h >> 31);
+                        if (h < min_hash) {
+                            min_hash = h;
+                            chosen = cell_points[j];
+                        }
+                    }
                     break;
-                const details::PointPair &pair = *pos;
-                unsigned int id_a = pair.index_a;
-                unsigned int id_b = pair.index_b;
-                if (sqr_distance[id_a] < sqr_distance[id_b])
-                    points_to_delete.push_back(id_a);
-                else
-                    points_to_delete.push_back(id_b);
-                --remaining_num;
+                }
             }
-
-            return points_to_delete;
+            keep[chosen] = 1;
         }
+
+        return details::points_to_remove(keep);
     }
-    //  \endcond
 
 
     std::vector<PointCloud::Vertex>
-    PointCloudSimplification::uniform_simplification(PointCloud *cloud, unsigned int num_expected) {
-        std::vector<PointCloud::Vertex> points_to_delete;
+    PointCloudSimplification::uniform_simplification(PointCloud *cloud, float epsilon, KdTreeSearch *) {
+        if (!cloud || epsilon <= 0) {
+            LOG(ERROR) << "empty point cloud or invalid distance threshold: " << epsilon;
+            return std::vector<PointCloud::Vertex>();
+        }
 
-        int num_original = cloud->n_vertices();
-        int num_should_delete = num_original - num_expected;
-        if (num_should_delete <= 0)
-            return points_to_delete;
+        std::vector<unsigned char> keep;
+        if (details::poisson_disk_sampling(cloud->points(), epsilon, keep) < 0) {
+            LOG(WARNING) << "distance threshold too small (" << epsilon << "). No point will be removed";
+            return std::vector<PointCloud::Vertex>();
+        }
 
-        std::vector<bool> remain(cloud->n_vertices(), true);    // 1: keep this point; 0: delete this point
-        const std::vector<vec3> &points = cloud->points();
+        return details::points_to_remove(keep);
+    }
 
-        //---------------------------------------------------------------
 
-        std::vector<unsigned int> original_index(num_original);
-        for (int i = 0; i < num_original; ++i)
-            original_index[i] = i;
+    //----- uniform simplification (specifying expected point number) ---------------------------------
 
-        PointCloud *point_cloud = cloud;
-        bool cloud_is_new = false;
 
-        while (points_to_delete.size() < num_should_delete) {
-            const std::vector<int> &to_delete = details::uniform_simplification(point_cloud, num_expected);
+    std::vector<PointCloud::Vertex>
+    PointCloudSimplification::uniform_simplification(PointCloud *cloud, unsigned int num_expected) {
+        if (!cloud || num_expected >= cloud->n_vertices())
+            return std::vector<PointCloud::Vertex>();
+        if (num_expected == 0) {
+            std::vector<unsigned char> keep(cloud->n_vertices(), 0);
+            return details::points_to_remove(keep);
+        }
 
-            for (std::size_t i = 0; i < to_delete.size(); ++i) {
-                int new_id = to_delete[i];
-                int orig_id = original_index[new_id];
-                if (remain[orig_id]) {
-                    points_to_delete.push_back(PointCloud::Vertex(orig_id));
-                    remain[orig_id] = 0;
+        const std::vector<vec3> &points = cloud->points();
+        const float diagonal = cloud->bounding_box().diagonal();
+
+        // The number of samples of the Poisson-disk like sampling decreases with the distance threshold, so the
+        // threshold giving the expected number is searched for. The distance threshold 'lower' gives more samples
+        // than expected and 'upper' gives no more than expected. Since the number of samples roughly follows a power
+        // law of the threshold, the next threshold is interpolated in log-log space (safeguarded by bisection).
+        const int target = static_cast<int>(num_expected);
+        float lower = 0.0f, upper = diagonal;
+        std::vector<unsigned char> keep_lower(points.size(), 1), keep_upper, keep;
+        int num_lower = static_cast<int>(points.size());
+        int num_upper = details::poisson_disk_sampling(points, upper, keep_upper);
+        float previous = 0.0f;  // the previous upper bound and its number of samples
+        int num_previous = 0;
+        for (int iter = 0; iter < 40 && num_upper != target && upper - lower > 1e-6f * diagonal; ++iter) {
+            // a small surplus is removed afterwards
+            if (lower > 0.0f && num_lower - target <= std::max(1, target / 1000))
+                break;
+
+            float epsilon = upper * 0.125f;
+            if (lower == 0.0f && num_previous > 0 && num_upper > num_previous && previous > upper) {
+                // no lower bound yet: extrapolate along the power law of the last two thresholds, aiming at slightly
+                // more samples than expected to obtain a lower bound
+                const double slope = std::log(double(num_upper) / num_previous) / std::log(double(previous) / upper);
+                const double guess = upper * std::pow(double(num_upper) / (1.1 * target), 1.0 / slope);
+                epsilon = static_cast<float>(std::min(0.95 * upper, std::max(upper / 64.0, guess)));
+            } else if (lower > 0.0f) {
+                epsilon = 0.5f * (lower + upper);
+                if (num_upper > 0) {
+                    const double t = (std::log(double(num_lower)) - std::log(double(target))) /
+                                     (std::log(double(num_lower)) - std::log(double(num_upper)));
+                    const double guess = lower * std::pow(double(upper) / lower, t);
+                    const double margin = 0.05 * (upper - lower);
+                    epsilon = static_cast<float>(std::min(upper - margin, std::max(lower + margin, guess)));
                 }
             }
 
-            // Now we have some points to delete, but the remaining point number may still be greater than the expected
-            // number. We create a new point cloud from the remaining points and run the same algorithm again. We have
-            // to know the original indices of the points in the new point cloud.
-            if (cloud_is_new)
-                delete point_cloud;
-
-            if (points_to_delete.size() < num_should_delete) {
-                point_cloud = new PointCloud;
-                cloud_is_new = true;
-                original_index.clear(); // we need to update the original_index
-                for (unsigned int i = 0; i < remain.size(); ++i) {
-                    if (remain[i]) {
-                        point_cloud->add_vertex(points[i]);
-                        original_index.push_back(i);
+            const int num = details::poisson_disk_sampling(points, epsilon, keep);
+            if (num < 0) {  // too small for the grid
+                lower = epsilon;
+                continue;
+            }
+            if (num > target) {
+                lower = epsilon;
+                keep_lower.swap(keep);
+                num_lower = num;
+            } else {
+                previous = upper;
+                num_previous = num_upper;
+                upper = epsilon;
+                keep_upper.swap(keep);
+                num_upper = num;
+            }
+        }
+        if (num_upper == target)
+            return details::points_to_remove(keep_upper);
+
+        // The samples at the distance threshold 'lower' are slightly more than expected. We remove the extra ones
+        // in the densest regions, i.e., those closest to another sample (measured in the sample's own grid cell and
+        // its neighbors).
+        std::vector<int> samples;
+        std::vector<vec3> sample_points;
+        for (std::size_t i = 0; i < keep_lower.size(); ++i) {
+            if (keep_lower[i]) {
+                samples.push_back(static_cast<int>(i));
+                sample_points.push_back(points[i]);
+            }
+        }
+        const int num_samples = static_cast<int>(samples.size());
+        std::vector<float> spacing(num_samples, FLT_MAX);
+        const details::HashGrid grid(sample_points, std::max(2.0f * lower, 1e-6f * diagonal));
+        if (grid.valid()) {
+            const auto &cell_points = grid.cell_points();
+#pragma omp parallel for schedule(dynamic, 64)
+            for (int c = 0; c < static_cast<int>(grid.num_cells()); ++c) {
+                int64_t x, y, z;
+                grid.cell_coordinates(c, x, y, z);
+                for (std::size_t j = grid.cell_start(c); j < grid.cell_start(c + 1); ++j) {
+                    const int a = cell_points[j];
+                    for (int64_t dz = -1; dz <= 1; ++dz) {
+                        for (int64_t dy = -1; dy <= 1; ++dy) {
+                            for (int64_t dx = -1; dx <= 1; ++dx) {
+                                const int64_t n = grid.find(x + dx, y + dy, z + dz);
+                                if (n < 0)
+                                    continue;
+                                for (std::size_t l = grid.cell_start(n); l < grid.cell_start(n + 1); ++l) {
+                                    const int b = cell_points[l];
+                                    if (b != a)
+                                        spacing[a] = std::min(spacing[a], distance2(sample_points[a], sample_points[b]));
+                                }
+                            }
+                        }
                     }
                 }
             }
         }
 
-        return points_to_delete;
+        std::vector<int> order(num_samples);
+        for (int i = 0; i < num_samples; ++i)
+            order[i] = i;
+        const int num_extra = num_lower - static_cast<int>(num_expected);
+        std::partial_sort(order.begin(), order.begin() + num_extra, order.end(), [&](int a, int b) {
+            return spacing[a] < spacing[b] || (spacing[a] == spacing[b] && a < b);
+        });
+        for (int i = 0; i < num_extra; ++i)
+            keep_lower[samples[order[i]]] = 0;
+
+        return details::points_to_remove(keep_lower);
     }
 
 
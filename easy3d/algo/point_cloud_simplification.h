@@ -57,26 +57,37 @@ namespace easy3d {
 
         //----- simplification using a grid (non-uniform) ------------------------------------------------
 
+        /// \brief The choice of the representative point of each grid cell.
+        enum Representative {
+            FIRST,              ///< the point with the smallest index
+            CENTROID_NEAREST,   ///< the point nearest to the centroid of the points in the cell
+            RANDOM              ///< a random (but reproducible) point
+        };
+
         /**
          * \brief Simplification of a point cloud using a regular grid covering the bounding box of the points. Simplification
-         * is done by keeping a representative point (chosen arbitrarily) for each cell of the grid. This is non-uniform
-         * simplification since the representative point is chosen arbitrarily.
+         * is done by keeping a representative point for each cell of the grid. This is non-uniform simplification since
+         * the representative point is chosen independently for each cell. The grid is a hash grid, which runs in linear
+         * time and in parallel.
          * @param cloud The point cloud.
          * @param cell_size The size of the cells of the grid.
+         * @param representative The choice of the representative point of each cell.
          * @return The indices of points to be deleted.
          */
-        static std::vector<PointCloud::Vertex> grid_simplification(PointCloud *cloud, float cell_size);
+        static std::vector<PointCloud::Vertex>
+        grid_simplification(PointCloud *cloud, float cell_size, Representative representative = FIRST);
 
         //----- uniform simplification (specifying distance threshold) ------------------------------------
 
         /**
          * @brief Uniformly downsample a point cloud based on a distance criterion. This function can also be used for
-         *        removing duplicate points of a point cloud.
+         *        removing duplicate points of a point cloud. It is a Poisson-disk like sampling on a hash grid, which
+         *        runs in linear time and in parallel (the result doesn't depend on the number of threads).
          * @param cloud: The point cloud.
          * @param epsilon: The minimum allowed distance between points. Two points with a distance smaller than this
          *                 value are considered identical. After simplification, the distance of any point pair is
          *                 larger than this value.
-         * @param kdtree   A kdtree defined on this point cloud. If null, a new kdtree will be built and used.
+         * @param kdtree   Not used anymore (kept for compatibility).
          * @return The indices of points to be deleted.
          */
         static std::vector<PointCloud::Vertex>
@@ -85,7 +96,8 @@ namespace easy3d {
         //----- uniform simplification (specifying expected point number) ---------------------------------
 
         /**
-         * @brief Uniformly downsample a point cloud given the expected point number.
+         * @brief Uniformly downsample a point cloud given the expected point number. The distance threshold of the
+         *        Poisson-disk like sampling is searched for the expected number.
          * @param cloud: The point cloud.
          * @param num:   The expected point number, which must be less than or equal to the original point number.
          * @return The indices of points to be deleted.
@@ -0,0 +1,316 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <easy3d/algo/sparse_solver.h>
+
+#include <map>
+#include <mutex>
+#include <cstring>
+
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <Eigen/IterativeLinearSolvers>
+
+#include <easy3d/util/stop_watch.h>
+#include <easy3d/util/logging.h>
+
+
+namespace easy3d {
+
+    // \cond
+    using SparseMatrix = Eigen::SparseMatrix<double>;
+    using RowMajorMatrix = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+    // \endcond
+
+
+    struct SparseSolver::Impl {
+        Impl() : method(AUTO), iterative_threshold(1000000), tolerance(1e-10), max_iterations(1000),
+                 active(DIRECT), analyzed(false), factorized(false) {
+            clear_timings();
+        }
+
+        void clear_timings() {
+            timings.assembly = timings.analysis = timings.factorization = timings.solve = 0.0;
+            timings.iterations = 0;
+        }
+
+        Method method;
+        unsigned int iterative_threshold;
+        double tolerance;
+        unsigned int max_iterations;
+
+        // the method used for the current matrix
+        Method active;
+        bool analyzed;
+        bool factorized;
+
+        SparseMatrix A;
+        Eigen::SimplicialLDLT<SparseMatrix> ldlt;
+        // the conjugate gradient method works on the full (symmetric) matrix in row-major order, which allows
+        // Eigen to do the matrix-vector products in parallel.
+        RowMajorMatrix full;
+        Eigen::ConjugateGradient<RowMajorMatrix, Eigen::Lower | Eigen::Upper, Eigen::DiagonalPreconditioner<double> > cg;
+
+        Timings timings;
+    };
+
+
+    SparseSolver::SparseSolver() : impl_(new Impl) {
+    }
+
+
+    SparseSolver::~SparseSolver() {
+        delete impl_;
+    }
+
+
+    void SparseSolver::set_method(Method method) {
+        impl_->method = method;
+    }
+
+
+    SparseSolver::Method SparseSolver::method() const {
+        return impl_->method;
+    }
+
+
+    void SparseSolver::set_iterative_threshold(unsigned int n) {
+        impl_->iterative_threshold = n;
+    }
+
+
+    unsigned int SparseSolver::iterative_threshold() const {
+        return impl_->iterative_threshold;
+    }
+
+
+    void SparseSolver::set_iterative_parameters(double tolerance, unsigned int max_iterations) {
+        impl_->tolerance = tolerance;
+        impl_->max_iterations = max_iterations;
+    }
+
+
+    const SparseSolver::Timings &SparseSolver::timings() const {
+        return impl_->timings;
+    }
+
+
+    void SparseSolver::clear() {
+        Method method = impl_->method;
+        unsigned int threshold = impl_->iterative_threshold;
+        double tolerance = impl_->tolerance;
+        unsigned int max_iterations = impl_->max_iterations;
+
+        delete impl_;
+        impl_ = new Impl;
+        impl_->method = method;
+        impl_->iterative_threshold = threshold;
+        impl_->tolerance = tolerance;
+        impl_->max_iterations = max_iterations;
+    }
+
+
+    bool SparseSolver::factorize(unsigned int n, const std::vector<Entry> &entries) {
+        impl_->clear_timings();
+
+        StopWatch w;
+        SparseMatrix M(n, n);
+        M.setFromTriplets(entries.begin(), entries.end());
+        M.makeCompressed();
+
+        SparseMatrix &A = impl_->A;
+        const auto nnz = static_cast<std::size_t>(M.nonZeros());
+        const bool same_pattern = (A.rows() == M.rows()) && (static_cast<std::size_t>(A.nonZeros()) == nnz) &&
+                                  std::memcmp(A.outerIndexPtr(), M.outerIndexPtr(), (n + 1) * sizeof(int)) == 0 &&
+                                  std::memcmp(A.innerIndexPtr(), M.innerIndexPtr(), nnz * sizeof(int)) == 0;
+        const bool same_values = same_pattern &&
+                                 std::memcmp(A.valuePtr(), M.valuePtr(), nnz * sizeof(double)) == 0;
+        A.swap(M);
+
+        Method method = impl_->method;
+        if (method == AUTO)
+            method = (n >= impl_->iterative_threshold) ? CONJUGATE_GRADIENT : DIRECT;
+        if (method != impl_->active) {
+            impl_->active = method;
+            impl_->analyzed = false;
+            impl_->factorized = false;
+        }
+        impl_->timings.assembly = w.elapsed_seconds(6);
+
+        if (method == DIRECT) {
+            auto &ldlt = impl_->ldlt;
+            if (!same_pattern || !impl_->analyzed) {
+                w.restart();
+                ldlt.analyzePattern(A);
+                impl_->timings.analysis = w.elapsed_seconds(6);
+                impl_->analyzed = true;
+                impl_->factorized = false;
+            }
+            if (!same_values || !impl_->factorized) {
+                w.restart();
+                ldlt.factorize(A);
+                impl_->timings.factorization = w.elapsed_seconds(6);
+                impl_->factorized = (ldlt.info() == Eigen::Success);
+                if (!impl_->factorized)
+                    LOG(ERROR) << "failed to factorize the sparse matrix (" << n << " x " << n << ")";
+            }
+        } else {
+            if (!same_values || !impl_->factorized) {
+                w.restart();
+                impl_->full = A.selfadjointView<Eigen::Lower>();
+                impl_->cg.setTolerance(impl_->tolerance);
+                impl_->cg.setMaxIterations(static_cast<Eigen::Index>(impl_->max_iterations));
+                impl_->cg.compute(impl_->full);
+                impl_->timings.factorization = w.elapsed_seconds(6);
+                impl_->factorized = (impl_->cg.info() == Eigen::Success);
+                if (!impl_->factorized)
+                    LOG(ERROR) << "failed to set up the conjugate gradient solver (" << n << " x " << n << ")";
+            }
+        }
+
+        return impl_->factorized;
+    }
+
+
+    bool SparseSolver::solve(const double *b, double *x, unsigned int num_rhs) {
+        if (!impl_->factorized) {
+            LOG(ERROR) << "the sparse matrix has not been factorized";
+            return false;
+        }
+
+        StopWatch w;
+        const auto n = impl_->A.rows();
+        Eigen::Map<const Eigen::MatrixXd> B(b, n, num_rhs);
+        Eigen::Map<Eigen::MatrixXd> X(x, n, num_rhs);
+
+        bool success = true;
+        if (impl_->active == DIRECT) {
+            X = impl_->ldlt.solve(B);
+            success = (impl_->ldlt.info() == Eigen::Success);
+            impl_->timings.iterations = 0;
+        } else {
+            auto &cg = impl_->cg;
+            cg.setTolerance(impl_->tolerance);
+            cg.setMaxIterations(static_cast<Eigen::Index>(impl_->max_iterations));
+            int iterations = 0;
+            for (unsigned int j = 0; j < num_rhs; ++j) {
+                Eigen::VectorXd guess = X.col(j);
+                X.col(j) = cg.solveWithGuess(B.col(j), guess);
+                iterations = std::max(iterations, static_cast<int>(cg.iterations()));
+                if (cg.info() != Eigen::Success) {
+                    LOG(WARNING) << "conjugate gradient did not converge (error: " << cg.error() << ", iterations: "
+                                 << cg.iterations() << ")";
+                    success = false;
+                }
+            }
+            impl_->timings.iterations = iterations;
+        }
+        impl_->timings.solve = w.elapsed_seconds(6);
+
+        return success;
+    }
+
+
+    // ------------------------------------------------------------------------------------------------------------
+
+
+    namespace details {
+
+        struct SolverCache {
+            struct Item {
+                std::shared_ptr<SparseSolver> solver;
+                std::size_t last_used;
+            };
+
+            std::mutex mutex;
+            std::map<std::pair<const void *, std::string>, Item> items;
+            std::size_t capacity = 8;
+            std::size_t clock = 0;
+
+            // releases the least recently used solvers until there are at most 'size' solvers
+            void shrink_to(std::size_t size) {
+                while (items.size() > size) {
+                    auto oldest = items.begin();
+                    for (auto it = items.begin(); it != items.end(); ++it) {
+                        if (it->second.last_used < oldest->second.last_used)
+                            oldest = it;
+                    }
+                    items.erase(oldest);
+                }
+            }
+        };
+
+        SolverCache &solver_cache() {
+            static SolverCache cache;
+            return cache;
+        }
+    }
+
+
+    std::shared_ptr<SparseSolver> SparseSolverCache::get(const void *owner, const std::string &name) {
+        auto &cache = details::solver_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+
+        const auto key = std::make_pair(owner, name);
+        auto pos = cache.items.find(key);
+        if (pos == cache.items.end()) {
+            if (cache.capacity > 0)
+                cache.shrink_to(cache.capacity - 1);
+            details::SolverCache::Item item;
+            item.solver = std::make_shared<SparseSolver>();
+            pos = cache.items.insert(std::make_pair(key, item)).first;
+        }
+        pos->second.last_used = ++cache.clock;
+        return pos->second.solver;
+    }
+
+
+    void SparseSolverCache::release(const void *owner) {
+        auto &cache = details::solver_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        for (auto it = cache.items.begin(); it != cache.items.end();) {
+            if (it->first.first == owner)
+                it = cache.items.erase(it);
+            else
+                ++it;
+        }
+    }
+
+
+    void SparseSolverCache::clear() {
+        auto &cache = details::solver_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.items.clear();
+    }
+
+
+    void SparseSolverCache::set_capacity(std::size_t capacity) {
+        auto &cache = details::solver_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.capacity = capacity;
+        cache.shrink_to(capacity);
+    }
+
+} // namespace easy3d
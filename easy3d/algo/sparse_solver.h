@@ -0,0 +1,166 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EASY3D_ALGO_SPARSE_SOLVER_H
+#define EASY3D_ALGO_SPARSE_SOLVER_H
+
+#include <vector>
+#include <string>
+#include <memory>
+
+
+namespace easy3d {
+
+    /**
+     * \brief A solver for sparse symmetric positive (semi-)definite linear systems that keeps its factorization.
+     * \class SparseSolver easy3d/algo/sparse_solver.h
+     *
+     * \details The matrix is given as a list of entries (duplicated entries are summed up). Only the lower triangle
+     * is used, i.e., the matrix is assumed to be symmetric. When a new matrix is given, the solver compares it with
+     * the previous one: if the sparsity pattern is the same (e.g., the connectivity of the mesh has not changed),
+     * the symbolic factorization is reused, and if also the values are the same, the numeric factorization is reused.
+     * So a system can be solved repeatedly with different right-hand sides, or re-assembled after a change of the
+     * geometry, at a fraction of the cost of a fresh solver.
+     *
+     * Two methods are available:
+     *  - DIRECT: a sparse Cholesky (LDLT) factorization, which is robust and exact.
+     *  - CONJUGATE_GRADIENT: conjugate gradients with a Jacobi (diagonal) preconditioner. It uses little memory,
+     *    runs in parallel (if OpenMP is enabled), and uses the given solution as the initial guess. It is preferable
+     *    for very large systems.
+     * With AUTO (default), the conjugate gradient method is used for systems with at least iterative_threshold()
+     * unknowns.
+     *
+     * The implementation is based on Eigen, which is not exposed in the interface.
+     * \see SparseSolverCache
+     */
+    class SparseSolver {
+    public:
+        /// \brief The solution methods.
+        enum Method { AUTO, DIRECT, CONJUGATE_GRADIENT };
+
+        /// \brief A (nonzero) entry of the matrix.
+        class Entry {
+        public:
+            Entry(int row, int col, double value) : row_(row), col_(col), value_(value) {}
+            int row() const { return row_; }
+            int col() const { return col_; }
+            double value() const { return value_; }
+        private:
+            int row_;
+            int col_;
+            double value_;
+        };
+
+        /// \brief The time (in seconds) spent in each step of the last factorize() and solve().
+        struct Timings {
+            double assembly;        ///< building the sparse matrix from the entries (and comparing it with the previous)
+            double analysis;        ///< symbolic factorization (0 if reused)
+            double factorization;   ///< numeric factorization, or the preconditioner (0 if reused)
+            double solve;           ///< back-substitution, or the iterations
+            int iterations;         ///< the number of iterations (conjugate gradient only)
+        };
+
+    public:
+        SparseSolver();
+        ~SparseSolver();
+
+        /// \brief Sets the solution method. It takes effect on the next factorize().
+        void set_method(Method method);
+        /// \brief Returns the solution method.
+        Method method() const;
+
+        /// \brief Sets the minimum number of unknowns for which AUTO chooses the conjugate gradient method.
+        void set_iterative_threshold(unsigned int n);
+        /// \brief Returns the minimum number of unknowns for which AUTO chooses the conjugate gradient method.
+        unsigned int iterative_threshold() const;
+
+        /// \brief Sets the relative residual and the maximum number of iterations for the conjugate gradient method.
+        void set_iterative_parameters(double tolerance, unsigned int max_iterations);
+
+        /**
+         * \brief Sets the matrix and factorizes it (reusing the previous factorization as much as possible).
+         * \param n The number of unknowns.
+         * \param entries The entries of the n x n matrix. Only the lower triangle is used.
+         * \return \c false if the factorization failed (e.g., the matrix is not positive definite).
+         */
+        bool factorize(unsigned int n, const std::vector<Entry> &entries);
+
+        /**
+         * \brief Solves the system with the last factorized matrix.
+         * \param b The right-hand sides (n x num_rhs values, column-major, i.e., one right-hand side after another).
+         * \param x The solutions (n x num_rhs values, column-major). For the conjugate gradient method, the given values
+         *      are used as the initial guess.
+         * \param num_rhs The number of right-hand sides.
+         * \return \c false if the solver failed (or did not converge).
+         */
+        bool solve(const double *b, double *x, unsigned int num_rhs = 1);
+
+        /// \brief Releases the matrix and the factorization.
+        void clear();
+
+        /// \brief Returns the timings of the last factorize() and solve().
+        const Timings &timings() const;
+
+    private:
+        // not copyable
+        SparseSolver(const SparseSolver &);
+        SparseSolver &operator=(const SparseSolver &);
+
+        struct Impl;
+        Impl *impl_;
+    };
+
+
+    /**
+     * \brief A cache of sparse solvers shared by the algorithms, such that factorizations survive across calls.
+     * \class SparseSolverCache easy3d/algo/sparse_solver.h
+     *
+     * \details A solver is identified by an owner (typically the mesh) and a name (typically the algorithm). Since the
+     * solvers validate their factorizations against the new matrices, a stale entry only costs a new factorization.
+     * The least recently used solvers are released when the cache is full. Example usage:
+     *  \code
+     *      auto solver = SparseSolverCache::get(mesh, "SurfaceMeshSmoothing::implicit_smoothing");
+     *      if (solver->factorize(n, entries))
+     *          solver->solve(b.data(), x.data(), 3);
+     *  \endcode
+     */
+    class SparseSolverCache {
+    public:
+        /// \brief Returns the solver of an owner with a given name, which is created if it doesn't exist.
+        static std::shared_ptr<SparseSolver> get(const void *owner, const std::string &name);
+
+        /// \brief Releases the solvers of an owner, e.g., when the mesh is destroyed.
+        static void release(const void *owner);
+
+        /// \brief Releases all solvers.
+        static void clear();
+
+        /// \brief Sets the maximum number of solvers kept in the cache (default: 8).
+        static void set_capacity(std::size_t capacity);
+    };
+
+} // namespace easy3d
+
+#endif // EASY3D_ALGO_SPARSE_SOLVER_H
@@ -42,21 +42,33 @@ namespace easy3d {
     //-----------------------------------------------------------------------------
 
     void SurfaceMeshCurvature::analyze(unsigned int post_smoothing_steps) {
-        float kmin, kmax, mean, gauss;
-        float area, sum_angles;
-        float weight, sum_weights;
-        vec3 p0, p1, p2, laplace;
+        const int num_vertices = static_cast<int>(mesh_->vertices_size());
+        const int num_edges = static_cast<int>(mesh_->edges_size());
 
         // cotan weight per edge
         auto cotan = mesh_->add_edge_property<double>("curv:cotan");
-        for (auto e : mesh_->edges())
-            cotan[e] = geom::cotan_weight(mesh_, e);
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_edges; ++i) {
+            const SurfaceMesh::Edge e(i);
+            if (!mesh_->is_deleted(e))
+                cotan[e] = geom::cotan_weight(mesh_, e);
+        }
 
         // Voronoi area per vertex
         // Laplace per vertex
         // angle sum per vertex
         // -> mean, Gauss -> min, max curvature
-        for (auto v : mesh_->vertices()) {
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_vertices; ++i) {
+            const SurfaceMesh::Vertex v(i);
+            if (mesh_->is_deleted(v))
+                continue;
+
+            float kmin, kmax, mean, gauss;
+            float area, sum_angles;
+            float weight, sum_weights;
+            vec3 p0, p1, p2, laplace;
+
             kmin = kmax = 0.0;
 
             if (!mesh_->is_isolated(v) && !mesh_->is_border(v)) {
@@ -100,28 +112,30 @@ namespace easy3d {
         }
 
         // boundary vertices: interpolate from interior neighbors
-        for (auto v : mesh_->vertices()) {
-            if (mesh_->is_border(v)) {
-                kmin = kmax = sum_weights = 0.0;
-
-                for (auto vh : mesh_->halfedges(v)) {
-                    v = mesh_->target(vh);
-                    if (!mesh_->is_border(v)) {
-                        weight = cotan[mesh_->edge(vh)];
-                        sum_weights += weight;
-                        kmin += weight * min_curvature_[v];
-                        kmax += weight * max_curvature_[v];
-                    }
-                }
-
-                if (sum_weights) {
-                    kmin /= sum_weights;
-                    kmax /= sum_weights;
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_vertices; ++i) {
+            const SurfaceMesh::Vertex v(i);
+            if (mesh_->is_deleted(v) || !mesh_->is_border(v))
+                continue;
+
+            float kmin = 0.0, kmax = 0.0, sum_weights = 0.0;
+            for (auto vh : mesh_->halfedges(v)) {
+                const SurfaceMesh::Vertex vv = mesh_->target(vh);
+                if (!mesh_->is_border(vv)) {
+                    const float weight = cotan[mesh_->edge(vh)];
+                    sum_weights += weight;
+                    kmin += weight * min_curvature_[vv];
+                    kmax += weight * max_curvature_[vv];
                 }
+            }
 
-                min_curvature_[v] = kmin;
-                max_curvature_[v] = kmax;
+            if (sum_weights) {
+                kmin /= sum_weights;
+                kmax /= sum_weights;
             }
+
+            min_curvature_[v] = kmin;
+            max_curvature_[v] = kmax;
         }
 
         // clean-up properties
@@ -135,43 +149,47 @@ namespace easy3d {
 
     void SurfaceMeshCurvature::analyze_tensor(unsigned int post_smoothing_steps,
                                               bool two_ring_neighborhood) {
+        const int num_vertices = static_cast<int>(mesh_->vertices_size());
+        const int num_edges = static_cast<int>(mesh_->edges_size());
+        const int num_faces = static_cast<int>(mesh_->faces_size());
+
         auto area = mesh_->add_vertex_property<double>("curv:area", 0.0);
         auto normal = mesh_->add_face_property<dvec3>("curv:normal");
         auto evec = mesh_->add_edge_property<dvec3>("curv:evec", dvec3(0, 0, 0));
         auto angle = mesh_->add_edge_property<double>("curv:angle", 0.0);
 
-        dvec3 p0, p1, n0, n1, ev;
-        double l, A, beta, a1, a2, a3;
-        dmat3 tensor;
-
-        double eval1, eval2, eval3, kmin, kmax;
-        dvec3 evec1, evec2, evec3;
-
-        std::vector<SurfaceMesh::Vertex> neighborhood;
-        neighborhood.reserve(15);
-
         // precompute Voronoi area per vertex
-        for (auto v : mesh_->vertices()) {
-            area[v] = geom::voronoi_area(mesh_, v);
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_vertices; ++i) {
+            const SurfaceMesh::Vertex v(i);
+            if (!mesh_->is_deleted(v))
+                area[v] = geom::voronoi_area(mesh_, v);
         }
 
         // precompute face normals
-        for (auto f : mesh_->faces()) {
-            normal[f] = (dvec3) mesh_->compute_face_normal(f);
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_faces; ++i) {
+            const SurfaceMesh::Face f(i);
+            if (!mesh_->is_deleted(f))
+                normal[f] = (dvec3) mesh_->compute_face_normal(f);
         }
 
         // precompute dihedralAngle*edge_length*edge per edge
-        for (auto e : mesh_->edges()) {
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_edges; ++i) {
+            const SurfaceMesh::Edge e(i);
+            if (mesh_->is_deleted(e))
+                continue;
             auto h0 = mesh_->halfedge(e, 0);
             auto h1 = mesh_->halfedge(e, 1);
             auto f0 = mesh_->face(h0);
             auto f1 = mesh_->face(h1);
             if (f0.is_valid() && f1.is_valid()) {
-                n0 = normal[f0];
-                n1 = normal[f1];
-                ev = (dvec3) mesh_->position(mesh_->target(h0));
+                const dvec3 n0 = normal[f0];
+                const dvec3 n1 = normal[f1];
+                dvec3 ev = (dvec3) mesh_->position(mesh_->target(h0));
                 ev -= (dvec3) mesh_->position(mesh_->target(h1));
-                l = norm(ev);
+                double l = norm(ev);
                 if (l != 0) {   // avoid overflow in case of 0-length edges
                     ev /= l;
                     l *= 0.5; // only consider half of the edge (matchig Voronoi area)
@@ -181,98 +199,104 @@ namespace easy3d {
             }
         }
 
-        // compute curvature tensor for each vertex
-        for (auto v : mesh_->vertices()) {
-            kmin = 0.0;
-            kmax = 0.0;
-
-            if (!mesh_->is_isolated(v)) {
-                // one-ring or two-ring neighborhood?
-                neighborhood.clear();
-                neighborhood.push_back(v);
-                if (two_ring_neighborhood) {
-                    for (auto vv : mesh_->vertices(v))
-                        neighborhood.push_back(vv);
-                }
+        // compute curvature tensor for each vertex. Each thread has its own neighborhood buffer and eigen solver.
+#pragma omp parallel
+        {
+            std::vector<SurfaceMesh::Vertex> neighborhood;
+            neighborhood.reserve(15);
+
+            // Liangliang: eigen solver requires FT** as input matrix :-(
+            double entries[3][3];
+            double *matrix[3] = {entries[0], entries[1], entries[2]};
+            EigenSolver<double> solver(3);
+
+#pragma omp for schedule(static)
+            for (int i = 0; i < num_vertices; ++i) {
+                const SurfaceMesh::Vertex v(i);
+                if (mesh_->is_deleted(v))
+                    continue;
 
-                A = 0.0;
-                tensor = dmat3(0.0);
-
-                // compute tensor over vertex neighborhood stored in vertices
-                for (auto nit : neighborhood) {
-                    // accumulate tensor from dihedral angles around vertices
-                    for (auto hv : mesh_->halfedges(nit)) {
-                        auto ee = mesh_->edge(hv);
-                        ev = evec[ee];
-                        beta = angle[ee];
-                        for (int i = 0; i < 3; ++i)
-                            for (int j = 0; j < 3; ++j)
-                                tensor(i, j) += beta * ev[i] * ev[j];
+                double A, beta, a1, a2, a3;
+                dvec3 ev;
+                dmat3 tensor;
+                double eval1, eval2, eval3, kmin = 0.0, kmax = 0.0;
+
+                if (!mesh_->is_isolated(v)) {
+                    // one-ring or two-ring neighborhood?
+                    neighborhood.clear();
+                    neighborhood.push_back(v);
+                    if (two_ring_neighborhood) {
+                        for (auto vv : mesh_->vertices(v))
+                            neighborhood.push_back(vv);
                     }
 
-                    // accumulate area
-                    A += area[nit];
-                }
-
-                // normalize tensor by accumulated
-                if (A != 0)     // avoid overflow in case of 0-area
-                    tensor /= A;
-
-                // Liangliang: eigen solver requires FT** as input matrix :-(
-                double **matrix = new double *[3];
-                for (int i = 0; i < 3; ++i) {
-                    matrix[i] = new double[3];
-                    for (int j = 0; j < 3; ++j)
-                        matrix[i][j] = tensor(i, j);
-                }
-                // Eigen-decomposition
-                EigenSolver<double> solver(3);
-                solver.solve(matrix, EigenSolver<double>::DECREASING);
-                eval1 = solver.eigen_value(0);
-                eval2 = solver.eigen_value(1);
-                eval3 = solver.eigen_value(2);
-                for (int i = 0; i < 3; ++i) {
-                    evec1[i] = solver.eigen_vector(i, 0);
-                    evec2[i] = solver.eigen_vector(i, 1);
-                    evec3[i] = solver.eigen_vector(i, 2);
-                }
-                for (int i = 0; i < 3; ++i)
-                    delete[] matrix[i];
-                delete[] matrix;
-
-                // curvature values:
-                //   normal vector -> eval with smallest absolute value
-                //   evals are sorted in decreasing order
-                a1 = fabs(eval1);
-                a2 = fabs(eval2);
-                a3 = fabs(eval3);
-                if (a1 < a2) {
-                    if (a1 < a3) {
-                        // e1 is normal
-                        kmax = eval2;
-                        kmin = eval3;
-                    } else {
-                        // e3 is normal
-                        kmax = eval1;
-                        kmin = eval2;
+                    A = 0.0;
+                    tensor = dmat3(0.0);
+
+                    // compute tensor over vertex neighborhood stored in vertices
+                    for (auto nit : neighborhood) {
+                        // accumulate tensor from dihedral angles around vertices
+                        for (auto hv : mesh_->halfedges(nit)) {
+                            auto ee = mesh_->edge(hv);
+                            ev = evec[ee];
+                            beta = angle[ee];
+                            for (int r = 0; r < 3; ++r)
+                                for (int c = 0; c < 3; ++c)
+                                    tensor(r, c) += beta * ev[r] * ev[c];
+                        }
+
+                        // accumulate area
+                        A += area[nit];
                     }
-                } else {
-                    if (a2 < a3) {
-                        // e2 is normal
-                        kmax = eval1;
-                        kmin = eval3;
+
+                    // normalize tensor by accumulated
+                    if (A != 0)     // avoid overflow in case of 0-area
+                        tensor /= A;
+
+                    for (int r = 0; r < 3; ++r)
+                        for (int c = 0; c < 3; ++c)
+                            matrix[r][c] = tensor(r, c);
+
+                    // Eigen-decomposition
+                    solver.solve(matrix, EigenSolver<double>::DECREASING);
+                    eval1 = solver.eigen_value(0);
+                    eval2 = solver.eigen_value(1);
+                    eval3 = solver.eigen_value(2);
+
+                    // curvature values:
+                    //   normal vector -> eval with smallest absolute value
+                    //   evals are sorted in decreasing order
+                    a1 = fabs(eval1);
+                    a2 = fabs(eval2);
+                    a3 = fabs(eval3);
+                    if (a1 < a2) {
+                        if (a1 < a3) {
+                            // e1 is normal
+                            kmax = eval2;
+                            kmin = eval3;
+                        } else {
+                            // e3 is normal
+                            kmax = eval1;
+                            kmin = eval2;
+                        }
                     } else {
-                        // e3 is normal
-                        kmax = eval1;
-                        kmin = eval2;
+                        if (a2 < a3) {
+                            // e2 is normal
+                            kmax = eval1;
+                            kmin = eval3;
+                        } else {
+                            // e3 is normal
+                            kmax = eval1;
+                            kmin = eval2;
+                        }
                     }
                 }
-            }
 
-            assert(kmin <= kmax);
+                assert(kmin <= kmax);
 
-            min_curvature_[v] = kmin;
-            max_curvature_[v] = kmax;
+                min_curvature_[v] = kmin;
+                max_curvature_[v] = kmax;
+            }
         }
 
         // clean-up properties
@@ -288,26 +312,38 @@ namespace easy3d {
     //-----------------------------------------------------------------------------
 
     void SurfaceMeshCurvature::smooth_curvatures(unsigned int iterations) {
-        float kmin, kmax;
-        float weight, sum_weights;
+        if (iterations == 0)
+            return;
+
+        const int num_vertices = static_cast<int>(mesh_->vertices_size());
+        const int num_edges = static_cast<int>(mesh_->edges_size());
 
         // properties
         auto vfeature = mesh_->get_vertex_property<bool>("v:feature");
         auto cotan = mesh_->add_edge_property<double>("curv:cotan");
 
         // cotan weight per edge
-        for (auto e : mesh_->edges()) {
-            cotan[e] = geom::cotan_weight(mesh_, e);
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_edges; ++i) {
+            const SurfaceMesh::Edge e(i);
+            if (!mesh_->is_deleted(e))
+                cotan[e] = std::max(0.0, geom::cotan_weight(mesh_, e));
         }
 
-        for (unsigned int i = 0; i < iterations; ++i) {
-            for (auto v : mesh_->vertices()) {
+        // each iteration reads the values of the previous one, so the vertices can be processed in any order
+        std::vector<float> prev_min, prev_max;
+        for (unsigned int iter = 0; iter < iterations; ++iter) {
+            prev_min = min_curvature_.vector();
+            prev_max = max_curvature_.vector();
+
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < num_vertices; ++i) {
+                const SurfaceMesh::Vertex v(i);
                 // don't smooth feature vertices
-                if (vfeature && vfeature[v])
+                if (mesh_->is_deleted(v) || (vfeature && vfeature[v]))
                     continue;
 
-                kmin = kmax = sum_weights = 0.0;
-
+                float kmin = 0.0, kmax = 0.0, sum_weights = 0.0;
                 for (auto vh : mesh_->halfedges(v)) {
                     auto tv = mesh_->target(vh);
 
@@ -315,10 +351,10 @@ namespace easy3d {
                     if (vfeature && vfeature[tv])
                         continue;
 
-                    weight = std::max(0.0, geom::cotan_weight(mesh_, mesh_->edge(vh)));
+                    const float weight = cotan[mesh_->edge(vh)];
                     sum_weights += weight;
-                    kmin += weight * min_curvature_[tv];
-                    kmax += weight * max_curvature_[tv];
+                    kmin += weight * prev_min[tv.idx()];
+                    kmax += weight * prev_max[tv.idx()];
                 }
 
                 if (sum_weights) {
@@ -336,9 +372,11 @@ namespace easy3d {
 
     void SurfaceMeshCurvature::compute_mean_curvature() {
         auto curvatures = mesh_->vertex_property<float>("v:curv-mean");
-        for (auto v : mesh_->vertices()) {
-//            curvatures[v] = fabs(mean_curvature(v));
-            curvatures[v] = mean_curvature(v);
+        const int num_vertices = static_cast<int>(mesh_->vertices_size());
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_vertices; ++i) {
+//            curvatures[SurfaceMesh::Vertex(i)] = fabs(mean_curvature(SurfaceMesh::Vertex(i)));
+            curvatures[SurfaceMesh::Vertex(i)] = mean_curvature(SurfaceMesh::Vertex(i));
         }
     }
 
@@ -346,16 +384,20 @@ namespace easy3d {
 
     void SurfaceMeshCurvature::compute_gauss_curvature() {
         auto curvatures = mesh_->vertex_property<float>("v:curv-gauss");
-        for (auto v : mesh_->vertices())
-            curvatures[v] = gauss_curvature(v);
+        const int num_vertices = static_cast<int>(mesh_->vertices_size());
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_vertices; ++i)
+            curvatures[SurfaceMesh::Vertex(i)] = gauss_curvature(SurfaceMesh::Vertex(i));
     }
 
     //-----------------------------------------------------------------------------
 
     void SurfaceMeshCurvature::compute_max_abs_curvature() {
         auto curvatures = mesh_->vertex_property<float>("v:curv-max_abs");
-        for (auto v : mesh_->vertices())
-            curvatures[v] = max_abs_curvature(v);
+        const int num_vertices = static_cast<int>(mesh_->vertices_size());
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_vertices; ++i)
+            curvatures[SurfaceMesh::Vertex(i)] = max_abs_curvature(SurfaceMesh::Vertex(i));
     }
 
 } // namespace easy3d
\ No newline at end of file
@@ -35,7 +35,8 @@ namespace easy3d {
      * \class SurfaceMeshCurvature easy3d/algo/surface_mesh_curvature.h
      *
      * \details Curvature values for boundary vertices are interpolated from their interior neighbors.
-     * Curvature values can be smoothed. For more details, please refer to the following papers:
+     * Curvature values can be smoothed. All vertices are processed in parallel, and the results do not depend on the
+     * number of threads. For more details, please refer to the following papers:
      *    - Discrete Differential-Geometry Operators for Triangulated 2-Manifolds. Meyer et al. 2003.
      *    - Restricted Delaunay triangulations and normal cycle. Cohen-Steiner and Morvan. 2003.
      */
@@ -25,19 +25,14 @@
 
 #include <easy3d/algo/surface_mesh_fairing.h>
 #include <easy3d/algo/surface_mesh_geometry.h>
+#include <easy3d/algo/sparse_solver.h>
 #include <easy3d/util/logging.h>
 
 #include <Eigen/Dense>
-#include <Eigen/Sparse>
 
 
 namespace easy3d {
 
-    // \cond
-    using SparseMatrix = Eigen::SparseMatrix<double>;
-    using Triplet = Eigen::Triplet<double>;
-    // \endcond
-
     //=============================================================================
 
     SurfaceMeshFairing::SurfaceMeshFairing(SurfaceMesh *mesh) : mesh_(mesh) {
@@ -133,12 +128,11 @@ namespace easy3d {
 
         // construct matrix & rhs
         const unsigned int n = vertices.size();
-        SparseMatrix A(n, n);
         Eigen::MatrixXd B(n, 3);
         dvec3 b;
 
         std::map<SurfaceMesh::Vertex, double> row;
-        std::vector<Triplet> triplets;
+        std::vector<SparseSolver::Entry> triplets;
 
         for (unsigned int i = 0; i < n; ++i) {
             b = dvec3(0.0);
@@ -159,13 +153,16 @@ namespace easy3d {
             B.row(i) = (Eigen::Vector3d) b;
         }
 
-        A.setFromTriplets(triplets.begin(), triplets.end());
-
-        // solve A*X = B
-        Eigen::SimplicialLDLT<SparseMatrix> solver(A);
-        Eigen::MatrixXd X = solver.solve(B);
+        // solve A*X = B. Fairing the same region again (e.g., with a different continuity) reuses the symbolic
+        // factorization kept by the cached solver of this mesh.
+        auto solver = SparseSolverCache::get(mesh_, "SurfaceMeshFairing::fair");
+        Eigen::MatrixXd X(n, 3);
+        for (unsigned int i = 0; i < n; ++i) {  // initial guess (used by the iterative solver)
+            const vec3 &p = points_[vertices[i]];
+            X.row(i) = Eigen::Vector3d(p.x, p.y, p.z);
+        }
 
-        if (solver.info() != Eigen::Success) {
+        if (!solver->factorize(n, triplets) || !solver->solve(B.data(), X.data(), 3)) {
             std::cerr << "SurfaceMeshFairing: Could not solve linear system\n";
         } else {
             for (unsigned int i = 0; i < n; ++i) {
@@ -0,0 +1,202 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <easy3d/algo/surface_mesh_geodesic_heat.h>
+#include <easy3d/algo/surface_mesh_geometry.h>
+#include <easy3d/util/logging.h>
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+
+namespace easy3d {
+
+    // \cond
+    using SparseMatrix = Eigen::SparseMatrix<double>;
+    using Triplet = Eigen::Triplet<double>;
+    // \endcond
+
+    struct SurfaceMeshGeodesicHeat::Solvers {
+        Eigen::SimplicialLDLT<SparseMatrix> heat;     // (M + t * L)
+        Eigen::SimplicialLDLT<SparseMatrix> poisson;  // L (regularized)
+        std::vector<double> cotan;                    // the cotangents of the corner angles (three per face)
+        std::vector<int> triangles;                   // the vertices of the faces (three per face)
+    };
+
+    //-----------------------------------------------------------------------------
+
+    SurfaceMeshGeodesicHeat::SurfaceMeshGeodesicHeat(SurfaceMesh *mesh, float time_factor)
+            : mesh_(mesh), time_factor_(time_factor), solvers_(nullptr) {
+        distance_ = mesh_->vertex_property<float>("v:geodesic:distance");
+    }
+
+    //-----------------------------------------------------------------------------
+
+    SurfaceMeshGeodesicHeat::~SurfaceMeshGeodesicHeat() {
+        delete solvers_;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshGeodesicHeat::precompute() {
+        delete solvers_;
+        solvers_ = nullptr;
+
+        if (!mesh_->is_triangle_mesh() || mesh_->has_garbage()) {
+            LOG(ERROR) << "heat geodesics require a triangle mesh without garbage";
+            return false;
+        }
+
+        const int n = static_cast<int>(mesh_->n_vertices());
+        auto solvers = new Solvers;
+        solvers->cotan.resize(mesh_->n_faces() * 3);
+        solvers->triangles.resize(mesh_->n_faces() * 3);
+
+        // the lumped mass matrix and the (positive semi-definite) cotan Laplacian
+        std::vector<double> mass(n, 0.0);
+        std::vector<Triplet> triplets;
+        triplets.reserve(mesh_->n_faces() * 9);
+        for (auto f : mesh_->faces()) {
+            int *t = &solvers->triangles[f.idx() * 3];
+            dvec3 p[3];
+            int i = 0;
+            for (auto v : mesh_->vertices(f)) {
+                t[i] = v.idx();
+                p[i++] = dvec3(mesh_->position(v));
+            }
+
+            const double area = 0.5 * norm(cross(p[1] - p[0], p[2] - p[0]));
+            for (i = 0; i < 3; ++i) {
+                mass[t[i]] += area / 3.0;
+
+                // the cotangent of the angle at corner i, which weights the opposite edge (j, k)
+                const int j = (i + 1) % 3, k = (i + 2) % 3;
+                const dvec3 d0 = p[j] - p[i], d1 = p[k] - p[i];
+                const double cot = area > 0.0 ? geom::clamp_cot(dot(d0, d1) / (2.0 * area)) : 0.0;
+                solvers->cotan[f.idx() * 3 + i] = cot;
+
+                const double w = 0.5 * cot;
+                triplets.emplace_back(t[j], t[j], w);
+                triplets.emplace_back(t[k], t[k], w);
+                triplets.emplace_back(t[j], t[k], -w);
+                triplets.emplace_back(t[k], t[j], -w);
+            }
+        }
+        SparseMatrix L(n, n);
+        L.setFromTriplets(triplets.begin(), triplets.end());
+
+        // the diffusion time is proportional to the squared mean edge length
+        double length = 0.0;
+        for (auto e : mesh_->edges())
+            length += mesh_->edge_length(e);
+        length /= std::max(1u, mesh_->n_edges());
+        const double t = time_factor_ * length * length;
+
+        SparseMatrix M(n, n), I(n, n);
+        triplets.clear();
+        for (int i = 0; i < n; ++i)
+            triplets.emplace_back(i, i, mass[i]);
+        M.setFromTriplets(triplets.begin(), triplets.end());
+        I.setIdentity();
+
+        solvers->heat.compute(M + t * L);
+        // the Laplacian is singular (constants are in its kernel): a tiny regularization makes it definite
+        solvers->poisson.compute(L + 1e-8 * I);
+        if (solvers->heat.info() != Eigen::Success || solvers->poisson.info() != Eigen::Success) {
+            LOG(ERROR) << "SurfaceMeshGeodesicHeat: could not factorize the linear systems";
+            delete solvers;
+            return false;
+        }
+
+        solvers_ = solvers;
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshGeodesicHeat::compute(const std::vector<SurfaceMesh::Vertex> &seed) {
+        if (seed.empty())
+            return false;
+        if (!solvers_ && !precompute())
+            return false;
+
+        const int n = static_cast<int>(mesh_->n_vertices());
+        const int num_faces = static_cast<int>(mesh_->n_faces());
+        const auto &points = mesh_->points();
+        const std::vector<int> &triangles = solvers_->triangles;
+        const std::vector<double> &cotan = solvers_->cotan;
+
+        // 1. diffuse the heat from the seeds
+        Eigen::VectorXd b = Eigen::VectorXd::Zero(n);
+        for (auto v : seed)
+            b[v.idx()] = 1.0;
+        const Eigen::VectorXd u = solvers_->heat.solve(b);
+
+        // 2. the normalized (negative) gradient of the heat in each face
+        std::vector<dvec3> field(num_faces);
+#pragma omp parallel for schedule(static)
+        for (int f = 0; f < num_faces; ++f) {
+            const int *t = &triangles[f * 3];
+            const dvec3 p0(points[t[0]]), p1(points[t[1]]), p2(points[t[2]]);
+            const dvec3 normal = cross(p1 - p0, p2 - p0);
+            // the gradient is proportional to the sum of u_i * (N x e_i), where e_i is the edge opposite to vertex i
+            const dvec3 grad = u[t[0]] * cross(normal, p2 - p1) +
+                               u[t[1]] * cross(normal, p0 - p2) +
+                               u[t[2]] * cross(normal, p1 - p0);
+            const double len = norm(grad);
+            field[f] = len > 0.0 ? -grad / len : dvec3(0, 0, 0);
+        }
+
+        // 3. the integrated divergence of the field at each vertex
+        Eigen::VectorXd div = Eigen::VectorXd::Zero(n);
+        for (int f = 0; f < num_faces; ++f) {
+            const int *t = &triangles[f * 3];
+            const dvec3 &x = field[f];
+            for (int i = 0; i < 3; ++i) {
+                const int j = (i + 1) % 3, k = (i + 2) % 3;
+                const dvec3 pi(points[t[i]]), pj(points[t[j]]), pk(points[t[k]]);
+                // the edge (i, j) is weighted by the angle at k, and (i, k) by the angle at j
+                div[t[i]] += 0.5 * (cotan[f * 3 + k] * dot(pj - pi, x) + cotan[f * 3 + j] * dot(pk - pi, x));
+            }
+        }
+
+        // 4. recover the distances, which are zero at the seeds
+        // (L is positive semi-definite, i.e., it is the negative of the Laplace-Beltrami operator)
+        const Eigen::VectorXd phi = solvers_->poisson.solve(-div);
+        if (solvers_->heat.info() != Eigen::Success || solvers_->poisson.info() != Eigen::Success) {
+            LOG(ERROR) << "SurfaceMeshGeodesicHeat: could not solve the linear systems";
+            return false;
+        }
+
+        double offset = phi[seed[0].idx()];
+        for (auto v : seed)
+            offset = std::min(offset, phi[v.idx()]);
+        for (auto v : mesh_->vertices())
+            distance_[v] = static_cast<float>(phi[v.idx()] - offset);
+
+        return true;
+    }
+
+} // namespace easy3d
@@ -0,0 +1,87 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EASY3D_ALGO_SURFACE_MESH_GEODESIC_HEAT_H
+#define EASY3D_ALGO_SURFACE_MESH_GEODESIC_HEAT_H
+
+#include <easy3d/core/surface_mesh.h>
+
+#include <vector>
+
+
+namespace easy3d {
+
+    /**
+     * \brief This class computes geodesic distances from a set of seed vertices using the heat method.
+     * \class SurfaceMeshGeodesicHeat easy3d/algo/surface_mesh_geodesic_heat.h
+     * \details The heat is diffused from the seeds for a short time, and the distances are recovered from the
+     * normalized gradient of the heat by solving a Poisson equation. The two linear systems only depend on the mesh,
+     * so they are factorized once (in precompute(), or by the first call to compute()), and each query only requires
+     * two back-substitutions. This makes repeated queries (e.g., with different seeds) much cheaper than with
+     * SurfaceMeshGeodesic. Boundaries are handled with Neumann conditions. See the following paper for more details:
+     *  - Keenan Crane, Clarisse Weischedel, and Max Wardetzky. Geodesics in heat: a new approach to computing
+     *    distance based on heat flow. ACM Transactions on Graphics, 32(5), 2013.
+     * \note The mesh must not be modified after the factorization. Call precompute() again if it is.
+     */
+    class SurfaceMeshGeodesicHeat {
+    public:
+        //! \brief Construct from mesh.
+        //! \param mesh The triangle mesh on which to compute the geodesic distances.
+        //! \param time_factor The diffusion time in units of the squared mean edge length. Larger values give
+        //!     smoother (but less accurate) distances.
+        SurfaceMeshGeodesicHeat(SurfaceMesh *mesh, float time_factor = 1.0f);
+
+        // destructor
+        ~SurfaceMeshGeodesicHeat();
+
+        //! \brief Builds and factorizes the heat and Poisson systems.
+        //! \return \c true on success.
+        bool precompute();
+
+        //! \brief Compute geodesic distances from specified seed points.
+        //! \details The results are store as SurfaceMesh::VertexProperty<float> with a name "v:geodesic:distance".
+        //! \param[in] seed The vector of seed vertices.
+        //! \return \c true on success.
+        bool compute(const std::vector<SurfaceMesh::Vertex> &seed);
+
+        //! \brief Access the computed geodesic distance.
+        //! \param[in] v The vertex for which to return the geodesic distance.
+        //! \pre The function compute() has been called before.
+        float operator()(SurfaceMesh::Vertex v) const { return distance_[v]; }
+
+    private:
+        SurfaceMesh *mesh_;
+        float time_factor_;
+
+        // the factorized systems (implementation uses Eigen, which is not exposed)
+        struct Solvers;
+        Solvers *solvers_;
+
+        SurfaceMesh::VertexProperty<float> distance_;
+    };
+
+} // namespace easy3d
+
+#endif // EASY3D_ALGO_SURFACE_MESH_GEODESIC_HEAT_H
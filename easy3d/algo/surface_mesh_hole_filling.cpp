@@ -2,6 +2,12 @@
 
 #include <easy3d/algo/surface_mesh_hole_filling.h>
 #include <easy3d/algo/surface_mesh_fairing.h>
+#include <easy3d/algo/sparse_solver.h>
+#include <easy3d/util/stop_watch.h>
+
+#include <queue>
+#include <algorithm>
+#include <unordered_map>
 
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
@@ -11,7 +17,7 @@ using Triplet = Eigen::Triplet<double>;
 
 namespace easy3d {
 
-    SurfaceMeshHoleFilling::SurfaceMeshHoleFilling(SurfaceMesh *mesh) : mesh_(mesh) {
+    SurfaceMeshHoleFilling::SurfaceMeshHoleFilling(SurfaceMesh *mesh) : mesh_(mesh), large_hole_threshold_(100) {
         points_ = mesh_->get_vertex_property<vec3>("v:point");
     }
 
@@ -85,6 +91,201 @@ namespace easy3d {
 
     //-----------------------------------------------------------------------------
 
+    namespace details {
+
+        // copy the faces within 'rings' rings of the hole into a new mesh. The vertex property "v:source" of the new
+        // mesh records the corresponding vertices in the original mesh (-1 for the vertices added later), and
+        // 'patch_hole' returns the halfedge of the hole in the new mesh.
+        SurfaceMesh *extract_patch(const SurfaceMesh *mesh, SurfaceMesh::Halfedge hole, int rings,
+                                   SurfaceMesh::Halfedge &patch_hole) {
+            // collect the vertices within (rings - 1) rings of the hole
+            std::unordered_map<int, int> dist;
+            std::vector<SurfaceMesh::Vertex> front;
+            SurfaceMesh::Halfedge h = hole;
+            do {
+                dist[mesh->target(h).idx()] = 0;
+                front.push_back(mesh->target(h));
+            } while ((h = mesh->next(h)) != hole);
+
+            std::vector<SurfaceMesh::Vertex> vertices(front);
+            for (int d = 1; d < rings; ++d) {
+                std::vector<SurfaceMesh::Vertex> next_front;
+                for (auto v : front) {
+                    for (auto vv : mesh->vertices(v)) {
+                        if (dist.insert(std::make_pair(vv.idx(), d)).second)
+                            next_front.push_back(vv);
+                    }
+                }
+                vertices.insert(vertices.end(), next_front.begin(), next_front.end());
+                front.swap(next_front);
+            }
+
+            // their incident faces
+            std::vector<int> faces;
+            for (auto v : vertices) {
+                for (auto f : mesh->faces(v))
+                    faces.push_back(f.idx());
+            }
+            std::sort(faces.begin(), faces.end());
+            faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+
+            auto patch = new SurfaceMesh;
+            auto source = patch->add_vertex_property<int>("v:source", -1);
+            std::unordered_map<int, SurfaceMesh::Vertex> vmap;
+            std::vector<SurfaceMesh::Vertex> face_vertices;
+            for (int idx : faces) {
+                face_vertices.clear();
+                for (auto v : mesh->vertices(SurfaceMesh::Face(idx))) {
+                    auto pos = vmap.find(v.idx());
+                    if (pos == vmap.end()) {
+                        auto pv = patch->add_vertex(mesh->position(v));
+                        source[pv] = v.idx();
+                        pos = vmap.insert(std::make_pair(v.idx(), pv)).first;
+                    }
+                    face_vertices.push_back(pos->second);
+                }
+                patch->add_face(face_vertices);
+            }
+
+            patch_hole = patch->find_halfedge(vmap[mesh->source(hole).idx()], vmap[mesh->target(hole).idx()]);
+            if (patch_hole.is_valid() && !patch->is_border(patch_hole))
+                patch_hole = SurfaceMesh::Halfedge();
+            return patch;
+        }
+
+
+        // add the vertices and faces created in the patch to the mesh
+        bool stitch_patch(SurfaceMesh *mesh, SurfaceMesh *patch, unsigned int num_copied_faces,
+                          unsigned int &new_vertices, unsigned int &new_faces) {
+            new_vertices = new_faces = 0;
+
+            auto source = patch->get_vertex_property<int>("v:source");
+            auto copied = patch->get_face_property<bool>("f:copied");
+            std::vector<SurfaceMesh::Vertex> vmap(patch->vertices_size());
+            for (auto v : patch->vertices()) {
+                if (source[v] >= 0)
+                    vmap[v.idx()] = SurfaceMesh::Vertex(source[v]);
+                else {
+                    vmap[v.idx()] = mesh->add_vertex(patch->position(v));
+                    ++new_vertices;
+                }
+            }
+
+            // add the new faces in breadth-first order starting from the boundary of the hole, such that each face
+            // is attached to the filled part
+            std::vector<SurfaceMesh::Face> order;
+            auto visited = patch->add_face_property<bool>("f:visited", false);
+            for (auto f : patch->faces()) {
+                if (copied[f])
+                    continue;
+                for (auto h : patch->halfedges(f)) {
+                    auto g = patch->face(patch->opposite(h));
+                    if (g.is_valid() && copied[g]) {
+                        visited[f] = true;
+                        order.push_back(f);
+                        break;
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < order.size(); ++i) {
+                for (auto h : patch->halfedges(order[i])) {
+                    auto g = patch->face(patch->opposite(h));
+                    if (g.is_valid() && !copied[g] && !visited[g]) {
+                        visited[g] = true;
+                        order.push_back(g);
+                    }
+                }
+            }
+            patch->remove_face_property(visited);
+
+            bool success = (order.size() + num_copied_faces == patch->n_faces());
+            std::vector<SurfaceMesh::Vertex> face_vertices;
+            for (auto f : order) {
+                face_vertices.clear();
+                for (auto v : patch->vertices(f))
+                    face_vertices.push_back(vmap[v.idx()]);
+                if (mesh->add_face(face_vertices).is_valid())
+                    ++new_faces;
+                else
+                    success = false;
+            }
+            return success;
+        }
+    }
+
+
+    int SurfaceMeshHoleFilling::fill_all_holes(unsigned int max_size) {
+        stats_.clear();
+
+        // detect the holes
+        std::vector<SurfaceMesh::Halfedge> holes;
+        auto visited = mesh_->add_halfedge_property<bool>("SurfaceMeshHoleFilling:visited", false);
+        for (auto h : mesh_->halfedges()) {
+            if (visited[h] || !mesh_->is_border(h))
+                continue;
+            unsigned int size = 0;
+            SurfaceMesh::Halfedge hh = h;
+            do {
+                visited[hh] = true;
+                ++size;
+            } while ((hh = mesh_->next(hh)) != h);
+
+            if (size <= max_size) {
+                holes.push_back(h);
+                HoleStats stats;
+                stats.size = size;
+                stats.new_vertices = stats.new_faces = 0;
+                stats.time = 0.0;
+                stats.filled = false;
+                stats_.push_back(stats);
+            }
+        }
+        mesh_->remove_halfedge_property(visited);
+
+        // fill each hole in a copy of its neighborhood (large enough for the refinement and fairing), such that the
+        // holes can be filled in parallel
+        const int num = static_cast<int>(holes.size());
+        std::vector<SurfaceMesh *> patches(num, nullptr);
+        std::vector<unsigned int> num_copied_faces(num, 0);
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < num; ++i) {
+            StopWatch w;
+            SurfaceMesh::Halfedge h;
+            SurfaceMesh *patch = details::extract_patch(mesh_, holes[i], 3, h);
+            auto copied = patch->add_face_property<bool>("f:copied", false);
+            for (auto f : patch->faces())
+                copied[f] = true;
+            num_copied_faces[i] = patch->n_faces();
+            if (h.is_valid()) {
+                SurfaceMeshHoleFilling filling(patch);
+                filling.set_large_hole_threshold(large_hole_threshold_);
+                stats_[i].filled = filling.fill_hole(h);
+                // the patch is temporary, so are the solvers used for its fairing
+                SparseSolverCache::release(patch);
+            }
+            patches[i] = patch;
+            stats_[i].time = w.elapsed_seconds(6);
+        }
+
+        // stitch the patches into the mesh
+        int count = 0;
+        for (int i = 0; i < num; ++i) {
+            StopWatch w;
+            if (stats_[i].filled) {
+                stats_[i].filled = details::stitch_patch(mesh_, patches[i], num_copied_faces[i],
+                                                         stats_[i].new_vertices, stats_[i].new_faces);
+                if (stats_[i].filled)
+                    ++count;
+            }
+            delete patches[i];
+            stats_[i].time += w.elapsed_seconds(6);
+        }
+
+        return count;
+    }
+
+    //-----------------------------------------------------------------------------
+
     bool SurfaceMeshHoleFilling::triangulate_hole(SurfaceMesh::Halfedge _h) {
         // trace hole
         hole_.clear();
@@ -100,6 +301,9 @@ namespace easy3d {
         } while ((h = mesh_->next(h)) != _h);
         const int n = hole_.size();
 
+        if (n > static_cast<int>(large_hole_threshold_))
+            return triangulate_hole_greedy();
+
         // compute minimal triangulation by dynamic programming
         weight_.clear();
         weight_.resize(n, std::vector<Weight>(n, Weight()));
@@ -166,6 +370,96 @@ namespace easy3d {
 
     //-----------------------------------------------------------------------------
 
+    bool SurfaceMeshHoleFilling::triangulate_hole_greedy() {
+        const int n = hole_.size();
+
+        // the remaining hole as a doubly linked list
+        std::vector<int> prev(n), next(n);
+        std::vector<vec3> normals(n);
+        for (int i = 0; i < n; ++i) {
+            prev[i] = (i + n - 1) % n;
+            next[i] = (i + 1) % n;
+            normals[i] = mesh_->compute_vertex_normal(hole_vertex(i));
+        }
+        std::vector<bool> removed(n, false);
+        int remaining = n;
+
+        // the interior angle of the hole at vertex i, measured around its normal
+        auto angle = [&](int i) -> float {
+            const vec3 &p = points_[hole_vertex(i)];
+            const vec3 d0 = points_[hole_vertex(next[i])] - p;
+            const vec3 d1 = points_[hole_vertex(prev[i])] - p;
+            float a = std::atan2(dot(cross(d0, d1), normals[i]), dot(d0, d1));
+            if (a < 0)
+                a += static_cast<float>(2.0 * M_PI);
+            return a;
+        };
+
+        // the candidates ordered by their interior angles (the smallest first)
+        struct Candidate {
+            float angle;
+            int vertex;
+            int version;
+            bool operator<(const Candidate &other) const { return angle > other.angle; }
+        };
+        std::priority_queue<Candidate> queue;
+        std::vector<int> version(n, 0);
+        auto push = [&](int i) {
+            // the new edge must not exist already
+            if (mesh_->find_halfedge(hole_vertex(prev[i]), hole_vertex(next[i])).is_valid())
+                return;
+            Candidate c;
+            c.angle = angle(i);
+            c.vertex = i;
+            c.version = version[i];
+            queue.push(c);
+        };
+        for (int i = 0; i < n; ++i)
+            push(i);
+
+        std::vector<ivec3> triangles;
+        triangles.reserve(n - 2);
+        while (remaining > 3) {
+            if (queue.empty()) {
+                std::cerr << "[SurfaceMeshHoleFilling] Failed to triangulate the hole\n";
+                return false;
+            }
+            const Candidate c = queue.top();
+            queue.pop();
+            const int i = c.vertex;
+            if (removed[i] || c.version != version[i])
+                continue;
+
+            // cut off the triangle (prev, i, next)
+            const int a = prev[i];
+            const int b = next[i];
+            triangles.push_back(ivec3(a, i, b));
+            removed[i] = true;
+            next[a] = b;
+            prev[b] = a;
+            --remaining;
+
+            ++version[a];
+            push(a);
+            ++version[b];
+            push(b);
+        }
+        for (int i = 0; i < n; ++i) {
+            if (!removed[i]) {
+                triangles.push_back(ivec3(prev[i], i, next[i]));
+                break;
+            }
+        }
+
+        // now add triangles to mesh
+        for (const auto &t : triangles)
+            mesh_->add_triangle(hole_vertex(t[0]), hole_vertex(t[1]), hole_vertex(t[2]));
+
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+
     SurfaceMeshHoleFilling::Weight SurfaceMeshHoleFilling::compute_weight(int _i, int _j,
                                                                           int _k) const {
         const SurfaceMesh::Vertex a = hole_vertex(_i);
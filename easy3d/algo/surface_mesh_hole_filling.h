@@ -38,6 +38,10 @@ namespace easy3d {
      * angle/area-minimizing triangulation, followed by isometric remeshing, and finished by curvature-minimizing
      * fairing of the filled-in patch. See the following paper for more details:
      *  - Peter Liepa. Filling holes in meshes. SGP, pages 200–205, 2003.
+     *
+     * The optimal triangulation takes O(n^3) time, so holes with more than large_hole_threshold() boundary edges are
+     * triangulated by a greedy advancing front instead (cutting the boundary vertex with the smallest interior angle
+     * first), which takes O(n log n) time.
      */
     class SurfaceMeshHoleFilling {
     public:
@@ -47,6 +51,32 @@ namespace easy3d {
         /// \brief fill the hole specified by halfedge h
         bool fill_hole(SurfaceMesh::Halfedge h);
 
+        /**
+         * \brief Fill all holes that have at most \p max_size boundary edges.
+         * \details Each hole is filled in a copy of its neighborhood, such that the holes are filled in parallel. The
+         *      results are then stitched into the mesh.
+         * \return The number of holes that have been filled.
+         * \sa statistics()
+         */
+        int fill_all_holes(unsigned int max_size = 500);
+
+        /// \brief The statistics of filling a hole.
+        struct HoleStats {
+            unsigned int size;          ///< the number of boundary edges of the hole
+            unsigned int new_vertices;  ///< the number of vertices added
+            unsigned int new_faces;     ///< the number of faces added
+            double time;                ///< the time (in seconds) spent on the hole
+            bool filled;                ///< whether the hole has been filled
+        };
+        /// \brief The statistics of the holes processed by the last call of fill_all_holes().
+        const std::vector<HoleStats> &statistics() const { return stats_; }
+
+        /// \brief Set the number of boundary edges above which a hole is triangulated by the greedy advancing front
+        /// instead of the optimal (but O(n^3)) dynamic programming. Default value is 100.
+        void set_large_hole_threshold(unsigned int n) { large_hole_threshold_ = n; }
+        /// \brief The number of boundary edges above which a hole is triangulated by the greedy advancing front.
+        unsigned int large_hole_threshold() const { return large_hole_threshold_; }
+
     private:
         struct Weight {
             Weight(float _angle = FLT_MAX, float _area = FLT_MAX)
@@ -70,6 +100,9 @@ namespace easy3d {
         // compute optimal triangulation of hole
         bool triangulate_hole(SurfaceMesh::Halfedge h);
 
+        // compute a greedy triangulation of hole_ (for large holes)
+        bool triangulate_hole_greedy();
+
         // compute the weight of the triangle (i,j,k).
         Weight compute_weight(int i, int j, int k) const;
 
@@ -124,6 +157,9 @@ namespace easy3d {
         // data for computing optimal triangulation
         std::vector<std::vector<Weight>> weight_;
         std::vector<std::vector<int>> index_;
+
+        unsigned int large_hole_threshold_;
+        std::vector<HoleStats> stats_;
     };
 
 }
@@ -0,0 +1,363 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <easy3d/algo/surface_mesh_lod.h>
+#include <easy3d/algo/surface_mesh_simplification.h>
+#include <easy3d/core/hash.h>
+#include <easy3d/util/logging.h>
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+
+namespace easy3d {
+
+    namespace details {
+
+        // the header of a saved LOD chain, which identifies the mesh it was built for
+        struct LODFileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+            uint64_t num_vertices;
+            uint64_t num_faces;
+            uint64_t hash;
+        };
+
+        inline LODFileHeader lod_file_header(const SurfaceMesh *mesh) {
+            LODFileHeader header;
+            std::memcpy(header.magic, "e3d_lod", 8);
+            header.version = 1;
+            header.reserved = 0;
+            header.num_vertices = mesh->n_vertices();
+            header.num_faces = mesh->n_faces();
+            const auto &points = mesh->points();
+            header.hash = hash_bytes(points.data(), points.size() * sizeof(vec3));
+            return header;
+        }
+
+        inline bool write_array(FILE *fp, const std::vector<int> &data) {
+            const uint64_t size = data.size();
+            return fwrite(&size, sizeof(size), 1, fp) == 1 &&
+                   (size == 0 || fwrite(data.data(), sizeof(int), size, fp) == size);
+        }
+
+        inline bool read_array(FILE *fp, std::vector<int> &data) {
+            uint64_t size = 0;
+            if (fread(&size, sizeof(size), 1, fp) != 1)
+                return false;
+            data.resize(size);
+            return size == 0 || fread(data.data(), sizeof(int), size, fp) == size;
+        }
+
+    }
+
+
+    SurfaceMeshLOD::SurfaceMeshLOD(SurfaceMesh *mesh) : mesh_(mesh), min_vertices_(0) {
+        vrank_ = mesh_->get_vertex_property<int>("v:lod_rank");
+        vparent_ = mesh_->get_vertex_property<int>("v:lod_parent");
+        flevel_ = mesh_->get_face_property<int>("f:lod_level");
+        if (vrank_ && vparent_ && flevel_)
+            update();
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshLOD::clear() {
+        mesh_->remove_vertex_property(vrank_);
+        mesh_->remove_vertex_property(vparent_);
+        mesh_->remove_face_property(flevel_);
+        min_vertices_ = 0;
+        triangles_.clear();
+        vertices_by_rank_.clear();
+        faces_by_level_.clear();
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshLOD::build(unsigned int min_vertices, float aspect_ratio, float edge_length,
+                               unsigned int max_valence, float normal_deviation) {
+        clear();
+        if (!mesh_->is_triangle_mesh() || mesh_->has_garbage()) {
+            LOG(ERROR) << "LOD chain requires a triangle mesh without garbage";
+            return false;
+        }
+
+        // simplify a copy of the mesh and record the collapses
+        std::vector<std::pair<SurfaceMesh::Vertex, SurfaceMesh::Vertex> > collapses;
+        {
+            SurfaceMesh copy(*mesh_);
+            SurfaceMeshSimplification simplifier(&copy);
+            simplifier.initialize(aspect_ratio, edge_length, max_valence, normal_deviation);
+            simplifier.collapses_ = &collapses;
+            simplifier.build_queue();
+            if (copy.n_vertices() > min_vertices)
+                simplifier.decimate(copy.n_vertices() - min_vertices);
+            simplifier.clear_queue();
+        }
+
+        const int nv = static_cast<int>(mesh_->n_vertices());
+        const int nc = static_cast<int>(collapses.size());
+        vrank_ = mesh_->vertex_property<int>("v:lod_rank", -1);
+        vparent_ = mesh_->vertex_property<int>("v:lod_parent", -1);
+        flevel_ = mesh_->face_property<int>("f:lod_level", 0);
+
+        // the vertex removed by the i-th collapse has rank (nv - 1 - i). The remaining ones get the lowest ranks.
+        for (int i = 0; i < nc; ++i) {
+            vrank_[collapses[i].first] = nv - 1 - i;
+            vparent_[collapses[i].first] = collapses[i].second.idx();
+        }
+        int rank = 0;
+        for (auto v : mesh_->vertices()) {
+            if (vrank_[v] == -1)
+                vrank_[v] = rank++;
+        }
+
+        // replay the collapses on the faces to find the level at which each face disappears. Each vertex keeps the
+        // list of its current faces, so the total cost is linear in the sum of the valences of the removed vertices.
+        std::vector<int> corners;
+        corners.reserve(mesh_->n_faces() * 3);
+        std::vector<std::vector<int> > vertex_faces(nv);
+        for (auto f : mesh_->faces()) {
+            for (auto v : mesh_->vertices(f)) {
+                corners.push_back(v.idx());
+                vertex_faces[v.idx()].push_back(f.idx());
+            }
+        }
+        std::vector<bool> removed(mesh_->n_faces(), false);
+        for (int i = 0; i < nc; ++i) {
+            const int v0 = collapses[i].first.idx();
+            const int v1 = collapses[i].second.idx();
+            for (auto f : vertex_faces[v0]) {
+                if (removed[f])
+                    continue;
+                int *c = &corners[f * 3];
+                if (c[0] == v1 || c[1] == v1 || c[2] == v1) {
+                    removed[f] = true;
+                    flevel_[SurfaceMesh::Face(f)] = nv - 1 - i;  // it exists as long as the vertex v0 exists
+                } else {
+                    std::replace(c, c + 3, v0, v1);
+                    vertex_faces[v1].push_back(f);
+                }
+            }
+            std::vector<int>().swap(vertex_faces[v0]);
+        }
+
+        return update();
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshLOD::update() {
+        min_vertices_ = 0;
+        triangles_.clear();
+        vertices_by_rank_.clear();
+        faces_by_level_.clear();
+
+        const int nv = static_cast<int>(mesh_->n_vertices());
+        if (!mesh_->is_triangle_mesh() || mesh_->has_garbage() ||
+            vrank_.vector().size() != static_cast<std::size_t>(nv) ||
+            vparent_.vector().size() != static_cast<std::size_t>(nv) ||
+            flevel_.vector().size() != mesh_->n_faces()) {
+            LOG(WARNING) << "the LOD chain does not match the mesh";
+            return false;
+        }
+
+        // the ranks must be a permutation, and each vertex must be collapsed into a vertex of lower rank
+        vertices_by_rank_.assign(nv, -1);
+        for (auto v : mesh_->vertices()) {
+            const int rank = vrank_[v];
+            const int parent = vparent_[v];
+            if (rank < 0 || rank >= nv || vertices_by_rank_[rank] != -1 ||
+                (parent >= 0 && (parent >= nv || vrank_[SurfaceMesh::Vertex(parent)] >= rank))) {
+                LOG(WARNING) << "invalid LOD chain";
+                vertices_by_rank_.clear();
+                return false;
+            }
+            vertices_by_rank_[rank] = v.idx();
+            if (parent < 0)
+                ++min_vertices_;
+        }
+
+        triangles_.reserve(mesh_->n_faces() * 3);
+        for (auto f : mesh_->faces()) {
+            for (auto v : mesh_->vertices(f))
+                triangles_.push_back(v.idx());
+        }
+
+        faces_by_level_.resize(mesh_->n_faces());
+        for (std::size_t i = 0; i < faces_by_level_.size(); ++i)
+            faces_by_level_[i] = static_cast<int>(i);
+        const auto &levels = flevel_.vector();
+        std::stable_sort(faces_by_level_.begin(), faces_by_level_.end(), [&levels](int a, int b) {
+            return levels[a] < levels[b];
+        });
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    unsigned int SurfaceMeshLOD::num_faces(unsigned int n_vertices) const {
+        // the faces with levels lower than the number of vertices exist
+        const auto &levels = flevel_.vector();
+        auto pos = std::lower_bound(faces_by_level_.begin(), faces_by_level_.end(), static_cast<int>(n_vertices),
+                                    [&levels](int f, int n) { return levels[f] < n; });
+        return static_cast<unsigned int>(pos - faces_by_level_.begin());
+    }
+
+    //-----------------------------------------------------------------------------
+
+    unsigned int SurfaceMeshLOD::num_vertices(unsigned int n_faces) const {
+        // the number of faces increases with the number of vertices
+        unsigned int lower = min_vertices_, upper = max_vertices();
+        while (lower < upper) {
+            const unsigned int middle = lower + (upper - lower) / 2;
+            if (num_faces(middle) >= n_faces)
+                upper = middle;
+            else
+                lower = middle + 1;
+        }
+        return lower;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshLOD::extract_triangles(unsigned int n_faces, std::vector<unsigned int> &indices) const {
+        indices.clear();
+        if (!is_valid())
+            return;
+
+        const int n = static_cast<int>(num_vertices(n_faces));
+        const unsigned int num = num_faces(n);
+
+        // the representative of each vertex in this level. The parent of a vertex has a lower rank, so processing the
+        // vertices in increasing order of rank visits the parents first.
+        std::vector<int> map(vertices_by_rank_.size());
+        for (std::size_t rank = 0; rank < vertices_by_rank_.size(); ++rank) {
+            const int v = vertices_by_rank_[rank];
+            map[v] = static_cast<int>(rank) < n ? v : map[vparent_[SurfaceMesh::Vertex(v)]];
+        }
+
+        indices.resize(num * 3);
+        for (unsigned int i = 0; i < num; ++i) {
+            const int *c = &triangles_[faces_by_level_[i] * 3];
+            for (int j = 0; j < 3; ++j)
+                indices[i * 3 + j] = map[c[j]];
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+
+    SurfaceMesh *SurfaceMeshLOD::extract(unsigned int n_faces) const {
+        if (!is_valid())
+            return nullptr;
+
+        std::vector<unsigned int> indices;
+        extract_triangles(n_faces, indices);
+
+        auto mesh = new SurfaceMesh;
+        const auto &points = mesh_->points();
+        std::vector<int> vertex(points.size(), -1);
+        for (std::size_t i = 0; i < indices.size(); i += 3) {
+            SurfaceMesh::Vertex vts[3];
+            for (int j = 0; j < 3; ++j) {
+                int &v = vertex[indices[i + j]];
+                if (v == -1)
+                    v = mesh->add_vertex(points[indices[i + j]]).idx();
+                vts[j] = SurfaceMesh::Vertex(v);
+            }
+            mesh->add_triangle(vts[0], vts[1], vts[2]);
+        }
+        return mesh;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshLOD::save(const std::string &file_name) const {
+        if (!is_valid()) {
+            LOG(ERROR) << "no LOD chain to save";
+            return false;
+        }
+
+        FILE *fp = fopen(file_name.c_str(), "wb");
+        if (!fp) {
+            LOG(ERROR) << "could not open file: " << file_name;
+            return false;
+        }
+
+        const details::LODFileHeader header = details::lod_file_header(mesh_);
+        bool success = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                       details::write_array(fp, vrank_.vector()) &&
+                       details::write_array(fp, vparent_.vector()) &&
+                       details::write_array(fp, flevel_.vector());
+        fclose(fp);
+        if (!success)
+            LOG(ERROR) << "failed writing LOD chain to file: " << file_name;
+        return success;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshLOD::load(const std::string &file_name) {
+        FILE *fp = fopen(file_name.c_str(), "rb");
+        if (!fp)
+            return false;
+
+        const details::LODFileHeader expected = details::lod_file_header(mesh_);
+        details::LODFileHeader header;
+        if (fread(&header, sizeof(header), 1, fp) != 1 || std::memcmp(&header, &expected, sizeof(header)) != 0) {
+            LOG(WARNING) << "not an LOD file, or it was created for a different mesh: " << file_name;
+            fclose(fp);
+            return false;
+        }
+
+        std::vector<int> ranks, parents, levels;
+        bool success = details::read_array(fp, ranks) &&
+                       details::read_array(fp, parents) &&
+                       details::read_array(fp, levels) &&
+                       ranks.size() == mesh_->n_vertices() &&
+                       parents.size() == mesh_->n_vertices() &&
+                       levels.size() == mesh_->n_faces();
+        fclose(fp);
+        if (!success) {
+            LOG(WARNING) << "failed loading LOD chain from file: " << file_name;
+            return false;
+        }
+
+        vrank_ = mesh_->vertex_property<int>("v:lod_rank");
+        vparent_ = mesh_->vertex_property<int>("v:lod_parent");
+        flevel_ = mesh_->face_property<int>("f:lod_level");
+        vrank_.vector().swap(ranks);
+        vparent_.vector().swap(parents);
+        flevel_.vector().swap(levels);
+        if (!update()) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+} // namespace easy3d
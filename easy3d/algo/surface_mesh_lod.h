@@ -0,0 +1,151 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EASY3D_ALGO_SURFACE_MESH_LOD_H
+#define EASY3D_ALGO_SURFACE_MESH_LOD_H
+
+#include <easy3d/core/surface_mesh.h>
+
+#include <string>
+#include <vector>
+
+
+namespace easy3d {
+
+    /**
+     * \brief Continuous level-of-detail (LOD) chain of a triangle mesh.
+     * \class SurfaceMeshLOD easy3d/algo/surface_mesh_lod.h
+     *
+     * \details The mesh is simplified once by SurfaceMeshSimplification down to a base mesh, and the sequence of
+     * halfedge collapses is recorded (in the spirit of progressive meshes). Since a halfedge collapse does not move the
+     * remaining vertex, every intermediate mesh uses the original vertices, and it is fully described by
+     *  - the rank of each vertex (vertices are removed in decreasing order of their ranks),
+     *  - the parent of each vertex (the vertex it was collapsed into), and
+     *  - the level of each face (the number of vertices at which the face disappears).
+     * Any level of detail can thus be extracted in linear time, without running the simplification again.
+     *
+     * The chain is stored alongside the model as the properties "v:lod_rank", "v:lod_parent", and "f:lod_level",
+     * so it is kept when the mesh is saved in a format supporting properties (e.g., PLY) and picked up by the
+     * constructor when the mesh is loaded. It can also be saved into a binary (sidecar) file. For rendering, the
+     * indices returned by extract_triangles() refer to the original vertices, so switching levels only requires
+     * updating the element buffer of a drawable. Example usage:
+     *  \code
+     *      SurfaceMeshLOD lod(mesh);
+     *      if (!lod.is_valid() && !lod.load(file_name + ".lod"))
+     *          lod.build();
+     *      std::vector<unsigned int> indices;
+     *      lod.extract_triangles(mesh->n_faces() / 10, indices);
+     *      drawable->update_element_buffer(indices);
+     *  \endcode
+     */
+    class SurfaceMeshLOD {
+    public:
+        /**
+         * \brief Constructor.
+         * \details If the mesh already has an LOD chain (stored as properties), it is used directly.
+         * \param mesh The triangle mesh. It must not have garbage (i.e., deleted elements).
+         */
+        explicit SurfaceMeshLOD(SurfaceMesh *mesh);
+        ~SurfaceMeshLOD() {}
+
+        /**
+         * \brief Records the LOD chain by simplifying a copy of the mesh.
+         * \param min_vertices The number of vertices of the coarsest level. The simplification may stop earlier if no
+         *      more collapses are legal (e.g., for a tetrahedron).
+         * \param aspect_ratio, edge_length, max_valence, normal_deviation See SurfaceMeshSimplification::initialize().
+         * \return \c true on success.
+         */
+        bool build(unsigned int min_vertices = 4, float aspect_ratio = 0.0f, float edge_length = 0.0f,
+                   unsigned int max_valence = 0, float normal_deviation = 0.0f);
+
+        /// \brief Returns whether the LOD chain is available.
+        bool is_valid() const { return !triangles_.empty(); }
+
+        /// \brief Removes the LOD chain (including the properties stored in the mesh).
+        void clear();
+
+        /// \brief The number of vertices of the finest level (i.e., the original mesh).
+        unsigned int max_vertices() const { return static_cast<unsigned int>(vertices_by_rank_.size()); }
+        /// \brief The number of vertices of the coarsest level.
+        unsigned int min_vertices() const { return min_vertices_; }
+
+        /// \brief The number of faces of the level with \p n_vertices vertices.
+        unsigned int num_faces(unsigned int n_vertices) const;
+
+        /// \brief The number of vertices of the coarsest level having at least \p n_faces faces (or the finest level
+        ///     if the mesh has less than \p n_faces faces).
+        unsigned int num_vertices(unsigned int n_faces) const;
+
+        /**
+         * \brief Extracts the triangles of the level having (at least) \p n_faces faces.
+         * \param n_faces The target number of faces.
+         * \param indices Returns the vertex indices (three per triangle) referring to the vertices of the original
+         *      mesh. The orientations of the original faces are preserved.
+         */
+        void extract_triangles(unsigned int n_faces, std::vector<unsigned int> &indices) const;
+
+        /**
+         * \brief Extracts the level having (at least) \p n_faces faces as a new mesh.
+         * \return The mesh (nullptr if the LOD chain is not available). The caller takes the ownership.
+         */
+        SurfaceMesh *extract(unsigned int n_faces) const;
+
+        /// \name Persistence
+        /// @{
+        /**
+         * \brief Saves the LOD chain into a binary (sidecar) file. The file also stores the number of vertices/faces
+         *        and a hash value of the vertex coordinates, which are used to validate the file when it is loaded.
+         * @param file_name The file name, e.g., "bunny.ply.lod".
+         * @return \c true on success.
+         */
+        bool save(const std::string &file_name) const;
+
+        /**
+         * \brief Loads an LOD chain previously saved by save(), and stores it as properties of the mesh.
+         * @return \c false if the file doesn't exist, is corrupted, or was created for another mesh.
+         */
+        bool load(const std::string &file_name);
+        /// @}
+
+    private:
+        // collects the triangles and sorts the vertices/faces using the properties
+        bool update();
+
+    private:
+        SurfaceMesh *mesh_;
+
+        SurfaceMesh::VertexProperty<int> vrank_;
+        SurfaceMesh::VertexProperty<int> vparent_;
+        SurfaceMesh::FaceProperty<int> flevel_;
+
+        unsigned int min_vertices_;
+        std::vector<int> triangles_;        // the vertices of the original faces (three per face)
+        std::vector<int> vertices_by_rank_; // the vertices in increasing order of rank
+        std::vector<int> faces_by_level_;   // the faces in increasing order of level
+    };
+
+} // namespace easy3d
+
+#endif // EASY3D_ALGO_SURFACE_MESH_LOD_H
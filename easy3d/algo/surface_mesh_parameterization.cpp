@@ -25,11 +25,11 @@
 
 #include <easy3d/algo/surface_mesh_parameterization.h>
 #include <easy3d/algo/surface_mesh_geometry.h>
+#include <easy3d/algo/sparse_solver.h>
 #include <easy3d/util/logging.h>
 
 #include <cmath>
 #include <Eigen/Dense>
-#include <Eigen/Sparse>
 
 
 namespace easy3d {
@@ -134,10 +134,8 @@ namespace easy3d {
 
         // setup matrix A and rhs B
         const unsigned int n = free_vertices.size();
-        Eigen::SparseMatrix<double> A(n, n);
         Eigen::MatrixXd B(n, 2);
-        std::vector<Eigen::Triplet<double>>
-                triplets;
+        std::vector<SparseSolver::Entry> triplets;
         dvec2 b;
         double w, ww;
         SurfaceMesh::Vertex v, vv;
@@ -166,13 +164,10 @@ namespace easy3d {
             B.row(i) = (Eigen::Vector2d) b;
         }
 
-        // build sparse matrix from triplets
-        A.setFromTriplets(triplets.begin(), triplets.end());
-
-        // solve A*X = B
-        Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver(A);
-        Eigen::MatrixXd X = solver.solve(B);
-        if (solver.info() != Eigen::Success) {
+        // solve A*X = B (with the cached solver of this mesh, such that repeated calls reuse the factorization)
+        auto solver = SparseSolverCache::get(mesh_, "SurfaceMeshParameterization::harmonic");
+        Eigen::MatrixXd X = Eigen::MatrixXd::Zero(n, 2);
+        if (!solver->factorize(n, triplets) || !solver->solve(B.data(), X.data(), 2)) {
             LOG(ERROR) << "failed solving the linear system.";
         } else {
             // copy solution
@@ -320,10 +315,8 @@ namespace easy3d {
         double si, sj0, sj1, sign;
         int row(0), c0, c1;
 
-        Eigen::SparseMatrix<double> A(2 * n, 2 * n);
         Eigen::VectorXd b = Eigen::VectorXd::Zero(2 * n);
-        std::vector<Eigen::Triplet<double>>
-                triplets;
+        std::vector<SparseSolver::Entry> triplets;
 
         for (unsigned int i = 0; i < nv2; ++i) {
             vi = SurfaceMesh::Vertex(i % nv);
@@ -379,13 +372,10 @@ namespace easy3d {
             }
         }
 
-        // build sparse matrix from triplets
-        A.setFromTriplets(triplets.begin(), triplets.end());
-
-        // solve A*X = B
-        Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver(A);
-        Eigen::VectorXd x = solver.solve(b);
-        if (solver.info() != Eigen::Success) {
+        // solve A*X = B (with the cached solver of this mesh, such that repeated calls reuse the factorization)
+        auto solver = SparseSolverCache::get(mesh_, "SurfaceMeshParameterization::lscm");
+        Eigen::VectorXd x = Eigen::VectorXd::Zero(2 * n);
+        if (!solver->factorize(2 * n, triplets) || !solver->solve(b.data(), x.data())) {
             LOG(ERROR) << "failed solving the linear system";
         } else {
             // copy solution
@@ -0,0 +1,176 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <easy3d/algo/surface_mesh_ray_caster.h>
+
+#include <cmath>
+
+
+namespace easy3d {
+
+
+    SurfaceMeshRayCaster::SurfaceMeshRayCaster(const SurfaceMesh *mesh) : mesh_(mesh) {
+        bvh_ = new TriangleMeshBVH(mesh);
+        epsilon_ = bvh_->n_triangles() > 0 ? bvh_->bounding_box().diagonal() * 1e-5f : 0.0f;
+    }
+
+
+    SurfaceMeshRayCaster::~SurfaceMeshRayCaster() {
+        delete bvh_;
+    }
+
+
+    bool SurfaceMeshRayCaster::cast(const vec3 &origin, const vec3 &dir, Intersection &hit, float t_max) const {
+        return bvh_->intersect(origin, dir, hit, t_max);
+    }
+
+
+    void SurfaceMeshRayCaster::cast(const std::vector<vec3> &origins, const std::vector<vec3> &dirs,
+                                    std::vector<Intersection> &hits, float t_max) const {
+        bvh_->intersect(origins, dirs, hits, t_max);
+    }
+
+
+    bool SurfaceMeshRayCaster::is_visible(const vec3 &from, const vec3 &to) const {
+        const float len = distance(from, to);
+        if (len <= 2 * epsilon_)
+            return true;
+        const vec3 dir = (to - from) / len;
+        return !bvh_->occluded(from + dir * epsilon_, dir, len - 2 * epsilon_);
+    }
+
+
+    void SurfaceMeshRayCaster::depth_map(const mat4 &mvp, int width, int height, std::vector<float> &depths,
+                                         std::vector<int> *faces) const {
+        depths.assign(width * height, 1.0f);
+        if (faces)
+            faces->assign(width * height, -1);
+
+        const mat4 inv_mvp = inverse(mvp);
+
+        // the pixels are processed in tiles of 4x4, such that each tile is a packet of coherent rays
+        const int tile = 4;
+        const int tiles_x = (width + tile - 1) / tile;
+        const int tiles_y = (height + tile - 1) / tile;
+        const int num_tiles = tiles_x * tiles_y;
+
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < num_tiles; ++i) {
+            const int x0 = (i % tiles_x) * tile;
+            const int y0 = (i / tiles_x) * tile;
+
+            vec3 origins[tile * tile], dirs[tile * tile];
+            int pixels[tile * tile];
+            int num = 0;
+            for (int y = y0; y < std::min(y0 + tile, height); ++y) {
+                for (int x = x0; x < std::min(x0 + tile, width); ++x) {
+                    // the ray from the near plane to the far plane through the center of the pixel
+                    const float nx = (x + 0.5f) / width * 2.0f - 1.0f;
+                    const float ny = 1.0f - (y + 0.5f) / height * 2.0f;
+                    const vec3 p_near = inv_mvp * vec3(nx, ny, -1.0f);
+                    const vec3 p_far = inv_mvp * vec3(nx, ny, 1.0f);
+                    origins[num] = p_near;
+                    dirs[num] = p_far - p_near;
+                    pixels[num] = y * width + x;
+                    ++num;
+                }
+            }
+
+            Intersection hits[tile * tile];
+            bvh_->intersect(origins, dirs, num, hits, 1.0f);
+            for (int j = 0; j < num; ++j) {
+                if (!hits[j].face.is_valid())
+                    continue;
+                const vec3 q = mvp * hits[j].point;  // in NDC
+                depths[pixels[j]] = std::min(1.0f, std::max(0.0f, q.z * 0.5f + 0.5f));
+                if (faces)
+                    (*faces)[pixels[j]] = hits[j].face.idx();
+            }
+        }
+    }
+
+
+    void SurfaceMeshRayCaster::visibility(const std::vector<vec3> &viewpoints, std::vector<int> &counts) const {
+        const int num = static_cast<int>(mesh_->n_vertices());
+        counts.assign(num, 0);
+        auto points = mesh_->get_vertex_property<vec3>("v:point");
+
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < num; ++i) {
+            const vec3 &p = points[SurfaceMesh::Vertex(i)];
+            for (const auto &vp : viewpoints) {
+                if (is_visible(p, vp))
+                    ++counts[i];
+            }
+        }
+    }
+
+
+    void SurfaceMeshRayCaster::ambient_occlusion(std::vector<float> &occlusion, int num_samples,
+                                                 float max_distance) const {
+        const int num = static_cast<int>(mesh_->n_vertices());
+        occlusion.assign(num, 0.0f);
+        if (num_samples <= 0 || bvh_->n_triangles() == 0)
+            return;
+
+        if (max_distance <= 0.0f)
+            max_distance = bvh_->bounding_box().diagonal() * 0.2f;
+
+        // cosine-weighted directions on the hemisphere around the z-axis (from the Hammersley point set)
+        std::vector<vec3> samples(num_samples);
+        for (int i = 0; i < num_samples; ++i) {
+            unsigned int bits = static_cast<unsigned int>(i);
+            bits = (bits << 16u) | (bits >> 16u);
+            bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+            bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+            bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+            bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+            const float u = (i + 0.5f) / num_samples;
+            const float v = static_cast<float>(bits) * 2.3283064365386963e-10f; // / 2^32
+            const float r = std::sqrt(u);
+            const float phi = 2.0f * static_cast<float>(M_PI) * v;
+            samples[i] = vec3(r * std::cos(phi), r * std::sin(phi), std::sqrt(std::max(0.0f, 1.0f - u)));
+        }
+
+        auto points = mesh_->get_vertex_property<vec3>("v:point");
+
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < num; ++i) {
+            const SurfaceMesh::Vertex v(i);
+            const vec3 n = mesh_->compute_vertex_normal(v);
+            const vec3 t = normalize(geom::orthogonal(n));
+            const vec3 b = cross(n, t);
+            const vec3 origin = points[v] + n * epsilon_;
+
+            int occluded = 0;
+            for (const auto &s : samples) {
+                const vec3 dir = t * s.x + b * s.y + n * s.z;
+                if (bvh_->occluded(origin, dir, max_distance))
+                    ++occluded;
+            }
+            occlusion[i] = static_cast<float>(occluded) / num_samples;
+        }
+    }
+
+}
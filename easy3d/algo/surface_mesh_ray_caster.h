@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EASY3D_ALGO_SURFACE_MESH_RAY_CASTER_H
+#define EASY3D_ALGO_SURFACE_MESH_RAY_CASTER_H
+
+#include <easy3d/algo/triangle_mesh_bvh.h>
+
+
+namespace easy3d {
+
+    /**
+     * \brief Ray casting on a surface mesh in CPU, i.e., without an OpenGL context.
+     * \class SurfaceMeshRayCaster easy3d/algo/surface_mesh_ray_caster.h
+     *
+     * \details The rays are traced in the bounding volume hierarchy of the mesh (see TriangleMeshBVH). Batches of
+     * rays are processed in parallel as packets of coherent rays. Besides single and batched ray queries, this class
+     * provides headless implementations of depth maps, visibility, and ambient occlusion.
+     * \note The ray caster works in the coordinate system of the mesh, i.e., the transformation introduced by the
+     * manipulator of the mesh is not taken into account.
+     * Example usage:
+     *  \code
+     *      SurfaceMeshRayCaster caster(mesh);
+     *      std::vector<float> depths;
+     *      caster.depth_map(camera->modelViewProjectionMatrix(), width, height, depths);
+     *  \endcode
+     */
+    class SurfaceMeshRayCaster {
+    public:
+        typedef TriangleMeshBVH::Intersection Intersection;
+
+    public:
+        /// \brief Constructs a ray caster for \p mesh. The mesh must not be modified during the lifetime of the caster.
+        explicit SurfaceMeshRayCaster(const SurfaceMesh *mesh);
+        ~SurfaceMeshRayCaster();
+
+        /// \brief The mesh the ray caster was built for.
+        const SurfaceMesh *mesh() const { return mesh_; }
+        /// \brief The underlying BVH.
+        const TriangleMeshBVH *bvh() const { return bvh_; }
+
+        /**
+         * \brief Casts a single ray.
+         * @param origin The origin of the ray.
+         * @param dir The direction of the ray (not necessarily normalized).
+         * @param hit Returns the first intersection (if any).
+         * @param t_max Only intersections with parameter t (i.e., origin + t * dir) in [0, t_max] are reported.
+         * @return true if the ray hits the mesh.
+         */
+        bool cast(const vec3 &origin, const vec3 &dir, Intersection &hit,
+                  float t_max = std::numeric_limits<float>::max()) const;
+
+        /**
+         * \brief Casts a batch of rays in parallel. Rays are grouped into packets in the given order, so coherent
+         *        rays should be provided consecutively. The faces of the missed rays are invalid.
+         */
+        void cast(const std::vector<vec3> &origins, const std::vector<vec3> &dirs, std::vector<Intersection> &hits,
+                  float t_max = std::numeric_limits<float>::max()) const;
+
+        /// \brief Tests if the segment between \p from and \p to is not blocked by the mesh.
+        bool is_visible(const vec3 &from, const vec3 &to) const;
+
+        /**
+         * \brief Renders a depth map (in CPU) of the mesh.
+         * @param mvp The model-view-projection matrix.
+         * @param width The width of the depth map.
+         * @param height The height of the depth map.
+         * @param depths Returns the depth values (row-major, the first row is the top of the image). Like an OpenGL
+         *        depth buffer, the values are in [0, 1] and the pixels not covered by the mesh have a value of 1.
+         * @param faces Returns the index of the visible face at each pixel (-1 for the pixels not covered by the
+         *        mesh), if not \c nullptr.
+         */
+        void depth_map(const mat4 &mvp, int width, int height, std::vector<float> &depths,
+                       std::vector<int> *faces = nullptr) const;
+
+        /**
+         * \brief Computes the visibility of the vertices from a set of viewpoints.
+         * @param viewpoints The viewpoints.
+         * @param counts Returns for each vertex the number of viewpoints from which the vertex is visible.
+         */
+        void visibility(const std::vector<vec3> &viewpoints, std::vector<int> &counts) const;
+
+        /**
+         * \brief Computes the ambient occlusion of the vertices.
+         * @param occlusion Returns for each vertex the fraction (in [0, 1]) of the hemisphere (around the vertex
+         *        normal) that is occluded by the mesh.
+         * @param num_samples The number of rays per vertex.
+         * @param max_distance Only occluders within this distance are considered. A non-positive value means 20% of
+         *        the diagonal of the bounding box of the mesh.
+         */
+        void ambient_occlusion(std::vector<float> &occlusion, int num_samples = 64, float max_distance = 0.0f) const;
+
+    private:
+        const SurfaceMesh *mesh_;
+        TriangleMeshBVH *bvh_;
+        float epsilon_; // a small offset of the ray origins for avoiding self-intersections
+    };
+
+} // namespace easy3d
+
+#endif  // EASY3D_ALGO_SURFACE_MESH_RAY_CASTER_H
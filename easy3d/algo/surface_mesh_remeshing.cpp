@@ -25,8 +25,9 @@
 #include <easy3d/algo/surface_mesh_remeshing.h>
 #include <easy3d/algo/surface_mesh_curvature.h>
 #include <easy3d/algo/surface_mesh_geometry.h>
-#include <easy3d/algo/triangle_mesh_kdtree.h>
+#include <easy3d/algo/triangle_mesh_bvh.h>
 #include <easy3d/util/progress.h>
+#include <easy3d/util/stop_watch.h>
 
 #include <cmath>
 #include <algorithm>
@@ -35,7 +36,8 @@
 namespace easy3d {
 
     SurfaceMeshRemeshing::SurfaceMeshRemeshing(SurfaceMesh *mesh)
-            : mesh_(mesh), refmesh_(nullptr), kd_tree_(nullptr) {
+            : mesh_(mesh), refmesh_(nullptr), bvh_(nullptr) {
+        timings_ = {0, 0, 0, 0, 0, 0};
         points_ = mesh_->get_vertex_property<vec3>("v:point");
 
         mesh_->update_vertex_normals();
@@ -60,7 +62,10 @@ namespace easy3d {
         use_projection_ = use_projection;
         target_edge_length_ = edge_length;
 
+        timings_ = {0, 0, 0, 0, 0, 0};
+        StopWatch w;
         preprocessing();
+        timings_.preprocessing = w.elapsed_seconds(6);
 
         ProgressLogger progress(iterations, false, false);
         for (unsigned int i = 0; i < iterations; ++i) {
@@ -71,7 +76,7 @@ namespace easy3d {
 
             split_long_edges();
 
-            mesh_->update_vertex_normals();
+            update_vertex_normals();
 
             collapse_short_edges();
 
@@ -84,6 +89,10 @@ namespace easy3d {
         remove_caps();
 
         postprocessing();
+
+        LOG(INFO) << "remeshing timings (seconds): split " << timings_.split << ", collapse " << timings_.collapse
+                  << ", flip " << timings_.flip << ", smoothing " << timings_.smoothing << " (projection "
+                  << timings_.projection << ")";
     }
 
     //-----------------------------------------------------------------------------
@@ -104,7 +113,10 @@ namespace easy3d {
         approx_error_ = approx_error;
         use_projection_ = use_projection;
 
+        timings_ = {0, 0, 0, 0, 0, 0};
+        StopWatch w;
         preprocessing();
+        timings_.preprocessing = w.elapsed_seconds(6);
 
         ProgressLogger progress(iterations, false, false);
         for (unsigned int i = 0; i < iterations; ++i) {
@@ -114,7 +126,7 @@ namespace easy3d {
             }
             split_long_edges();
 
-            mesh_->update_vertex_normals();
+            update_vertex_normals();
 
             collapse_short_edges();
 
@@ -127,6 +139,10 @@ namespace easy3d {
         remove_caps();
 
         postprocessing();
+
+        LOG(INFO) << "remeshing timings (seconds): split " << timings_.split << ", collapse " << timings_.collapse
+                  << ", flip " << timings_.flip << ", smoothing " << timings_.smoothing << " (projection "
+                  << timings_.projection << ")";
     }
 
     //-----------------------------------------------------------------------------
@@ -249,17 +265,18 @@ namespace easy3d {
                 refsizing_[v] = vsizing_[v];
             }
 
-            // build kd-tree
-            kd_tree_ = new TriangleMeshKdTree(refmesh_, 0);
+            // build the BVH
+            bvh_ = new TriangleMeshBVH(refmesh_);
         }
     }
 
     //-----------------------------------------------------------------------------
 
     void SurfaceMeshRemeshing::postprocessing() {
-        // delete kd-tree and reference mesh
+        // delete the BVH and reference mesh
         if (use_projection_) {
-            delete kd_tree_;
+            delete bvh_;
+            bvh_ = nullptr;
             delete refmesh_;
         }
 
@@ -277,7 +294,7 @@ namespace easy3d {
         }
 
         // find closest triangle of reference mesh
-        TriangleMeshKdTree::NearestNeighbor nn = kd_tree_->nearest(points_[v]);
+        TriangleMeshBVH::NearestNeighbor nn = bvh_->nearest(points_[v]);
         const SurfaceMesh::Face f = nn.face;
         if (!f.is_valid()) {
             LOG(WARNING) << "could not find the nearest face for " << v << " (" << points_[v] << ")";
@@ -325,183 +342,346 @@ namespace easy3d {
 
     //-----------------------------------------------------------------------------
 
+    void SurfaceMeshRemeshing::project_to_reference(const std::vector<SurfaceMesh::Vertex> &vertices) {
+        if (!use_projection_ || vertices.empty())
+            return;
+
+        StopWatch w;
+        const int num = static_cast<int>(vertices.size());
+#pragma omp parallel for schedule(dynamic, 256)
+        for (int i = 0; i < num; ++i)
+            project_to_reference(vertices[i]);
+        timings_.projection += w.elapsed_seconds(6);
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshRemeshing::update_vertex_normals() {
+        const int num = static_cast<int>(mesh_->vertices_size());
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num; ++i) {
+            const SurfaceMesh::Vertex v(i);
+            if (!mesh_->is_deleted(v))
+                vnormal_[v] = mesh_->compute_vertex_normal(v);
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+
     void SurfaceMeshRemeshing::split_long_edges() {
+        StopWatch w;
         SurfaceMesh::Vertex vnew, v0, v1;
-        SurfaceMesh::Edge enew, e0, e1;
-        SurfaceMesh::Face f0, f1, f2, f3;
-        bool ok, is_feature, is_boundary;
-        int i;
+        SurfaceMesh::Edge enew;
+        bool is_feature, is_boundary;
+
+        // the edges to be checked (all edges in the first round, and then the edges incident to the new vertices)
+        std::vector<SurfaceMesh::Edge> edges;
+        edges.reserve(mesh_->n_edges());
+        for (auto e : mesh_->edges())
+            edges.push_back(e);
+        std::vector<char> too_long;
+        std::vector<SurfaceMesh::Vertex> new_vertices, projected;
+
+        for (int i = 0; !edges.empty() && i < 10; ++i) {
+            // find the long edges in parallel
+            const int num = static_cast<int>(edges.size());
+            too_long.assign(num, 0);
+#pragma omp parallel for schedule(static)
+            for (int j = 0; j < num; ++j) {
+                const SurfaceMesh::Edge e = edges[j];
+                too_long[j] = !elocked_[e] && is_too_long(mesh_->vertex(e, 0), mesh_->vertex(e, 1));
+            }
 
-        for (ok = false, i = 0; !ok && i < 10; ++i) {
-            ok = true;
+            // split them (splitting an edge does not change the other edges)
+            new_vertices.clear();
+            projected.clear();
+            for (int j = 0; j < num; ++j) {
+                if (!too_long[j])
+                    continue;
 
-            for (auto e : mesh_->edges()) {
+                const SurfaceMesh::Edge e = edges[j];
                 v0 = mesh_->vertex(e, 0);
                 v1 = mesh_->vertex(e, 1);
+                const vec3 &p0 = points_[v0];
+                const vec3 &p1 = points_[v1];
 
-                if (!elocked_[e] && is_too_long(v0, v1)) {
-                    const vec3 &p0 = points_[v0];
-                    const vec3 &p1 = points_[v1];
+                is_feature = efeature_[e];
+                is_boundary = mesh_->is_border(e);
 
-                    is_feature = efeature_[e];
-                    is_boundary = mesh_->is_border(e);
+                vnew = mesh_->add_vertex((p0 + p1) * 0.5f);
+                mesh_->split(e, vnew);
 
-                    vnew = mesh_->add_vertex((p0 + p1) * 0.5f);
-                    mesh_->split(e, vnew);
+                // need sizing for adaptive refinement
+                vsizing_[vnew] = 0.5f * (vsizing_[v0] + vsizing_[v1]);
+                new_vertices.push_back(vnew);
 
-                    // need normal or sizing for adaptive refinement
-                    vnormal_[vnew] = mesh_->compute_vertex_normal(vnew);
-                    vsizing_[vnew] = 0.5f * (vsizing_[v0] + vsizing_[v1]);
+                if (is_feature) {
+                    enew = is_boundary ? SurfaceMesh::Edge(mesh_->n_edges() - 2)
+                                       : SurfaceMesh::Edge(mesh_->n_edges() - 3);
+                    efeature_[enew] = true;
+                    vfeature_[vnew] = true;
+                } else {
+                    projected.push_back(vnew);
+                }
+            }
 
-                    if (is_feature) {
-                        enew = is_boundary ? SurfaceMesh::Edge(mesh_->n_edges() - 2)
-                                           : SurfaceMesh::Edge(mesh_->n_edges() - 3);
-                        efeature_[enew] = true;
-                        vfeature_[vnew] = true;
-                    } else {
-                        project_to_reference(vnew);
-                    }
+            // need normals for adaptive refinement
+            const int num_new = static_cast<int>(new_vertices.size());
+#pragma omp parallel for schedule(static)
+            for (int j = 0; j < num_new; ++j)
+                vnormal_[new_vertices[j]] = mesh_->compute_vertex_normal(new_vertices[j]);
+            project_to_reference(projected);
 
-                    ok = false;
-                }
+            // only the edges incident to the new vertices may still be too long
+            edges.clear();
+            for (auto v : new_vertices) {
+                for (auto h : mesh_->halfedges(v))
+                    edges.push_back(mesh_->edge(h));
             }
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
         }
+
+        timings_.split += w.elapsed_seconds(6);
     }
 
     //-----------------------------------------------------------------------------
 
-    void SurfaceMeshRemeshing::collapse_short_edges() {
+    SurfaceMesh::Halfedge SurfaceMeshRemeshing::collapse_candidate(SurfaceMesh::Edge e) const {
         SurfaceMesh::Vertex v0, v1;
         SurfaceMesh::Halfedge h0, h1, h01, h10;
-        bool ok, b0, b1, l0, l1, f0, f1;
-        int i;
+        bool b0, b1, l0, l1, f0, f1;
         bool hcol01, hcol10;
 
-        for (ok = false, i = 0; !ok && i < 10; ++i) {
-            ok = true;
-
-            for (auto e : mesh_->edges()) {
-                if (!mesh_->is_deleted(e) && !elocked_[e]) {
-                    h10 = mesh_->halfedge(e, 0);
-                    h01 = mesh_->halfedge(e, 1);
-                    v0 = mesh_->target(h10);
-                    v1 = mesh_->target(h01);
-
-                    if (is_too_short(v0, v1)) {
-                        // get status
-                        b0 = mesh_->is_border(v0);
-                        b1 = mesh_->is_border(v1);
-                        l0 = vlocked_[v0];
-                        l1 = vlocked_[v1];
-                        f0 = vfeature_[v0];
-                        f1 = vfeature_[v1];
-                        hcol01 = hcol10 = true;
-
-                        // boundary rules
-                        if (b0 && b1) {
-                            if (!mesh_->is_border(e))
-                                continue;
-                        } else if (b0)
-                            hcol01 = false;
-                        else if (b1)
-                            hcol10 = false;
-
-                        // locked rules
-                        if (l0 && l1)
-                            continue;
-                        else if (l0)
-                            hcol01 = false;
-                        else if (l1)
-                            hcol10 = false;
-
-                        // feature rules
-                        if (f0 && f1) {
-                            // edge must be feature
-                            if (!efeature_[e])
-                                continue;
-
-                            // the other two edges removed by collapse must not be features
-                            h0 = mesh_->prev(h01);
-                            h1 = mesh_->next(h10);
-                            if (efeature_[mesh_->edge(h0)] ||
-                                efeature_[mesh_->edge(h1)])
-                                hcol01 = false;
-                            // the other two edges removed by collapse must not be features
-                            h0 = mesh_->prev(h10);
-                            h1 = mesh_->next(h01);
-                            if (efeature_[mesh_->edge(h0)] ||
-                                efeature_[mesh_->edge(h1)])
-                                hcol10 = false;
-                        } else if (f0)
-                            hcol01 = false;
-                        else if (f1)
-                            hcol10 = false;
-
-                        // topological rules
-                        bool collapse_ok = mesh_->is_collapse_ok(h01);
-
-                        if (hcol01)
-                            hcol01 = collapse_ok;
-                        if (hcol10)
-                            hcol10 = collapse_ok;
-
-                        // both collapses possible: collapse into vertex w/ higher valence
-                        if (hcol01 && hcol10) {
-                            if (mesh_->valence(v0) < mesh_->valence(v1))
-                                hcol10 = false;
-                            else
-                                hcol01 = false;
-                        }
+        if (mesh_->is_deleted(e) || elocked_[e])
+            return SurfaceMesh::Halfedge();
+
+        h10 = mesh_->halfedge(e, 0);
+        h01 = mesh_->halfedge(e, 1);
+        v0 = mesh_->target(h10);
+        v1 = mesh_->target(h01);
+
+        if (!is_too_short(v0, v1))
+            return SurfaceMesh::Halfedge();
+
+        // get status
+        b0 = mesh_->is_border(v0);
+        b1 = mesh_->is_border(v1);
+        l0 = vlocked_[v0];
+        l1 = vlocked_[v1];
+        f0 = vfeature_[v0];
+        f1 = vfeature_[v1];
+        hcol01 = hcol10 = true;
+
+        // boundary rules
+        if (b0 && b1) {
+            if (!mesh_->is_border(e))
+                return SurfaceMesh::Halfedge();
+        } else if (b0)
+            hcol01 = false;
+        else if (b1)
+            hcol10 = false;
+
+        // locked rules
+        if (l0 && l1)
+            return SurfaceMesh::Halfedge();
+        else if (l0)
+            hcol01 = false;
+        else if (l1)
+            hcol10 = false;
+
+        // feature rules
+        if (f0 && f1) {
+            // edge must be feature
+            if (!efeature_[e])
+                return SurfaceMesh::Halfedge();
+
+            // the other two edges removed by collapse must not be features
+            h0 = mesh_->prev(h01);
+            h1 = mesh_->next(h10);
+            if (efeature_[mesh_->edge(h0)] ||
+                efeature_[mesh_->edge(h1)])
+                hcol01 = false;
+            // the other two edges removed by collapse must not be features
+            h0 = mesh_->prev(h10);
+            h1 = mesh_->next(h01);
+            if (efeature_[mesh_->edge(h0)] ||
+                efeature_[mesh_->edge(h1)])
+                hcol10 = false;
+        } else if (f0)
+            hcol01 = false;
+        else if (f1)
+            hcol10 = false;
+
+        // topological rules
+        bool collapse_ok = mesh_->is_collapse_ok(h01);
+
+        if (hcol01)
+            hcol01 = collapse_ok;
+        if (hcol10)
+            hcol10 = collapse_ok;
+
+        // both collapses possible: collapse into vertex w/ higher valence
+        if (hcol01 && hcol10) {
+            if (mesh_->valence(v0) < mesh_->valence(v1))
+                hcol10 = false;
+            else
+                hcol01 = false;
+        }
 
-                        // try v1 -> v0
-                        if (hcol10) {
-                            // don't create too long edges
-                            for (auto vv : mesh_->vertices(v1)) {
-                                if (is_too_long(v0, vv)) {
-                                    hcol10 = false;
-                                    break;
-                                }
-                            }
+        // try v1 -> v0
+        if (hcol10) {
+            // don't create too long edges
+            for (auto vv : mesh_->vertices(v1)) {
+                if (is_too_long(v0, vv))
+                    return SurfaceMesh::Halfedge();
+            }
+            return h10;
+        }
 
-                            if (hcol10) {
-                                mesh_->collapse(h10);
-                                ok = false;
-                            }
-                        }
+            // try v0 -> v1
+        else if (hcol01) {
+            // don't create too long edges
+            for (auto vv : mesh_->vertices(v0)) {
+                if (is_too_long(v1, vv))
+                    return SurfaceMesh::Halfedge();
+            }
+            return h01;
+        }
 
-                            // try v0 -> v1
-                        else if (hcol01) {
-                            // don't create too long edges
-                            for (auto vv : mesh_->vertices(v0)) {
-                                if (is_too_long(v1, vv)) {
-                                    hcol01 = false;
-                                    break;
-                                }
-                            }
+        return SurfaceMesh::Halfedge();
+    }
 
-                            if (hcol01) {
-                                mesh_->collapse(h01);
-                                ok = false;
-                            }
-                        }
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshRemeshing::collapse_short_edges() {
+        StopWatch w;
+
+        // the edges to be checked (all edges in the first round, and then the edges around the collapses)
+        std::vector<SurfaceMesh::Edge> edges;
+        edges.reserve(mesh_->n_edges());
+        for (auto e : mesh_->edges())
+            edges.push_back(e);
+        std::vector<SurfaceMesh::Halfedge> candidates;
+        std::vector<SurfaceMesh::Vertex> marked;
+        std::vector<int> vmark(mesh_->vertices_size(), -1);  // the round in which a vertex was marked
+
+        for (int i = 0; !edges.empty() && i < 100; ++i) {
+            // find the candidates in parallel
+            const int num = static_cast<int>(edges.size());
+            candidates.resize(num);
+#pragma omp parallel for schedule(static)
+            for (int j = 0; j < num; ++j)
+                candidates[j] = collapse_candidate(edges[j]);
+
+            // collapse an independent set of the candidates. A collapse only changes the faces incident to the removed
+            // vertex, so the decision for an edge remains valid as long as neither of its vertices is in the (closed)
+            // one-ring of a vertex removed before.
+            marked.clear();
+            for (int j = 0; j < num; ++j) {
+                const SurfaceMesh::Halfedge h = candidates[j];
+                if (!h.is_valid())
+                    continue;
+                const SurfaceMesh::Vertex v0 = mesh_->source(h);
+                const SurfaceMesh::Vertex v1 = mesh_->target(h);
+                if (vmark[v0.idx()] == i || vmark[v1.idx()] == i)
+                    continue;
+
+                vmark[v0.idx()] = i;
+                for (auto v : mesh_->vertices(v0)) {
+                    if (vmark[v.idx()] != i) {
+                        vmark[v.idx()] = i;
+                        marked.push_back(v);
                     }
                 }
+                mesh_->collapse(h);
+            }
+
+            // only the edges around the collapses may change their status
+            edges.clear();
+            for (auto v : marked) {
+                for (auto h : mesh_->halfedges(v))
+                    edges.push_back(mesh_->edge(h));
             }
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
         }
 
         mesh_->collect_garbage();
+        timings_.collapse += w.elapsed_seconds(6);
     }
 
     //-----------------------------------------------------------------------------
 
-    void SurfaceMeshRemeshing::flip_edges() {
+    bool SurfaceMeshRemeshing::is_flip_candidate(SurfaceMesh::Edge e,
+                                                 const SurfaceMesh::VertexProperty<int> &valence) const {
         SurfaceMesh::Vertex v0, v1, v2, v3;
         SurfaceMesh::Halfedge h;
         int val0, val1, val2, val3;
         int val_opt0, val_opt1, val_opt2, val_opt3;
         int ve0, ve1, ve2, ve3, ve_before, ve_after;
-        bool ok;
-        int i;
+
+        if (elocked_[e] || efeature_[e] || mesh_->is_border(e))
+            return false;
+
+        h = mesh_->halfedge(e, 0);
+        v0 = mesh_->target(h);
+        v2 = mesh_->target(mesh_->next(h));
+        h = mesh_->halfedge(e, 1);
+        v1 = mesh_->target(h);
+        v3 = mesh_->target(mesh_->next(h));
+
+        if (vlocked_[v0] || vlocked_[v1] || vlocked_[v2] || vlocked_[v3])
+            return false;
+
+        val0 = valence[v0];
+        val1 = valence[v1];
+        val2 = valence[v2];
+        val3 = valence[v3];
+
+        val_opt0 = (mesh_->is_border(v0) ? 4 : 6);
+        val_opt1 = (mesh_->is_border(v1) ? 4 : 6);
+        val_opt2 = (mesh_->is_border(v2) ? 4 : 6);
+        val_opt3 = (mesh_->is_border(v3) ? 4 : 6);
+
+        ve0 = (val0 - val_opt0);
+        ve1 = (val1 - val_opt1);
+        ve2 = (val2 - val_opt2);
+        ve3 = (val3 - val_opt3);
+
+        ve0 *= ve0;
+        ve1 *= ve1;
+        ve2 *= ve2;
+        ve3 *= ve3;
+
+        ve_before = ve0 + ve1 + ve2 + ve3;
+
+        --val0;
+        --val1;
+        ++val2;
+        ++val3;
+
+        ve0 = (val0 - val_opt0);
+        ve1 = (val1 - val_opt1);
+        ve2 = (val2 - val_opt2);
+        ve3 = (val3 - val_opt3);
+
+        ve0 *= ve0;
+        ve1 *= ve1;
+        ve2 *= ve2;
+        ve3 *= ve3;
+
+        ve_after = ve0 + ve1 + ve2 + ve3;
+
+        return ve_before > ve_after && mesh_->is_flip_ok(e);
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshRemeshing::flip_edges() {
+        StopWatch w;
+        SurfaceMesh::Vertex v0, v1, v2, v3;
+        SurfaceMesh::Halfedge h;
 
         // precompute valences
         SurfaceMesh::VertexProperty<int> valence = mesh_->add_vertex_property<int>("valence");
@@ -509,196 +689,187 @@ namespace easy3d {
             valence[v] = mesh_->valence(v);
         }
 
-        for (ok = false, i = 0; !ok && i < 10; ++i) {
-            ok = true;
-
-            for (auto e : mesh_->edges()) {
-                if (!elocked_[e] && !efeature_[e]) {
-                    h = mesh_->halfedge(e, 0);
-                    v0 = mesh_->target(h);
-                    v2 = mesh_->target(mesh_->next(h));
-                    h = mesh_->halfedge(e, 1);
-                    v1 = mesh_->target(h);
-                    v3 = mesh_->target(mesh_->next(h));
-
-                    if (!vlocked_[v0] && !vlocked_[v1] && !vlocked_[v2] &&
-                        !vlocked_[v3]) {
-                        val0 = valence[v0];
-                        val1 = valence[v1];
-                        val2 = valence[v2];
-                        val3 = valence[v3];
-
-                        val_opt0 = (mesh_->is_border(v0) ? 4 : 6);
-                        val_opt1 = (mesh_->is_border(v1) ? 4 : 6);
-                        val_opt2 = (mesh_->is_border(v2) ? 4 : 6);
-                        val_opt3 = (mesh_->is_border(v3) ? 4 : 6);
-
-                        ve0 = (val0 - val_opt0);
-                        ve1 = (val1 - val_opt1);
-                        ve2 = (val2 - val_opt2);
-                        ve3 = (val3 - val_opt3);
-
-                        ve0 *= ve0;
-                        ve1 *= ve1;
-                        ve2 *= ve2;
-                        ve3 *= ve3;
-
-                        ve_before = ve0 + ve1 + ve2 + ve3;
-
-                        --val0;
-                        --val1;
-                        ++val2;
-                        ++val3;
-
-                        ve0 = (val0 - val_opt0);
-                        ve1 = (val1 - val_opt1);
-                        ve2 = (val2 - val_opt2);
-                        ve3 = (val3 - val_opt3);
-
-                        ve0 *= ve0;
-                        ve1 *= ve1;
-                        ve2 *= ve2;
-                        ve3 *= ve3;
-
-                        ve_after = ve0 + ve1 + ve2 + ve3;
-
-                        if (ve_before > ve_after && mesh_->is_flip_ok(e)) {
-                            mesh_->flip(e);
-                            --valence[v0];
-                            --valence[v1];
-                            ++valence[v2];
-                            ++valence[v3];
-                            ok = false;
-                        }
-                    }
+        // the edges to be checked (all edges in the first round, and then the edges around the flipped ones)
+        std::vector<SurfaceMesh::Edge> edges;
+        edges.reserve(mesh_->n_edges());
+        for (auto e : mesh_->edges())
+            edges.push_back(e);
+        std::vector<char> candidates;
+        std::vector<SurfaceMesh::Vertex> marked;
+        std::vector<int> vmark(mesh_->vertices_size(), -1);  // the round in which a vertex was marked
+
+        for (int i = 0; !edges.empty() && i < 100; ++i) {
+            // find the candidates in parallel
+            const int num = static_cast<int>(edges.size());
+            candidates.assign(num, 0);
+#pragma omp parallel for schedule(static)
+            for (int j = 0; j < num; ++j)
+                candidates[j] = is_flip_candidate(edges[j], valence);
+
+            // flip an independent set of the candidates: a flip only changes the valences of its four vertices and
+            // the two faces spanned by them, so flips with disjoint vertices do not affect each other.
+            marked.clear();
+            for (int j = 0; j < num; ++j) {
+                if (!candidates[j])
+                    continue;
+
+                const SurfaceMesh::Edge e = edges[j];
+                h = mesh_->halfedge(e, 0);
+                v0 = mesh_->target(h);
+                v2 = mesh_->target(mesh_->next(h));
+                h = mesh_->halfedge(e, 1);
+                v1 = mesh_->target(h);
+                v3 = mesh_->target(mesh_->next(h));
+                if (vmark[v0.idx()] == i || vmark[v1.idx()] == i || vmark[v2.idx()] == i || vmark[v3.idx()] == i)
+                    continue;
+
+                for (auto v : {v0, v1, v2, v3}) {
+                    vmark[v.idx()] = i;
+                    marked.push_back(v);
                 }
+
+                mesh_->flip(e);
+                --valence[v0];
+                --valence[v1];
+                ++valence[v2];
+                ++valence[v3];
             }
+
+            // only the edges of the faces around the flips may change their status
+            edges.clear();
+            for (auto v : marked) {
+                for (auto hh : mesh_->halfedges(v)) {
+                    edges.push_back(mesh_->edge(hh));
+                    if (!mesh_->is_border(hh))
+                        edges.push_back(mesh_->edge(mesh_->next(hh)));
+                }
+            }
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
         }
 
         mesh_->remove_vertex_property(valence);
+        timings_.flip += w.elapsed_seconds(6);
     }
 
     //-----------------------------------------------------------------------------
 
     void SurfaceMeshRemeshing::tangential_smoothing(unsigned int iterations) {
-        SurfaceMesh::Vertex v1, v2, v3, vv;
-        SurfaceMesh::Edge e;
-        float w, ww, area;
-        vec3 u, n, t, b;
+        StopWatch w;
 
         // add property
         SurfaceMesh::VertexProperty<vec3> update = mesh_->add_vertex_property<vec3>("v:update", vec3(0, 0, 0));
 
+        // the vertices to be smoothed
+        std::vector<SurfaceMesh::Vertex> vertices;
+        for (auto v : mesh_->vertices()) {
+            if (!mesh_->is_border(v) && !vlocked_[v])
+                vertices.push_back(v);
+        }
+        const int num = static_cast<int>(vertices.size());
+
         // project at the beginning to get valid sizing values and normal vectors
         // for vertices introduced by splitting
-        if (use_projection_) {
-            for (auto v : mesh_->vertices()) {
-                if (!mesh_->is_border(v) && !vlocked_[v]) {
-                    project_to_reference(v);
-                }
-            }
-        }
+        project_to_reference(vertices);
 
         for (unsigned int iters = 0; iters < iterations; ++iters) {
-            for (auto v : mesh_->vertices()) {
-                if (!mesh_->is_border(v) && !vlocked_[v]) {
-                    if (vfeature_[v]) {
-                        u = vec3(0.0);
-                        t = vec3(0.0);
-                        ww = 0;
-                        int c = 0;
-
-                        for (auto h : mesh_->halfedges(v)) {
-                            if (efeature_[mesh_->edge(h)]) {
-                                vv = mesh_->target(h);
-
-                                b = points_[v];
-                                b += points_[vv];
-                                b *= 0.5;
-
-                                w = distance(points_[v], points_[vv]) /
-                                    (0.5 * (vsizing_[v] + vsizing_[vv]));
-                                ww += w;
-                                u += w * b;
-
-                                if (c == 0) {
-                                    t += normalize(points_[vv] - points_[v]);
-                                    ++c;
-                                } else {
-                                    ++c;
-                                    t -= normalize(points_[vv] - points_[v]);
-                                }
-                            }
-                        }
+            // the updates only depend on the current positions, so they are computed in parallel
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < num; ++i) {
+                const SurfaceMesh::Vertex v = vertices[i];
+                SurfaceMesh::Vertex v1, v2, v3, vv;
+                float w, ww, area;
+                vec3 u, n, t, b;
 
-                        assert(c == 2);
+                if (vfeature_[v]) {
+                    u = vec3(0.0);
+                    t = vec3(0.0);
+                    ww = 0;
+                    int c = 0;
 
-                        if (ww > 0) {// to avoid overflow (i.e., ww == 0)
-                            u /= ww;
-                            u -= points_[v];
-                            t = normalize(t);
-                            u = t * dot(u, t);
-                            update[v] = u;
-                        }
-                    } else {
-                        u = vec3(0.0);
-                        t = vec3(0.0);
-                        ww = 0;
-
-                        for (auto h : mesh_->halfedges(v)) {
-                            v1 = v;
-                            v2 = mesh_->target(h);
-                            v3 = mesh_->target(mesh_->next(h));
-
-                            b = points_[v1];
-                            b += points_[v2];
-                            b += points_[v3];
-                            b *= (1.0 / 3.0);
-
-                            area = norm(cross(points_[v2] - points_[v1],
-                                              points_[v3] - points_[v1]));
-                            w = area /
-                                pow((vsizing_[v1] + vsizing_[v2] + vsizing_[v3]) /
-                                    3.0,
-                                    2.0);
+                    for (auto h : mesh_->halfedges(v)) {
+                        if (efeature_[mesh_->edge(h)]) {
+                            vv = mesh_->target(h);
 
-                            u += w * b;
+                            b = points_[v];
+                            b += points_[vv];
+                            b *= 0.5;
+
+                            w = distance(points_[v], points_[vv]) /
+                                (0.5 * (vsizing_[v] + vsizing_[vv]));
                             ww += w;
-                        }
+                            u += w * b;
 
-                        if (ww > 0) { // to avoid overflow (i.e., ww == 0)
-                            u /= ww;
-                            u -= points_[v];
-                            n = vnormal_[v];
-                            u -= n * dot(u, n);
-                            update[v] = u;
+                            if (c == 0) {
+                                t += normalize(points_[vv] - points_[v]);
+                                ++c;
+                            } else {
+                                ++c;
+                                t -= normalize(points_[vv] - points_[v]);
+                            }
                         }
                     }
+
+                    assert(c == 2);
+
+                    if (ww > 0) {// to avoid overflow (i.e., ww == 0)
+                        u /= ww;
+                        u -= points_[v];
+                        t = normalize(t);
+                        u = t * dot(u, t);
+                        update[v] = u;
+                    }
+                } else {
+                    u = vec3(0.0);
+                    t = vec3(0.0);
+                    ww = 0;
+
+                    for (auto h : mesh_->halfedges(v)) {
+                        v1 = v;
+                        v2 = mesh_->target(h);
+                        v3 = mesh_->target(mesh_->next(h));
+
+                        b = points_[v1];
+                        b += points_[v2];
+                        b += points_[v3];
+                        b *= (1.0 / 3.0);
+
+                        area = norm(cross(points_[v2] - points_[v1],
+                                          points_[v3] - points_[v1]));
+                        w = area /
+                            pow((vsizing_[v1] + vsizing_[v2] + vsizing_[v3]) /
+                                3.0,
+                                2.0);
+
+                        u += w * b;
+                        ww += w;
+                    }
+
+                    if (ww > 0) { // to avoid overflow (i.e., ww == 0)
+                        u /= ww;
+                        u -= points_[v];
+                        n = vnormal_[v];
+                        u -= n * dot(u, n);
+                        update[v] = u;
+                    }
                 }
             }
 
             // update vertex positions
-            for (auto v : mesh_->vertices()) {
-                if (!mesh_->is_border(v) && !vlocked_[v]) {
-                    points_[v] += update[v];
-                }
-            }
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < num; ++i)
+                points_[vertices[i]] += update[vertices[i]];
 
             // update normal vectors (if not done so through projection)
-            mesh_->update_vertex_normals();
+            update_vertex_normals();
         }
 
         // project at the end
-        if (use_projection_) {
-            for (auto v : mesh_->vertices()) {
-                if (!mesh_->is_border(v) && !vlocked_[v]) {
-                    project_to_reference(v);
-                }
-            }
-        }
+        project_to_reference(vertices);
 
         // remove property
         mesh_->remove_vertex_property(update);
+        timings_.smoothing += w.elapsed_seconds(6);
     }
 
     //-----------------------------------------------------------------------------
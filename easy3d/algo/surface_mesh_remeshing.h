@@ -27,9 +27,11 @@
 
 #include <easy3d/core/surface_mesh.h>
 
+#include <vector>
+
 namespace easy3d {
 
-    class TriangleMeshKdTree;
+    class TriangleMeshBVH;
 
     /**
      * \brief A class for uniform and adaptive surface remeshing.
@@ -40,6 +42,11 @@ namespace easy3d {
      * and tangential relaxation. See the following papers for more details:
      *  - Mario Botsch and Leif Kobbelt. A remeshing approach to multiresolution modeling. SGP, 2004.
      *  - Marion Dunyach et al. Adaptive remeshing for real-time mesh deformation. EG (Short Papers) 2013.
+     *
+     * The smoothing and projection phases process the vertices in parallel. The topological phases (split, collapse,
+     * and flip) evaluate the edges in parallel and then perform the operations of an independent set of the
+     * candidates (i.e., operations whose one-rings do not overlap), which is repeated on the affected edges until no
+     * candidates remain. The time spent in each phase is available from timings().
      */
     class SurfaceMeshRemeshing {
     public:
@@ -56,6 +63,18 @@ namespace easy3d {
                                 float approx_error, unsigned int iterations = 10,
                                 bool use_projection = true);
 
+        //! \brief The time (in seconds) spent in each phase of the last remeshing.
+        struct Timings {
+            double preprocessing;   //!< building the sizing field and the reference mesh
+            double split;           //!< splitting long edges
+            double collapse;        //!< collapsing short edges
+            double flip;            //!< flipping edges to improve valences
+            double smoothing;       //!< tangential smoothing
+            double projection;      //!< projecting vertices onto the reference mesh (part of split and smoothing)
+        };
+        //! \brief Returns the timings of the last remeshing.
+        const Timings &timings() const { return timings_; }
+
     private:
         void preprocessing();
         void postprocessing();
@@ -68,6 +87,15 @@ namespace easy3d {
         void remove_caps();
 
         void project_to_reference(SurfaceMesh::Vertex v);
+        // projects the vertices in parallel
+        void project_to_reference(const std::vector<SurfaceMesh::Vertex> &vertices);
+
+        // the halfedge to be collapsed for an edge (invalid if the edge should not be collapsed)
+        SurfaceMesh::Halfedge collapse_candidate(SurfaceMesh::Edge e) const;
+        // whether flipping an edge improves the valences of its vertices
+        bool is_flip_candidate(SurfaceMesh::Edge e, const SurfaceMesh::VertexProperty<int> &valence) const;
+        // computes the vertex normals in parallel
+        void update_vertex_normals();
 
         bool is_too_long(SurfaceMesh::Vertex v0, SurfaceMesh::Vertex v1) const {
             return distance(points_[v0], points_[v1]) >
@@ -84,7 +112,7 @@ namespace easy3d {
         SurfaceMesh *refmesh_;
 
         bool use_projection_;
-        TriangleMeshKdTree *kd_tree_;
+        TriangleMeshBVH *bvh_;
 
         bool uniform_;
         float target_edge_length_;
@@ -103,6 +131,8 @@ namespace easy3d {
         SurfaceMesh::VertexProperty <vec3> refpoints_;
         SurfaceMesh::VertexProperty <vec3> refnormals_;
         SurfaceMesh::VertexProperty<float> refsizing_;
+
+        Timings timings_;
     };
 
 } // namespace easy3d
@@ -22,9 +22,16 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #include <easy3d/algo/surface_mesh_sampler.h>
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
 #include <easy3d/core/surface_mesh.h>
 #include <easy3d/core/point_cloud.h>
+#include <easy3d/algo/point_cloud_simplification.h>
 #include <easy3d/util/file_system.h>
 #include <easy3d/util/progress.h>
 
@@ -32,6 +39,119 @@
 namespace easy3d {
 
 
+    // \cond
+    namespace details {
+
+        // the finalizer of splitmix64
+        inline uint64_t hash(uint64_t x) {
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            return x ^ (x >> 31);
+        }
+
+        // a counter-based random number in [0, 1): the value only depends on the seed and the counter
+        inline double uniform(uint64_t seed, uint64_t counter) {
+            const uint64_t bits = hash(hash(seed + 0x9e3779b97f4a7c15ull) ^ counter) >> 11;
+            return static_cast<double>(bits) * (1.0 / 9007199254740992.0);  // 2^-53
+        }
+
+
+        // The triangles (the polygonal faces are triangulated as fans) of a mesh in flat arrays.
+        struct TriangleTable {
+            std::vector<SurfaceMesh::Vertex> vertices;  // three vertices per triangle
+            std::vector<vec3> normals;                  // the normal of each triangle (i.e., of its face)
+            std::vector<double> area_sum;               // the prefix sums of the triangle areas (size + 1 entries)
+
+            std::size_t size() const { return normals.size(); }
+            double area() const { return area_sum.back(); }
+        };
+
+
+        void build_triangle_table(const SurfaceMesh *mesh, TriangleTable &table) {
+            auto face_normals = mesh->get_face_property<vec3>("f:normal");
+            for (auto f : mesh->faces()) {
+                const vec3 n = face_normals ? face_normals[f] : mesh->compute_face_normal(f);
+                SurfaceMesh::Halfedge start = mesh->halfedge(f);
+                SurfaceMesh::Halfedge cur = mesh->next(mesh->next(start));
+                SurfaceMesh::Vertex va = mesh->target(start);
+                while (cur != start) {
+                    table.vertices.push_back(va);
+                    table.vertices.push_back(mesh->source(cur));
+                    table.vertices.push_back(mesh->target(cur));
+                    table.normals.push_back(n);
+                    cur = mesh->next(cur);
+                }
+            }
+
+            const int num = static_cast<int>(table.size());
+            const auto &points = mesh->points();
+            std::vector<double> areas(num);
+#pragma omp parallel for
+            for (int i = 0; i < num; ++i) {
+                const SurfaceMesh::Vertex *v = &table.vertices[3 * i];
+                areas[i] = geom::triangle_area(points[v[0].idx()], points[v[1].idx()], points[v[2].idx()]);
+            }
+
+            table.area_sum.resize(num + 1);
+            table.area_sum[0] = 0.0;
+            for (int i = 0; i < num; ++i)
+                table.area_sum[i + 1] = table.area_sum[i] + areas[i];
+        }
+
+
+        // Generates 'num' samples on the triangles, storing them in points[0, num) and normals[0, num). The number of
+        // samples of a triangle is determined by the prefix sums of the areas: triangle t receives the samples in
+        // [first(t), first(t + 1)), where first(t) = floor(num * area_sum[t] / area). So the triangles can be processed
+        // independently, and a sample's random numbers are drawn from the counters (2k, 2k + 1) of its index k.
+        // Returns false if cancelled.
+        bool generate_samples(const SurfaceMesh *mesh, const TriangleTable &table, std::size_t num, uint64_t seed,
+                              vec3 *points, vec3 *normals) {
+            const auto &mesh_points = mesh->points();
+            const double scale = static_cast<double>(num) / table.area();
+            auto first = [&](std::size_t t) -> std::size_t {
+                if (t == table.size())
+                    return num;
+                return std::min(num, static_cast<std::size_t>(table.area_sum[t] * scale));
+            };
+
+            // the triangles are processed in blocks to report the progress and to allow cancellation
+            const int num_triangles = static_cast<int>(table.size());
+            const int num_blocks = std::min(num_triangles, 100);
+            ProgressLogger progress(num_blocks, false, false);
+            for (int b = 0; b < num_blocks; ++b) {
+                if (progress.is_canceled())
+                    return false;
+
+                const int begin = static_cast<int>(static_cast<int64_t>(num_triangles) * b / num_blocks);
+                const int end = static_cast<int>(static_cast<int64_t>(num_triangles) * (b + 1) / num_blocks);
+#pragma omp parallel for schedule(dynamic, 256)
+                for (int t = begin; t < end; ++t) {
+                    const vec3 &a = mesh_points[table.vertices[3 * t].idx()];
+                    const vec3 ab = mesh_points[table.vertices[3 * t + 1].idx()] - a;
+                    const vec3 ac = mesh_points[table.vertices[3 * t + 2].idx()] - a;
+                    const vec3 &n = table.normals[t];
+                    const std::size_t last = first(t + 1);
+                    for (std::size_t k = first(t); k < last; ++k) {
+                        // uniform barycentric coordinates
+                        const double s = std::sqrt(uniform(seed, 2 * k));
+                        const double r = uniform(seed, 2 * k + 1);
+                        points[k] = a + static_cast<float>(s * (1.0 - r)) * ab + static_cast<float>(s * r) * ac;
+                        normals[k] = n;
+                    }
+                }
+                progress.notify(b + 1);
+            }
+            return true;
+        }
+
+    }
+    // \endcond
+
+
+    SurfaceMeshSampler::SurfaceMeshSampler() : seed_(0), blue_noise_(false), oversampling_(4.0f) {
+    }
+
+
     PointCloud *SurfaceMeshSampler::apply(const SurfaceMesh *mesh, int num /* = 1000000 */) {
         PointCloud *cloud = new PointCloud;
         const std::string &name = file_system::name_less_extension(mesh->name()) + "_sampled.ply";
@@ -41,110 +161,69 @@ namespace easy3d {
 
         LOG(INFO) << "sampling surface...";
 
-        // add all mesh vertices (even the requestred number is smaller than the
-        // number of vertices in the mesh.
-
-        auto mesh_points = mesh->get_vertex_property<vec3>("v:point");
-        auto mesh_vertex_normals = mesh->get_vertex_property<vec3>("v:normal");
-        for (auto p : mesh->vertices()) {
-            PointCloud::Vertex v = cloud->add_vertex(mesh_points[p]);
-            if (mesh_vertex_normals)
-                normals[v] = mesh_vertex_normals[p];
-            else
-                normals[v] = mesh->compute_vertex_normal(p);
+        // add all mesh vertices (even the requestred number is smaller than the number of vertices in the mesh).
+        // In blue-noise mode, the vertices are not added because they don't respect the spacing of the samples.
+        if (!blue_noise_) {
+            auto mesh_points = mesh->get_vertex_property<vec3>("v:point");
+            auto mesh_vertex_normals = mesh->get_vertex_property<vec3>("v:normal");
+            for (auto p : mesh->vertices()) {
+                PointCloud::Vertex v = cloud->add_vertex(mesh_points[p]);
+                if (mesh_vertex_normals)
+                    normals[v] = mesh_vertex_normals[p];
+                else
+                    normals[v] = mesh->compute_vertex_normal(p);
+            }
         }
 
         // now we may still need some points
-        int num_needed = num - cloud->n_vertices();
+        const int num_needed = num - static_cast<int>(cloud->n_vertices());
         if (num_needed <= 0)
             return cloud;   // we got enougth points already
 
         // collect triangles and compute their areas
-        struct Triangle : std::vector<SurfaceMesh::Vertex> {
-        };
-
-        std::vector<Triangle> triangles;
-        std::vector<float> triangle_areas;
-        std::vector<vec3> triangle_normals;
-
-        auto mesh_face_normals = mesh->get_face_property<vec3>("f:normal");
-        float surface_area = 0.0;
-        for (auto f : mesh->faces()) {
-            const vec3 &n = mesh_face_normals ? mesh_face_normals[f] : mesh->compute_face_normal(f);
-            SurfaceMesh::Halfedge start = mesh->halfedge(f);
-            SurfaceMesh::Halfedge cur = mesh->next(mesh->next(start));
-            SurfaceMesh::Vertex va = mesh->target(start);
-            while (cur != start) {
-                SurfaceMesh::Vertex vb = mesh->source(cur);
-                SurfaceMesh::Vertex vc = mesh->target(cur);
-
-                Triangle tri;
-                tri.push_back(va);
-                tri.push_back(vb);
-                tri.push_back(vc);
-                triangles.push_back(tri);
-                float area = geom::triangle_area(mesh_points[va], mesh_points[vb], mesh_points[vc]);
-                triangle_areas.push_back(area);
-                triangle_normals.push_back(n);
-                surface_area += area;
-
-                cur = mesh->next(cur);
-            }
+        details::TriangleTable triangles;
+        details::build_triangle_table(mesh, triangles);
+        if (triangles.size() == 0 || !(triangles.area() > 0.0)) {
+            LOG(WARNING) << "the mesh has no face (or zero area) to sample";
+            return cloud;
         }
 
-        float density = num_needed / surface_area;
-        float samples_error = 0.0;
-        std::size_t triangle_num = triangles.size();
-        std::size_t num_generated = 0;
-        std::size_t triangles_done = 0;
-        ProgressLogger progress(triangle_num, false, false);
-        for (std::size_t idx = 0; idx < triangle_num; ++idx) {
-            if (progress.is_canceled()) {
+        if (!blue_noise_) {
+            const std::size_t offset = cloud->vertices_size();
+            cloud->resize(static_cast<unsigned int>(offset + num_needed));
+            if (!details::generate_samples(mesh, triangles, num_needed, seed_, cloud->points().data() + offset,
+                                           normals.vector().data() + offset)) {
                 LOG(WARNING) << "sampling surface mesh cancelled";
                 delete cloud;
                 return nullptr;
             }
-
-            const Triangle &tri = triangles[idx];
-            const vec3 &n = triangle_normals[idx];
-
-            // samples number considering the facet size (i.e., area)
-            float samples_num = triangle_areas[idx] * density;
-            std::size_t quant_samples_num = (std::size_t) samples_num;
-
-            // adjust w.r.t. accumulated error
-            samples_error += samples_num - quant_samples_num;
-            if (samples_error > 1.0) {
-                samples_error -= 1.0;
-                quant_samples_num++;
+        }
+        else {
+            // the candidates are uniform samples, which are thinned to the expected number by Poisson-disk sampling
+            const std::size_t num_candidates = static_cast<std::size_t>(std::max(1.0f, oversampling_) * num_needed);
+            PointCloud candidates;
+            auto candidate_normals = candidates.add_vertex_property<vec3>("v:normal");
+            candidates.resize(static_cast<unsigned int>(num_candidates));
+            if (!details::generate_samples(mesh, triangles, num_candidates, seed_, candidates.points().data(),
+                                           candidate_normals.vector().data())) {
+                LOG(WARNING) << "sampling surface mesh cancelled";
+                delete cloud;
+                return nullptr;
             }
 
-            if (triangles_done ==
-                triangle_num - 1)        // override number to gather all remaining points if last facet
-                quant_samples_num = num_needed - num_generated;
-
-            // generate points
-            for (unsigned int j = 0; j < quant_samples_num; j++) {
-                // compute barycentric coords
-                double s = sqrt((double) rand() / (double) RAND_MAX);
-                double t = (double) rand() / (double) RAND_MAX;
-                double c[3];
-
-                c[0] = 1.0 - s;
-                c[1] = s * (1.0 - t);
-                c[2] = s * t;
-
-                vec3 p;
-                for (std::size_t i = 0; i < 3; i++)
-                    p = p + c[i] * mesh_points[tri[i]];
-
-                PointCloud::Vertex v = cloud->add_vertex(p);
-                normals[v] = n;
+            const auto to_remove = PointCloudSimplification::uniform_simplification(&candidates, static_cast<unsigned int>(num_needed));
+            std::vector<unsigned char> removed(num_candidates, 0);
+            for (auto v : to_remove)
+                removed[v.idx()] = 1;
+            cloud->resize(static_cast<unsigned int>(num_candidates - to_remove.size()));
+            std::size_t idx = 0;
+            for (std::size_t i = 0; i < num_candidates; ++i) {
+                if (!removed[i]) {
+                    cloud->points()[idx] = candidates.points()[i];
+                    normals.vector()[idx] = candidate_normals.vector()[i];
+                    ++idx;
+                }
             }
-
-            num_generated += quant_samples_num;
-            triangles_done++;
-            progress.next();
         }
 
         LOG(INFO) << "done. resulted point cloud has " << cloud->n_vertices() << " points";
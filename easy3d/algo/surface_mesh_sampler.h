@@ -32,11 +32,41 @@ namespace easy3d {
     class SurfaceMesh;
 
     /// \brief Sample a surface mesh (near uniformly) into a point cloud.
+    /// \details The triangles are stored in a flat table and the samples are distributed to them according to the
+    ///     prefix sums of their areas, so all samples can be generated in parallel. Each sample draws its random numbers
+    ///     from a counter-based generator keyed by the seed and the index of the sample, which makes the result
+    ///     independent of the number of threads.
     /// \class SurfaceMeshSampler easy3d/algo/surface_mesh_sampler.h
     class SurfaceMeshSampler {
     public:
+        SurfaceMeshSampler();
+
+        /// \brief Sets the seed of the random number generator. The same seed reproduces the same samples.
+        void set_random_seed(unsigned int seed) { seed_ = seed; }
+        /// \brief Returns the seed of the random number generator (default 0).
+        unsigned int random_seed() const { return seed_; }
+
+        /**
+         * \brief Generates blue-noise (Poisson-disk) samples instead of uniform random samples (default false).
+         * In this mode, (oversampling x num) uniform samples are generated as candidates, which are then thinned by
+         * Poisson-disk sampling (see PointCloudSimplification::uniform_simplification()) to exactly the expected
+         * number. The vertices of the mesh are not included, and the memory peak is proportional to the number of
+         * candidates.
+         */
+        void set_blue_noise(bool b) { blue_noise_ = b; }
+        /// \brief Returns whether blue-noise samples are generated.
+        bool blue_noise() const { return blue_noise_; }
+
+        /// \brief Sets the ratio of the number of candidates to the expected number in blue-noise mode (default 4).
+        void set_oversampling(float ratio) { oversampling_ = ratio; }
+
         /// @param num The expected point number, much be greater than the number of vertices of the surface mesh.
         PointCloud *apply(const SurfaceMesh *mesh, int num = 1000000);
+
+    private:
+        unsigned int seed_;
+        bool blue_noise_;
+        float oversampling_;
     };
 
 } // namespace easy3d
@@ -24,14 +24,21 @@
 
 #include <easy3d/algo/surface_mesh_simplification.h>
 
+#include <easy3d/util/logging.h>
+
 #include <cfloat>
+#include <tuple>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <unordered_map>
 #include <iterator> // for back_inserter on Windows
 
 
 namespace easy3d {
 
     SurfaceMeshSimplification::SurfaceMeshSimplification(SurfaceMesh *mesh)
-            : mesh_(mesh), initialized_(false), queue_(nullptr) {
+            : mesh_(mesh), initialized_(false), queue_(nullptr), collapses_(nullptr) {
         aspect_ratio_ = 0;
         edge_length_ = 0;
         max_valence_ = 0;
@@ -149,13 +156,312 @@ namespace easy3d {
         if (!initialized_)
             initialize();
 
-        unsigned int nv(mesh_->n_vertices());
+        const unsigned int nv(mesh_->n_vertices());
 
-        std::vector<SurfaceMesh::Vertex> one_ring;
-        std::vector<SurfaceMesh::Vertex>::iterator or_it, or_end;
-        SurfaceMesh::Halfedge h;
-        SurfaceMesh::Vertex v;
+        build_queue();
+        if (nv > n_vertices)
+            decimate(nv - n_vertices);
+        clear_queue();
+
+        mesh_->collect_garbage();
+    }
+
+    //-----------------------------------------------------------------------------
+
+    namespace details {
+
+        // Partitions the faces into num_parts (a power of two) parts by recursively splitting the face centroids at
+        // the median along the longest axis. Returns the part of each face.
+        std::vector<int> partition_faces(const SurfaceMesh *mesh, int num_parts) {
+            const auto &points = mesh->points();
+            std::vector<vec3> centroids(mesh->n_faces());
+            std::vector<int> faces(mesh->n_faces());
+            for (auto f : mesh->faces()) {
+                vec3 c(0, 0, 0);
+                for (auto v : mesh->vertices(f))
+                    c += points[v.idx()];
+                centroids[f.idx()] = c / 3.0f;
+                faces[f.idx()] = f.idx();
+            }
+
+            std::vector<int> face_part(mesh->n_faces(), 0);
+            // (first, last, first part, number of parts)
+            std::vector<std::tuple<int, int, int, int> > ranges(1, std::make_tuple(0, int(faces.size()), 0, num_parts));
+            while (!ranges.empty()) {
+                int first, last, part, count;
+                std::tie(first, last, part, count) = ranges.back();
+                ranges.pop_back();
+                if (count == 1 || last - first < 2) {
+                    for (int i = first; i < last; ++i)
+                        face_part[faces[i]] = part;
+                    continue;
+                }
+
+                Box3 box;
+                for (int i = first; i < last; ++i)
+                    box.add_point(centroids[faces[i]]);
+                int axis = 0;
+                for (int i = 1; i < 3; ++i) {
+                    if (box.range(i) > box.range(axis))
+                        axis = i;
+                }
+
+                const int mid = first + (last - first) / 2;
+                std::nth_element(faces.begin() + first, faces.begin() + mid, faces.begin() + last,
+                                 [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+                ranges.emplace_back(first, mid, part, count / 2);
+                ranges.emplace_back(mid, last, part + count / 2, count / 2);
+            }
+            return face_part;
+        }
+
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshSimplification::simplify_parallel(unsigned int n_vertices, unsigned int num_partitions) {
+        if (!mesh_->is_triangle_mesh()) {
+            LOG(ERROR) << "Not a triangle mesh!";
+            return;
+        }
+        if (mesh_->has_garbage())
+            mesh_->collect_garbage();
+
+        // make sure the decimater is initialized
+        if (!initialized_)
+            initialize();
+
+        const unsigned int nv = mesh_->n_vertices();
+        if (nv <= n_vertices)
+            return;
+
+        // choose the number of parts (a power of two): a few parts per thread, but not too small
+        const unsigned int min_part_faces = 20000;
+        if (num_partitions == 0)
+            num_partitions = 2 * std::max(1u, std::thread::hardware_concurrency());
+        num_partitions = std::min(num_partitions, mesh_->n_faces() / min_part_faces);
+        int num_parts = 1;
+        while (num_parts * 2 <= static_cast<int>(num_partitions))
+            num_parts *= 2;
+        if (num_parts < 2) {
+            simplify(n_vertices);
+            return;
+        }
+
+        // partition the faces
+        const std::vector<int> face_part = details::partition_faces(mesh_, num_parts);
+
+        // the vertices on the borders of the parts, and the locked vertices (borders and their one-ring neighbors).
+        // Since the faces incident to the borders are never changed, the parts remain consistent with each other.
+        std::vector<char> border(mesh_->n_vertices(), 0), locked(mesh_->n_vertices(), 0);
+        for (auto v : mesh_->vertices()) {
+            int part = -1;
+            for (auto f : mesh_->faces(v)) {
+                if (part == -1)
+                    part = face_part[f.idx()];
+                else if (part != face_part[f.idx()]) {
+                    border[v.idx()] = 1;
+                    break;
+                }
+            }
+        }
+        std::size_t num_locked = 0;
+        for (auto v : mesh_->vertices()) {
+            locked[v.idx()] = border[v.idx()];
+            if (!locked[v.idx()]) {
+                for (auto vv : mesh_->vertices(v)) {
+                    if (border[vv.idx()]) {
+                        locked[v.idx()] = 1;
+                        break;
+                    }
+                }
+            }
+            if (locked[v.idx()])
+                ++num_locked;
+        }
+
+        std::vector<std::vector<SurfaceMesh::Face> > part_faces(num_parts);
+        for (auto f : mesh_->faces())
+            part_faces[face_part[f.idx()]].push_back(f);
+
+        typedef std::vector<std::pair<SurfaceMesh::Vertex, SurfaceMesh::Vertex> > Collapses;
+        std::vector<SurfaceMesh *> sub_meshes(num_parts, nullptr);
+        std::vector<SurfaceMeshSimplification *> simplifiers(num_parts, nullptr);
+        std::vector<std::vector<SurfaceMesh::Vertex> > sub_to_parent(num_parts);
+        std::vector<Collapses> collapses(num_parts);
+        std::atomic<bool> failed(false);
+
+        // build the sub meshes and their simplifiers
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int p = 0; p < num_parts; ++p) {
+            auto sub = new SurfaceMesh;
+            sub_meshes[p] = sub;
+            std::vector<SurfaceMesh::Vertex> &to_parent = sub_to_parent[p];
+
+            // a border vertex gets a copy per fan of consecutive faces of this part around it, so the sub mesh is
+            // manifold. A fan is identified by its first face (in the order of rotation around the vertex).
+            std::unordered_map<uint64_t, SurfaceMesh::Vertex> to_sub;
+            auto sub_vertex = [&](SurfaceMesh::Halfedge h) -> SurfaceMesh::Vertex {
+                const SurfaceMesh::Vertex v = mesh_->target(h);
+                uint64_t key = uint64_t(v.idx()) << 32 | 0xFFFFFFFFu;
+                if (border[v.idx()]) {
+                    const SurfaceMesh::Halfedge start = h;
+                    SurfaceMesh::Halfedge hh = h;
+                    while (true) {
+                        const SurfaceMesh::Halfedge next = mesh_->opposite(mesh_->next(hh));
+                        const SurfaceMesh::Face f = mesh_->face(next);
+                        if (!f.is_valid() || face_part[f.idx()] != p || next == start)
+                            break;
+                        hh = next;
+                    }
+                    key = uint64_t(v.idx()) << 32 | uint32_t(mesh_->face(hh).idx());
+                }
+                auto pos = to_sub.find(key);
+                if (pos != to_sub.end())
+                    return pos->second;
+                const SurfaceMesh::Vertex sv = sub->add_vertex(vpoint_[v]);
+                to_parent.push_back(v);
+                to_sub[key] = sv;
+                return sv;
+            };
+
+            std::vector<SurfaceMesh::Face> face_to_parent;
+            face_to_parent.reserve(part_faces[p].size());
+            for (auto f : part_faces[p]) {
+                const SurfaceMesh::Halfedge h0 = mesh_->halfedge(f);
+                const SurfaceMesh::Halfedge h1 = mesh_->next(h0);
+                const SurfaceMesh::Halfedge h2 = mesh_->next(h1);
+                const SurfaceMesh::Face sf = sub->add_triangle(sub_vertex(h0), sub_vertex(h1), sub_vertex(h2));
+                if (!sf.is_valid()) {
+                    failed = true;
+                    break;
+                }
+                face_to_parent.push_back(f);
+            }
+            if (failed)
+                continue;
+
+            auto simplifier = new SurfaceMeshSimplification(sub);
+            simplifiers[p] = simplifier;
+            simplifier->aspect_ratio_ = aspect_ratio_;
+            simplifier->edge_length_ = edge_length_;
+            simplifier->max_valence_ = max_valence_;
+            simplifier->normal_deviation_ = normal_deviation_;
+            simplifier->hausdorff_error_ = hausdorff_error_;
+
+            // only the unlocked (and selected) vertices can be removed
+            simplifier->has_selection_ = true;
+            simplifier->vselected_ = sub->add_vertex_property<bool>("v:selected");
+            for (auto v : sub->vertices()) {
+                const SurfaceMesh::Vertex pv = to_parent[v.idx()];
+                simplifier->vselected_[v] = !locked[pv.idx()] && (!has_selection_ || vselected_[pv]);
+            }
+
+            simplifier->has_features_ = has_features_;
+            if (has_features_) {
+                simplifier->vfeature_ = sub->add_vertex_property<bool>("v:feature");
+                simplifier->efeature_ = sub->add_edge_property<bool>("e:feature");
+                for (auto v : sub->vertices())
+                    simplifier->vfeature_[v] = vfeature_[to_parent[v.idx()]];
+                for (auto e : sub->edges()) {
+                    const SurfaceMesh::Vertex v0 = to_parent[sub->vertex(e, 0).idx()];
+                    const SurfaceMesh::Vertex v1 = to_parent[sub->vertex(e, 1).idx()];
+                    simplifier->efeature_[e] = efeature_[mesh_->edge(mesh_->find_halfedge(v0, v1))];
+                }
+            }
+
+            // the sub meshes start with the quadrics (and other data) of the whole mesh
+            for (auto v : sub->vertices())
+                simplifier->vquadric_[v] = vquadric_[to_parent[v.idx()]];
+            if (normal_deviation_) {
+                simplifier->normal_cone_ = sub->face_property<NormalCone>("f:normalCone");
+                for (auto f : sub->faces())
+                    simplifier->normal_cone_[f] = normal_cone_[face_to_parent[f.idx()]];
+            }
+            if (hausdorff_error_) {
+                simplifier->face_points_ = sub->face_property<Points>("f:points");
+                for (auto f : sub->faces())
+                    simplifier->face_points_[f] = face_points_[face_to_parent[f.idx()]];
+            }
+
+            simplifier->initialized_ = true;
+            simplifier->collapses_ = &collapses[p];
+            simplifier->build_queue();
+        }
+
+        // decimate the parts in rounds of increasing error thresholds, sharing the budget of collapses. A part of the
+        // collapses is reserved for the final pass, at least as many as needed to simplify the locked vertices.
+        const std::size_t num_collapses = nv - n_vertices;
+        const std::size_t reserved = std::max(num_collapses / 10, std::size_t(num_locked * (double(num_collapses) / nv)));
+        std::atomic<long long> budget(static_cast<long long>(num_collapses - std::min(num_collapses, reserved)));
+
+        auto min_front_priority = [&]() -> float {
+            float prio = FLT_MAX;
+            for (auto simplifier : simplifiers) {
+                if (simplifier && !simplifier->queue_->empty())
+                    prio = std::min(prio, simplifier->vpriority_[simplifier->queue_->front()]);
+            }
+            return prio;
+        };
+
+        float threshold = failed ? FLT_MAX : min_front_priority();
+        while (!failed && budget > 0 && threshold < FLT_MAX) {
+#pragma omp parallel for schedule(dynamic, 1)
+            for (int p = 0; p < num_parts; ++p) {
+                SurfaceMeshSimplification *simplifier = simplifiers[p];
+                while (budget-- > 0) {
+                    if (simplifier->decimate(1, threshold) == 0) {
+                        ++budget;   // not used
+                        break;
+                    }
+                }
+            }
+
+            const float prio = min_front_priority();
+            if (prio == FLT_MAX)
+                break;
+            threshold = std::max(threshold * 4.0f, prio);
+        }
+
+        for (int p = 0; p < num_parts; ++p) {
+            delete simplifiers[p];
+            delete sub_meshes[p];
+        }
+
+        if (failed) {
+            LOG(WARNING) << "failed partitioning the mesh (non-manifold?). Simplifying the mesh using a single thread";
+            simplify(n_vertices);
+            return;
+        }
+
+        // replay the collapses of the parts on the whole mesh
+        for (int p = 0; p < num_parts; ++p) {
+            const std::vector<SurfaceMesh::Vertex> &to_parent = sub_to_parent[p];
+            for (const auto &c : collapses[p]) {
+                const SurfaceMesh::Halfedge h = mesh_->find_halfedge(to_parent[c.first.idx()], to_parent[c.second.idx()]);
+                if (!h.is_valid() || !mesh_->is_collapse_ok(h)) {
+                    LOG(ERROR) << "unexpected invalid collapse in part " << p << " (this should not happen)";
+                    break;
+                }
+                CollapseData cd(mesh_, h);
+                mesh_->collapse(h);
+                postprocess_collapse(cd);
+            }
+        }
 
+        // the final pass
+        const unsigned int remaining = mesh_->n_vertices();
+        build_queue();
+        if (remaining > n_vertices)
+            decimate(remaining - n_vertices);
+        clear_queue();
+
+        mesh_->collect_garbage();
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshSimplification::build_queue() {
         // add properties for priority queue
         vpriority_ = mesh_->add_vertex_property<float>("v:prio");
         heap_pos_ = mesh_->add_vertex_property<int>("v:heap");
@@ -169,12 +475,31 @@ namespace easy3d {
             queue_->reset_heap_position(v);
             enqueue_vertex(v);
         }
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshSimplification::clear_queue() {
+        delete queue_;
+        queue_ = nullptr;
+        mesh_->remove_vertex_property(vpriority_);
+        mesh_->remove_vertex_property(heap_pos_);
+        mesh_->remove_vertex_property(vtarget_);
+    }
 
-        while (nv > n_vertices && !queue_->empty()) {
+    //-----------------------------------------------------------------------------
+
+    unsigned int SurfaceMeshSimplification::decimate(unsigned int max_collapses, float max_priority) {
+        std::vector<SurfaceMesh::Vertex> one_ring;
+        unsigned int count = 0;
+
+        while (count < max_collapses && !queue_->empty()) {
             // get 1st element
-            v = queue_->front();
+            SurfaceMesh::Vertex v = queue_->front();
+            if (vpriority_[v] > max_priority)
+                break;
             queue_->pop_front();
-            h = vtarget_[v];
+            SurfaceMesh::Halfedge h = vtarget_[v];
             CollapseData cd(mesh_, h);
 
             // check this (again)
@@ -189,24 +514,19 @@ namespace easy3d {
 
             // perform collapse
             mesh_->collapse(h);
-            --nv;
-            //if (nv % 1000 == 0) std::cerr << nv << "\r";
+            ++count;
+            if (collapses_)
+                collapses_->push_back(std::make_pair(cd.v0, cd.v1));
 
             // postprocessing, e.g., update quadrics
             postprocess_collapse(cd);
 
             // update queue
-            for (or_it = one_ring.begin(), or_end = one_ring.end(); or_it != or_end;
-                 ++or_it)
-                enqueue_vertex(*or_it);
+            for (auto vv : one_ring)
+                enqueue_vertex(vv);
         }
 
-        // clean up
-        delete queue_;
-        mesh_->collect_garbage();
-        mesh_->remove_vertex_property(vpriority_);
-        mesh_->remove_vertex_property(heap_pos_);
-        mesh_->remove_vertex_property(vtarget_);
+        return count;
     }
 
     //-----------------------------------------------------------------------------
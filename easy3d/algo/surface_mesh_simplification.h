@@ -27,9 +27,11 @@
 
 #include <easy3d/core/surface_mesh.h>
 #include <easy3d/core/heap.h>
+#include <easy3d/core/eigen_solver.h>
 
 #include <set>
 #include <vector>
+#include <cfloat>
 
 
 namespace easy3d {
@@ -92,6 +94,45 @@ namespace easy3d {
             return *this;
         }
 
+        /**
+         * \brief Computes the point minimizing the quadric, i.e., the least-squares solution of A * p = -b, where A is
+         *      the upper-left 3x3 block and b the upper part of the last column of the matrix.
+         * \details Directions in which the quadric is (nearly) flat do not determine the solution. The solution is
+         *      computed with a truncated pseudo-inverse, and those directions are taken from \p p0 (e.g., the centroid
+         *      of the points that contributed to the quadric).
+         * \param p0 The point that is used in the undetermined directions.
+         * \param tolerance Eigenvalues smaller than tolerance * (max eigenvalue) are considered to be zero.
+         */
+        vec3 minimizer(const vec3 &p0, double tolerance = 1e-3) const {
+            double m[3][3] = {{a_, b_, c_},
+                              {b_, e_, f_},
+                              {c_, f_, h_}};
+            double *rows[3] = {m[0], m[1], m[2]};
+            EigenSolver<double> solver(3);
+            solver.solve(rows, EigenSolver<double>::DECREASING);
+
+            // residual at p0: r = -(A * p0 + b)
+            const double x(p0[0]), y(p0[1]), z(p0[2]);
+            const double r[3] = {-(a_ * x + b_ * y + c_ * z + d_),
+                                 -(b_ * x + e_ * y + f_ * z + g_),
+                                 -(c_ * x + f_ * y + h_ * z + i_)};
+
+            double p[3] = {x, y, z};
+            const double max_value = solver.eigen_value(0);
+            for (int k = 0; k < 3; ++k) {
+                const double value = solver.eigen_value(k);
+                if (max_value <= 0.0 || value <= tolerance * max_value)
+                    break;
+                double t = 0.0;
+                for (int j = 0; j < 3; ++j)
+                    t += solver.eigen_vector(j, k) * r[j];
+                t /= value;
+                for (int j = 0; j < 3; ++j)
+                    p[j] += t * solver.eigen_vector(j, k);
+            }
+            return vec3(static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]));
+        }
+
         //! evaluate quadric Q at position p by computing (p^T * Q * p)
         double operator()(const vec3 &p) const {
             const double x(p[0]), y(p[1]), z(p[2]);
@@ -192,7 +233,25 @@ namespace easy3d {
         //! Simplify mesh to \p n vertices.
         void simplify(unsigned int n_vertices);
 
+        /**
+         * \brief Simplify mesh to \p n_vertices vertices using multiple threads.
+         * \details The mesh is partitioned spatially into \p num_partitions parts, and the interiors of the parts
+         *      are decimated concurrently. The borders of the parts (and their one-ring neighbors) are locked during
+         *      this phase. The parts proceed in rounds of increasing error thresholds and draw from a shared budget
+         *      of collapses, so the collapses are performed roughly in the same order as in the serial algorithm.
+         *      The result is then decimated to the target number of vertices by a final serial pass over the whole
+         *      mesh, which also simplifies the borders of the parts. The parameters given to initialize() apply to
+         *      both phases. The output quality is comparable to that of simplify(), but the result is not identical.
+         * \param n_vertices The target number of vertices.
+         * \param num_partitions The number of parts. If 0, it is chosen from the number of available threads and
+         *      the size of the mesh. Small meshes are simplified using simplify().
+         */
+        void simplify_parallel(unsigned int n_vertices, unsigned int num_partitions = 0);
+
     private:
+        // records the collapses to build level-of-detail chains
+        friend class SurfaceMeshLOD;
+
         //! Store data for an halfedge collapse
         /*
                     vl
@@ -248,6 +307,16 @@ namespace easy3d {
         typedef std::vector<vec3> Points;
 
     private:
+        // create the priority queue with all the vertices
+        void build_queue();
+
+        // destroy the priority queue
+        void clear_queue();
+
+        // perform (at most) max_collapses collapses in the order of priority, stopping when the queue is empty or the
+        // priority of the next candidate exceeds max_priority. Returns the number of collapses performed.
+        unsigned int decimate(unsigned int max_collapses, float max_priority = FLT_MAX);
+
         // put the vertex v in the priority queue
         void enqueue_vertex(SurfaceMesh::Vertex v);
 
@@ -286,6 +355,9 @@ namespace easy3d {
 
         PriorityQueue *queue_;
 
+        // if not null, the performed collapses are recorded as (removed vertex, remaining vertex) pairs
+        std::vector<std::pair<SurfaceMesh::Vertex, SurfaceMesh::Vertex> > *collapses_;
+
         bool has_selection_;
         bool has_features_;
         float normal_deviation_;
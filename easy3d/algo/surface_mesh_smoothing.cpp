@@ -25,18 +25,13 @@
 
 #include <easy3d/algo/surface_mesh_smoothing.h>
 #include <easy3d/algo/surface_mesh_geometry.h>
+#include <easy3d/algo/sparse_solver.h>
 
 #include <Eigen/Dense>
-#include <Eigen/Sparse>
 
 
 namespace easy3d {
 
-    // \cond
-    using SparseMatrix = Eigen::SparseMatrix<double>;
-    using Triplet = Eigen::Triplet<double>;
-    // \endcond
-
     //-----------------------------------------------------------------------------
 
     SurfaceMeshSmoothing::SurfaceMeshSmoothing(SurfaceMesh *mesh) : mesh_(mesh) {
@@ -178,11 +173,10 @@ namespace easy3d {
         const unsigned int n = free_vertices.size();
 
         // A*X = B
-        SparseMatrix A(n, n);
         Eigen::MatrixXd B(n, 3);
 
         // nonzero elements of A as triplets: (row, column, value)
-        std::vector<Triplet> triplets;
+        std::vector<SparseSolver::Entry> triplets;
 
         // setup matrix A and rhs B
         dvec3 b;
@@ -218,13 +212,15 @@ namespace easy3d {
             triplets.emplace_back(i, i, 1.0 / vweight[v] + timestep * ww);
         }
 
-        // build sparse matrix from triplets
-        A.setFromTriplets(triplets.begin(), triplets.end());
-
-        // solve A*X = B
-        Eigen::SimplicialLDLT<SparseMatrix> solver(A);
-        Eigen::MatrixXd X = solver.solve(B);
-        if (solver.info() != Eigen::Success) {
+        // solve A*X = B. The sparsity pattern of A only depends on the connectivity, so the solver of this mesh is
+        // kept in the cache and its symbolic factorization is reused by the subsequent smoothing steps.
+        auto solver = SparseSolverCache::get(mesh_, "SurfaceMeshSmoothing::implicit_smoothing");
+        Eigen::MatrixXd X(n, 3);
+        for (unsigned int i = 0; i < n; ++i) {  // initial guess (used by the iterative solver)
+            const vec3 &p = points[free_vertices[i]];
+            X.row(i) = Eigen::Vector3d(p.x, p.y, p.z);
+        }
+        if (!solver->factorize(n, triplets) || !solver->solve(B.data(), X.data(), 3)) {
             std::cerr << "SurfaceMeshSmoothing: Could not solve linear system\n";
         } else {
             // copy solution
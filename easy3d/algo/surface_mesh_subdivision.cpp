@@ -29,174 +29,320 @@
 
 namespace easy3d {
 
-    bool SurfaceMeshSubdivision::catmull_clark(SurfaceMesh *mesh) {
-        if (!mesh)
-            return false;
+    namespace details {
+
+        /**
+         * Refines the connectivity of a mesh (without garbage) in one pass: each edge e is split at a new vertex
+         * (nv + e), and each face is split into
+         *  - quads around a new face vertex (nv + ne + f), one for each corner (Catmull-Clark), or
+         *  - triangles: one for each corner and one in the center (Loop).
+         * The refined topology is fully determined by the old one, so the indices of all new elements are known in
+         * advance: the two halves of edge e become edges 2e and 2e+1, the new edges inside the faces follow, one for
+         * each corner (i.e., face halfedge), and so do the new faces. This allows building the connectivity in
+         * parallel, without the incremental (and allocating) split operations.
+         */
+        void refine(SurfaceMesh *mesh, bool quads) {
+            typedef SurfaceMesh::Vertex Vertex;
+            typedef SurfaceMesh::Halfedge Halfedge;
+            typedef SurfaceMesh::Face Face;
+
+            const int nv = static_cast<int>(mesh->vertices_size());
+            const int ne = static_cast<int>(mesh->edges_size());
+            const int nf = static_cast<int>(mesh->faces_size());
+            const int nh = 2 * ne;
+
+            // the index of the first corner of each face
+            std::vector<int> offset(nf + 1, 0);
+            for (int f = 0; f < nf; ++f)
+                offset[f + 1] = offset[f] + static_cast<int>(mesh->valence(Face(f)));
+            const int nc = offset[nf];
+
+            // the old connectivity
+            std::vector<Halfedge> next(nh);
+            std::vector<Vertex> target(nh);
+            std::vector<int> corner(nh, -1);    // the corner of each halfedge (-1 for border halfedges)
+            std::vector<Halfedge> out(nv);
+            std::vector<Halfedge> first_halfedge(nf);
+#pragma omp parallel for
+            for (int h = 0; h < nh; ++h) {
+                next[h] = mesh->next(Halfedge(h));
+                target[h] = mesh->target(Halfedge(h));
+            }
+#pragma omp parallel for
+            for (int f = 0; f < nf; ++f) {
+                first_halfedge[f] = mesh->halfedge(Face(f));
+                int c = offset[f];
+                for (auto h : mesh->halfedges(Face(f)))
+                    corner[h.idx()] = c++;
+            }
+#pragma omp parallel for
+            for (int v = 0; v < nv; ++v)
+                out[v] = mesh->out_halfedge(Vertex(v));
+
+            auto efeature = mesh->get_edge_property<bool>("e:feature");
+            auto vfeature = mesh->get_vertex_property<bool>("v:feature");
+            std::vector<bool> feature;
+            if (efeature)
+                feature = efeature.vector();
+
+            // the new vertex on the edge of halfedge h
+            auto edge_vertex = [nv](int h) { return Vertex(nv + h / 2); };
+            // the halves of halfedge h: from its source to the edge vertex, and from the edge vertex to its target
+            auto first_half = [](int h) { return Halfedge(4 * (h >> 1) + 2 * (h & 1)); };
+            auto second_half = [](int h) { return Halfedge(4 * (h >> 1) + 3 - 2 * (h & 1)); };
+            // the halfedges of the new edge at corner c
+            auto inner = [ne](int c, int i) { return Halfedge(2 * (2 * ne + c) + i); };
+
+            mesh->resize(nv + ne + (quads ? nf : 0), 2 * ne + nc, quads ? nc : nc + nf);
+
+            // the faces
+#pragma omp parallel for
+            for (int f = 0; f < nf; ++f) {
+                const int n = offset[f + 1] - offset[f];
+                int g = first_halfedge[f].idx();
+                for (int k = 0; k < n; ++k) {
+                    const int gn = next[g].idx();
+                    const int c = offset[f] + k;
+                    const Face face(c);
+
+                    // the face at the target of g starts with the second half of g and the first half of its next
+                    const Halfedge a = second_half(g);
+                    const Halfedge b = first_half(gn);
+                    mesh->set_target(a, target[g]);
+                    mesh->set_target(b, edge_vertex(gn));
+                    mesh->set_face(a, face);
+                    mesh->set_face(b, face);
+                    mesh->set_next(a, b);
+                    mesh->set_halfedge(face, a);
+
+                    if (quads) {
+                        // ... and is closed via the face vertex
+                        const Halfedge to_center = inner(corner[gn], 0);
+                        const Halfedge from_center = inner(c, 1);
+                        mesh->set_target(to_center, Vertex(nv + ne + f));
+                        mesh->set_target(from_center, edge_vertex(g));
+                        mesh->set_face(to_center, face);
+                        mesh->set_face(from_center, face);
+                        mesh->set_next(b, to_center);
+                        mesh->set_next(to_center, from_center);
+                        mesh->set_next(from_center, a);
+                    } else {
+                        // ... and is closed by the new edge between the two edge vertices
+                        const Halfedge h = inner(c, 0);
+                        mesh->set_target(h, edge_vertex(g));
+                        mesh->set_face(h, face);
+                        mesh->set_next(b, h);
+                        mesh->set_next(h, a);
+
+                        // whose opposite belongs to the center triangle
+                        const Face center(nc + f);
+                        const Halfedge o = inner(c, 1);
+                        mesh->set_target(o, edge_vertex(gn));
+                        mesh->set_face(o, center);
+                        mesh->set_next(o, inner(corner[gn], 1));
+                        if (k == 0)
+                            mesh->set_halfedge(center, o);
+                    }
 
-        auto points = mesh->vertex_property<vec3>("v:point");
-        auto vfeature = mesh->get_vertex_property<bool>("v:feature");
-        auto efeature = mesh->get_edge_property<bool>("e:feature");
-
-        // reserve memory
-        std::size_t nv = mesh->n_vertices();
-        std::size_t ne = mesh->n_edges();
-        std::size_t nf = mesh->n_faces();
-        mesh->reserve(nv + ne + nf, 2 * ne + 4 * nf, 4 * nf);
-
-        // get properties
-        auto vpoint = mesh->add_vertex_property<vec3>("catmull:vpoint");
-        auto epoint = mesh->add_edge_property<vec3>("catmull:epoint");
-        auto fpoint = mesh->add_face_property<vec3>("catmull:fpoint");
-
-        // compute face vertices
-        for (auto f : mesh->faces()) {
-            vec3 p(0, 0, 0);
-            float c(0);
-            for (auto v : mesh->vertices(f)) {
-                p += points[v];
-                ++c;
+                    g = gn;
+                }
             }
-            p /= c;
-            fpoint[f] = p;
-        }
 
-        // compute edge vertices
-        for (auto e : mesh->edges()) {
-            // boundary or feature edge?
-            if (mesh->is_border(e) || (efeature && efeature[e])) {
-                epoint[e] = 0.5f * (points[mesh->vertex(e, 0)] +
-                                    points[mesh->vertex(e, 1)]);
+            // the border halfedges
+#pragma omp parallel for
+            for (int h = 0; h < nh; ++h) {
+                if (corner[h] != -1)
+                    continue;
+                const Halfedge a = first_half(h);
+                const Halfedge b = second_half(h);
+                mesh->set_target(a, edge_vertex(h));
+                mesh->set_target(b, target[h]);
+                mesh->set_face(a, Face());
+                mesh->set_face(b, Face());
+                mesh->set_next(a, b);
+                mesh->set_next(b, first_half(next[h].idx()));
             }
 
-                // interior edge
-            else {
-                vec3 p(0, 0, 0);
-                p += points[mesh->vertex(e, 0)];
-                p += points[mesh->vertex(e, 1)];
-                p += fpoint[mesh->face(e, 0)];
-                p += fpoint[mesh->face(e, 1)];
-                p *= 0.25f;
-                epoint[e] = p;
+            // the outgoing halfedges (border halfedges for border vertices)
+#pragma omp parallel for
+            for (int v = 0; v < nv; ++v) {
+                if (out[v].is_valid())
+                    mesh->set_out_halfedge(Vertex(v), first_half(out[v].idx()));
+            }
+#pragma omp parallel for
+            for (int e = 0; e < ne; ++e) {
+                const int h = (corner[2 * e + 1] == -1) ? 2 * e + 1 : 2 * e;
+                mesh->set_out_halfedge(Vertex(nv + e), second_half(h));
+            }
+            if (quads) {
+#pragma omp parallel for
+                for (int f = 0; f < nf; ++f)
+                    mesh->set_out_halfedge(Vertex(nv + ne + f), inner(offset[f], 1));
             }
-        }
 
-        // compute new positions for old vertices
-        for (auto v : mesh->vertices()) {
-            // isolated vertex?
-            if (mesh->is_isolated(v)) {
-                vpoint[v] = points[v];
+            // the halves of a feature edge are feature edges, and so is the vertex splitting it
+            if (efeature) {
+                for (int e = 0; e < ne; ++e) {
+                    efeature[SurfaceMesh::Edge(2 * e)] = feature[e];
+                    efeature[SurfaceMesh::Edge(2 * e + 1)] = feature[e];
+                }
+                for (int c = 0; c < nc; ++c)
+                    efeature[SurfaceMesh::Edge(2 * ne + c)] = false;
+            }
+            if (vfeature) {
+                for (int e = 0; e < ne; ++e)
+                    vfeature[Vertex(nv + e)] = efeature ? feature[e] : false;
+                if (quads) {
+                    for (int f = 0; f < nf; ++f)
+                        vfeature[Vertex(nv + ne + f)] = false;
+                }
             }
+        }
+
+    }
 
-                // boundary vertex?
-            else if (mesh->is_border(v)) {
-                auto h1 = mesh->out_halfedge(v);
-                auto h0 = mesh->prev(h1);
 
-                vec3 p = points[v];
-                p *= 6.0;
-                p += points[mesh->target(h1)];
-                p += points[mesh->source(h0)];
-                p *= 0.125;
+    bool SurfaceMeshSubdivision::catmull_clark(SurfaceMesh *mesh, unsigned int levels) {
+        if (!mesh)
+            return false;
 
-                vpoint[v] = p;
-            }
+        for (unsigned int level = 0; level < levels; ++level) {
+            if (mesh->has_garbage())
+                mesh->collect_garbage();
 
-                // interior feature vertex?
-            else if (vfeature && vfeature[v]) {
-                vec3 p = points[v];
-                p *= 6.0;
-                int count(0);
+            auto points = mesh->vertex_property<vec3>("v:point");
+            auto vfeature = mesh->get_vertex_property<bool>("v:feature");
+            auto efeature = mesh->get_edge_property<bool>("e:feature");
 
-                for (auto h : mesh->halfedges(v)) {
-                    if (efeature[mesh->edge(h)]) {
-                        p += points[mesh->target(h)];
-                        ++count;
-                    }
+            const int nv = static_cast<int>(mesh->vertices_size());
+            const int ne = static_cast<int>(mesh->edges_size());
+            const int nf = static_cast<int>(mesh->faces_size());
+            std::vector<vec3> vpoint(nv), epoint(ne), fpoint(nf);
+
+            // compute face vertices
+#pragma omp parallel for
+            for (int i = 0; i < nf; ++i) {
+                const SurfaceMesh::Face f(i);
+                vec3 p(0, 0, 0);
+                float c(0);
+                for (auto v : mesh->vertices(f)) {
+                    p += points[v];
+                    ++c;
+                }
+                p /= c;
+                fpoint[i] = p;
+            }
+
+            // compute edge vertices
+#pragma omp parallel for
+            for (int i = 0; i < ne; ++i) {
+                const SurfaceMesh::Edge e(i);
+                // boundary or feature edge?
+                if (mesh->is_border(e) || (efeature && efeature[e])) {
+                    epoint[i] = 0.5f * (points[mesh->vertex(e, 0)] +
+                                        points[mesh->vertex(e, 1)]);
                 }
 
-                if (count == 2) // vertex is on feature edge
-                {
-                    p *= 0.125;
-                    vpoint[v] = p;
-                } else // keep fixed
-                {
-                    vpoint[v] = points[v];
+                    // interior edge
+                else {
+                    vec3 p(0, 0, 0);
+                    p += points[mesh->vertex(e, 0)];
+                    p += points[mesh->vertex(e, 1)];
+                    p += fpoint[mesh->face(e, 0).idx()];
+                    p += fpoint[mesh->face(e, 1).idx()];
+                    p *= 0.25f;
+                    epoint[i] = p;
                 }
             }
 
-                // interior vertex
-            else {
-                // weights from SIGGRAPH paper "Subdivision Surfaces in Character Animation"
+            // compute new positions for old vertices
+#pragma omp parallel for
+            for (int i = 0; i < nv; ++i) {
+                const SurfaceMesh::Vertex v(i);
+                // isolated vertex?
+                if (mesh->is_isolated(v)) {
+                    vpoint[i] = points[v];
+                }
 
-                const float k = mesh->valence(v);
-                vec3 p(0, 0, 0);
+                    // boundary vertex?
+                else if (mesh->is_border(v)) {
+                    auto h1 = mesh->out_halfedge(v);
+                    auto h0 = mesh->prev(h1);
 
-                for (auto vv : mesh->vertices(v))
-                    p += points[vv];
+                    vec3 p = points[v];
+                    p *= 6.0;
+                    p += points[mesh->target(h1)];
+                    p += points[mesh->source(h0)];
+                    p *= 0.125;
 
-                for (auto f : mesh->faces(v))
-                    p += fpoint[f];
+                    vpoint[i] = p;
+                }
 
-                p /= (k * k);
+                    // interior feature vertex?
+                else if (vfeature && vfeature[v]) {
+                    vec3 p = points[v];
+                    p *= 6.0;
+                    int count(0);
+
+                    for (auto h : mesh->halfedges(v)) {
+                        if (efeature[mesh->edge(h)]) {
+                            p += points[mesh->target(h)];
+                            ++count;
+                        }
+                    }
 
-                p += ((k - 2.0f) / k) * points[v];
+                    if (count == 2) // vertex is on feature edge
+                    {
+                        p *= 0.125;
+                        vpoint[i] = p;
+                    } else // keep fixed
+                    {
+                        vpoint[i] = points[v];
+                    }
+                }
 
-                vpoint[v] = p;
-            }
-        }
+                    // interior vertex
+                else {
+                    // weights from SIGGRAPH paper "Subdivision Surfaces in Character Animation"
 
-        // assign new positions to old vertices
-        for (auto v : mesh->vertices()) {
-            points[v] = vpoint[v];
-        }
+                    const float k = mesh->valence(v);
+                    vec3 p(0, 0, 0);
 
-        // split edges
-        for (auto e : mesh->edges()) {
-            // feature edge?
-            if (efeature && efeature[e]) {
-                auto h = mesh->insert_vertex(e, epoint[e]);
-                auto v = mesh->target(h);
-                auto e0 = mesh->edge(h);
-                auto e1 = mesh->edge(mesh->next(h));
-
-                vfeature[v] = true;
-                efeature[e0] = true;
-                efeature[e1] = true;
-            }
+                    for (auto vv : mesh->vertices(v))
+                        p += points[vv];
 
-                // normal edge
-            else {
-                mesh->insert_vertex(e, epoint[e]);
-            }
-        }
+                    for (auto f : mesh->faces(v))
+                        p += fpoint[f.idx()];
 
-        // split faces
-        for (auto f : mesh->faces()) {
-            auto h0 = mesh->halfedge(f);
-            mesh->insert_edge(h0, mesh->next(mesh->next(h0)));
+                    p /= (k * k);
 
-            auto h1 = mesh->next(h0);
-            mesh->insert_vertex(mesh->edge(h1), fpoint[f]);
+                    p += ((k - 2.0f) / k) * points[v];
 
-            auto h =
-                    mesh->next(mesh->next(mesh->next(h1)));
-            while (h != h0) {
-                mesh->insert_edge(h1, h);
-                h = mesh->next(
-                        mesh->next(mesh->next(h1)));
+                    vpoint[i] = p;
+                }
             }
-        }
 
-        // clean-up properties
-        mesh->remove_vertex_property(vpoint);
-        mesh->remove_edge_property(epoint);
-        mesh->remove_face_property(fpoint);
+            // split edges and faces
+            details::refine(mesh, true);
+
+            // assign the positions
+            points = mesh->vertex_property<vec3>("v:point");
+#pragma omp parallel for
+            for (int i = 0; i < nv; ++i)
+                points[SurfaceMesh::Vertex(i)] = vpoint[i];
+#pragma omp parallel for
+            for (int i = 0; i < ne; ++i)
+                points[SurfaceMesh::Vertex(nv + i)] = epoint[i];
+#pragma omp parallel for
+            for (int i = 0; i < nf; ++i)
+                points[SurfaceMesh::Vertex(nv + ne + i)] = fpoint[i];
+        }
 
         return true;
     }
 
 
-    bool SurfaceMeshSubdivision::loop(SurfaceMesh *mesh) {
+    bool SurfaceMeshSubdivision::loop(SurfaceMesh *mesh, unsigned int levels) {
         if (!mesh)
             return false;
 
@@ -205,212 +351,193 @@ namespace easy3d {
             return false;
         }
 
-        auto points = mesh->vertex_property<vec3>("v:point");
-        auto vfeature = mesh->get_vertex_property<bool>("v:feature");
-        auto efeature = mesh->get_edge_property<bool>("e:feature");
-
-        // reserve memory
-        std::size_t nv = mesh->n_vertices();
-        std::size_t ne = mesh->n_edges();
-        std::size_t nf = mesh->n_faces();
-        mesh->reserve(nv + ne, 2 * ne + 3 * nf, 4 * nf);
-
-        // add properties
-        auto vpoint = mesh->add_vertex_property<vec3>("loop:vpoint");
-        auto epoint = mesh->add_edge_property<vec3>("loop:epoint");
-
-        // compute vertex positions
-        for (auto v : mesh->vertices()) {
-            // isolated vertex?
-            if (mesh->is_isolated(v)) {
-                vpoint[v] = points[v];
-            }
-
-                // boundary vertex?
-            else if (mesh->is_border(v)) {
-                auto h1 = mesh->out_halfedge(v);
-                auto h0 = mesh->prev(h1);
-
-                vec3 p = points[v];
-                p *= 6.0;
-                p += points[mesh->target(h1)];
-                p += points[mesh->source(h0)];
-                p *= 0.125;
-                vpoint[v] = p;
-            }
-
-                // interior feature vertex?
-            else if (vfeature && vfeature[v]) {
-                vec3 p = points[v];
-                p *= 6.0;
-                int count(0);
-
-                for (auto h : mesh->halfedges(v)) {
-                    if (efeature[mesh->edge(h)]) {
-                        p += points[mesh->target(h)];
-                        ++count;
-                    }
+        for (unsigned int level = 0; level < levels; ++level) {
+            if (mesh->has_garbage())
+                mesh->collect_garbage();
+
+            auto points = mesh->vertex_property<vec3>("v:point");
+            auto vfeature = mesh->get_vertex_property<bool>("v:feature");
+            auto efeature = mesh->get_edge_property<bool>("e:feature");
+
+            const int nv = static_cast<int>(mesh->vertices_size());
+            const int ne = static_cast<int>(mesh->edges_size());
+            std::vector<vec3> vpoint(nv), epoint(ne);
+
+            // compute vertex positions
+#pragma omp parallel for
+            for (int i = 0; i < nv; ++i) {
+                const SurfaceMesh::Vertex v(i);
+                // isolated vertex?
+                if (mesh->is_isolated(v)) {
+                    vpoint[i] = points[v];
                 }
 
-                if (count == 2) // vertex is on feature edge
-                {
+                    // boundary vertex?
+                else if (mesh->is_border(v)) {
+                    auto h1 = mesh->out_halfedge(v);
+                    auto h0 = mesh->prev(h1);
+
+                    vec3 p = points[v];
+                    p *= 6.0;
+                    p += points[mesh->target(h1)];
+                    p += points[mesh->source(h0)];
                     p *= 0.125;
-                    vpoint[v] = p;
-                } else // keep fixed
-                {
-                    vpoint[v] = points[v];
+                    vpoint[i] = p;
                 }
-            }
 
-                // interior vertex
-            else {
-                vec3 p(0, 0, 0);
-                float k(0);
+                    // interior feature vertex?
+                else if (vfeature && vfeature[v]) {
+                    vec3 p = points[v];
+                    p *= 6.0;
+                    int count(0);
+
+                    for (auto h : mesh->halfedges(v)) {
+                        if (efeature[mesh->edge(h)]) {
+                            p += points[mesh->target(h)];
+                            ++count;
+                        }
+                    }
 
-                for (auto vv : mesh->vertices(v)) {
-                    p += points[vv];
-                    ++k;
+                    if (count == 2) // vertex is on feature edge
+                    {
+                        p *= 0.125;
+                        vpoint[i] = p;
+                    } else // keep fixed
+                    {
+                        vpoint[i] = points[v];
+                    }
                 }
-                p /= k;
 
-                float beta =
-                        (0.625 - pow(0.375 + 0.25 * cos(2.0 * M_PI / k), 2.0));
+                    // interior vertex
+                else {
+                    vec3 p(0, 0, 0);
+                    float k(0);
 
-                vpoint[v] = points[v] * (float) (1.0 - beta) + beta * p;
-            }
-        }
+                    for (auto vv : mesh->vertices(v)) {
+                        p += points[vv];
+                        ++k;
+                    }
+                    p /= k;
 
-        // compute edge positions
-        for (auto e : mesh->edges()) {
-            // boundary or feature edge?
-            if (mesh->is_border(e) || (efeature && efeature[e])) {
-                epoint[e] =
-                        (points[mesh->vertex(e, 0)] + points[mesh->vertex(e, 1)]) *
-                        float(0.5);
-            }
+                    float beta =
+                            (0.625 - pow(0.375 + 0.25 * cos(2.0 * M_PI / k), 2.0));
 
-                // interior edge
-            else {
-                auto h0 = mesh->halfedge(e, 0);
-                auto h1 = mesh->halfedge(e, 1);
-                vec3 p = points[mesh->target(h0)];
-                p += points[mesh->target(h1)];
-                p *= 3.0;
-                p += points[mesh->target(mesh->next(h0))];
-                p += points[mesh->target(mesh->next(h1))];
-                p *= 0.125;
-                epoint[e] = p;
+                    vpoint[i] = points[v] * (float) (1.0 - beta) + beta * p;
+                }
             }
-        }
 
-        // set new vertex positions
-        for (auto v : mesh->vertices()) {
-            points[v] = vpoint[v];
-        }
-
-        // insert new vertices on edges
-        for (auto e : mesh->edges()) {
-            // feature edge?
-            if (efeature && efeature[e]) {
-                auto h = mesh->insert_vertex(e, epoint[e]);
-                auto v = mesh->target(h);
-                auto e0 = mesh->edge(h);
-                auto e1 = mesh->edge(mesh->next(h));
-
-                vfeature[v] = true;
-                efeature[e0] = true;
-                efeature[e1] = true;
-            }
+            // compute edge positions
+#pragma omp parallel for
+            for (int i = 0; i < ne; ++i) {
+                const SurfaceMesh::Edge e(i);
+                // boundary or feature edge?
+                if (mesh->is_border(e) || (efeature && efeature[e])) {
+                    epoint[i] =
+                            (points[mesh->vertex(e, 0)] + points[mesh->vertex(e, 1)]) *
+                            float(0.5);
+                }
 
-                // normal edge
-            else {
-                mesh->insert_vertex(e, epoint[e]);
+                    // interior edge
+                else {
+                    auto h0 = mesh->halfedge(e, 0);
+                    auto h1 = mesh->halfedge(e, 1);
+                    vec3 p = points[mesh->target(h0)];
+                    p += points[mesh->target(h1)];
+                    p *= 3.0;
+                    p += points[mesh->target(mesh->next(h0))];
+                    p += points[mesh->target(mesh->next(h1))];
+                    p *= 0.125;
+                    epoint[i] = p;
+                }
             }
-        }
 
-        // split faces
-        SurfaceMesh::Halfedge h;
-        for (auto f : mesh->faces()) {
-            h = mesh->halfedge(f);
-            mesh->insert_edge(h, mesh->next(mesh->next(h)));
-            h = mesh->next(h);
-            mesh->insert_edge(h, mesh->next(mesh->next(h)));
-            h = mesh->next(h);
-            mesh->insert_edge(h, mesh->next(mesh->next(h)));
+            // split edges and faces
+            details::refine(mesh, false);
+
+            // assign the positions
+            points = mesh->vertex_property<vec3>("v:point");
+#pragma omp parallel for
+            for (int i = 0; i < nv; ++i)
+                points[SurfaceMesh::Vertex(i)] = vpoint[i];
+#pragma omp parallel for
+            for (int i = 0; i < ne; ++i)
+                points[SurfaceMesh::Vertex(nv + i)] = epoint[i];
         }
 
-        // clean-up properties
-        mesh->remove_vertex_property(vpoint);
-        mesh->remove_edge_property(epoint);
-
         return true;
     }
 
 
-    bool SurfaceMeshSubdivision::sqrt3(SurfaceMesh *mesh) {
+    bool SurfaceMeshSubdivision::sqrt3(SurfaceMesh *mesh, unsigned int levels) {
         if (!mesh)
             return false;
 
-        // reserve memory
-        int nv = mesh->n_vertices();
-        int ne = mesh->n_edges();
-        int nf = mesh->n_faces();
-        mesh->reserve(nv + nf, ne + 3 * nf, 3 * nf);
-
-        auto points = mesh->vertex_property<vec3>("v:point");
-
-        // remember end of old vertices and edges
-        auto vend = mesh->vertices_end();
-        auto eend = mesh->edges_end();
-
-        // compute new positions of old vertices
-        auto new_pos = mesh->add_vertex_property<vec3>("v:np");
-        for (auto v : mesh->vertices()) {
-            if (!mesh->is_border(v)) {
-                float n = mesh->valence(v);
-                float alpha = (4.0 - 2.0 * cos(2.0 * M_PI / n)) / 9.0;
-                vec3 p(0, 0, 0);
-
-                for (auto vv : mesh->vertices(v))
-                    p += points[vv];
-
-                p = (1.0f - alpha) * points[v] + alpha / n * p;
-                new_pos[v] = p;
+        for (unsigned int level = 0; level < levels; ++level) {
+            if (mesh->has_garbage())
+                mesh->collect_garbage();
+
+            // reserve memory
+            int nv = mesh->n_vertices();
+            int ne = mesh->n_edges();
+            int nf = mesh->n_faces();
+            mesh->reserve(nv + nf, ne + 3 * nf, 3 * nf);
+
+            auto points = mesh->vertex_property<vec3>("v:point");
+
+            // compute new positions of old vertices
+            std::vector<vec3> new_pos(nv);
+#pragma omp parallel for
+            for (int i = 0; i < nv; ++i) {
+                const SurfaceMesh::Vertex v(i);
+                if (!mesh->is_border(v)) {
+                    float n = mesh->valence(v);
+                    float alpha = (4.0 - 2.0 * cos(2.0 * M_PI / n)) / 9.0;
+                    vec3 p(0, 0, 0);
+
+                    for (auto vv : mesh->vertices(v))
+                        p += points[vv];
+
+                    p = (1.0f - alpha) * points[v] + alpha / n * p;
+                    new_pos[i] = p;
+                } else
+                    new_pos[i] = points[v];
             }
-        }
-
-        // split faces
-        for (auto f : mesh->faces()) {
-            vec3 p(0, 0, 0);
-            float c(0);
 
-            for (auto fv : mesh->vertices(f)) {
-                p += points[fv];
-                ++c;
-            }
-
-            p /= c;
+            // compute face centers
+            std::vector<vec3> centers(nf);
+#pragma omp parallel for
+            for (int i = 0; i < nf; ++i) {
+                vec3 p(0, 0, 0);
+                float c(0);
 
-            mesh->split(f, p);
-        }
+                for (auto fv : mesh->vertices(SurfaceMesh::Face(i))) {
+                    p += points[fv];
+                    ++c;
+                }
 
-        // set new positions of old vertices
-        for (auto vit = mesh->vertices_begin(); vit != vend; ++vit) {
-            if (!mesh->is_border(*vit)) {
-                points[*vit] = new_pos[*vit];
+                centers[i] = p / c;
             }
-        }
 
-        mesh->remove_vertex_property(new_pos);
-
-        // flip old edges
-        for (auto eit = mesh->edges_begin(); eit != eend; ++eit) {
-            if (mesh->is_flip_ok(*eit)) {
-                mesh->flip(*eit);
+            // split faces
+            for (int i = 0; i < nf; ++i)
+                mesh->split(SurfaceMesh::Face(i), centers[i]);
+
+            // set new positions of old vertices
+            points = mesh->vertex_property<vec3>("v:point");
+#pragma omp parallel for
+            for (int i = 0; i < nv; ++i)
+                points[SurfaceMesh::Vertex(i)] = new_pos[i];
+
+            // flip old edges
+            for (int i = 0; i < ne; ++i) {
+                const SurfaceMesh::Edge e(i);
+                if (mesh->is_flip_ok(e)) {
+                    mesh->flip(e);
+                }
             }
         }
 
         return true;
     }
 
-} // namespace easy3d
\ No newline at end of file
+} // namespace easy3d
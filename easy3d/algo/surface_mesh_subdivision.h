@@ -32,16 +32,20 @@ namespace easy3d {
 
     /// \brief SurfaceMeshSubdivision implement several well-known subdivision algorithms.
     /// \class SurfaceMeshSubdivision easy3d/algo/surface_mesh_subdivision.h
+    /// \details The new positions are computed in parallel. For Catmull-Clark and Loop, the refined connectivity is
+    /// built in bulk (it is fully determined by the old one) instead of by incremental split operations.
+    /// The positions and the feature flags ("v:feature", "e:feature") are updated; other properties of the edges,
+    /// halfedges, and faces are not meaningful after the subdivision.
     class SurfaceMeshSubdivision {
     public:
-        /** \brief The Catmull-Clark subdivision. */
-        static bool catmull_clark(SurfaceMesh *mesh);
+        /** \brief The Catmull-Clark subdivision, applied \p levels times. */
+        static bool catmull_clark(SurfaceMesh *mesh, unsigned int levels = 1);
 
-        /** \brief The Loop subdivision. */
-        static bool loop(SurfaceMesh *mesh);
+        /** \brief The Loop subdivision, applied \p levels times. The mesh must be a triangle mesh. */
+        static bool loop(SurfaceMesh *mesh, unsigned int levels = 1);
 
-        /** \brief The sqrt3 subdivision. */
-        static bool sqrt3(SurfaceMesh *mesh);
+        /** \brief The sqrt3 subdivision, applied \p levels times. */
+        static bool sqrt3(SurfaceMesh *mesh, unsigned int levels = 1);
     };
 
 } // namespace easy3d
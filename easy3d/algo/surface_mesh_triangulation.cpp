@@ -25,6 +25,9 @@
 
 #include <easy3d/algo/surface_mesh_triangulation.h>
 
+#include <queue>
+#include <cmath>
+
 
 namespace easy3d {
 
@@ -32,13 +35,65 @@ namespace easy3d {
         points_ = mesh_->get_vertex_property<vec3>("v:point");
         objective_ = MIN_AREA;
         objective_ = MAX_ANGLE;
+        large_polygon_threshold_ = 100;
     }
 
     //-----------------------------------------------------------------------------
 
     void SurfaceMeshTriangulation::triangulate(Objective o) {
-        for (auto f: mesh_->faces())
-            triangulate(f, o);
+        // store objective
+        objective_ = o;
+
+        // the triangulations are computed in parallel (without modifying the mesh), and then the mesh is updated
+        struct Polygon {
+            SurfaceMesh::Face face;
+            bool manifold;
+            std::vector<SurfaceMesh::Halfedge> halfedges;
+            std::vector<SurfaceMesh::Vertex> vertices;
+            std::vector<ivec2> diagonals;
+            std::vector<ivec3> ears;
+        };
+
+        std::vector<Polygon> polygons;
+        for (auto f: mesh_->faces()) {
+            if (mesh_->valence(f) > 3) {
+                polygons.emplace_back();
+                polygons.back().face = f;
+            }
+        }
+
+        const int num = static_cast<int>(polygons.size());
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int i = 0; i < num; ++i) {
+            Polygon &polygon = polygons[i];
+            polygon.manifold = collect_polygon(polygon.face, polygon.halfedges, polygon.vertices);
+            if (!polygon.manifold)
+                continue;
+            if (polygon.vertices.size() > large_polygon_threshold_)
+                triangulate_ear_clipping(polygon.vertices, o, polygon.ears);
+            else
+                triangulate_optimal(polygon.vertices, o, polygon.diagonals);
+        }
+
+        for (auto &polygon : polygons) {
+            if (!polygon.manifold) {
+                std::cerr << "[SurfaceMeshTriangulation] Non-manifold polygon\n";
+                continue;
+            }
+
+            halfedges_.swap(polygon.halfedges);
+            vertices_.swap(polygon.vertices);
+            if (!polygon.ears.empty())
+                clip_ears(polygon.ears);
+            else {
+                for (const auto &d : polygon.diagonals)
+                    insert_edge(d[0], d[1]);
+            }
+        }
+
+        // clean up
+        halfedges_.clear();
+        vertices_.clear();
     }
 
     //-----------------------------------------------------------------------------
@@ -47,39 +102,75 @@ namespace easy3d {
         // store objective
         objective_ = o;
 
-
         // collect polygon halfedges
-        SurfaceMesh::Halfedge h0 = mesh_->halfedge(f);
+        if (!collect_polygon(f, halfedges_, vertices_)) {
+            std::cerr << "[SurfaceMeshTriangulation] Non-manifold polygon\n";
+            return;
+        }
+
+        // do we have at least four vertices?
+        const int n = halfedges_.size();
+        if (n <= 3) return;
+
+        if (n > static_cast<int>(large_polygon_threshold_)) {
+            std::vector<ivec3> ears;
+            triangulate_ear_clipping(vertices_, o, ears);
+            clip_ears(ears);
+        } else {
+            std::vector<ivec2> diagonals;
+            triangulate_optimal(vertices_, o, diagonals);
+            for (const auto &d : diagonals)
+                insert_edge(d[0], d[1]);
+        }
+
+        // clean up
         halfedges_.clear();
         vertices_.clear();
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshTriangulation::collect_polygon(SurfaceMesh::Face f,
+                                                   std::vector<SurfaceMesh::Halfedge> &halfedges,
+                                                   std::vector<SurfaceMesh::Vertex> &vertices) const {
+        halfedges.clear();
+        vertices.clear();
+
+        SurfaceMesh::Halfedge h0 = mesh_->halfedge(f);
         SurfaceMesh::Halfedge h = h0;
         do {
             if (!mesh_->is_manifold(mesh_->target(h))) {
-                std::cerr << "[SurfaceMeshTriangulation] Non-manifold polygon\n";
-                return;
+                halfedges.clear();
+                vertices.clear();
+                return false;
             }
 
-            halfedges_.push_back(h);
-            vertices_.push_back(mesh_->target(h));
+            halfedges.push_back(h);
+            vertices.push_back(mesh_->target(h));
         } while ((h = mesh_->next(h)) != h0);
 
-        // do we have at least four vertices?
-        const int n = halfedges_.size();
-        if (n <= 3) return;
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshTriangulation::triangulate_optimal(const std::vector<SurfaceMesh::Vertex> &vertices,
+                                                       Objective obj, std::vector<ivec2> &diagonals) const {
+        diagonals.clear();
+        const int n = vertices.size();
+        if (n <= 3) return true;
 
         // compute minimal triangulation by dynamic programming
-        weight_.clear();
-        weight_.resize(n, std::vector<float>(n, FLT_MAX));
-        index_.clear();
-        index_.resize(n, std::vector<int>(n, 0));
+        std::vector<std::vector<float> > weight(n, std::vector<float>(n, FLT_MAX));
+        std::vector<std::vector<int> > index(n, std::vector<int>(n, 0));
 
         int i, j, m, k, imin;
         float w, wmin;
 
         // initialize 2-gons
         for (i = 0; i < n - 1; ++i) {
-            weight_[i][i + 1] = 0.0;
-            index_[i][i + 1] = -1;
+            weight[i][i + 1] = 0.0;
+            index[i][i + 1] = -1;
         }
 
         // n-gons with n>2
@@ -92,12 +183,12 @@ namespace easy3d {
 
                 // find best split i < m < i+j
                 for (m = i + 1; m < k; ++m) {
-                    switch (objective_) {
+                    switch (obj) {
                         case MIN_AREA:
-                            w = weight_[i][m] + compute_weight(i, m, k) + weight_[m][k];
+                            w = weight[i][m] + compute_weight(vertices, i, m, k, obj) + weight[m][k];
                             break;
                         case MAX_ANGLE:
-                            w = std::max(weight_[i][m], std::max(compute_weight(i, m, k), weight_[m][k]));
+                            w = std::max(weight[i][m], std::max(compute_weight(vertices, i, m, k, obj), weight[m][k]));
                             break;
                         default:
                             // should never happen
@@ -111,12 +202,13 @@ namespace easy3d {
                     }
                 }
 
-                weight_[i][k] = wmin;
-                index_[i][k] = imin;
+                weight[i][k] = wmin;
+                index[i][k] = imin;
             }
         }
 
-        // now add triangles to mesh
+        // now collect the diagonals (in an order they can be inserted)
+        diagonals.reserve(2 * n);
         std::vector<ivec2> todo;
         todo.reserve(n);
         todo.push_back(ivec2(0, n - 1));
@@ -127,30 +219,219 @@ namespace easy3d {
             int end = tri[1];
             if (end - start < 2)
                 continue;
-            int split = index_[start][end];
+            int split = index[start][end];
 
-            insert_edge(start, split);
-            insert_edge(split, end);
+            diagonals.push_back(ivec2(start, split));
+            diagonals.push_back(ivec2(split, end));
 
             todo.push_back(ivec2(start, split));
             todo.push_back(ivec2(split, end));
         }
 
+        return true;
+    }
 
-        // clean up
-        weight_.clear();
-        index_.clear();
-        halfedges_.clear();
-        vertices_.clear();
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshTriangulation::triangulate_ear_clipping(const std::vector<SurfaceMesh::Vertex> &vertices,
+                                                            Objective obj, std::vector<ivec3> &ears) const {
+        ears.clear();
+        const int n = vertices.size();
+        if (n <= 3) return true;
+        ears.reserve(n - 3);
+
+        // project the polygon onto its best-fitting plane (with the normal computed by Newell's method), such that
+        // it is counterclockwise in 2D
+        const dvec3 origin = static_cast<dvec3>(points_[vertices[0]]);
+        dvec3 normal(0.0);
+        for (int i = 0; i < n; ++i) {
+            const dvec3 p = static_cast<dvec3>(points_[vertices[i]]) - origin;
+            const dvec3 q = static_cast<dvec3>(points_[vertices[(i + 1) % n]]) - origin;
+            normal += cross(p, q);
+        }
+        if (length(normal) < DBL_MIN)
+            normal = dvec3(0, 0, 1);
+        normal = normalize(normal);
+        const dvec3 u = normalize(orthogonal(normal));
+        const dvec3 v = cross(normal, u);
+
+        std::vector<dvec2> pts(n);
+        dvec2 pmin(DBL_MAX, DBL_MAX), pmax(-DBL_MAX, -DBL_MAX);
+        for (int i = 0; i < n; ++i) {
+            const dvec3 d = static_cast<dvec3>(points_[vertices[i]]) - origin;
+            pts[i] = dvec2(dot(d, u), dot(d, v));
+            pmin = comp_min(pmin, pts[i]);
+            pmax = comp_max(pmax, pts[i]);
+        }
+
+        // the remaining polygon as a doubly linked list
+        std::vector<int> prev(n), next(n);
+        for (int i = 0; i < n; ++i) {
+            prev[i] = (i + n - 1) % n;
+            next[i] = (i + 1) % n;
+        }
+        std::vector<bool> removed(n, false);
+        int remaining = n;
+
+        auto orient = [](const dvec2 &a, const dvec2 &b, const dvec2 &c) -> double {
+            return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        };
+        auto is_convex = [&](int i) -> bool {
+            return orient(pts[prev[i]], pts[i], pts[next[i]]) > 0;
+        };
+
+        // only reflex vertices can lie inside an ear, and a vertex never becomes reflex when an ear is clipped. So
+        // the reflex vertices are stored in a uniform grid to quickly find the candidates inside an ear.
+        const int res = std::max(1, static_cast<int>(std::sqrt(static_cast<double>(n))));
+        const dvec2 extent = pmax - pmin;
+        const double cell_size = std::max(std::max(extent.x, extent.y) / res, DBL_MIN);
+        auto cell_index = [&](double x, double min) -> int {
+            return std::min(res - 1, std::max(0, static_cast<int>((x - min) / cell_size)));
+        };
+        std::vector<std::vector<int> > grid(res * res);
+        std::vector<bool> reflex(n, false);
+        for (int i = 0; i < n; ++i) {
+            if (!is_convex(i)) {
+                reflex[i] = true;
+                grid[cell_index(pts[i].y, pmin.y) * res + cell_index(pts[i].x, pmin.x)].push_back(i);
+            }
+        }
+
+        auto is_ear = [&](int i) -> bool {
+            const int a = prev[i];
+            const int c = next[i];
+            if (!is_convex(i))
+                return false;
+            // the diagonal must not exist in the mesh
+            if (remaining > 3 && is_edge(vertices[a], vertices[c]))
+                return false;
+
+            const dvec2 &pa = pts[a], &pb = pts[i], &pc = pts[c];
+            const int x0 = cell_index(std::min(pa.x, std::min(pb.x, pc.x)), pmin.x);
+            const int x1 = cell_index(std::max(pa.x, std::max(pb.x, pc.x)), pmin.x);
+            const int y0 = cell_index(std::min(pa.y, std::min(pb.y, pc.y)), pmin.y);
+            const int y1 = cell_index(std::max(pa.y, std::max(pb.y, pc.y)), pmin.y);
+            for (int y = y0; y <= y1; ++y) {
+                for (int x = x0; x <= x1; ++x) {
+                    for (int r : grid[y * res + x]) {
+                        if (removed[r] || !reflex[r] || r == a || r == i || r == c)
+                            continue;
+                        const dvec2 &p = pts[r];
+                        if (p == pa || p == pb || p == pc)
+                            continue;
+                        if (orient(pa, pb, p) >= 0 && orient(pb, pc, p) >= 0 && orient(pc, pa, p) >= 0)
+                            return false;
+                    }
+                }
+            }
+            return true;
+        };
+
+        // the ears ordered by their weights (the best ear is clipped first)
+        struct Ear {
+            float weight;
+            int vertex;
+            int version;
+            bool operator<(const Ear &other) const { return weight > other.weight; }
+        };
+        std::priority_queue<Ear> queue;
+        std::vector<int> version(n, 0);
+        auto push = [&](int i) {
+            if (is_ear(i)) {
+                Ear ear;
+                ear.weight = compute_weight(vertices, prev[i], i, next[i], obj);
+                ear.vertex = i;
+                ear.version = version[i];
+                queue.push(ear);
+            }
+        };
+
+        for (int i = 0; i < n; ++i)
+            push(i);
+
+        while (remaining > 3) {
+            int i = -1;
+            if (queue.empty()) {
+                // a vertex can become an ear when a reflex vertex inside it becomes convex, which is not tracked. So
+                // check the remaining polygon again.
+                for (int j = 0; j < n; ++j) {
+                    if (!removed[j]) {
+                        ++version[j];
+                        push(j);
+                    }
+                }
+
+                // still no ear (the polygon is not simple in the projection plane): clip a vertex whose diagonal
+                // doesn't exist in the mesh, preferably a convex one
+                if (queue.empty()) {
+                    for (int j = 0; j < n; ++j) {
+                        if (removed[j] || is_edge(vertices[prev[j]], vertices[next[j]]))
+                            continue;
+                        if (i == -1 || (is_convex(j) && !is_convex(i)))
+                            i = j;
+                    }
+                    if (i == -1) {
+                        std::cerr << "[SurfaceMeshTriangulation] Failed to triangulate a polygon with " << n
+                                  << " vertices\n";
+                        return false;
+                    }
+                }
+            }
+
+            if (i == -1) {
+                const Ear ear = queue.top();
+                queue.pop();
+                if (removed[ear.vertex] || ear.version != version[ear.vertex])
+                    continue;
+                i = ear.vertex;
+            }
+
+            // clip the ear
+            const int a = prev[i];
+            const int c = next[i];
+            ears.push_back(ivec3(a, i, c));
+            removed[i] = true;
+            next[a] = c;
+            prev[c] = a;
+            --remaining;
+
+            // update the neighbors
+            for (int j : {a, c}) {
+                if (reflex[j] && is_convex(j))
+                    reflex[j] = false;
+                ++version[j];
+                push(j);
+            }
+        }
+
+        return true;
     }
 
     //-----------------------------------------------------------------------------
 
-    float SurfaceMeshTriangulation::compute_weight(int i, int j, int k) const {
-        const SurfaceMesh::Vertex a = vertices_[i];
-        const SurfaceMesh::Vertex b = vertices_[j];
-        const SurfaceMesh::Vertex c = vertices_[k];
+    void SurfaceMeshTriangulation::clip_ears(const std::vector<ivec3> &ears) {
+        // the halfedges entering the vertices in the remaining polygon
+        std::vector<SurfaceMesh::Halfedge> in(halfedges_);
+        for (const auto &ear : ears) {
+            const int a = ear[0];
+            const int c = ear[2];
+            // the edge might have been inserted by the triangulation of another polygon
+            if (mesh_->find_halfedge(vertices_[a], vertices_[c]).is_valid()) {
+                std::cerr << "[SurfaceMeshTriangulation] Edge already exists. Polygon not fully triangulated\n";
+                return;
+            }
+            // the new edge cuts off the triangle, and it enters c in the remaining polygon
+            in[c] = mesh_->insert_edge(in[a], in[c]);
+        }
+    }
+
+    //-----------------------------------------------------------------------------
 
+    float SurfaceMeshTriangulation::compute_weight(const std::vector<SurfaceMesh::Vertex> &vertices,
+                                                   int i, int j, int k, Objective obj) const {
+        const SurfaceMesh::Vertex a = vertices[i];
+        const SurfaceMesh::Vertex b = vertices[j];
+        const SurfaceMesh::Vertex c = vertices[k];
         // if one of the potential edges already exists as NON-boundary edge
         // this would result in an invalid triangulation
         // -> prevent by giving infinite weight
@@ -167,7 +448,7 @@ namespace easy3d {
         const vec3 &pc = points_[c];
 
         float w = FLT_MAX;
-        switch (objective_) {
+        switch (obj) {
             // compute squared triangle area
             case MIN_AREA:
                 w = length2(cross(pb - pa, pc - pa));
@@ -40,6 +40,12 @@ namespace easy3d {
      * \details Tringulate n-gons into n-2 triangles. Find the triangulation that minimizes the sum of squared triangle
      * areas. See the following paper for more details:
      *  - Peter Liepa. Filling holes in meshes. SGP, 2003.
+     *
+     * The optimal triangulation takes O(n^3) time, which is impractical for large polygons (e.g., the faces
+     * produced by SurfaceMeshPolygonization or planar faces of CAD models). So polygons with more vertices than
+     * large_polygon_threshold() are triangulated by greedy ear clipping on the best-fit plane of the polygon
+     * (a priority queue of the ears ordered by the objective, with a uniform grid accelerating the ear tests),
+     * which takes O(n log n) time for typical polygons.
      */
     class SurfaceMeshTriangulation {
     public:
@@ -53,16 +59,41 @@ namespace easy3d {
 
         SurfaceMeshTriangulation(SurfaceMesh *mesh);
 
-        //! \brief triangulate all faces
+        //! \brief triangulate all faces. The triangulations of the faces are computed in parallel.
         void triangulate(Objective obj = MIN_AREA);
 
         //! \brief triangulate a particular face f
         void triangulate(SurfaceMesh::Face f, Objective obj = MIN_AREA);
 
+        //! \brief Sets the number of vertices above which a polygon is triangulated by ear clipping instead of the
+        //! optimal (but O(n^3)) dynamic programming. Default value is 100.
+        void set_large_polygon_threshold(unsigned int n) { large_polygon_threshold_ = n; }
+        //! \brief Returns the number of vertices above which a polygon is triangulated by ear clipping.
+        unsigned int large_polygon_threshold() const { return large_polygon_threshold_; }
+
     private:
 
+        // collect the halfedges and vertices of face f. Returns false if the face has a non-manifold vertex.
+        bool collect_polygon(SurfaceMesh::Face f,
+                             std::vector<SurfaceMesh::Halfedge> &halfedges,
+                             std::vector<SurfaceMesh::Vertex> &vertices) const;
+
+        // compute the optimal triangulation of a polygon by dynamic programming. The triangulation is returned as
+        // the diagonals (i,j) in an order they can be inserted by insert_edge().
+        bool triangulate_optimal(const std::vector<SurfaceMesh::Vertex> &vertices, Objective obj,
+                                 std::vector<ivec2> &diagonals) const;
+
+        // triangulate a polygon by greedy ear clipping. The triangulation is returned as the ears (i,j,k) in the
+        // order they are clipped.
+        bool triangulate_ear_clipping(const std::vector<SurfaceMesh::Vertex> &vertices, Objective obj,
+                                      std::vector<ivec3> &ears) const;
+
+        // clip the ears from the polygon stored in halfedges_ and vertices_
+        void clip_ears(const std::vector<ivec3> &ears);
+
         // compute the weight of the triangle (i,j,k).
-        float compute_weight(int i, int j, int k) const;
+        float compute_weight(const std::vector<SurfaceMesh::Vertex> &vertices, int i, int j, int k,
+                             Objective obj) const;
 
         // does edge (a,b) exist?
         bool is_edge(SurfaceMesh::Vertex a, SurfaceMesh::Vertex b) const;
@@ -82,9 +113,7 @@ namespace easy3d {
         std::vector<SurfaceMesh::Halfedge> halfedges_;
         std::vector<SurfaceMesh::Vertex> vertices_;
 
-        // data for computing optimal triangulation
-        std::vector<std::vector<float> > weight_;
-        std::vector<std::vector<int> > index_;
+        unsigned int large_polygon_threshold_;
     };
 
 } // namespace easy3d
@@ -0,0 +1,363 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <easy3d/algo/surface_mesh_vertex_clustering.h>
+#include <easy3d/core/surface_mesh.h>
+#include <easy3d/core/surface_mesh_builder.h>
+#include <easy3d/core/hash.h>
+#include <easy3d/util/file_system.h>
+#include <easy3d/util/logging.h>
+
+#include <3rd_party/rply/rply.h>
+
+#include <cstdio>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <algorithm>
+
+
+namespace easy3d {
+
+    namespace details {
+
+        typedef std::function<void(const vec3 &, const vec3 &, const vec3 &)> TriangleCallback;
+
+        // streams the triangles of a (binary or ASCII) STL file
+        bool stream_stl(const std::string &file_name, const TriangleCallback &callback) {
+            FILE *in = fopen(file_name.c_str(), "rb");
+            if (!in) {
+                LOG(ERROR) << "could not open file: " << file_name;
+                return false;
+            }
+
+            // ASCII or binary STL?
+            char line[100];
+            const bool binary = !(fread(line, 1, 5, in) == 5 &&
+                                  (strncmp(line, "SOLID", 5) == 0 || strncmp(line, "solid", 5) == 0));
+            rewind(in);
+
+            vec3 p[3];
+            if (binary) {
+                uint32_t num = 0;
+                if (fread(line, 1, 80, in) != 80 || fread(&num, sizeof(num), 1, in) != 1) {
+                    LOG(ERROR) << "failed reading the header of file: " << file_name;
+                    fclose(in);
+                    return false;
+                }
+                // normal, 3 vertices, attribute byte count
+                char record[50];
+                for (uint32_t i = 0; i < num; ++i) {
+                    if (fread(record, 1, 50, in) != 50) {
+                        LOG(ERROR) << "unexpected end of file: " << file_name;
+                        break;
+                    }
+                    std::memcpy(p, record + 12, 36);
+                    callback(p[0], p[1], p[2]);
+                }
+            } else {
+                int count = 0;
+                while (fgets(line, 100, in)) {
+                    const char *c = line;
+                    while (isspace(*c) && *c != '\0')
+                        ++c;
+                    if (strncmp(c, "vertex", 6) == 0 || strncmp(c, "VERTEX", 6) == 0) {
+                        if (sscanf(c + 6, "%f %f %f", &p[count].x, &p[count].y, &p[count].z) == 3 && ++count == 3) {
+                            callback(p[0], p[1], p[2]);
+                            count = 0;
+                        }
+                    } else if (strncmp(c, "outer", 5) == 0 || strncmp(c, "OUTER", 5) == 0)
+                        count = 0;
+                }
+            }
+
+            fclose(in);
+            return true;
+        }
+
+
+        // the state of streaming a PLY file
+        struct PlyStream {
+            std::vector<vec3> points;
+            std::vector<int> face;
+            Box3 box;
+            std::function<void(const Box3 &)> begin_faces;   // called before the first face
+            TriangleCallback callback;
+        };
+
+        int ply_vertex_cb(p_ply_argument argument) {
+            PlyStream *stream = nullptr;
+            long instance = 0, coordinate = 0;
+            ply_get_argument_element(argument, nullptr, &instance);
+            ply_get_argument_user_data(argument, (void **) &stream, &coordinate);
+            vec3 &p = stream->points[instance];
+            p[coordinate] = static_cast<float>(ply_get_argument_value(argument));
+            if (coordinate == 2)
+                stream->box.add_point(p);
+            return 1;
+        }
+
+        int ply_face_cb(p_ply_argument argument) {
+            PlyStream *stream = nullptr;
+            long length = 0, index = 0;
+            ply_get_argument_property(argument, nullptr, &length, &index);
+            ply_get_argument_user_data(argument, (void **) &stream, nullptr);
+            if (index == -1) {  // the number of vertices of the face
+                if (stream->begin_faces) {
+                    stream->begin_faces(stream->box);
+                    stream->begin_faces = nullptr;
+                }
+                stream->face.clear();
+                return 1;
+            }
+
+            const int id = static_cast<int>(ply_get_argument_value(argument));
+            if (id < 0 || id >= static_cast<int>(stream->points.size()))
+                return 0;
+            stream->face.push_back(id);
+            if (index == length - 1) {  // the last vertex of the face: triangulate it as a fan
+                const std::vector<int> &f = stream->face;
+                for (std::size_t i = 1; i + 1 < f.size(); ++i)
+                    stream->callback(stream->points[f[0]], stream->points[f[i]], stream->points[f[i + 1]]);
+            }
+            return 1;
+        }
+
+        // streams the faces of a PLY file. begin_faces is called (with the bounding box of the vertices) before the
+        // first face.
+        bool stream_ply(const std::string &file_name, const std::function<void(const Box3 &)> &begin_faces,
+                        const TriangleCallback &callback) {
+            p_ply ply = ply_open(file_name.c_str(), nullptr, 0, nullptr);
+            if (!ply || !ply_read_header(ply)) {
+                LOG(ERROR) << "could not open ply file: " << file_name;
+                if (ply)
+                    ply_close(ply);
+                return false;
+            }
+
+            PlyStream stream;
+            stream.begin_faces = begin_faces;
+            stream.callback = callback;
+            const long num_vertices = ply_set_read_cb(ply, "vertex", "x", ply_vertex_cb, &stream, 0);
+            ply_set_read_cb(ply, "vertex", "y", ply_vertex_cb, &stream, 1);
+            ply_set_read_cb(ply, "vertex", "z", ply_vertex_cb, &stream, 2);
+            long num_faces = ply_set_read_cb(ply, "face", "vertex_indices", ply_face_cb, &stream, 0);
+            if (num_faces == 0)
+                num_faces = ply_set_read_cb(ply, "face", "vertex_index", ply_face_cb, &stream, 0);
+            if (num_vertices == 0 || num_faces == 0) {
+                LOG(ERROR) << "no vertices or faces in ply file: " << file_name;
+                ply_close(ply);
+                return false;
+            }
+
+            stream.points.resize(num_vertices);
+            const bool success = ply_read(ply) != 0;
+            ply_close(ply);
+            if (!success)
+                LOG(ERROR) << "failed reading ply file: " << file_name;
+            return success;
+        }
+
+    }
+
+
+    SurfaceMeshVertexClustering::SurfaceMeshVertexClustering(unsigned int resolution)
+            : resolution_(std::max(1u, resolution)), cell_size_(0.0f), num_input_triangles_(0) {
+        dims_[0] = dims_[1] = dims_[2] = 1;
+    }
+
+
+    SurfaceMeshVertexClustering::~SurfaceMeshVertexClustering() {
+    }
+
+
+    void SurfaceMeshVertexClustering::set_bounding_box(const Box3 &box) {
+        box_ = box;
+        cell_size_ = std::max(box.max_range(), FLT_MIN) / resolution_;
+        for (int i = 0; i < 3; ++i)
+            dims_[i] = std::max(1, static_cast<int>(std::ceil(box.range(i) / cell_size_)));
+
+        cells_.clear();
+        clusters_.clear();
+        triangles_.clear();
+        num_input_triangles_ = 0;
+    }
+
+
+    unsigned int SurfaceMeshVertexClustering::cluster(const vec3 &p) {
+        uint64_t key = 0;
+        for (int i = 2; i >= 0; --i) {
+            int c = static_cast<int>((p[i] - box_.min_coord(i)) / cell_size_);
+            c = std::min(std::max(c, 0), dims_[i] - 1);
+            key = key * dims_[i] + c;
+        }
+
+        auto pos = cells_.find(key);
+        unsigned int index;
+        if (pos == cells_.end()) {
+            index = static_cast<unsigned int>(clusters_.size());
+            cells_[key] = index;
+            clusters_.push_back({Quadric(), dvec3(0, 0, 0), 0});
+        } else
+            index = pos->second;
+
+        Cluster &c = clusters_[index];
+        c.sum += dvec3(p.x, p.y, p.z);
+        ++c.count;
+        return index;
+    }
+
+
+    void SurfaceMeshVertexClustering::add_triangle(const vec3 &a, const vec3 &b, const vec3 &c) {
+        if (cell_size_ <= 0.0f) {
+            LOG_N_TIMES(1, ERROR) << "the bounding box must be set before adding triangles";
+            return;
+        }
+
+        ++num_input_triangles_;
+        const vec3 *points[3] = {&a, &b, &c};
+        unsigned int ids[3];
+        for (int i = 0; i < 3; ++i)
+            ids[i] = cluster(*points[i]);
+
+        // the area-weighted quadric of the triangle contributes to the clusters of its vertices
+        const vec3 n = cross(b - a, c - a);
+        const float length = norm(n);
+        if (length > 0.0f) {
+            Quadric q(n / length, a);
+            q *= 0.5 * length;
+            for (auto id : ids)
+                clusters_[id].quadric += q;
+        }
+
+        // a triangle survives only if its vertices are in different clusters
+        if (ids[0] == ids[1] || ids[1] == ids[2] || ids[2] == ids[0])
+            return;
+
+        // rotate the smallest index to the front (orientation is preserved)
+        Triangle t;
+        const int first = static_cast<int>(std::min_element(ids, ids + 3) - ids);
+        for (int i = 0; i < 3; ++i)
+            t.v[i] = ids[(first + i) % 3];
+
+        // skip duplicates, and also the triangles with opposite orientations (otherwise the result is non-manifold)
+        const Triangle reversed = {{t.v[0], t.v[2], t.v[1]}};
+        if (triangles_.find(reversed) == triangles_.end() && triangles_.find(t) == triangles_.end())
+            triangles_.emplace(t, static_cast<unsigned int>(triangles_.size()));
+    }
+
+
+    std::size_t SurfaceMeshVertexClustering::TriangleHash::operator()(const Triangle &t) const {
+        uint64_t seed = 0;
+        hash_combine(seed, t.v[0]);
+        hash_combine(seed, t.v[1]);
+        hash_combine(seed, t.v[2]);
+        return static_cast<std::size_t>(seed);
+    }
+
+
+    SurfaceMesh *SurfaceMeshVertexClustering::extract_mesh() const {
+        // the triangles in the order of insertion, so the result is deterministic
+        std::vector<Triangle> triangles(triangles_.size());
+        for (const auto &t : triangles_)
+            triangles[t.second] = t.first;
+
+        // compute the representatives of the clusters
+        std::vector<uint64_t> cell_of_cluster(clusters_.size());
+        for (const auto &c : cells_)
+            cell_of_cluster[c.second] = c.first;
+
+        auto representative = [&](unsigned int id) -> vec3 {
+            const Cluster &c = clusters_[id];
+            const vec3 centroid(c.sum / static_cast<double>(c.count));
+            const vec3 p = c.quadric.minimizer(centroid);
+
+            // the representative should not go far beyond its cell (it may happen for nearly degenerate quadrics)
+            uint64_t key = cell_of_cluster[id];
+            for (int i = 0; i < 3; ++i) {
+                const float lower = box_.min_coord(i) + (key % dims_[i]) * cell_size_;
+                key /= dims_[i];
+                if (p[i] < lower - 0.5f * cell_size_ || p[i] > lower + 1.5f * cell_size_)
+                    return centroid;
+            }
+            return p;
+        };
+
+        auto mesh = new SurfaceMesh;
+        SurfaceMeshBuilder builder(mesh);
+        builder.begin_surface();
+
+        std::vector<int> vertex_of_cluster(clusters_.size(), -1);
+        std::vector<SurfaceMesh::Vertex> vertices(3);
+        for (const auto &t : triangles) {
+            for (int i = 0; i < 3; ++i) {
+                int &v = vertex_of_cluster[t.v[i]];
+                if (v == -1)
+                    v = builder.add_vertex(representative(t.v[i])).idx();
+                vertices[i] = SurfaceMesh::Vertex(v);
+            }
+            builder.add_face(vertices);
+        }
+
+        builder.end_surface(false);
+        return mesh;
+    }
+
+
+    SurfaceMesh *SurfaceMeshVertexClustering::simplify(const std::string &file_name, unsigned int resolution) {
+        SurfaceMeshVertexClustering clustering(resolution);
+        auto add = [&clustering](const vec3 &a, const vec3 &b, const vec3 &c) { clustering.add_triangle(a, b, c); };
+
+        const std::string ext = file_system::extension(file_name, true);
+        bool success = false;
+        if (ext == "stl") {
+            // 1st pass: the bounding box
+            Box3 box;
+            success = details::stream_stl(file_name, [&box](const vec3 &a, const vec3 &b, const vec3 &c) {
+                box.add_point(a);
+                box.add_point(b);
+                box.add_point(c);
+            });
+            // 2nd pass: the clustering
+            if (success && box.is_valid()) {
+                clustering.set_bounding_box(box);
+                success = details::stream_stl(file_name, add);
+            }
+        } else if (ext == "ply") {
+            success = details::stream_ply(file_name, [&clustering](const Box3 &box) {
+                clustering.set_bounding_box(box);
+            }, add);
+        } else
+            LOG(ERROR) << "unsupported file format (only ply and stl are supported): " << ext;
+
+        if (!success || clustering.num_output_triangles() == 0)
+            return nullptr;
+
+        LOG(INFO) << "vertex clustering: " << clustering.num_input_triangles() << " triangles -> "
+                  << clustering.num_output_triangles() << " triangles (" << clustering.num_clusters() << " clusters)";
+        return clustering.extract_mesh();
+    }
+
+} // namespace easy3d
@@ -0,0 +1,132 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EASY3D_ALGO_SURFACE_MESH_VERTEX_CLUSTERING_H
+#define EASY3D_ALGO_SURFACE_MESH_VERTEX_CLUSTERING_H
+
+#include <easy3d/algo/surface_mesh_simplification.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+
+namespace easy3d {
+
+    /**
+     * \brief Out-of-core simplification of triangle meshes by vertex clustering.
+     * \class SurfaceMeshVertexClustering easy3d/algo/surface_mesh_vertex_clustering.h
+     *
+     * \details The triangles are streamed into a uniform grid (one at a time, in any order), and the vertices in each
+     * cell are merged into a single representative. The representative minimizes the sum of the (area-weighted) error
+     * quadrics of the triangles incident to the cell, so it lies on the features of the original surface. Triangles
+     * whose vertices fall into less than three different cells are dropped. See the following paper for more details:
+     *  - Peter Lindstrom. Out-of-core simplification of large polygonal models. SIGGRAPH 2000.
+     *
+     * The memory consumption depends on the number of occupied cells and the size of the result, not on the size of
+     * the input. It is thus suitable for meshes that cannot be loaded as a SurfaceMesh, e.g., as a first stage before
+     * SurfaceMeshSimplification. Example usage:
+     *  \code
+     *      // from a file (streamed in bounded memory)
+     *      SurfaceMesh* mesh = SurfaceMeshVertexClustering::simplify("huge_scan.ply", 1000);
+     *      // or from any source of triangles
+     *      SurfaceMeshVertexClustering clustering(1000);
+     *      clustering.set_bounding_box(box);
+     *      for_each_triangle:
+     *          clustering.add_triangle(a, b, c);
+     *      SurfaceMesh* result = clustering.extract_mesh();
+     *  \endcode
+     */
+    class SurfaceMeshVertexClustering {
+    public:
+        /**
+         * \brief Constructor.
+         * \param resolution The number of grid cells along the longest side of the bounding box.
+         */
+        explicit SurfaceMeshVertexClustering(unsigned int resolution);
+        ~SurfaceMeshVertexClustering();
+
+        /// \brief Sets the bounding box of the input, which defines the grid. It must be called before the first
+        ///     add_triangle() and clears the clusters added so far.
+        void set_bounding_box(const Box3 &box);
+
+        /// \brief Adds a triangle of the input. Vertices outside the bounding box are clamped into the grid.
+        void add_triangle(const vec3 &a, const vec3 &b, const vec3 &c);
+
+        /// \brief Creates the simplified mesh from the triangles added so far. The caller takes the ownership.
+        SurfaceMesh *extract_mesh() const;
+
+        /// \brief The number of triangles added.
+        std::size_t num_input_triangles() const { return num_input_triangles_; }
+        /// \brief The number of occupied cells.
+        std::size_t num_clusters() const { return clusters_.size(); }
+        /// \brief The number of triangles in the result.
+        std::size_t num_output_triangles() const { return triangles_.size(); }
+
+        /**
+         * \brief Simplifies a triangle mesh stored in a file, without loading the whole mesh into memory.
+         * \details Binary and ASCII STL files are streamed twice (bounding box first, then the triangles), using memory
+         *      independent of the file size. For PLY files, the vertex coordinates are stored (12 bytes per vertex)
+         *      and the faces are streamed. Polygonal faces are triangulated as fans.
+         * \param file_name The input file (ply or stl).
+         * \param resolution The number of grid cells along the longest side of the bounding box.
+         * \return The simplified mesh (nullptr if failed). The caller takes the ownership.
+         */
+        static SurfaceMesh *simplify(const std::string &file_name, unsigned int resolution);
+
+    private:
+        // the cluster (i.e., its index) of a point
+        unsigned int cluster(const vec3 &p);
+
+    private:
+        unsigned int resolution_;
+        Box3 box_;
+        float cell_size_;
+        int dims_[3];
+
+        std::unordered_map<uint64_t, unsigned int> cells_; // occupied cell -> index of its cluster
+
+        struct Cluster {
+            Quadric quadric;    // sum of the area-weighted quadrics of the incident triangles
+            dvec3 sum;          // sum of the points in the cell
+            unsigned int count; // number of points in the cell
+        };
+        std::vector<Cluster> clusters_;
+
+        struct Triangle {
+            unsigned int v[3];
+            bool operator==(const Triangle &t) const { return v[0] == t.v[0] && v[1] == t.v[1] && v[2] == t.v[2]; }
+        };
+        struct TriangleHash {
+            std::size_t operator()(const Triangle &t) const;
+        };
+        std::unordered_map<Triangle, unsigned int, TriangleHash> triangles_;  // triangle -> its order of insertion
+
+        std::size_t num_input_triangles_;
+    };
+
+} // namespace easy3d
+
+#endif // EASY3D_ALGO_SURFACE_MESH_VERTEX_CLUSTERING_H
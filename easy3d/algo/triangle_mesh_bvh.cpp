@@ -0,0 +1,747 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <easy3d/algo/triangle_mesh_bvh.h>
+#include <easy3d/core/hash.h>
+#include <easy3d/util/logging.h>
+
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+
+namespace easy3d {
+
+    namespace details {
+
+        // number of bins used for evaluating the SAH
+        const int bvh_num_bins = 16;
+        // the tree depth is limited such that a fixed-size traversal stack is always sufficient
+        const int bvh_max_depth = 60;
+        const int bvh_stack_size = 64;
+
+        inline float half_area(const vec3 &bmin, const vec3 &bmax) {
+            const vec3 d = bmax - bmin;
+            return d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+
+        // squared distance from a point to a box (0 if the point is inside)
+        inline float box_distance2(const float *bmin, const float *bmax, const vec3 &p) {
+            float d2 = 0.0f;
+            for (int i = 0; i < 3; ++i) {
+                if (p[i] < bmin[i])
+                    d2 += (bmin[i] - p[i]) * (bmin[i] - p[i]);
+                else if (p[i] > bmax[i])
+                    d2 += (p[i] - bmax[i]) * (p[i] - bmax[i]);
+            }
+            return d2;
+        }
+
+        // slab test. Returns the entry distance of the ray, or FLT_MAX if the box is missed within [0, t_max].
+        inline float ray_box(const float *bmin, const float *bmax, const vec3 &org, const vec3 &inv_dir, float t_max) {
+            float t0 = 0.0f, t1 = t_max;
+            for (int i = 0; i < 3; ++i) {
+                float tn = (bmin[i] - org[i]) * inv_dir[i];
+                float tf = (bmax[i] - org[i]) * inv_dir[i];
+                if (tn > tf) std::swap(tn, tf);
+                t0 = tn > t0 ? tn : t0;
+                t1 = tf < t1 ? tf : t1;
+                if (t0 > t1)
+                    return FLT_MAX;
+            }
+            return t0;
+        }
+
+        // Moller-Trumbore ray-triangle intersection. Returns true if the intersection is within (0, t_max).
+        inline bool ray_triangle(const vec3 &org, const vec3 &dir, const vec3 &a, const vec3 &b, const vec3 &c,
+                                 float t_max, float &t) {
+            const vec3 e1 = b - a;
+            const vec3 e2 = c - a;
+            const vec3 pv = cross(dir, e2);
+            const float det = dot(e1, pv);
+            if (std::fabs(det) < FLT_MIN)
+                return false;
+            const float inv_det = 1.0f / det;
+            const vec3 tv = org - a;
+            const float u = dot(tv, pv) * inv_det;
+            if (u < 0.0f || u > 1.0f)
+                return false;
+            const vec3 qv = cross(tv, e1);
+            const float v = dot(dir, qv) * inv_det;
+            if (v < 0.0f || u + v > 1.0f)
+                return false;
+            t = dot(e2, qv) * inv_det;
+            return t >= 0.0f && t <= t_max;
+        }
+
+        inline bool boxes_overlap(const float *bmin, const float *bmax, const Box3 &box) {
+            for (int i = 0; i < 3; ++i) {
+                if (bmin[i] > box.max_point()[i] || bmax[i] < box.min_point()[i])
+                    return false;
+            }
+            return true;
+        }
+
+        // Separating axis test of a triangle against an axis-aligned box (Akenine-Moller, 2001).
+        inline bool triangle_box_overlap(const vec3 &center, const vec3 &half, const vec3 *tri) {
+            const vec3 v[3] = {tri[0] - center, tri[1] - center, tri[2] - center};
+            const vec3 e[3] = {v[1] - v[0], v[2] - v[1], v[0] - v[2]};
+
+            // the three box normals
+            for (int i = 0; i < 3; ++i) {
+                const float mn = std::min(v[0][i], std::min(v[1][i], v[2][i]));
+                const float mx = std::max(v[0][i], std::max(v[1][i], v[2][i]));
+                if (mn > half[i] || mx < -half[i])
+                    return false;
+            }
+
+            // the nine cross products of the box axes and the triangle edges
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    vec3 axis(0, 0, 0);
+                    axis[(j + 1) % 3] = -e[i][(j + 2) % 3];
+                    axis[(j + 2) % 3] = e[i][(j + 1) % 3];
+                    const float p0 = dot(v[0], axis), p1 = dot(v[1], axis), p2 = dot(v[2], axis);
+                    const float r = half.x * std::fabs(axis.x) + half.y * std::fabs(axis.y) + half.z * std::fabs(axis.z);
+                    if (std::min(p0, std::min(p1, p2)) > r || std::max(p0, std::max(p1, p2)) < -r)
+                        return false;
+                }
+            }
+
+            // the triangle normal
+            const vec3 n = cross(e[0], e[1]);
+            const float r = half.x * std::fabs(n.x) + half.y * std::fabs(n.y) + half.z * std::fabs(n.z);
+            const float s = dot(n, v[0]);
+            return std::fabs(s) <= r;
+        }
+
+        inline void remove_duplicates(std::vector<SurfaceMesh::Face> &faces) {
+            std::sort(faces.begin(), faces.end());
+            faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+        }
+
+        // the header of a saved BVH, which identifies the mesh it was built for
+        struct BVHFileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+            uint64_t num_vertices;
+            uint64_t num_faces;
+            uint64_t hash;
+        };
+
+        inline BVHFileHeader bvh_file_header(const SurfaceMesh *mesh) {
+            BVHFileHeader header;
+            std::memcpy(header.magic, "e3d_bvh", 8);
+            header.version = 1;
+            header.reserved = 0;
+            header.num_vertices = mesh->n_vertices();
+            header.num_faces = mesh->n_faces();
+            const auto &points = mesh->points();
+            header.hash = hash_bytes(points.data(), points.size() * sizeof(vec3));
+            return header;
+        }
+
+        template<typename T>
+        inline bool write_array(FILE *fp, const std::vector<T> &data) {
+            const uint64_t size = data.size();
+            return fwrite(&size, sizeof(size), 1, fp) == 1 &&
+                   (size == 0 || fwrite(data.data(), sizeof(T), size, fp) == size);
+        }
+
+        template<typename T>
+        inline bool read_array(FILE *fp, std::vector<T> &data) {
+            uint64_t size = 0;
+            if (fread(&size, sizeof(size), 1, fp) != 1)
+                return false;
+            data.resize(size);
+            return size == 0 || fread(data.data(), sizeof(T), size, fp) == size;
+        }
+
+    }
+
+
+    TriangleMeshBVH::TriangleMeshBVH(const SurfaceMesh *mesh, unsigned int max_leaf_size) {
+        auto points = mesh->get_vertex_property<vec3>("v:point");
+
+        // collect triangles (non-triangular faces are fan-triangulated)
+        triangles_.reserve(mesh->n_faces());
+        faces_.reserve(mesh->n_faces());
+        Triangle tri;
+        for (auto f : mesh->faces()) {
+            auto h = mesh->halfedge(f);
+            tri.x[0] = points[mesh->target(h)];
+            h = mesh->next(h);
+            tri.x[2] = points[mesh->target(h)];
+            for (h = mesh->next(h); h != mesh->halfedge(f); h = mesh->next(h)) {
+                tri.x[1] = tri.x[2];
+                tri.x[2] = points[mesh->target(h)];
+                triangles_.push_back(tri);
+                faces_.push_back(f);
+            }
+        }
+
+        build(std::max(1u, max_leaf_size));
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void TriangleMeshBVH::build(unsigned int max_leaf_size) {
+        const int num = static_cast<int>(triangles_.size());
+        nodes_.clear();
+        if (num == 0)
+            return;
+
+        // bounding boxes and centroids of the triangles
+        std::vector<Box3> boxes(num);
+        std::vector<vec3> centroids(num);
+#pragma omp parallel for
+        for (int i = 0; i < num; ++i) {
+            Box3 &box = boxes[i];
+            for (int j = 0; j < 3; ++j)
+                box.add_point(triangles_[i].x[j]);
+            centroids[i] = box.center();
+        }
+
+        std::vector<uint32_t> indices(num);
+        for (int i = 0; i < num; ++i)
+            indices[i] = static_cast<uint32_t>(i);
+
+        // processes a node whose 'first' and 'count' specify its range in 'indices': computes its bounding box and
+        // reorders the range for the best split. Returns the number of triangles of the left child, or 0 if the
+        // node should be a leaf.
+        auto split_node = [&](Node &node, bool force_leaf) -> uint32_t {
+            const uint32_t begin = node.first;
+            const uint32_t end = node.first + node.count;
+
+            Box3 bounds, cbounds;
+            for (uint32_t i = begin; i < end; ++i) {
+                bounds.add_box(boxes[indices[i]]);
+                cbounds.add_point(centroids[indices[i]]);
+            }
+            for (int i = 0; i < 3; ++i) {
+                node.bmin[i] = bounds.min_point()[i];
+                node.bmax[i] = bounds.max_point()[i];
+            }
+
+            if (node.count <= max_leaf_size || force_leaf)
+                return 0;
+
+            // binned SAH along each axis
+            int best_axis = -1, best_bin = -1;
+            float best_cost = FLT_MAX;
+            for (int axis = 0; axis < 3; ++axis) {
+                const float cmin = cbounds.min_point()[axis];
+                const float extent = cbounds.max_point()[axis] - cmin;
+                if (extent <= 0.0f)
+                    continue;
+
+                Box3 bin_boxes[details::bvh_num_bins];
+                uint32_t bin_counts[details::bvh_num_bins] = {0};
+                const float scale = details::bvh_num_bins / extent;
+                for (uint32_t i = begin; i < end; ++i) {
+                    const uint32_t id = indices[i];
+                    const int b = std::min(details::bvh_num_bins - 1, static_cast<int>((centroids[id][axis] - cmin) * scale));
+                    ++bin_counts[b];
+                    bin_boxes[b].add_box(boxes[id]);
+                }
+
+                // sweep from the right to accumulate the costs of the right parts
+                float right_cost[details::bvh_num_bins];
+                Box3 acc;
+                uint32_t acc_count = 0;
+                for (int b = details::bvh_num_bins - 1; b > 0; --b) {
+                    acc_count += bin_counts[b];
+                    if (bin_counts[b])
+                        acc.add_box(bin_boxes[b]);
+                    right_cost[b] = acc_count ? acc_count * details::half_area(acc.min_point(), acc.max_point()) : 0.0f;
+                }
+
+                // sweep from the left and evaluate the splits between bin b-1 and b
+                acc.clear();
+                acc_count = 0;
+                for (int b = 1; b < details::bvh_num_bins; ++b) {
+                    acc_count += bin_counts[b - 1];
+                    if (bin_counts[b - 1])
+                        acc.add_box(bin_boxes[b - 1]);
+                    if (acc_count == 0 || acc_count == node.count)
+                        continue;
+                    const float cost = acc_count * details::half_area(acc.min_point(), acc.max_point()) + right_cost[b];
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_bin = b;
+                    }
+                }
+            }
+
+            const float parent_area = details::half_area(bounds.min_point(), bounds.max_point());
+            if (best_axis >= 0) {
+                // traversal cost is assumed to be equal to one triangle test
+                const float split_cost = 1.0f + (parent_area > 0.0f ? best_cost / parent_area : FLT_MAX);
+                if (split_cost >= static_cast<float>(node.count) && node.count <= 4 * max_leaf_size)
+                    return 0;
+
+                const float cmin = cbounds.min_point()[best_axis];
+                const float scale = details::bvh_num_bins / (cbounds.max_point()[best_axis] - cmin);
+                auto mid = std::partition(indices.begin() + begin, indices.begin() + end, [&](uint32_t id) -> bool {
+                    const int b = std::min(details::bvh_num_bins - 1, static_cast<int>((centroids[id][best_axis] - cmin) * scale));
+                    return b < best_bin;
+                });
+                const auto num_left = static_cast<uint32_t>(mid - (indices.begin() + begin));
+                if (num_left > 0 && num_left < node.count)
+                    return num_left;
+            }
+
+            // all centroids coincide (or the binning failed): split the range in the middle
+            const uint32_t half = node.count / 2;
+            const vec3 extent = cbounds.max_point() - cbounds.min_point();
+            const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+            std::nth_element(indices.begin() + begin, indices.begin() + begin + half, indices.begin() + end,
+                             [&](uint32_t a, uint32_t b) -> bool { return centroids[a][axis] < centroids[b][axis]; });
+            return half;
+        };
+
+        // breadth-first construction: all nodes of a level are independent (they cover disjoint ranges of
+        // 'indices'), so they are processed in parallel.
+        nodes_.reserve(2 * num);
+        Node root;
+        root.first = 0;
+        root.count = static_cast<uint32_t>(num);
+        nodes_.push_back(root);
+
+        std::vector<uint32_t> level(1, 0), next_level;
+        std::vector<uint32_t> num_left;
+        for (int depth = 0; !level.empty(); ++depth) {
+            const bool force_leaf = (depth >= details::bvh_max_depth);
+            const int level_size = static_cast<int>(level.size());
+            num_left.resize(level_size);
+#pragma omp parallel for schedule(dynamic)
+            for (int i = 0; i < level_size; ++i)
+                num_left[i] = split_node(nodes_[level[i]], force_leaf);
+
+            next_level.clear();
+            for (int i = 0; i < level_size; ++i) {
+                if (num_left[i] == 0)
+                    continue;
+                const uint32_t id = level[i];
+                const auto child = static_cast<uint32_t>(nodes_.size());
+                Node left, right;
+                left.first = nodes_[id].first;
+                left.count = num_left[i];
+                right.first = left.first + left.count;
+                right.count = nodes_[id].count - left.count;
+                nodes_.push_back(left);
+                nodes_.push_back(right);
+                nodes_[id].first = child;
+                nodes_[id].count = 0;
+                next_level.push_back(child);
+                next_level.push_back(child + 1);
+            }
+            level.swap(next_level);
+        }
+
+        // reorder the triangles such that each leaf references a contiguous range
+        std::vector<Triangle> triangles(num);
+        std::vector<SurfaceMesh::Face> faces(num);
+        for (int i = 0; i < num; ++i) {
+            triangles[i] = triangles_[indices[i]];
+            faces[i] = faces_[indices[i]];
+        }
+        triangles_.swap(triangles);
+        faces_.swap(faces);
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool TriangleMeshBVH::save(const std::string &file_name, const SurfaceMesh *mesh) const {
+        FILE *fp = fopen(file_name.c_str(), "wb");
+        if (!fp) {
+            LOG(ERROR) << "could not open file: " << file_name;
+            return false;
+        }
+
+        const details::BVHFileHeader header = details::bvh_file_header(mesh);
+        bool success = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                       details::write_array(fp, nodes_) &&
+                       details::write_array(fp, triangles_) &&
+                       details::write_array(fp, faces_);
+        fclose(fp);
+        if (!success)
+            LOG(ERROR) << "failed writing BVH to file: " << file_name;
+        return success;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool TriangleMeshBVH::load(const std::string &file_name, const SurfaceMesh *mesh) {
+        nodes_.clear();
+        triangles_.clear();
+        faces_.clear();
+
+        FILE *fp = fopen(file_name.c_str(), "rb");
+        if (!fp)
+            return false;
+
+        const details::BVHFileHeader expected = details::bvh_file_header(mesh);
+        details::BVHFileHeader header;
+        if (fread(&header, sizeof(header), 1, fp) != 1 || std::memcmp(&header, &expected, sizeof(header)) != 0) {
+            LOG(WARNING) << "not a BVH file, or it was created for a different mesh: " << file_name;
+            fclose(fp);
+            return false;
+        }
+
+        bool success = details::read_array(fp, nodes_) &&
+                       details::read_array(fp, triangles_) &&
+                       details::read_array(fp, faces_) &&
+                       triangles_.size() == faces_.size();
+        fclose(fp);
+        if (!success) {
+            LOG(WARNING) << "failed loading BVH from file: " << file_name;
+            nodes_.clear();
+            triangles_.clear();
+            faces_.clear();
+        }
+        return success;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    Box3 TriangleMeshBVH::bounding_box() const {
+        if (nodes_.empty())
+            return Box3();
+        const Node &root = nodes_[0];
+        return Box3(vec3(root.bmin), vec3(root.bmax));
+    }
+
+    //-----------------------------------------------------------------------------
+
+    TriangleMeshBVH::NearestNeighbor TriangleMeshBVH::nearest(const vec3 &p) const {
+        NearestNeighbor data;
+        data.dist = FLT_MAX;
+        data.tests = 0;
+        if (nodes_.empty())
+            return data;
+
+        float best2 = FLT_MAX;
+        std::pair<uint32_t, float> stack[details::bvh_stack_size];
+        int top = 0;
+        stack[top++] = std::make_pair(0u, details::box_distance2(nodes_[0].bmin, nodes_[0].bmax, p));
+        while (top > 0) {
+            const auto entry = stack[--top];
+            if (entry.second >= best2)
+                continue;
+
+            const Node &node = nodes_[entry.first];
+            if (node.count > 0) {
+                vec3 n;
+                for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                    const Triangle &t = triangles_[i];
+                    const float d = geom::dist_point_triangle(p, t.x[0], t.x[1], t.x[2], n);
+                    ++data.tests;
+                    if (d < data.dist) {
+                        data.dist = d;
+                        data.face = faces_[i];
+                        data.nearest = n;
+                        best2 = d * d;
+                    }
+                }
+            } else {
+                const Node &l = nodes_[node.first];
+                const Node &r = nodes_[node.first + 1];
+                const float dl = details::box_distance2(l.bmin, l.bmax, p);
+                const float dr = details::box_distance2(r.bmin, r.bmax, p);
+                // push the farther child first such that the nearer one is visited first
+                if (dl <= dr) {
+                    if (dr < best2) stack[top++] = std::make_pair(node.first + 1, dr);
+                    if (dl < best2) stack[top++] = std::make_pair(node.first, dl);
+                } else {
+                    if (dl < best2) stack[top++] = std::make_pair(node.first, dl);
+                    if (dr < best2) stack[top++] = std::make_pair(node.first + 1, dr);
+                }
+            }
+        }
+        return data;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void TriangleMeshBVH::nearest(const std::vector<vec3> &points, std::vector<NearestNeighbor> &results) const {
+        const int num = static_cast<int>(points.size());
+        results.resize(num);
+#pragma omp parallel for
+        for (int i = 0; i < num; ++i)
+            results[i] = nearest(points[i]);
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool TriangleMeshBVH::intersect(const vec3 &origin, const vec3 &dir, Intersection &hit, float t_max) const {
+        hit.t = t_max;
+        hit.face = SurfaceMesh::Face();
+        if (nodes_.empty())
+            return false;
+
+        const vec3 inv_dir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+        std::pair<uint32_t, float> stack[details::bvh_stack_size];
+        int top = 0;
+        const float t_root = details::ray_box(nodes_[0].bmin, nodes_[0].bmax, origin, inv_dir, hit.t);
+        if (t_root != FLT_MAX)
+            stack[top++] = std::make_pair(0u, t_root);
+
+        while (top > 0) {
+            const auto entry = stack[--top];
+            if (entry.second > hit.t)
+                continue;
+
+            const Node &node = nodes_[entry.first];
+            if (node.count > 0) {
+                float t;
+                for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                    const Triangle &tri = triangles_[i];
+                    if (details::ray_triangle(origin, dir, tri.x[0], tri.x[1], tri.x[2], hit.t, t)) {
+                        hit.t = t;
+                        hit.face = faces_[i];
+                    }
+                }
+            } else {
+                const Node &l = nodes_[node.first];
+                const Node &r = nodes_[node.first + 1];
+                const float tl = details::ray_box(l.bmin, l.bmax, origin, inv_dir, hit.t);
+                const float tr = details::ray_box(r.bmin, r.bmax, origin, inv_dir, hit.t);
+                if (tl <= tr) {
+                    if (tr != FLT_MAX) stack[top++] = std::make_pair(node.first + 1, tr);
+                    if (tl != FLT_MAX) stack[top++] = std::make_pair(node.first, tl);
+                } else {
+                    if (tl != FLT_MAX) stack[top++] = std::make_pair(node.first, tl);
+                    if (tr != FLT_MAX) stack[top++] = std::make_pair(node.first + 1, tr);
+                }
+            }
+        }
+
+        if (hit.face.is_valid()) {
+            hit.point = origin + dir * hit.t;
+            return true;
+        }
+        return false;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool TriangleMeshBVH::occluded(const vec3 &origin, const vec3 &dir, float t_max) const {
+        if (nodes_.empty())
+            return false;
+
+        const vec3 inv_dir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+        uint32_t stack[details::bvh_stack_size];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &node = nodes_[stack[--top]];
+            if (details::ray_box(node.bmin, node.bmax, origin, inv_dir, t_max) == FLT_MAX)
+                continue;
+
+            if (node.count > 0) {
+                float t;
+                for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                    const Triangle &tri = triangles_[i];
+                    if (details::ray_triangle(origin, dir, tri.x[0], tri.x[1], tri.x[2], t_max, t))
+                        return true;
+                }
+            } else {
+                stack[top++] = node.first + 1;
+                stack[top++] = node.first;
+            }
+        }
+        return false;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void TriangleMeshBVH::intersect(const vec3 *origins, const vec3 *dirs, int num, Intersection *hits,
+                                    float t_max) const {
+        assert(num <= max_packet_size);
+        for (int i = 0; i < num; ++i) {
+            hits[i].t = t_max;
+            hits[i].face = SurfaceMesh::Face();
+        }
+        if (nodes_.empty() || num <= 0)
+            return;
+
+        vec3 inv_dirs[max_packet_size];
+        for (int i = 0; i < num; ++i)
+            inv_dirs[i] = vec3(1.0f / dirs[i].x, 1.0f / dirs[i].y, 1.0f / dirs[i].z);
+
+        // the first ray in the packet that hits the node (later rays are tested only if it is not the first one)
+        auto first_active = [&](const Node &node) -> int {
+            for (int i = 0; i < num; ++i) {
+                if (details::ray_box(node.bmin, node.bmax, origins[i], inv_dirs[i], hits[i].t) != FLT_MAX)
+                    return i;
+            }
+            return -1;
+        };
+
+        uint32_t stack[details::bvh_stack_size];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &node = nodes_[stack[--top]];
+            const int first = first_active(node);
+            if (first < 0)
+                continue;
+
+            if (node.count > 0) {
+                float t;
+                for (uint32_t j = node.first; j < node.first + node.count; ++j) {
+                    const Triangle &tri = triangles_[j];
+                    for (int i = first; i < num; ++i) {
+                        if (details::ray_triangle(origins[i], dirs[i], tri.x[0], tri.x[1], tri.x[2], hits[i].t, t)) {
+                            hits[i].t = t;
+                            hits[i].face = faces_[j];
+                        }
+                    }
+                }
+            } else {
+                // visit first the child that is nearer for the first active ray
+                const Node &l = nodes_[node.first];
+                const Node &r = nodes_[node.first + 1];
+                const float tl = details::ray_box(l.bmin, l.bmax, origins[first], inv_dirs[first], hits[first].t);
+                const float tr = details::ray_box(r.bmin, r.bmax, origins[first], inv_dirs[first], hits[first].t);
+                if (tl <= tr) {
+                    stack[top++] = node.first + 1;
+                    stack[top++] = node.first;
+                } else {
+                    stack[top++] = node.first;
+                    stack[top++] = node.first + 1;
+                }
+            }
+        }
+
+        for (int i = 0; i < num; ++i) {
+            if (hits[i].face.is_valid())
+                hits[i].point = origins[i] + dirs[i] * hits[i].t;
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void TriangleMeshBVH::intersect(const std::vector<vec3> &origins, const std::vector<vec3> &dirs,
+                                    std::vector<Intersection> &hits, float t_max) const {
+        const int num = static_cast<int>(std::min(origins.size(), dirs.size()));
+        hits.resize(num);
+        const int num_packets = (num + max_packet_size - 1) / max_packet_size;
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < num_packets; ++i) {
+            const int begin = i * max_packet_size;
+            const int size = std::min(static_cast<int>(max_packet_size), num - begin);
+            intersect(origins.data() + begin, dirs.data() + begin, size, hits.data() + begin, t_max);
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void TriangleMeshBVH::overlap(const Box3 &box, std::vector<SurfaceMesh::Face> &faces) const {
+        faces.clear();
+        if (nodes_.empty())
+            return;
+
+        const vec3 center = box.center();
+        const vec3 half = (box.max_point() - box.min_point()) * 0.5f;
+        uint32_t stack[details::bvh_stack_size];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &node = nodes_[stack[--top]];
+            if (!details::boxes_overlap(node.bmin, node.bmax, box))
+                continue;
+
+            if (node.count > 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                    if (details::triangle_box_overlap(center, half, triangles_[i].x))
+                        faces.push_back(faces_[i]);
+                }
+            } else {
+                stack[top++] = node.first + 1;
+                stack[top++] = node.first;
+            }
+        }
+        details::remove_duplicates(faces);
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void TriangleMeshBVH::overlap(const vec3 &center, float radius, std::vector<SurfaceMesh::Face> &faces) const {
+        faces.clear();
+        if (nodes_.empty())
+            return;
+
+        const float r2 = radius * radius;
+        uint32_t stack[details::bvh_stack_size];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &node = nodes_[stack[--top]];
+            if (details::box_distance2(node.bmin, node.bmax, center) > r2)
+                continue;
+
+            if (node.count > 0) {
+                vec3 n;
+                for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                    const Triangle &t = triangles_[i];
+                    if (geom::dist_point_triangle(center, t.x[0], t.x[1], t.x[2], n) <= radius)
+                        faces.push_back(faces_[i]);
+                }
+            } else {
+                stack[top++] = node.first + 1;
+                stack[top++] = node.first;
+            }
+        }
+        details::remove_duplicates(faces);
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void TriangleMeshBVH::overlap(const std::vector<Box3> &boxes,
+                                  std::vector<std::vector<SurfaceMesh::Face> > &faces) const {
+        const int num = static_cast<int>(boxes.size());
+        faces.resize(num);
+#pragma omp parallel for
+        for (int i = 0; i < num; ++i)
+            overlap(boxes[i], faces[i]);
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void TriangleMeshBVH::overlap(const std::vector<vec3> &centers, const std::vector<float> &radii,
+                                  std::vector<std::vector<SurfaceMesh::Face> > &faces) const {
+        const int num = static_cast<int>(std::min(centers.size(), radii.size()));
+        faces.resize(num);
+#pragma omp parallel for
+        for (int i = 0; i < num; ++i)
+            overlap(centers[i], radii[i], faces[i]);
+    }
+
+} // namespace easy3d
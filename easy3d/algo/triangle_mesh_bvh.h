@@ -0,0 +1,202 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EASY3D_ALGO_TRIANGLE_MESH_BVH_H
+#define EASY3D_ALGO_TRIANGLE_MESH_BVH_H
+
+
+#include <easy3d/core/surface_mesh.h>
+#include <string>
+#include <vector>
+#include <limits>
+
+
+namespace easy3d {
+
+    /**
+     * \brief A bounding volume hierarchy (BVH) for the faces of a surface mesh.
+     * \class TriangleMeshBVH easy3d/algo/triangle_mesh_bvh.h
+     *
+     * \details The hierarchy is built using the surface area heuristic (SAH) with binning. Construction processes
+     * all nodes of the same level in parallel (with OpenMP if supported). The nodes and the triangles are stored in
+     * flat arrays, and the triangles are reordered such that each leaf references a contiguous range of them.
+     * Non-triangular faces are fan-triangulated internally, and all queries report the original face.
+     *
+     * The BVH supports the following queries (each one has a batch variant that runs in parallel):
+     *  - closest point on the surface to a query point;
+     *  - the first intersection of a ray with the surface, and testing if a ray segment is occluded;
+     *  - the faces overlapping an axis-aligned box or a sphere.
+     *
+     * The BVH does not keep a reference to the mesh. It has to be rebuilt if the mesh geometry changes.
+     */
+    class TriangleMeshBVH {
+    public:
+        /**
+         * \brief Builds the BVH for a surface mesh.
+         * @param mesh The surface mesh.
+         * @param max_leaf_size The number of triangles below which a node will not be split.
+         */
+        explicit TriangleMeshBVH(const SurfaceMesh *mesh, unsigned int max_leaf_size = 4);
+
+        /**
+         * \brief Constructs an empty BVH. This is useful for loading a previously saved BVH.
+         * \see load()
+         */
+        TriangleMeshBVH() = default;
+
+        ~TriangleMeshBVH() = default;
+
+        //! \brief nearest neighbor information
+        struct NearestNeighbor {
+            float dist;             //!< the distance to the query point
+            SurfaceMesh::Face face; //!< the face containing the closest point
+            vec3 nearest;           //!< the closest point
+            int tests;              //!< the number of point-triangle distance evaluations
+        };
+
+        //! \brief ray intersection information
+        struct Intersection {
+            float t;                //!< the ray parameter of the intersection point, i.e., origin + t * dir
+            SurfaceMesh::Face face; //!< the intersected face (invalid if there is no intersection)
+            vec3 point;             //!< the intersection point
+        };
+
+        /// \name Closest point queries
+        /// @{
+        //! \brief Returns the point on the surface closest to \p p.
+        NearestNeighbor nearest(const vec3 &p) const;
+        //! \brief Batch version of nearest(). The queries are processed in parallel.
+        void nearest(const std::vector<vec3> &points, std::vector<NearestNeighbor> &results) const;
+        /// @}
+
+        /// \name Ray queries
+        /// @{
+        /**
+         * \brief Computes the first intersection of a ray with the surface.
+         * @param origin The origin of the ray.
+         * @param dir The direction of the ray (not necessarily normalized).
+         * @param hit Returns the intersection (if any).
+         * @param t_max Only intersections with t in [0, t_max] are considered.
+         * @return true if an intersection exists.
+         */
+        bool intersect(const vec3 &origin, const vec3 &dir, Intersection &hit,
+                       float t_max = std::numeric_limits<float>::max()) const;
+
+        /**
+         * \brief Tests if the ray segment origin + t * dir, t in [0, t_max], intersects the surface. This is faster
+         *        than intersect() because the traversal stops at the first intersection found.
+         */
+        bool occluded(const vec3 &origin, const vec3 &dir, float t_max = std::numeric_limits<float>::max()) const;
+
+        /**
+         * \brief Computes the first intersections of a packet of rays, which are traversed together: a node is visited
+         *        if any of the rays hits its bounding box. This amortizes the traversal over the rays and pays off
+         *        for coherent rays, e.g., the rays through neighboring pixels.
+         * @param num The number of rays in the packet. It must not exceed \c max_packet_size.
+         * \details The faces of the missed rays are invalid (i.e., hits[i].face.is_valid() == false).
+         */
+        void intersect(const vec3 *origins, const vec3 *dirs, int num, Intersection *hits,
+                       float t_max = std::numeric_limits<float>::max()) const;
+
+        /**
+         * \brief Batch version of intersect(). Consecutive rays are grouped into packets, and the packets are
+         *        processed in parallel. So it is beneficial to provide the rays in a coherent order.
+         * \details The faces of the missed rays are invalid (i.e., hits[i].face.is_valid() == false).
+         */
+        void intersect(const std::vector<vec3> &origins, const std::vector<vec3> &dirs,
+                       std::vector<Intersection> &hits, float t_max = std::numeric_limits<float>::max()) const;
+
+        //! \brief The maximum number of rays in a packet.
+        static const int max_packet_size = 16;
+        /// @}
+
+        /// \name Overlap queries
+        /// @{
+        //! \brief Collects the faces overlapping the axis-aligned box \p box.
+        void overlap(const Box3 &box, std::vector<SurfaceMesh::Face> &faces) const;
+        //! \brief Collects the faces overlapping the sphere defined by its \p center and \p radius.
+        void overlap(const vec3 &center, float radius, std::vector<SurfaceMesh::Face> &faces) const;
+        //! \brief Batch version of overlap() for boxes. The queries are processed in parallel.
+        void overlap(const std::vector<Box3> &boxes, std::vector<std::vector<SurfaceMesh::Face> > &faces) const;
+        //! \brief Batch version of overlap() for spheres. The queries are processed in parallel.
+        void overlap(const std::vector<vec3> &centers, const std::vector<float> &radii,
+                     std::vector<std::vector<SurfaceMesh::Face> > &faces) const;
+        /// @}
+
+        /// \name Persistence
+        /// @{
+        /**
+         * \brief Saves the BVH into a binary (sidecar) file, such that later runs can load it instead of building it
+         *        again. The file also stores the number of vertices/faces and a hash value of the vertex coordinates
+         *        of the mesh, which are used to validate the file when it is loaded.
+         * @param file_name The file name, e.g., "bunny.ply.bvh".
+         * @param mesh The mesh for which the BVH was built.
+         * @return \c true on success.
+         */
+        bool save(const std::string &file_name, const SurfaceMesh *mesh) const;
+
+        /**
+         * \brief Loads a BVH previously saved by save().
+         * @param file_name The file name.
+         * @param mesh The mesh for which the BVH was built. It must not have been changed since then.
+         * @return \c false if the file doesn't exist, is corrupted, or was created for another mesh. In this case, the
+         *         BVH has to be built.
+         */
+        bool load(const std::string &file_name, const SurfaceMesh *mesh);
+        /// @}
+
+        //! \brief Returns the bounding box of the whole hierarchy.
+        Box3 bounding_box() const;
+        //! \brief Returns the number of nodes.
+        std::size_t n_nodes() const { return nodes_.size(); }
+        //! \brief Returns the number of triangles (after triangulating non-triangular faces).
+        std::size_t n_triangles() const { return triangles_.size(); }
+
+    private:
+        // A node is 32 bytes. An inner node has 'count == 0' and its children are stored at 'first' and
+        // 'first + 1'. A leaf references the triangles [first, first + count).
+        struct Node {
+            float bmin[3];
+            float bmax[3];
+            uint32_t first;
+            uint32_t count;
+        };
+
+        // The corners of a triangle
+        struct Triangle {
+            vec3 x[3];
+        };
+
+        void build(unsigned int max_leaf_size);
+
+    private:
+        std::vector<Node> nodes_;
+        std::vector<Triangle> triangles_;       // reordered such that leaves reference contiguous ranges
+        std::vector<SurfaceMesh::Face> faces_;  // the face of each triangle (same order as triangles_)
+    };
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_ALGO_TRIANGLE_MESH_BVH_H
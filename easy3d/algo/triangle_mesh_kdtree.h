@@ -34,6 +34,7 @@ namespace easy3d {
 
     //! \brief A k-d tree for triangular surface meshes.
     /// \class TriangleMeshKdTree easy3d/algo/triangle_mesh_kdtree.h
+    /// \deprecated Use TriangleMeshBVH instead, which is faster to build and query, and supports more queries.
     class TriangleMeshKdTree {
     public:
         //! \brief construct with mesh
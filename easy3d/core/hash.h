@@ -27,6 +27,7 @@
 
 
 #include <cstdint>
+#include <cstring>
 #include <functional>
 
 
@@ -116,6 +117,37 @@ namespace easy3d
         }
     }
 
+
+    /**
+     * \brief Computes the hash value of a block of memory, e.g., the coordinates of all points of a model.
+     * \details The data is processed 8 bytes at a time (mixed as in MurmurHash3), so it is fast enough for validating
+     * very large data sets, e.g., checking if a file cached for a point cloud is still valid.
+     */
+    inline uint64_t hash_bytes(const void *data, std::size_t size, uint64_t seed = 0) {
+        const auto mix = [](uint64_t k) -> uint64_t {
+            k ^= k >> 33;
+            k *= 0xff51afd7ed558ccdULL;
+            k ^= k >> 33;
+            k *= 0xc4ceb9fe1a85ec53ULL;
+            k ^= k >> 33;
+            return k;
+        };
+
+        const auto bytes = static_cast<const unsigned char *>(data);
+        uint64_t h = seed ^ (size * 0x9ddfea08eb382d69ULL);
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t k;
+            std::memcpy(&k, bytes + i, 8);
+            h = (h ^ mix(k)) * 0x9ddfea08eb382d69ULL;
+        }
+        uint64_t tail = 0;
+        for (std::size_t j = 0; i + j < size; ++j)
+            tail |= static_cast<uint64_t>(bytes[i + j]) << (8 * j);
+        h = (h ^ mix(tail)) * 0x9ddfea08eb382d69ULL;
+        return mix(h);
+    }
+
 } // namespace easy3d
 
 #endif  // EASY3D_CORE_HASH_H
\ No newline at end of file
@@ -47,6 +47,11 @@ namespace easy3d {
         /// \brief Returns the pointer of the camera.
         const Camera *camera() const { return camera_; }
 
+        /// \brief Returns whether picking is done in GPU (if supported).
+        bool use_gpu_if_supported() const { return use_gpu_if_supported_; }
+        /// \brief Sets whether picking is done in GPU (if supported). Disable it to pick without an OpenGL context.
+        void set_use_gpu_if_supported(bool b) { use_gpu_if_supported_ = b; }
+
         /**
          * \brief Construct a picking line.
          * @param x The cursor x-coordinate, relative to the left edge of the content area.
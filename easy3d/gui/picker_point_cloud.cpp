@@ -94,6 +94,8 @@ namespace easy3d {
         const vec3& p_near = line.point();
 
         float sqr_dist_thresh = static_cast<float>(hit_resolution_ * hit_resolution_);
+        const float win_width = static_cast<float>(camera()->screenWidth());
+        const float win_height = static_cast<float>(camera()->screenHeight());
         // Get combined model-view and projection matrix
         const mat4& MVP = camera()->modelViewProjectionMatrix();
         // transformation introduced by manipulation
@@ -109,8 +111,9 @@ namespace easy3d {
             float w = m[3] * p.x + m[7] * p.y + m[11] * p.z + m[15];
             x /= w;
             y /= w;
-            x = 0.5f * x + 0.5f;
-            y = 0.5f * y + 0.5f;
+            // to the screen coordinate system (origin in the upper left corner)
+            x = (0.5f * x + 0.5f) * win_width;
+            y = (0.5f - 0.5f * y) * win_height;
             if (distance2(vec2(x, y), vec2(px, py)) < sqr_dist_thresh) {
                 status[i] = 1;
                 sqr_dist_to_near[i] = distance2(p, p_near);
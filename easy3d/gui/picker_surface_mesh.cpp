@@ -24,6 +24,7 @@
 
 
 #include <easy3d/gui/picker_surface_mesh.h>
+#include <easy3d/algo/surface_mesh_ray_caster.h>
 #include <easy3d/renderer/renderer.h>
 #include <easy3d/renderer/shader_program.h>
 #include <easy3d/renderer/shader_manager.h>
@@ -39,12 +40,16 @@ namespace easy3d {
     SurfaceMeshPicker::SurfaceMeshPicker(const Camera *cam)
             : Picker(cam)
             , hit_resolution_(15)
+            , ray_caster_(nullptr)
+            , ray_caster_num_vertices_(0)
+            , ray_caster_num_faces_(0)
     {
         use_gpu_if_supported_ = true;
     }
 
 
     SurfaceMeshPicker::~SurfaceMeshPicker() {
+        delete ray_caster_;
     }
 
 
@@ -200,42 +205,37 @@ namespace easy3d {
     }
 
 
-    SurfaceMesh::Face SurfaceMeshPicker::pick_face_cpu(SurfaceMesh *model, int x, int y) {
-        int num = model->n_faces();
-        const vec3 &p_near = unproject(x, y, 0);
-        const vec3 &p_far = unproject(x, y, 1);
-        const OrientedLine3 oline(p_near, p_far);
-
-        std::vector<char> status(num, 0);
-#pragma omp parallel for
-        for (int i = 0; i < num; ++i) {
-            if (do_intersect(model, SurfaceMesh::Face(i), oline))
-                status[i] = 1;
+    const SurfaceMeshRayCaster* SurfaceMeshPicker::ray_caster(SurfaceMesh *model) {
+        const Box3 &box = model->bounding_box();
+        const bool changed = !ray_caster_ || ray_caster_->mesh() != model ||
+                             ray_caster_num_vertices_ != model->n_vertices() ||
+                             ray_caster_num_faces_ != model->n_faces() ||
+                             ray_caster_bbox_.min_point() != box.min_point() ||
+                             ray_caster_bbox_.max_point() != box.max_point();
+        if (changed) {
+            delete ray_caster_;
+            ray_caster_ = new SurfaceMeshRayCaster(model);
+            ray_caster_num_vertices_ = model->n_vertices();
+            ray_caster_num_faces_ = model->n_faces();
+            ray_caster_bbox_ = box;
         }
+        return ray_caster_;
+    }
 
-        picked_face_ = SurfaceMesh::Face();
-        double squared_distance = FLT_MAX;
-        const Line3 &line = picking_line(x, y);
-        for (int i = 0; i < num; ++i) {
-            if (status[i]) {
-                const SurfaceMesh::Face face(i);
-                const Plane3 plane = face_plane(model, face);
-
-                vec3 p;
-                if (plane.intersect(line, p)) {
-                    double s = distance2(p, p_near);
-                    if (s < squared_distance) {
-                        squared_distance = s;
-                        picked_face_ = face;
-                    }
-                } else {
-                    // If reached here, a parallel facet with distance less than hit resolution should be
-                    // the candidate. However, the picking line does not intersect the facet.
-                    // Logger::err(title()) << "should have intersection";
-                }
-            }
+
+    SurfaceMesh::Face SurfaceMeshPicker::pick_face_cpu(SurfaceMesh *model, int x, int y) {
+        // the picking line in the coordinate system of the model (i.e., undo the manipulation)
+        vec3 p_near = unproject(x, y, 0);
+        vec3 p_far = unproject(x, y, 1);
+        if (model->manipulator()) {
+            const mat4 inv_manip = inverse(model->manipulator()->matrix());
+            p_near = inv_manip * p_near;
+            p_far = inv_manip * p_far;
         }
 
+        SurfaceMeshRayCaster::Intersection hit;
+        ray_caster(model)->cast(p_near, p_far - p_near, hit, 1.0f);
+        picked_face_ = hit.face;
         return picked_face_;
     }
 
@@ -33,6 +33,7 @@
 namespace easy3d {
 
     class ShaderProgram;
+    class SurfaceMeshRayCaster;
 
     /**
      * \brief Implementation of picking elements (i.e, vertices, faces, edges) from a surface mesh.
@@ -157,34 +158,24 @@ namespace easy3d {
         // selection implemented in GPU (using shader program)
         SurfaceMesh::Face pick_face_gpu(SurfaceMesh *model, int x, int y, ShaderProgram* program);
 
-        // selection implemented in CPU (with OpenMP if supported)
+        // selection implemented in CPU (by casting a ray into the BVH of the model)
         SurfaceMesh::Face pick_face_cpu(SurfaceMesh *model, int x, int y);
 
-        Plane3 face_plane(SurfaceMesh *model, SurfaceMesh::Face face) const;
+        // returns the ray caster of the model. It is (re)built when the model is changed.
+        const SurfaceMeshRayCaster* ray_caster(SurfaceMesh *model);
 
-        /**
-         * TODO: check if this works also for non-convex faces.
-         */
-        inline bool do_intersect(SurfaceMesh *model, SurfaceMesh::Face picked_face, const OrientedLine3 &line) const {
-            // Uses Plucker coordinates (see OrientedLine)
-            Sign face_sign = ZERO;
-            for (auto h : model->halfedges(picked_face)) {
-                auto s = model->source(h);
-                auto t = model->target(h);
-                const OrientedLine3 edge_line(model->position(t), model->position(s));
-                Sign sign = OrientedLine3::side(line, edge_line);
-                if (sign != ZERO) {
-                    if (face_sign != ZERO && sign != face_sign)
-                        return false;
-                    face_sign = sign;
-                }
-            }
-            return true;
-        }
+        Plane3 face_plane(SurfaceMesh *model, SurfaceMesh::Face face) const;
 
     private:
         unsigned int hit_resolution_;     // in pixels
         SurfaceMesh::Face picked_face_;
+
+        // the ray caster is kept for the subsequent picks on the same model. A change of the model is detected by
+        // its number of vertices/faces and its bounding box (see Model::invalidate_bounding_box()).
+        SurfaceMeshRayCaster* ray_caster_;
+        std::size_t ray_caster_num_vertices_;
+        std::size_t ray_caster_num_faces_;
+        Box3 ray_caster_bbox_;
     };
 
 }
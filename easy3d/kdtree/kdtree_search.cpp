@@ -23,6 +23,10 @@
  */
 
 #include <easy3d/kdtree/kdtree_search.h>
+#include <easy3d/core/hash.h>
+#include <easy3d/util/logging.h>
+
+#include <cstring>
 
 
 namespace easy3d {
@@ -37,4 +41,60 @@ namespace easy3d {
     {
     }
 
+
+    bool KdTreeSearch::save(const std::string &file_name) const {
+        LOG(WARNING) << "this KdTree implementation does not support saving to a file";
+        return false;
+    }
+
+
+    bool KdTreeSearch::load(const std::string &file_name, PointCloud *cloud) {
+        LOG(WARNING) << "this KdTree implementation does not support loading from a file";
+        return false;
+    }
+
+
+    namespace details {
+        const uint32_t kdtree_file_version = 1;
+    }
+
+
+    bool KdTreeSearch::write_header(FILE *fp, const char *magic, const std::vector<vec3> &points) {
+        char tag[8] = {0};
+        std::strncpy(tag, magic, sizeof(tag));
+        const uint32_t version = details::kdtree_file_version;
+        const uint64_t num = points.size();
+        const uint64_t hash = hash_bytes(points.data(), points.size() * sizeof(vec3));
+        return fwrite(tag, sizeof(tag), 1, fp) == 1 &&
+               fwrite(&version, sizeof(version), 1, fp) == 1 &&
+               fwrite(&num, sizeof(num), 1, fp) == 1 &&
+               fwrite(&hash, sizeof(hash), 1, fp) == 1;
+    }
+
+
+    bool KdTreeSearch::check_header(FILE *fp, const char *magic, const std::vector<vec3> &points) {
+        char tag[8] = {0}, expected[8] = {0};
+        std::strncpy(expected, magic, sizeof(expected));
+        uint32_t version = 0;
+        uint64_t num = 0, hash = 0;
+        if (fread(tag, sizeof(tag), 1, fp) != 1 ||
+            fread(&version, sizeof(version), 1, fp) != 1 ||
+            fread(&num, sizeof(num), 1, fp) != 1 ||
+            fread(&hash, sizeof(hash), 1, fp) != 1) {
+            LOG(WARNING) << "failed reading the header of the KdTree file";
+            return false;
+        }
+
+        if (std::memcmp(tag, expected, sizeof(tag)) != 0 || version != details::kdtree_file_version) {
+            LOG(WARNING) << "not a KdTree file of this implementation (or version)";
+            return false;
+        }
+
+        if (num != points.size() || hash != hash_bytes(points.data(), points.size() * sizeof(vec3))) {
+            LOG(WARNING) << "the KdTree file was created for a different point cloud";
+            return false;
+        }
+        return true;
+    }
+
 } // namespace easy3d
@@ -27,6 +27,8 @@
 
 
 #include <vector>
+#include <string>
+#include <cstdio>
 #include <easy3d/core/types.h>
 
 
@@ -72,6 +74,9 @@ namespace easy3d {
      * --------------------------------------------------------------------------------------
      *\endcode
      *
+     * The numbers above are dated. To compare the implementations on your own machine and data, run the benchmark
+     * \c bench_kdtree_backends (in the \c test directory), which reports the results in CSV format.
+     *
      * \attention KdTreeSearch_FLANN and KdTreeSearch_NanoFLANN are thread-safe. Others seem not (not tested yet).
      */
 
@@ -166,6 +171,37 @@ namespace easy3d {
          */
         virtual void find_points_in_range(const vec3 &p, float squared_radius, std::vector<int> &neighbors) const = 0;
         /// @}
+
+        /// \name Persistence
+        /// @{
+
+        /**
+         * \brief Saves the KdTree into a binary (sidecar) file, such that later runs can load it instead of building
+         *        the KdTree again. The file also stores the number of points and a hash value of the point
+         *        coordinates, which are used to validate the file when it is loaded.
+         * \param file_name The file name, e.g., "bunny.ply.kdtree".
+         * \return \c true on success. The default implementation does not support persistence and returns \c false.
+         * \see load()
+         */
+        virtual bool save(const std::string &file_name) const;
+
+        /**
+         * \brief Loads a KdTree previously saved by save(). This replaces begin(), add_point_cloud(), and end().
+         * \param file_name The file name.
+         * \param cloud The point cloud for which the KdTree was built. It must not have been changed since then.
+         * \return \c false if the file doesn't exist, is corrupted, or was created for another point cloud. In this
+         *         case, the KdTree has to be built. The default implementation does not support persistence and
+         *         returns \c false.
+         * \see save()
+         */
+        virtual bool load(const std::string &file_name, PointCloud *cloud);
+        /// @}
+
+    protected:
+        // Writes/checks the header of a saved KdTree, which consists of a magic string (identifying the backend), a
+        // format version, the number of points, and a hash value of the points.
+        static bool write_header(FILE *fp, const char *magic, const std::vector<vec3> &points);
+        static bool check_header(FILE *fp, const char *magic, const std::vector<vec3> &points);
     };
 
 } // namespace easy3d
@@ -24,9 +24,19 @@
 
 #include <easy3d/kdtree/kdtree_search_nanoflann.h>
 #include <easy3d/core/point_cloud.h>
+#include <easy3d/util/logging.h>
 
 #include <3rd_party/kdtree/nanoflann/nanoflann.hpp>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define EASY3D_LEAF_SCAN_SSE
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define EASY3D_LEAF_SCAN_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
 
 using namespace nanoflann;
 
@@ -43,9 +53,7 @@ namespace easy3d {
         // Since this is inlined and the "dim" argument is typically an immediate value, the
         //  "if/else's" are actually solved at compile time.
         inline float kdtree_get_pt(const size_t idx, const size_t dim) const {
-            if (dim == 0) return pts->at(idx).x;
-            else if (dim == 1) return pts->at(idx).y;
-            else return pts->at(idx).z;
+            return (*pts)[idx][dim];
         }
 
         // Optional bounding-box computation: return false to default to a standard bbox computation loop.
@@ -56,13 +64,178 @@ namespace easy3d {
     };
 
 
+    namespace details {
+
+        // Computes the squared distances from the query point q to n points given in SoA layout. The terms are
+        // summed in the same order as nanoflann's L2_Simple_Adaptor (and no FMA is used), so all kernels give
+        // bit-identical results.
+        typedef void (*LeafScanKernel)(const float *x, const float *y, const float *z, std::size_t n,
+                                       const float *q, float *dist);
+
+        void leaf_scan_scalar(const float *x, const float *y, const float *z, std::size_t n,
+                              const float *q, float *dist) {
+            for (std::size_t i = 0; i < n; ++i) {
+                const float dx = q[0] - x[i];
+                const float dy = q[1] - y[i];
+                const float dz = q[2] - z[i];
+                dist[i] = dx * dx + dy * dy + dz * dz;
+            }
+        }
+
+#ifdef EASY3D_LEAF_SCAN_SSE
+        void leaf_scan_sse(const float *x, const float *y, const float *z, std::size_t n,
+                           const float *q, float *dist) {
+            const __m128 qx = _mm_set1_ps(q[0]);
+            const __m128 qy = _mm_set1_ps(q[1]);
+            const __m128 qz = _mm_set1_ps(q[2]);
+            // the arrays are padded, so the last (partial) vector can be processed as a whole
+            for (std::size_t i = 0; i < n; i += 4) {
+                const __m128 dx = _mm_sub_ps(qx, _mm_loadu_ps(x + i));
+                const __m128 dy = _mm_sub_ps(qy, _mm_loadu_ps(y + i));
+                const __m128 dz = _mm_sub_ps(qz, _mm_loadu_ps(z + i));
+                const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                _mm_storeu_ps(dist + i, d);
+            }
+        }
+#endif
+
+#ifdef EASY3D_LEAF_SCAN_AVX2
+        __attribute__((target("avx2")))
+        void leaf_scan_avx2(const float *x, const float *y, const float *z, std::size_t n,
+                            const float *q, float *dist) {
+            const __m256 qx = _mm256_set1_ps(q[0]);
+            const __m256 qy = _mm256_set1_ps(q[1]);
+            const __m256 qz = _mm256_set1_ps(q[2]);
+            // the arrays are padded, so the last (partial) vector can be processed as a whole
+            for (std::size_t i = 0; i < n; i += 8) {
+                const __m256 dx = _mm256_sub_ps(qx, _mm256_loadu_ps(x + i));
+                const __m256 dy = _mm256_sub_ps(qy, _mm256_loadu_ps(y + i));
+                const __m256 dz = _mm256_sub_ps(qz, _mm256_loadu_ps(z + i));
+                const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                               _mm256_mul_ps(dz, dz));
+                _mm256_storeu_ps(dist + i, d);
+            }
+        }
+#endif
+
+        // the kernels may read/write up to this number of floats beyond the end of the input/output
+        const std::size_t leaf_scan_padding = 8;
+
+        // the best kernel supported by the CPU, selected once at runtime
+        const char *best_leaf_scan_kernel(LeafScanKernel &kernel) {
+#ifdef EASY3D_LEAF_SCAN_AVX2
+            if (__builtin_cpu_supports("avx2")) {
+                kernel = leaf_scan_avx2;
+                return "avx2";
+            }
+#endif
+#ifdef EASY3D_LEAF_SCAN_SSE
+            kernel = leaf_scan_sse;
+            return "sse";
+#else
+            kernel = leaf_scan_scalar;
+            return "scalar";
+#endif
+        }
+
+        struct LeafScan {
+            LeafScan() : vectorized(true) { name = best_leaf_scan_kernel(best); }
+            LeafScanKernel kernel() const { return vectorized ? best : leaf_scan_scalar; }
+            const char *kernel_name() const { return vectorized ? name : "scalar"; }
+
+            LeafScanKernel best;
+            const char *name;
+            bool vectorized;
+        };
+
+        LeafScan &leaf_scan() {
+            static LeafScan scan;
+            return scan;
+        }
+    }
+
+
     struct KdTree : public KDTreeSingleIndexAdaptor< L2_Simple_Adaptor<float, PointSet>, PointSet, 3 > {
-        KdTree(PointSet* pset) : KDTreeSingleIndexAdaptor< L2_Simple_Adaptor<float, PointSet>, PointSet, 3 >(3, *pset, KDTreeSingleIndexAdaptorParams(10)){
+        KdTree(PointSet* pset, int leaf_size) : KDTreeSingleIndexAdaptor< L2_Simple_Adaptor<float, PointSet>, PointSet, 3 >(3, *pset, KDTreeSingleIndexAdaptorParams(leaf_size)){
             pset_ = pset;
         }
         ~KdTree() { delete pset_; }
 
+        // Copies the points into SoA arrays in the order of the leaves (i.e., vind), such that the points of a
+        // leaf are contiguous in memory and can be scanned with SIMD instructions.
+        void prepare_leaves() {
+            const std::vector<vec3>& points = *pset_->pts;
+            const std::size_t num = vind.size();
+            xs_.assign(num + details::leaf_scan_padding, 0.0f);
+            ys_.assign(num + details::leaf_scan_padding, 0.0f);
+            zs_.assign(num + details::leaf_scan_padding, 0.0f);
+            for (std::size_t i = 0; i < num; ++i) {
+                const vec3& p = points[vind[i]];
+                xs_[i] = p.x;
+                ys_[i] = p.y;
+                zs_[i] = p.z;
+            }
+        }
+
+        // Same as nanoflann's findNeighbors() (with eps = 0), but uses the vectorized leaf scan.
+        template <class RESULTSET>
+        void search(RESULTSET& result, const float* query) const {
+            distance_vector_t dists;
+            assign(dists, 3, 0.0f);
+            const float distsq = computeInitialDistances(*this, query, dists);
+            search_level(result, query, root_node, distsq, dists, details::leaf_scan().kernel());
+        }
+
+        template <class RESULTSET>
+        void search_level(RESULTSET& result, const float* query, const NodePtr node, float mindistsq,
+                          distance_vector_t& dists, details::LeafScanKernel kernel) const {
+            if ((node->child1 == nullptr) && (node->child2 == nullptr)) {
+                const std::size_t left = node->node_type.lr.left;
+                const std::size_t right = node->node_type.lr.right;
+                // the leaf is processed in chunks (leaves are usually much smaller than a chunk)
+                const std::size_t chunk = 64;
+                float buffer[chunk + details::leaf_scan_padding];
+                for (std::size_t first = left; first < right; first += chunk) {
+                    const std::size_t n = std::min(chunk, right - first);
+                    kernel(&xs_[first], &ys_[first], &zs_[first], n, query, buffer);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        if (buffer[i] < result.worstDist())
+                            result.addPoint(buffer[i], vind[first + i]);
+                    }
+                }
+                return;
+            }
+
+            // which child branch should be taken first?
+            const int idx = node->node_type.sub.divfeat;
+            const float val = query[idx];
+            const float diff1 = val - node->node_type.sub.divlow;
+            const float diff2 = val - node->node_type.sub.divhigh;
+
+            NodePtr best_child, other_child;
+            float cut_dist;
+            if ((diff1 + diff2) < 0) {
+                best_child = node->child1;
+                other_child = node->child2;
+                cut_dist = distance.accum_dist(val, node->node_type.sub.divhigh, idx);
+            } else {
+                best_child = node->child2;
+                other_child = node->child1;
+                cut_dist = distance.accum_dist(val, node->node_type.sub.divlow, idx);
+            }
+
+            search_level(result, query, best_child, mindistsq, dists, kernel);
+
+            const float dst = dists[idx];
+            mindistsq = mindistsq + cut_dist - dst;
+            dists[idx] = cut_dist;
+            if (mindistsq <= result.worstDist())
+                search_level(result, query, other_child, mindistsq, dists, kernel);
+            dists[idx] = dst;
+        }
+
         PointSet* pset_;
+        std::vector<float> xs_, ys_, zs_;   // the points in leaf order
     };
 
     #define get_tree(x) (reinterpret_cast<const KdTree *>(x))
@@ -72,6 +245,7 @@ namespace easy3d {
     KdTreeSearch_NanoFLANN::KdTreeSearch_NanoFLANN() {
         points_ = nullptr;
         tree_ = nullptr;
+        leaf_size_ = 10;
     }
 
 
@@ -88,24 +262,97 @@ namespace easy3d {
 
     void KdTreeSearch_NanoFLANN::end() {
         PointSet* pset = new PointSet(points_);
-        KdTree* tree = new KdTree(pset);
+        KdTree* tree = new KdTree(pset, leaf_size_);
         tree->buildIndex();
+        tree->prepare_leaves();
         tree_ = tree;
     }
 
 
+    void KdTreeSearch_NanoFLANN::set_leaf_size(int size) {
+        if (size < 1) {
+            LOG(WARNING) << "invalid leaf size (" << size << "), must be positive";
+            return;
+        }
+        if (tree_)
+            LOG(WARNING) << "leaf size will take effect only after the KdTree is rebuilt";
+        leaf_size_ = size;
+    }
+
+
+    const char* KdTreeSearch_NanoFLANN::leaf_scan_kernel() {
+        return details::leaf_scan().kernel_name();
+    }
+
+
+    void KdTreeSearch_NanoFLANN::set_vectorized_leaf_scan(bool b) {
+        details::leaf_scan().vectorized = b;
+    }
+
+
     void KdTreeSearch_NanoFLANN::add_point_cloud(PointCloud* cloud) {
         points_ = &cloud->points();
     }
 
 
+    bool KdTreeSearch_NanoFLANN::save(const std::string &file_name) const {
+        if (!tree_ || !points_) {
+            LOG(ERROR) << "the KdTree has not been built yet";
+            return false;
+        }
+
+        FILE* fp = fopen(file_name.c_str(), "wb");
+        if (!fp) {
+            LOG(ERROR) << "could not open file: " << file_name;
+            return false;
+        }
+
+        bool success = write_header(fp, "nanoflnn", *points_);
+        if (success)
+            const_cast<KdTree*>(get_tree(tree_))->saveIndex(fp);
+        success = success && !ferror(fp);
+        fclose(fp);
+        if (!success)
+            LOG(ERROR) << "failed writing KdTree to file: " << file_name;
+        return success;
+    }
+
+
+    bool KdTreeSearch_NanoFLANN::load(const std::string &file_name, PointCloud *cloud) {
+        begin();
+        add_point_cloud(cloud);
+
+        FILE* fp = fopen(file_name.c_str(), "rb");
+        if (!fp)
+            return false;
+
+        bool success = check_header(fp, "nanoflnn", *points_);
+        if (success) {
+            KdTree* tree = new KdTree(new PointSet(points_), leaf_size_);
+            try {
+                tree->loadIndex(fp);
+                tree->prepare_leaves();
+                leaf_size_ = static_cast<int>(tree->m_leaf_max_size);
+                tree_ = tree;
+            }
+            catch (const std::exception& e) {
+                LOG(WARNING) << "failed loading KdTree from file: " << e.what();
+                delete tree;
+                success = false;
+            }
+        }
+        fclose(fp);
+        return success;
+    }
+
+
     int KdTreeSearch_NanoFLANN::find_closest_point(const vec3& p, float& squared_distance) const {
         std::size_t index;
 
         nanoflann::KNNResultSet<float> result_set(1);
         result_set.init(&index, &squared_distance);
 
-        get_tree(tree_)->findNeighbors(result_set, p, nanoflann::SearchParams(10));
+        get_tree(tree_)->search(result_set, p);
         return index;
     }
 
@@ -120,15 +367,17 @@ namespace easy3d {
         const vec3& p, int k, std::vector<int>& neighbors, std::vector<float>& squared_distances
     )  const
     {
-        std::vector<size_t> indices(k);
-        std::vector<float>	sqr_distances(k);
+        // the results are written to the output directly, so repeated queries with the same vectors don't allocate
+        neighbors.resize(k);
+        squared_distances.resize(k);
 
-        nanoflann::KNNResultSet<float> result_set(k);
-        result_set.init(&indices[0], &sqr_distances[0]);
-        get_tree(tree_)->findNeighbors(result_set, p, nanoflann::SearchParams(10));
+        nanoflann::KNNResultSet<float, int> result_set(k);
+        result_set.init(neighbors.data(), squared_distances.data());
+        get_tree(tree_)->search(result_set, p);
 
-        neighbors = std::vector<int>(indices.begin(), indices.end());
-        squared_distances = sqr_distances;
+        // fewer than k points
+        neighbors.resize(result_set.size());
+        squared_distances.resize(result_set.size());
     }
 
 
@@ -136,7 +385,7 @@ namespace easy3d {
         const vec3& p, int k, std::vector<int>& neighbors
     )  const
     {
-        std::vector<float> squared_distances;
+        static thread_local std::vector<float> squared_distances;
         return find_closest_k_points(p, k, neighbors, squared_distances);
     }
 
@@ -145,9 +394,9 @@ namespace easy3d {
         const vec3& p, float squared_radius, std::vector<int>& neighbors, std::vector<float>& squared_distances
     )  const {
         std::vector<std::pair<std::size_t, float> >   matches;
-        nanoflann::SearchParams params;
-        params.sorted = false;
-        const std::size_t num = get_tree(tree_)->radiusSearch(p, squared_radius, matches, params);
+        nanoflann::RadiusResultSet<float, std::size_t> result_set(squared_radius, matches);
+        get_tree(tree_)->search(result_set, p);
+        const std::size_t num = matches.size();
 
         neighbors.resize(num);
         squared_distances.resize(num);
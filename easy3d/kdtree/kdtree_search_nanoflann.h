@@ -60,6 +60,30 @@ namespace easy3d {
         virtual void end();
         /// @}
 
+        /// \name Tuning
+        /// @{
+        /**
+         * \brief Sets the maximum number of points in a leaf node (default is 10). It must be called before end().
+         * \details Larger leaves make the tree smaller and faster to build, and the leaves are scanned with SIMD
+         *      instructions, so a larger leaf size often pays off for larger K. The best value depends on the data
+         *      and the queries (see the benchmark in the \c test directory).
+         */
+        void set_leaf_size(int size);
+        /// \brief Returns the maximum number of points in a leaf node.
+        int leaf_size() const { return leaf_size_; }
+
+        /**
+         * \brief Returns the name of the kernel used for scanning the points in the leaf nodes, i.e., "avx2",
+         *      "sse", or "scalar". The best kernel supported by the CPU is selected at runtime.
+         */
+        static const char* leaf_scan_kernel();
+        /**
+         * \brief Enables/Disables the vectorized leaf scan (enabled by default). If disabled, the scalar kernel is
+         *      used. All kernels give identical results, so this is only useful for benchmarking.
+         */
+        static void set_vectorized_leaf_scan(bool b);
+        /// @}
+
         /// \name Closest point query
         /// @{
 
@@ -138,9 +162,26 @@ namespace easy3d {
         ) const;
         /// @}
 
+        /// \name Persistence
+        /// @{
+
+        /**
+         * \brief Saves the KdTree into a binary (sidecar) file. The points are not stored.
+         * \see KdTreeSearch::save()
+         */
+        virtual bool save(const std::string &file_name) const;
+
+        /**
+         * \brief Loads a KdTree previously saved by save().
+         * \see KdTreeSearch::load()
+         */
+        virtual bool load(const std::string &file_name, PointCloud *cloud);
+        /// @}
+
     protected:
         std::vector<vec3> *points_; // reference of the original point cloud data
         void *tree_;
+        int leaf_size_;
     };
 
 } // namespace easy3d
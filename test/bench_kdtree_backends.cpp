@@ -0,0 +1,254 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/kdtree/kdtree_search_ann.h>
+#include <easy3d/kdtree/kdtree_search_eth.h>
+#include <easy3d/kdtree/kdtree_search_flann.h>
+#include <easy3d/kdtree/kdtree_search_nanoflann.h>
+#include <easy3d/util/stop_watch.h>
+
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <thread>
+#include <cstdlib>
+#include <cmath>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <malloc.h>
+#endif
+
+using namespace easy3d;
+
+// Benchmark of all KdTreeSearch backends on synthetic point clouds. For each cloud and backend, it measures the build
+// time, the memory consumed by the tree, and the kNN/radius queries per second using 1, 2, 4, ... threads. The
+// results are written in CSV format (one row per cloud/backend/number of threads).
+// Usage: bench_kdtree_backends [num_points] [output.csv]
+// To benchmark a new index, add it to the list of backends in main().
+
+namespace {
+
+    const int num_queries = 100000;
+    const int k = 16;
+
+    struct Backend {
+        std::string name;
+        std::function<KdTreeSearch *()> create;
+        bool thread_safe; // only thread-safe backends are tested with multiple threads
+    };
+
+
+    // memory in use by the process in MB: the heap in use with glibc >= 2.33 (accurate), or the resident memory on
+    // other Linux systems (only a rough estimate). Returns -1 if it is not available.
+    double memory_in_use_mb() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        const struct mallinfo2 info = mallinfo2();
+        return static_cast<double>(info.uordblks + info.hblkhd) / (1024.0 * 1024.0);
+#elif defined(__linux__)
+        std::ifstream input("/proc/self/statm");
+        long pages = 0, resident = 0;
+        if (input >> pages >> resident)
+            return resident * (sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0));
+#endif
+        return -1.0;
+    }
+
+
+    // points uniformly distributed in the unit cube
+    PointCloud *uniform_cloud(int num, std::mt19937 &rng) {
+        std::uniform_real_distribution<float> u(0.0f, 1.0f);
+        auto cloud = new PointCloud;
+        for (int i = 0; i < num; ++i)
+            cloud->add_vertex(vec3(u(rng), u(rng), u(rng)));
+        return cloud;
+    }
+
+
+    // points in 50 Gaussian clusters of different sizes
+    PointCloud *clustered_cloud(int num, std::mt19937 &rng) {
+        std::uniform_real_distribution<float> u(0.0f, 1.0f);
+        std::normal_distribution<float> g(0.0f, 1.0f);
+        std::vector<vec3> centers(50);
+        std::vector<float> sigmas(centers.size());
+        for (std::size_t i = 0; i < centers.size(); ++i) {
+            centers[i] = vec3(u(rng), u(rng), u(rng));
+            sigmas[i] = 0.005f + 0.03f * u(rng);
+        }
+        auto cloud = new PointCloud;
+        for (int i = 0; i < num; ++i) {
+            const std::size_t c = rng() % centers.size();
+            cloud->add_vertex(centers[c] + sigmas[c] * vec3(g(rng), g(rng), g(rng)));
+        }
+        return cloud;
+    }
+
+
+    // a terrestrial scan of a street: ground and two facades seen from a scanner at the origin, so the density
+    // decreases with the distance to the scanner
+    PointCloud *planar_scan_cloud(int num, std::mt19937 &rng) {
+        std::uniform_real_distribution<float> u(0.0f, 1.0f);
+        std::normal_distribution<float> noise(0.0f, 0.002f);
+        auto cloud = new PointCloud;
+        for (int i = 0; i < num; ++i) {
+            const float along = 20.0f * (u(rng) - 0.5f) * u(rng);   // denser close to the scanner
+            const int plane = static_cast<int>(rng() % 3);
+            vec3 p;
+            if (plane == 0)     // ground
+                p = vec3(along, 8.0f * (u(rng) - 0.5f), -1.8f);
+            else                // facades
+                p = vec3(along, plane == 1 ? -4.0f : 4.0f, -1.8f + 10.0f * u(rng) * u(rng));
+            cloud->add_vertex(p + vec3(noise(rng), noise(rng), noise(rng)));
+        }
+        return cloud;
+    }
+
+
+    // runs func(begin, end) on the range [0, num) split into num_threads parts
+    void parallel_run(int num, int num_threads, const std::function<void(int, int)> &func) {
+        std::vector<std::thread> threads;
+        const int chunk = (num + num_threads - 1) / num_threads;
+        for (int t = 0; t < num_threads; ++t) {
+            const int begin = t * chunk;
+            const int end = std::min(num, begin + chunk);
+            threads.emplace_back(func, begin, end);
+        }
+        for (auto &t : threads)
+            t.join();
+    }
+
+}
+
+
+int main(int argc, char **argv) {
+    const int num_points = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    std::ofstream file;
+    if (argc > 2)
+        file.open(argv[2]);
+    std::ostream &output = file.is_open() ? file : std::cout;
+
+    const std::vector<Backend> backends = {
+            {"ANN",       [] { return new KdTreeSearch_ANN; },       false},
+            {"ETH",       [] { return new KdTreeSearch_ETH; },       false},
+            {"FLANN",     [] { return new KdTreeSearch_FLANN; },     true},
+            {"NanoFLANN", [] { return new KdTreeSearch_NanoFLANN; }, true},
+    };
+
+    const std::vector<std::pair<std::string, std::function<PointCloud *(int, std::mt19937 &)> > > clouds = {
+            {"uniform",     uniform_cloud},
+            {"clustered",   clustered_cloud},
+            {"planar_scan", planar_scan_cloud}
+    };
+
+    std::vector<int> thread_counts = {1};
+    const int max_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    while (thread_counts.back() * 2 <= max_threads)
+        thread_counts.push_back(thread_counts.back() * 2);
+    if (thread_counts.back() != max_threads)
+        thread_counts.push_back(max_threads);
+
+    output << "cloud,num_points,backend,threads,build_seconds,memory_mb,k,knn_queries_per_second,"
+              "radius,avg_radius_neighbors,radius_queries_per_second" << std::endl;
+
+    for (const auto &c : clouds) {
+        std::mt19937 rng(42);   // fixed seed, so the runs are reproducible
+        PointCloud *cloud = c.second(num_points, rng);
+        const std::vector<vec3> &points = cloud->points();
+
+        // the queries: points of the cloud with a small offset
+        std::vector<vec3> queries(num_queries);
+        for (int i = 0; i < num_queries; ++i)
+            queries[i] = points[rng() % points.size()] + vec3(1e-4f, -1e-4f, 1e-4f);
+
+        // the radius is chosen such that a query has about K neighbors on average
+        float radius = 0.0f;
+        {
+            KdTreeSearch_NanoFLANN kdtree;
+            kdtree.begin();
+            kdtree.add_point_cloud(cloud);
+            kdtree.end();
+            std::vector<int> neighbors;
+            std::vector<float> squared_distances;
+            double sum = 0.0;
+            for (int i = 0; i < 1000; ++i) {
+                kdtree.find_closest_k_points(queries[i], k, neighbors, squared_distances);
+                sum += std::sqrt(squared_distances.back());
+            }
+            radius = static_cast<float>(sum / 1000);
+        }
+        std::cerr << c.first << ": " << points.size() << " points, radius " << radius << std::endl;
+
+        for (const auto &b : backends) {
+            const double memory_before = memory_in_use_mb();
+            StopWatch w;
+            KdTreeSearch *kdtree = b.create();
+            kdtree->begin();
+            kdtree->add_point_cloud(cloud);
+            kdtree->end();
+            const double build_time = w.elapsed_seconds(6);
+            const double memory = memory_before < 0 ? -1.0 : memory_in_use_mb() - memory_before;
+
+            for (int num_threads : thread_counts) {
+                if (num_threads > 1 && !b.thread_safe)
+                    break;
+
+                w.restart();
+                parallel_run(num_queries, num_threads, [&](int begin, int end) {
+                    std::vector<int> neighbors;
+                    for (int i = begin; i < end; ++i)
+                        kdtree->find_closest_k_points(queries[i], k, neighbors);
+                });
+                const double knn_qps = num_queries / std::max(w.elapsed_seconds(6), 1e-6);
+
+                std::vector<std::size_t> counts(num_threads, 0);
+                w.restart();
+                parallel_run(num_queries, num_threads, [&](int begin, int end) {
+                    std::vector<int> neighbors;
+                    std::size_t count = 0;
+                    for (int i = begin; i < end; ++i) {
+                        kdtree->find_points_in_range(queries[i], radius * radius, neighbors);
+                        count += neighbors.size();
+                    }
+                    counts[begin / ((num_queries + num_threads - 1) / num_threads)] = count;
+                });
+                const double radius_qps = num_queries / std::max(w.elapsed_seconds(6), 1e-6);
+                std::size_t total = 0;
+                for (auto n : counts)
+                    total += n;
+
+                output << c.first << "," << points.size() << "," << b.name << "," << num_threads << ","
+                       << build_time << "," << memory << "," << k << "," << knn_qps << ","
+                       << radius << "," << double(total) / num_queries << "," << radius_qps << std::endl;
+                std::cerr << "    " << b.name << " (" << num_threads << " threads) done" << std::endl;
+            }
+            delete kdtree;
+        }
+        delete cloud;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/core/random.h>
+#include <easy3d/kdtree/kdtree_search_nanoflann.h>
+#include <easy3d/util/stop_watch.h>
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+
+
+using namespace easy3d;
+
+// Micro-benchmark of the kNN queries of KdTreeSearch_NanoFLANN: queries/second by K and leaf size, using the
+// scalar and the vectorized leaf scan.
+// Usage: bench_kdtree_leaf_scan [num_points] [num_queries]
+
+// a dense "scan": a wavy surface sampled with a bit of noise
+PointCloud *dense_scan(int num) {
+    auto cloud = new PointCloud;
+    for (int i = 0; i < num; ++i) {
+        const float x = random_float();
+        const float y = random_float();
+        const float z = 0.05f * std::sin(20.0f * x) * std::cos(15.0f * y) + 0.001f * random_float();
+        cloud->add_vertex(vec3(x, y, z));
+    }
+    return cloud;
+}
+
+
+int main(int argc, char **argv) {
+    const int num_points = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    const int num_queries = argc > 2 ? std::atoi(argv[2]) : 200000;
+
+    PointCloud *cloud = dense_scan(num_points);
+    const std::vector<vec3> &points = cloud->points();
+
+    std::vector<vec3> queries(num_queries);
+    for (int i = 0; i < num_queries; ++i)
+        queries[i] = points[std::rand() % num_points] + vec3(0.001f, 0.001f, 0.001f) * random_float();
+
+    std::cout << "points: " << num_points << ", queries: " << num_queries
+              << ", vectorized kernel: " << KdTreeSearch_NanoFLANN::leaf_scan_kernel() << std::endl;
+    std::cout << std::setw(10) << "leaf_size" << std::setw(6) << "k"
+              << std::setw(16) << "scalar (q/s)" << std::setw(16) << "simd (q/s)" << std::setw(10) << "speedup"
+              << std::endl;
+
+    const int leaf_sizes[] = {4, 10, 16, 32, 64};
+    const int ks[] = {1, 6, 16, 32, 64};
+    for (int leaf_size : leaf_sizes) {
+        KdTreeSearch_NanoFLANN kdtree;
+        kdtree.set_leaf_size(leaf_size);
+        kdtree.begin();
+        kdtree.add_point_cloud(cloud);
+        kdtree.end();
+
+        for (int k : ks) {
+            // the kernels are run alternately and the best of several runs is reported
+            double qps[2] = {0.0, 0.0};
+            for (int run = 0; run < 3; ++run) {
+                for (int vectorized = 0; vectorized < 2; ++vectorized) {
+                    KdTreeSearch_NanoFLANN::set_vectorized_leaf_scan(vectorized != 0);
+                    std::vector<int> neighbors;
+                    std::vector<float> squared_distances;
+                    std::size_t checksum = 0; // prevents the queries from being optimized away
+                    StopWatch w;
+                    for (const auto &q : queries) {
+                        kdtree.find_closest_k_points(q, k, neighbors, squared_distances);
+                        checksum += neighbors[0];
+                    }
+                    qps[vectorized] = std::max(qps[vectorized], num_queries / std::max(w.elapsed_seconds(6), 1e-6));
+                    if (checksum == std::size_t(-1))
+                        std::cout << checksum;
+                }
+            }
+            std::cout << std::setw(10) << leaf_size << std::setw(6) << k
+                      << std::setw(16) << std::fixed << std::setprecision(0) << qps[0]
+                      << std::setw(16) << qps[1]
+                      << std::setw(10) << std::setprecision(2) << qps[1] / qps[0] << std::endl;
+        }
+    }
+    KdTreeSearch_NanoFLANN::set_vectorized_leaf_scan(true);
+
+    delete cloud;
+    return EXIT_SUCCESS;
+}